@@ -23,6 +23,7 @@ using namespace vmath;
 /*--- Program Headers ---*/
 #include "ogl.h"
 #include "load.h"
+#include "texture.h"
 #include <jni.h>
 
 /*--- Macro definitions ---*/
@@ -45,6 +46,15 @@ enum {
  */
 GLuint loadGLTexture(const char *filename);
 
+/**
+ * @brief Load baked ETC2 texture (see texture.h) into memory
+ *
+ * @param filename [in]  - baked texture file name
+ *
+ * @returns texture id, 0 if the file is missing or invalid
+ */
+GLuint loadGLCompressedTexture(const char *filename);
+
 /**
  * @brief Print OpenGL Driver information
  */
@@ -341,28 +351,40 @@ int initialize() {
     /* Reset Projection Matrix */
     projectionMatrix = mat4::identity();
 
-    /* Load Textures */
-    textureDiffuse = loadGLTexture("day.jpg");
+    /* Load Textures, baked ETC2 when present else decode source images */
+    textureDiffuse = loadGLCompressedTexture("day.ctex");
+    if (0U == textureDiffuse) {
+        textureDiffuse = loadGLTexture("day.jpg");
+    }
     if (0U == textureDiffuse) {
         fprintf(gpFile, "Failed to load diffuse texture\n");
         return -1;
     }
 
-    textureNormal = loadGLTexture("normal.png");
-    if (0U == textureDiffuse) {
-        fprintf(gpFile, "Failed to load diffuse texture\n");
+    textureNormal = loadGLCompressedTexture("normal.ctex");
+    if (0U == textureNormal) {
+        textureNormal = loadGLTexture("normal.png");
+    }
+    if (0U == textureNormal) {
+        fprintf(gpFile, "Failed to load normal texture\n");
         return -1;
     }
 
-    textureSpecular = loadGLTexture("specular.png");
-    if (0U == textureDiffuse) {
-        fprintf(gpFile, "Failed to load diffuse texture\n");
+    textureSpecular = loadGLCompressedTexture("specular.ctex");
+    if (0U == textureSpecular) {
+        textureSpecular = loadGLTexture("specular.png");
+    }
+    if (0U == textureSpecular) {
+        fprintf(gpFile, "Failed to load specular texture\n");
         return -1;
     }
 
-    textureClouds = loadGLTexture("clouds.jpg");
-    if (0U == textureDiffuse) {
-        fprintf(gpFile, "Failed to load diffuse texture\n");
+    textureClouds = loadGLCompressedTexture("clouds.ctex");
+    if (0U == textureClouds) {
+        textureClouds = loadGLTexture("clouds.jpg");
+    }
+    if (0U == textureClouds) {
+        fprintf(gpFile, "Failed to load clouds texture\n");
         return -1;
     }
 
@@ -646,4 +668,53 @@ GLuint loadGLTexture(const char *filename) {
         fprintf(gpFile, "Texture loaded %s, nChannels %d\n", filename, nChannels);
     }
     return texture;
-}
\ No newline at end of file
+}
+
+GLuint loadGLCompressedTexture(const char *filename) {
+    Texture data = {};
+    GLuint texture = 0U;
+
+    sprintf(modelName, "%s/%s", filesDirectory, filename);
+    if (0 != loadTexture(&data, modelName)) {
+        fprintf(gpFile, "Baked texture %s not available\n", modelName);
+        return 0U;
+    }
+
+    // GLES 3.x guarantees ETC2 only, loadTexture() already checked the level sizes against the data
+    if (TEXTURE_FORMAT_ETC2 != data.header.format) {
+        fprintf(gpFile, "Error : unsupported compressed format 0x%X in %s\n", data.header.format,
+                filename);
+        unloadTexture(&data);
+        return 0U;
+    }
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // set up texture parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) data.header.nLevels - 1);
+
+    // push every precomputed level, no glGenerateMipmap required
+    for (uint32_t level = 0U; level < data.header.nLevels; ++level) {
+        const TextureLevel *pLevel = &data.levels[level];
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint) level, (GLenum) data.header.format,
+                               (GLsizei) pLevel->width, (GLsizei) pLevel->height, 0,
+                               (GLsizei) pLevel->size, data.pData + pLevel->offset);
+    }
+
+    if (GL_NO_ERROR != glGetError()) {
+        fprintf(gpFile, "Error : GPU rejected compressed format 0x%X of %s\n", data.header.format,
+                filename);
+        glDeleteTextures(1, &texture);
+        texture = 0U;
+    } else {
+        fprintf(gpFile, "Texture loaded %s, format 0x%X, %u levels\n", filename,
+                data.header.format, data.header.nLevels);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    unloadTexture(&data);
+    return texture;
+}
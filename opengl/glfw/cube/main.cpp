@@ -22,6 +22,13 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/fwd.hpp>
 #include "shader.h"
+#include "shaderreload.h"
+
+/* worker window only carries the context of the shader reload thread */
+static void makeWorkerCurrent(void* pUserData, bool bCurrent)
+{
+    glfwMakeContextCurrent(bCurrent ? (GLFWwindow*)pUserData : NULL);
+}
 
 int main(void)
 {
@@ -34,6 +41,10 @@ int main(void)
     GLuint colorBuffer   = 0;
     GLint result          = GL_FALSE;
     GLuint program        = -1;
+    GLFWwindow* worker    = nullptr;
+    ShaderReload reload;
+    int programIndex      = -1;
+    uint32_t generation   = 0U;
 
     // Initialise GLFW
     if (!glfwInit())
@@ -58,6 +69,10 @@ int main(void)
     }
     glfwMakeContextCurrent(window);
 
+    // Hidden window sharing objects with the main one, shaders are rebuilt in its context
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    worker = glfwCreateWindow(1, 1, "", NULL, window);
+
     // Initialize GLEW
     glewExperimental = true; // Needed for core profile
     if (glewInit() != GLEW_OK)
@@ -86,6 +101,14 @@ int main(void)
         return -1;
     }
 
+    // Rebuild the program in the background when the glsl files are saved
+    if (0 != shaderReloadInitialize(&reload, (NULL != worker) ? makeWorkerCurrent : NULL, worker) ||
+        0 > (programIndex = shaderReloadAdd(&reload, "vertex.glsl", "fragment.glsl", program)))
+    {
+        std::cerr << "Shader reload is disabled\n";
+        programIndex = -1;
+    }
+
     // clang-format off
     static const GLfloat vertexBufferData[] = {
         -1.0f,-1.0f,-1.0f, // triangle 1 : begin
@@ -195,6 +218,18 @@ int main(void)
     do {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // Swapped programs need their uniform locations again
+        if (0 <= programIndex)
+        {
+            shaderReloadUpdate(&reload);
+            program = shaderReloadProgram(&reload, programIndex);
+            if (generation != shaderReloadGeneration(&reload, programIndex))
+            {
+                generation = shaderReloadGeneration(&reload, programIndex);
+                MatrixID   = glGetUniformLocation(program, "MVP");
+            }
+        }
+
         glUseProgram(program);
         glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
 
@@ -231,7 +266,9 @@ int main(void)
     /* release resources */
     glDeleteBuffers(1, &vertexBuffer);
     glDeleteVertexArrays(1, &vertexArray);
-    glDeleteProgram(program);
+    if (0 > programIndex)
+        glDeleteProgram(program);
+    shaderReloadUninitialize(&reload);
 
     // Close OpenGL window and terminate GLFW
     glfwTerminate();
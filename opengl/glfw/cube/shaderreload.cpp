@@ -0,0 +1,422 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "shaderreload.h"
+
+static bool readSource(const std::string& path, std::string& source)
+{
+    std::ifstream file(path.c_str(), std::ios::in);
+    if (!file.is_open())
+    {
+        std::cerr << "failed to read shader " << path << std::endl;
+        return false;
+    }
+
+    std::stringstream sstr;
+    sstr << file.rdbuf();
+    source = sstr.str();
+    return true;
+}
+
+static std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.rfind('/');
+    return (std::string::npos == slash) ? std::string(".") : path.substr(0, slash);
+}
+
+static std::string nameOf(const std::string& path)
+{
+    size_t slash = path.rfind('/');
+    return (std::string::npos == slash) ? path : path.substr(slash + 1);
+}
+
+/* compile is only queued here, status is not queried so parallel compile does not block */
+static GLuint createShader(GLenum type, const std::string& source)
+{
+    GLuint      shader = glCreateShader(type);
+    const char* pCode  = source.c_str();
+
+    glShaderSource(shader, 1, &pCode, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+static void printLogs(const ReloadProgram* pProgram, GLuint program, const GLuint* pShaders)
+{
+    const char* pNames[2] = {pProgram->vertexPath.c_str(), pProgram->fragmentPath.c_str()};
+    GLint       length    = 0;
+
+    for (int i = 0; i < 2; i++)
+    {
+        GLint status = GL_FALSE;
+        glGetShaderiv(pShaders[i], GL_COMPILE_STATUS, &status);
+        glGetShaderiv(pShaders[i], GL_INFO_LOG_LENGTH, &length);
+        if (GL_TRUE != status && 0 < length)
+        {
+            std::vector<char> log(length + 1);
+            glGetShaderInfoLog(pShaders[i], length, NULL, log.data());
+            std::cerr << "Failed to compile shader: " << pNames[i] << "\n" << log.data() << std::endl;
+        }
+    }
+
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    if (0 < length)
+    {
+        std::vector<char> log(length + 1);
+        glGetProgramInfoLog(program, length, NULL, log.data());
+        std::cerr << "Failed to link program\n" << log.data() << std::endl;
+    }
+    std::cerr << "Keeping previous program of " << pNames[0] << ", " << pNames[1] << std::endl;
+}
+
+/* compiles and links, returns a linked program or 0 with logs printed */
+static GLuint buildProgram(const ReloadProgram* pProgram, bool bWait)
+{
+    std::string vertexSource;
+    std::string fragmentSource;
+
+    if (!readSource(pProgram->vertexPath, vertexSource) || !readSource(pProgram->fragmentPath, fragmentSource))
+        return 0U;
+
+    GLuint shaders[2] = {createShader(GL_VERTEX_SHADER, vertexSource), createShader(GL_FRAGMENT_SHADER, fragmentSource)};
+    GLuint program    = glCreateProgram();
+    glAttachShader(program, shaders[0]);
+    glAttachShader(program, shaders[1]);
+    glLinkProgram(program);
+
+    if (bWait)
+    {
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (GL_TRUE != status)
+        {
+            printLogs(pProgram, program, shaders);
+            glDeleteProgram(program);
+            program = 0U;
+        }
+        glDeleteShader(shaders[0]);
+        glDeleteShader(shaders[1]);
+    }
+    return program;
+}
+
+static void swapProgram(ReloadProgram* pProgram, GLuint program)
+{
+    /* deletion is deferred by GL while the program is bound */
+    glDeleteProgram(pProgram->program);
+    pProgram->program = program;
+    pProgram->generation++;
+    std::cout << "Reloaded " << pProgram->vertexPath << ", " << pProgram->fragmentPath << std::endl;
+}
+
+static void workerMain(ShaderReload* pReload)
+{
+    pReload->pfnCurrent(pReload->pUserData, true);
+
+    std::unique_lock<std::mutex> lock(pReload->mutex);
+    while (!pReload->bQuit)
+    {
+        if (pReload->requests.empty())
+        {
+            pReload->wake.wait(lock);
+            continue;
+        }
+
+        uint32_t       index    = pReload->requests.front();
+        ReloadProgram* pProgram = &pReload->programs[index];
+        pReload->requests.pop_front();
+
+        /* paths never change after shaderReloadAdd, the rest is only touched after results */
+        lock.unlock();
+        GLuint program = buildProgram(pProgram, true);
+        GLsync fence   = (0U != program) ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+        glFlush();
+        lock.lock();
+
+        pProgram->pending = program;
+        pProgram->fence   = fence;
+        pReload->results.push_back(index);
+    }
+    lock.unlock();
+
+    pReload->pfnCurrent(pReload->pUserData, false);
+}
+
+int shaderReloadInitialize(ShaderReload* pReload, PFNSHADERRELOADCURRENTPROC pfnCurrent, void* pUserData)
+{
+    pReload->fd         = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    pReload->nPrograms  = 0U;
+    pReload->pfnCurrent = pfnCurrent;
+    pReload->pUserData  = pUserData;
+    pReload->bQuit      = false;
+
+    if (0 > pReload->fd)
+    {
+        std::cerr << "inotify_init1 failed: " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+    if (GLEW_KHR_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFU);
+        pReload->bParallel = true;
+    }
+    else if (GLEW_ARB_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFFU);
+        pReload->bParallel = true;
+    }
+    else
+    {
+        pReload->bParallel = false;
+        if (NULL != pfnCurrent)
+            pReload->worker = std::thread(workerMain, pReload);
+    }
+
+    std::cout << "Shader reload: "
+              << (pReload->bParallel ? "parallel shader compile" : (NULL != pfnCurrent ? "worker thread" : "render thread"))
+              << std::endl;
+    return 0;
+}
+
+int shaderReloadAdd(ShaderReload* pReload, const char* pVertexPath, const char* pFragmentPath, GLuint program)
+{
+    if (SHADER_RELOAD_MAX_PROGRAMS <= pReload->nPrograms)
+        return -1;
+
+    ReloadProgram* pProgram = &pReload->programs[pReload->nPrograms];
+    pProgram->vertexPath    = pVertexPath;
+    pProgram->fragmentPath  = pFragmentPath;
+    pProgram->program       = program;
+    pProgram->generation    = 0U;
+    pProgram->bDirty        = false;
+    pProgram->bBuilding     = false;
+    pProgram->pending       = 0U;
+    pProgram->shaders[0]    = 0U;
+    pProgram->shaders[1]    = 0U;
+    pProgram->fence         = 0;
+
+    /* editors often write a new file and rename it, so the directory is watched, not the file */
+    const std::string* pPaths[2] = {&pProgram->vertexPath, &pProgram->fragmentPath};
+    for (int i = 0; i < 2; i++)
+    {
+        pProgram->watches[i] = inotify_add_watch(pReload->fd, directoryOf(*pPaths[i]).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (0 > pProgram->watches[i])
+        {
+            std::cerr << "Cannot watch " << *pPaths[i] << ": " << strerror(errno) << std::endl;
+            return -1;
+        }
+    }
+
+    return (int)pReload->nPrograms++;
+}
+
+GLuint shaderReloadProgram(const ShaderReload* pReload, int index)
+{
+    return pReload->programs[index].program;
+}
+
+uint32_t shaderReloadGeneration(const ShaderReload* pReload, int index)
+{
+    return pReload->programs[index].generation;
+}
+
+static void readEvents(ShaderReload* pReload)
+{
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t                            length;
+
+    while (0 < (length = read(pReload->fd, buffer, sizeof(buffer))))
+    {
+        for (char* p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len)
+        {
+            const struct inotify_event* pEvent = (const struct inotify_event*)p;
+            if (0 == pEvent->len)
+                continue;
+
+            for (uint32_t i = 0; i < pReload->nPrograms; i++)
+            {
+                ReloadProgram* pProgram = &pReload->programs[i];
+                if ((pEvent->wd == pProgram->watches[0] && nameOf(pProgram->vertexPath) == pEvent->name) ||
+                    (pEvent->wd == pProgram->watches[1] && nameOf(pProgram->fragmentPath) == pEvent->name))
+                {
+                    pProgram->bDirty = true;
+                }
+            }
+        }
+    }
+}
+
+static void startBuild(ShaderReload* pReload, uint32_t index)
+{
+    ReloadProgram* pProgram = &pReload->programs[index];
+
+    pProgram->bDirty = false;
+    if (pReload->bParallel)
+    {
+        std::string vertexSource;
+        std::string fragmentSource;
+        if (!readSource(pProgram->vertexPath, vertexSource) || !readSource(pProgram->fragmentPath, fragmentSource))
+            return;
+
+        pProgram->shaders[0] = createShader(GL_VERTEX_SHADER, vertexSource);
+        pProgram->shaders[1] = createShader(GL_FRAGMENT_SHADER, fragmentSource);
+        pProgram->pending    = glCreateProgram();
+        glAttachShader(pProgram->pending, pProgram->shaders[0]);
+        glAttachShader(pProgram->pending, pProgram->shaders[1]);
+        glLinkProgram(pProgram->pending);
+        pProgram->bBuilding = true;
+    }
+    else if (pReload->worker.joinable())
+    {
+        std::lock_guard<std::mutex> lock(pReload->mutex);
+        pReload->requests.push_back(index);
+        pProgram->bBuilding = true;
+        pReload->wake.notify_one();
+    }
+    else
+    {
+        GLuint program = buildProgram(pProgram, true);
+        if (0U != program)
+            swapProgram(pProgram, program);
+    }
+}
+
+/* parallel compile: finished when the driver says so, never blocks */
+static bool finishParallel(ReloadProgram* pProgram)
+{
+    GLint status = GL_FALSE;
+
+    glGetProgramiv(pProgram->pending, GL_COMPLETION_STATUS_KHR, &status);
+    if (GL_TRUE != status)
+        return false;
+
+    glGetProgramiv(pProgram->pending, GL_LINK_STATUS, &status);
+    if (GL_TRUE == status)
+    {
+        swapProgram(pProgram, pProgram->pending);
+    }
+    else
+    {
+        printLogs(pProgram, pProgram->pending, pProgram->shaders);
+        glDeleteProgram(pProgram->pending);
+    }
+
+    glDeleteShader(pProgram->shaders[0]);
+    glDeleteShader(pProgram->shaders[1]);
+    pProgram->pending   = 0U;
+    pProgram->bBuilding = false;
+    return GL_TRUE == status;
+}
+
+/* worker: finished once the fence it set after linking is signalled */
+static bool finishWorker(ReloadProgram* pProgram)
+{
+    if (0 != pProgram->fence)
+    {
+        GLenum wait = glClientWaitSync(pProgram->fence, 0, 0);
+        if (GL_TIMEOUT_EXPIRED == wait)
+            return false;
+
+        glDeleteSync(pProgram->fence);
+        pProgram->fence = 0;
+        if (GL_WAIT_FAILED != wait)
+            swapProgram(pProgram, pProgram->pending);
+        else
+            glDeleteProgram(pProgram->pending);
+    }
+
+    pProgram->pending   = 0U;
+    pProgram->bBuilding = false;
+    return true;
+}
+
+bool shaderReloadUpdate(ShaderReload* pReload)
+{
+    uint32_t generations = 0U;
+    for (uint32_t i = 0; i < pReload->nPrograms; i++)
+        generations += pReload->programs[i].generation;
+
+    readEvents(pReload);
+
+    if (pReload->worker.joinable())
+    {
+        std::deque<uint32_t> results;
+        {
+            std::lock_guard<std::mutex> lock(pReload->mutex);
+            results.swap(pReload->results);
+        }
+
+        /* not yet signalled go back to the queue */
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            if (!finishWorker(&pReload->programs[results[i]]))
+            {
+                std::lock_guard<std::mutex> lock(pReload->mutex);
+                pReload->results.push_back(results[i]);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < pReload->nPrograms; i++)
+    {
+        ReloadProgram* pProgram = &pReload->programs[i];
+
+        if (pProgram->bBuilding && pReload->bParallel)
+            finishParallel(pProgram);
+
+        /* a change during a build is picked up once it is done */
+        if (pProgram->bDirty && !pProgram->bBuilding)
+            startBuild(pReload, i);
+    }
+
+    for (uint32_t i = 0; i < pReload->nPrograms; i++)
+        generations -= pReload->programs[i].generation;
+
+    return 0U != generations;
+}
+
+void shaderReloadUninitialize(ShaderReload* pReload)
+{
+    if (pReload->worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(pReload->mutex);
+            pReload->bQuit = true;
+            pReload->wake.notify_one();
+        }
+        pReload->worker.join();
+        pReload->requests.clear();
+        pReload->results.clear();
+    }
+
+    for (uint32_t i = 0; i < pReload->nPrograms; i++)
+    {
+        ReloadProgram* pProgram = &pReload->programs[i];
+        if (0 != pProgram->fence)
+            glDeleteSync(pProgram->fence);
+        if (pReload->bParallel && pProgram->bBuilding)
+        {
+            glDeleteShader(pProgram->shaders[0]);
+            glDeleteShader(pProgram->shaders[1]);
+        }
+        glDeleteProgram(pProgram->pending);
+        glDeleteProgram(pProgram->program);
+        pProgram->program = 0U;
+    }
+    pReload->nPrograms = 0U;
+
+    if (0 <= pReload->fd)
+    {
+        close(pReload->fd);
+        pReload->fd = -1;
+    }
+}
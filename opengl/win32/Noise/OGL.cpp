@@ -101,6 +101,7 @@ const GLchar* vertexShaderSourceCode =
     "in      vec4 aPosition;"
     "in      vec3 aNormal;"
     "uniform mat4 uModelViewMatrix;"
+    "uniform mat3 uNormalMatrix;"
     "uniform mat4 uProjectionMatrix;"
     "uniform vec3 uld;"
     "uniform vec3 ukd;"
@@ -113,8 +114,7 @@ const GLchar* vertexShaderSourceCode =
     "    if(uKeyPressed == 1)"
     "    {"
     "        vec4 eyePosition  = uModelViewMatrix * aPosition;"
-    "        mat3 normalMatrix = mat3(transpose(inverse(uModelViewMatrix)));"
-    "        vec3 n            = normalize(normalMatrix * aNormal );"
+    "        vec3 n            = normalize(uNormalMatrix * aNormal );"
     "        vec3 s            = normalize(vec3(uLightPosition - eyePosition));"
     "        oDiffuseLight     = uld * ukd * max(dot(s,n),0.0); "
     "    }"
@@ -168,6 +168,7 @@ GLuint eboSpheres  = 0U;
 vmath::mat4 perspectiveProjectionMatrix = {};
 
 GLuint modelViewMatrixUniform  = 0;
+GLuint normalMatrixUniform     = 0;
 GLuint projectionMatrixUniform = 0;
 GLuint ldUniform               = 0;
 GLuint kdUniform               = 0;
@@ -607,6 +608,7 @@ int initialize(void)
     fprintf(gpFILE, "Program compilation Successfull\n");
 
     modelViewMatrixUniform  = glGetUniformLocation(shaderProgramObject, "uModelViewMatrix");
+    normalMatrixUniform     = glGetUniformLocation(shaderProgramObject, "uNormalMatrix");
     projectionMatrixUniform = glGetUniformLocation(shaderProgramObject, "uProjectionMatrix");
     ldUniform               = glGetUniformLocation(shaderProgramObject, "uld");
     kdUniform               = glGetUniformLocation(shaderProgramObject, "ukd");
@@ -704,6 +706,7 @@ void display(void)
     modelViewMatrix         = translationMatrix;
 
     glUniformMatrix4fv(modelViewMatrixUniform, 1, GL_FALSE, modelViewMatrix);
+    glUniformMatrix3fv(normalMatrixUniform, 1, GL_FALSE, vmath::inverseTranspose3x3(modelViewMatrix));
 
     glUniform3f(colorSkyUniform, 1.0f, 1.0f, 1.0f);
     glUniform3f(colorCloudUniform, 0.0f, 0.0f, 1.0f);
@@ -114,6 +114,7 @@ const GLchar* vertexShaderSourceCode =
     "out vec3 oViewDirection;"
     "\n"
     "uniform mat4 uModelMatrix;"
+    "uniform mat3 uNormalMatrix;"
     "uniform mat4 uViewMatrix;"
     "uniform mat4 uProjectionMatrix;"
     "uniform vec3 uLightPosition;"
@@ -122,9 +123,8 @@ const GLchar* vertexShaderSourceCode =
     "void main(void)"
     "{"
     "\n"
-    "   mat3 normalMatrix = transpose(inverse(mat3(uModelMatrix)));"
-    "   vec3 T = normalize(normalMatrix * aTangent);"
-    "   vec3 N = normalize(normalMatrix * aNormal);"
+    "   vec3 T = normalize(uNormalMatrix * aTangent);"
+    "   vec3 N = normalize(uNormalMatrix * aNormal);"
     "   T = normalize(T - dot(T, N) * N);"
     "   vec3 B = cross(N, T);"
     "   mat3 TBN = transpose(mat3(T, B, N));"
@@ -179,7 +179,7 @@ GLuint vertexShaderObject   = 0U;
 GLuint fragmentShaderObject = 0U;
 GLuint shaderProgramObject  = 0U;
 
-const GLfloat vertices[] = {
+constexpr GLfloat vertices[] = {
     -1.0f, 1.0f,  0.0f, // top-left
     -1.0f, -1.0f, 0.0f, // bottom-left
     1.0f,  -1.0f, 0.0f, // bottom-right
@@ -193,20 +193,56 @@ const GLfloat normals[] = {
     0.0f, 0.0f, 1.0f, // top-right
 };
 
-const GLfloat texCoords[] = {
+constexpr GLfloat texCoords[] = {
     0.0f, 1.0f, // top-left
     0.0f, 0.0f, // bottom-left
     1.0f, 0.0f, // bottom-right
     1.0f, 1.0f  // top-right
 };
 
-const GLfloat tangents[] = {
-    2.0f, 0.0f, 0.0f, // top-left
-    2.0f, 0.0f, 0.0f, // bottom-left
-    2.0f, 0.0f, 0.0f, // bottom-right
-    2.0f, 0.0f, 0.0f, // top-right
+/* one tangent per vertex, all equal as the quad is flat */
+struct TangentTable
+{
+    GLfloat data[4 * 3];
 };
 
+/**
+ * @brief Tangent of the quad from the first triangle, positions and texture coordinates
+ *        (dU1 * dV2 - dU2 * dV1) T = dV2 E1 - dV1 E2
+ */
+static VMATH_CONSTEXPR TangentTable quadTangents(void)
+{
+    const vec3 p0(vertices[0], vertices[1], vertices[2]);
+    const vec3 p1(vertices[3], vertices[4], vertices[5]);
+    const vec3 p2(vertices[6], vertices[7], vertices[8]);
+    const vec2 uv0(texCoords[0], texCoords[1]);
+    const vec2 uv1(texCoords[2], texCoords[3]);
+    const vec2 uv2(texCoords[4], texCoords[5]);
+
+    const vec3 edge1  = p1 - p0;
+    const vec3 edge2  = p2 - p0;
+    const vec2 delta1 = uv1 - uv0;
+    const vec2 delta2 = uv2 - uv0;
+
+    const float f       = 1.0f / (delta1[0] * delta2[1] - delta2[0] * delta1[1]);
+    const vec3  tangent = (edge1 * delta2[1] - edge2 * delta1[1]) * f;
+
+    TangentTable table = {};
+    for (int i = 0; i < 4; i++)
+    {
+        table.data[i * 3 + 0] = tangent[0];
+        table.data[i * 3 + 1] = tangent[1];
+        table.data[i * 3 + 2] = tangent[2];
+    }
+    return table;
+}
+
+VMATH_CONSTEXPR_DATA TangentTable tangents = quadTangents();
+
+#if defined(VMATH_HAS_CONSTEXPR)
+static_assert(2.0f == tangents.data[0] && 0.0f == tangents.data[1], "tangent of the quad is +X");
+#endif
+
 const GLuint indices[] = {
     0, 1, 2, // bottom-left
     2, 3, 0  // top-right
@@ -221,6 +257,7 @@ GLuint vboTexCoords = 0U;
 
 /* Matrix uniforms */
 GLuint modelMatrixUniform      = 0U;
+GLuint normalMatrixUniform     = 0U;
 GLuint viewMatrixUniform       = 0U;
 GLuint projectionMatrixUniform = 0U;
 GLuint viewPosUniform          = 0U;
@@ -688,6 +725,7 @@ int initialize(void)
 
     // get uniform locations
     modelMatrixUniform      = glGetUniformLocation(shaderProgramObject, "uModelMatrix");
+    normalMatrixUniform     = glGetUniformLocation(shaderProgramObject, "uNormalMatrix");
     viewMatrixUniform       = glGetUniformLocation(shaderProgramObject, "uViewMatrix");
     projectionMatrixUniform = glGetUniformLocation(shaderProgramObject, "uProjectionMatrix");
 
@@ -726,7 +764,7 @@ int initialize(void)
 
     glGenBuffers(1, &vboTangent);
     glBindBuffer(GL_ARRAY_BUFFER, vboTangent);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(tangents), tangents, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(tangents.data), tangents.data, GL_STATIC_DRAW);
     glVertexAttribPointer(AMC_ATTRIBUTE_TANGENT, 3, GL_FLOAT, GL_FALSE, 0, NULL);
     glEnableVertexAttribArray(AMC_ATTRIBUTE_TANGENT);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -797,6 +835,7 @@ void display(void)
     modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
 
     glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, modelMatrix);
+    glUniformMatrix3fv(normalMatrixUniform, 1, GL_FALSE, vmath::inverseTranspose3x3(modelMatrix));
     glUniformMatrix4fv(viewMatrixUniform, 1, GL_FALSE, viewMatrix);
     glUniformMatrix4fv(projectionMatrixUniform, 1, GL_FALSE, projectionMatrix);
     glUniform3fv(viewPosUniform, 1, vmath::vec3(0.0f, 0.0f, 5.0f));
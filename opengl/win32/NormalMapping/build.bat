@@ -1,5 +1,5 @@
 cls
 del *.obj *.exe
-cl.exe /c /EHsc OGL.cpp /I "C:/libs/glew/include"
+cl.exe /c /EHsc /std:c++17 OGL.cpp /I "C:/libs/glew/include"
 rc.exe OGL.rc
 link.exe OGL.obj OGL.res User32.lib GDI32.lib /SUBSYSTEM:WINDOWS /LIBPATH:"C:\libs\glew\lib\Release\x64"
\ No newline at end of file
@@ -0,0 +1,728 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "ibl.h"
+#include "stb_image.h"
+
+#define IBL_CACHE_MAGIC   0x394C4249U /**< "IBL9" */
+#define IBL_CACHE_VERSION 1U
+#define IBL_SH_SIZE       64U /**< texels per side of the source level the SH9 projection reads */
+#define IBL_GAMMA         2.2f
+
+/* header of a cache file, followed by the SH9 coefficients and every level of every face as RGB8 */
+typedef struct IblCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t faceSize;     /**< texels per side of the faces */
+    uint32_t size;         /**< IBL_SIZE */
+    uint32_t nLevels;      /**< IBL_LEVELS */
+    uint32_t nSamples;     /**< IBL_SAMPLES */
+    int64_t  faceBytes[6]; /**< st_size of the faces */
+    int64_t  faceTimes[6]; /**< st_mtime of the faces */
+} IblCacheHeader;
+
+/* linear mip chain of a cube map down to 1x1, level l has size >> l texels per side */
+typedef struct CubeChain
+{
+    uint32_t size;
+    uint32_t nLevels;
+    float   *pLevels[32]; /**< six faces of RGB texels per level */
+} CubeChain;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static uint32_t log2u(uint32_t value)
+{
+    uint32_t result = 0U;
+    while (1U < value)
+    {
+        value >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+/* level 0 is the largest power of two up to IBL_SIZE the faces can be boxed down to */
+static uint32_t baseSize(uint32_t faceSize)
+{
+    uint32_t size = IBL_SIZE;
+    while (faceSize < size && 1U < size)
+    {
+        size >>= 1;
+    }
+    return size;
+}
+
+static uint32_t levelCount(uint32_t size)
+{
+    uint32_t nLevels = log2u(size) + 1U;
+    return (IBL_LEVELS < nLevels) ? IBL_LEVELS : nLevels;
+}
+
+/* bytes of all levels of all faces as RGB8 */
+static size_t chainBytes(uint32_t size, uint32_t nLevels)
+{
+    size_t bytes = 0U;
+    for (uint32_t level = 0U; level < nLevels; ++level)
+    {
+        bytes += 6U * 3U * (size_t)(size >> level) * (size_t)(size >> level);
+    }
+    return bytes;
+}
+
+static uint8_t encode(float value)
+{
+    value = powf(fminf(fmaxf(value, 0.0f), 1.0f), 1.0f / IBL_GAMMA);
+    return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+/* direction through texel coordinates u, v in -1 to 1 of a face, after the cube map table of the GL spec */
+static void faceDirection(uint32_t face, float u, float v, float direction[3])
+{
+    switch (face)
+    {
+        case 0: direction[0] = 1.0f;  direction[1] = -v;    direction[2] = -u;    break;
+        case 1: direction[0] = -1.0f; direction[1] = -v;    direction[2] = u;     break;
+        case 2: direction[0] = u;     direction[1] = 1.0f;  direction[2] = v;     break;
+        case 3: direction[0] = u;     direction[1] = -1.0f; direction[2] = -v;    break;
+        case 4: direction[0] = u;     direction[1] = -v;    direction[2] = 1.0f;  break;
+        default: direction[0] = -u;   direction[1] = -v;    direction[2] = -1.0f; break;
+    }
+
+    float length  = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    direction[0] /= length;
+    direction[1] /= length;
+    direction[2] /= length;
+}
+
+static uint32_t directionFace(const float direction[3], float *pU, float *pV)
+{
+    float    ax = fabsf(direction[0]), ay = fabsf(direction[1]), az = fabsf(direction[2]);
+    float    sc, tc, ma;
+    uint32_t face;
+
+    if (ax >= ay && ax >= az)
+    {
+        face = (0.0f < direction[0]) ? 0U : 1U;
+        sc   = (0U == face) ? -direction[2] : direction[2];
+        tc   = -direction[1];
+        ma   = ax;
+    }
+    else if (ay >= az)
+    {
+        face = (0.0f < direction[1]) ? 2U : 3U;
+        sc   = direction[0];
+        tc   = (2U == face) ? direction[2] : -direction[2];
+        ma   = ay;
+    }
+    else
+    {
+        face = (0.0f < direction[2]) ? 4U : 5U;
+        sc   = (4U == face) ? direction[0] : -direction[0];
+        tc   = -direction[1];
+        ma   = az;
+    }
+
+    *pU = sc / ma;
+    *pV = tc / ma;
+    return face;
+}
+
+/* bilinear within the face, edges clamp */
+static void sampleLevel(const CubeChain *pChain, uint32_t level, uint32_t face, float u, float v, float rgb[3])
+{
+    uint32_t     size   = pChain->size >> level;
+    const float *pFace  = pChain->pLevels[level] + (size_t)face * size * size * 3U;
+    float        x      = fminf(fmaxf((u + 1.0f) * 0.5f * (float)size - 0.5f, 0.0f), (float)(size - 1U));
+    float        y      = fminf(fmaxf((v + 1.0f) * 0.5f * (float)size - 0.5f, 0.0f), (float)(size - 1U));
+    uint32_t     x0     = (uint32_t)x, y0 = (uint32_t)y;
+    uint32_t     x1     = (x0 + 1U < size) ? x0 + 1U : x0;
+    uint32_t     y1     = (y0 + 1U < size) ? y0 + 1U : y0;
+    float        fx     = x - (float)x0, fy = y - (float)y0;
+    const float *p00    = pFace + ((size_t)y0 * size + x0) * 3U;
+    const float *p10    = pFace + ((size_t)y0 * size + x1) * 3U;
+    const float *p01    = pFace + ((size_t)y1 * size + x0) * 3U;
+    const float *p11    = pFace + ((size_t)y1 * size + x1) * 3U;
+
+    for (int c = 0; c < 3; ++c)
+    {
+        float top    = p00[c] + (p10[c] - p00[c]) * fx;
+        float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+        rgb[c]       = top + (bottom - top) * fy;
+    }
+}
+
+/* trilinear between the levels around lod */
+static void sampleChain(const CubeChain *pChain, const float direction[3], float lod, float rgb[3])
+{
+    float    u, v;
+    uint32_t face = directionFace(direction, &u, &v);
+
+    lod            = fminf(fmaxf(lod, 0.0f), (float)(pChain->nLevels - 1U));
+    uint32_t level = (uint32_t)lod;
+    sampleLevel(pChain, level, face, u, v, rgb);
+
+    float fraction = lod - (float)level;
+    if (0.0f < fraction && level + 1U < pChain->nLevels)
+    {
+        float next[3];
+        sampleLevel(pChain, level + 1U, face, u, v, next);
+        for (int c = 0; c < 3; ++c)
+        {
+            rgb[c] += (next[c] - rgb[c]) * fraction;
+        }
+    }
+}
+
+static void freeChain(CubeChain *pChain)
+{
+    for (uint32_t level = 0U; level < pChain->nLevels; ++level)
+    {
+        free(pChain->pLevels[level]);
+        pChain->pLevels[level] = nullptr;
+    }
+}
+
+/* decode the faces to linear, box them down to level 0 and average the rest of the chain */
+static int loadChain(const char *const faces[6], uint32_t faceSize, CubeChain *pChain)
+{
+    float decode[256];
+    for (int i = 0; i < 256; ++i)
+    {
+        decode[i] = powf((float)i / 255.0f, IBL_GAMMA);
+    }
+
+    pChain->size    = baseSize(faceSize);
+    pChain->nLevels = log2u(pChain->size) + 1U;
+    for (uint32_t level = 0U; level < pChain->nLevels; ++level)
+    {
+        size_t size             = pChain->size >> level;
+        pChain->pLevels[level] = (float *)malloc(6U * 3U * size * size * sizeof(float));
+        if (nullptr == pChain->pLevels[level])
+        {
+            fprintf(stderr, "%s: out of memory\n", __func__);
+            freeChain(pChain);
+            return -1;
+        }
+    }
+
+    uint32_t box   = faceSize / pChain->size;
+    float    scale = 1.0f / (float)(box * box);
+    for (uint32_t face = 0U; face < 6U; ++face)
+    {
+        int            width, height, nChannels;
+        unsigned char *pData = stbi_load(faces[face], &width, &height, &nChannels, 3);
+        if (nullptr == pData || (uint32_t)width != faceSize || (uint32_t)height != faceSize)
+        {
+            fprintf(stderr, "%s: failed to load %s\n", __func__, faces[face]);
+            stbi_image_free(pData);
+            freeChain(pChain);
+            return -1;
+        }
+
+        float *pTexel = pChain->pLevels[0] + (size_t)face * pChain->size * pChain->size * 3U;
+        for (uint32_t y = 0U; y < pChain->size; ++y)
+        {
+            for (uint32_t x = 0U; x < pChain->size; ++x, pTexel += 3)
+            {
+                float sum[3] = {0.0f, 0.0f, 0.0f};
+                for (uint32_t by = 0U; by < box; ++by)
+                {
+                    const unsigned char *pSource = pData + (((size_t)(y * box + by) * faceSize) + x * box) * 3U;
+                    for (uint32_t bx = 0U; bx < box * 3U; bx += 3U)
+                    {
+                        sum[0] += decode[pSource[bx + 0U]];
+                        sum[1] += decode[pSource[bx + 1U]];
+                        sum[2] += decode[pSource[bx + 2U]];
+                    }
+                }
+                pTexel[0] = sum[0] * scale;
+                pTexel[1] = sum[1] * scale;
+                pTexel[2] = sum[2] * scale;
+            }
+        }
+        stbi_image_free(pData);
+    }
+
+    for (uint32_t level = 1U; level < pChain->nLevels; ++level)
+    {
+        uint32_t     size    = pChain->size >> level;
+        const float *pSource = pChain->pLevels[level - 1U];
+        float       *pTexel  = pChain->pLevels[level];
+        for (uint32_t face = 0U; face < 6U; ++face)
+        {
+            for (uint32_t y = 0U; y < size; ++y)
+            {
+                const float *pRow0 = pSource + (((size_t)face * 2U * size + 2U * y) * 2U * size) * 3U;
+                const float *pRow1 = pRow0 + 2U * size * 3U;
+                for (uint32_t x = 0U; x < size; ++x, pTexel += 3, pRow0 += 6, pRow1 += 6)
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        pTexel[c] = 0.25f * (pRow0[c] + pRow0[c + 3] + pRow1[c] + pRow1[c + 3]);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void shBasis(const float d[3], float y[9])
+{
+    y[0] = 0.282095f;
+    y[1] = 0.488603f * d[1];
+    y[2] = 0.488603f * d[2];
+    y[3] = 0.488603f * d[0];
+    y[4] = 1.092548f * d[0] * d[1];
+    y[5] = 1.092548f * d[1] * d[2];
+    y[6] = 0.315392f * (3.0f * d[2] * d[2] - 1.0f);
+    y[7] = 1.092548f * d[0] * d[2];
+    y[8] = 0.546274f * (d[0] * d[0] - d[1] * d[1]);
+}
+
+/* radiance onto SH9, weighted by the solid angle of the texels, then convolved with the clamped cosine over pi */
+static void projectSH(const CubeChain *pChain, float sh[9][3])
+{
+    uint32_t level  = log2u(pChain->size) - log2u((IBL_SH_SIZE < pChain->size) ? IBL_SH_SIZE : pChain->size);
+    uint32_t size   = pChain->size >> level;
+    float    weight = 0.0f;
+
+    memset(sh, 0, 9U * 3U * sizeof(float));
+    const float *pTexel = pChain->pLevels[level];
+    for (uint32_t face = 0U; face < 6U; ++face)
+    {
+        for (uint32_t y = 0U; y < size; ++y)
+        {
+            for (uint32_t x = 0U; x < size; ++x, pTexel += 3)
+            {
+                float u = 2.0f * ((float)x + 0.5f) / (float)size - 1.0f;
+                float v = 2.0f * ((float)y + 0.5f) / (float)size - 1.0f;
+                float d = 1.0f + u * u + v * v;
+                float solidAngle = 1.0f / (d * sqrtf(d));
+                float direction[3], basis[9];
+
+                faceDirection(face, u, v, direction);
+                shBasis(direction, basis);
+                for (int i = 0; i < 9; ++i)
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        sh[i][c] += pTexel[c] * basis[i] * solidAngle;
+                    }
+                }
+                weight += solidAngle;
+            }
+        }
+    }
+
+    /* the texels cover 4 pi, band l is scaled by A_l / pi: 1, 2 / 3, 1 / 4 */
+    const float band[9] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+    for (int i = 0; i < 9; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            sh[i][c] *= band[i] * 4.0f * (float)M_PI / weight;
+        }
+    }
+}
+
+static float radicalInverse(uint32_t bits)
+{
+    bits = (bits << 16U) | (bits >> 16U);
+    bits = ((bits & 0x55555555U) << 1U) | ((bits & 0xAAAAAAAAU) >> 1U);
+    bits = ((bits & 0x33333333U) << 2U) | ((bits & 0xCCCCCCCCU) >> 2U);
+    bits = ((bits & 0x0F0F0F0FU) << 4U) | ((bits & 0xF0F0F0F0U) >> 4U);
+    bits = ((bits & 0x00FF00FFU) << 8U) | ((bits & 0xFF00FF00U) >> 8U);
+    return (float)bits * 2.3283064365386963e-10f;
+}
+
+/* one level of the specular chain, with N = V the samples only differ per texel by the frame around N */
+static void prefilterLevel(const CubeChain *pChain, uint32_t level, uint32_t nLevels, uint8_t *pOut)
+{
+    uint32_t size        = pChain->size >> level;
+    float    roughness   = (float)level / (float)(nLevels - 1U);
+    float    alpha2      = roughness * roughness * roughness * roughness;
+    float    texelSolid  = 4.0f * (float)M_PI / (6.0f * (float)pChain->size * (float)pChain->size);
+    float    samples[IBL_SAMPLES][5]; /* tangent space H, N dot L, source lod */
+    uint32_t nSamples    = 0U;
+
+    for (uint32_t i = 0U; i < IBL_SAMPLES; ++i)
+    {
+        float phi      = 2.0f * (float)M_PI * (float)i / (float)IBL_SAMPLES;
+        float xi       = radicalInverse(i);
+        float cosTheta = sqrtf((1.0f - xi) / (1.0f + (alpha2 - 1.0f) * xi));
+        float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+        float nDotL    = 2.0f * cosTheta * cosTheta - 1.0f;
+        if (0.0f >= nDotL)
+            continue;
+
+        /* pdf of L is D(H) / 4 when N = V, a sample covers 1 / (n pdf) of the sphere */
+        float denominator = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+        float pdf         = alpha2 / ((float)M_PI * denominator * denominator) * 0.25f;
+        float sampleSolid = 1.0f / ((float)IBL_SAMPLES * pdf + 1e-4f);
+
+        samples[nSamples][0] = sinTheta * cosf(phi);
+        samples[nSamples][1] = sinTheta * sinf(phi);
+        samples[nSamples][2] = cosTheta;
+        samples[nSamples][3] = nDotL;
+        samples[nSamples][4] = 0.5f * log2f(sampleSolid / texelSolid) + 1.0f;
+        ++nSamples;
+    }
+
+    for (uint32_t face = 0U; face < 6U; ++face)
+    {
+        for (uint32_t y = 0U; y < size; ++y)
+        {
+            for (uint32_t x = 0U; x < size; ++x, pOut += 3)
+            {
+                float n[3], t[3], b[3];
+                faceDirection(face, 2.0f * ((float)x + 0.5f) / (float)size - 1.0f, 2.0f * ((float)y + 0.5f) / (float)size - 1.0f, n);
+
+                /* t = normalize(up x n), b = n x t */
+                float up[3] = {0.0f, 0.0f, 1.0f};
+                if (0.999f < fabsf(n[2]))
+                {
+                    up[0] = 1.0f;
+                    up[2] = 0.0f;
+                }
+                t[0]         = up[1] * n[2] - up[2] * n[1];
+                t[1]         = up[2] * n[0] - up[0] * n[2];
+                t[2]         = up[0] * n[1] - up[1] * n[0];
+                float length = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+                t[0] /= length;
+                t[1] /= length;
+                t[2] /= length;
+                b[0] = n[1] * t[2] - n[2] * t[1];
+                b[1] = n[2] * t[0] - n[0] * t[2];
+                b[2] = n[0] * t[1] - n[1] * t[0];
+
+                float sum[3] = {0.0f, 0.0f, 0.0f};
+                float total  = 0.0f;
+                for (uint32_t i = 0U; i < nSamples; ++i)
+                {
+                    const float *s = samples[i];
+                    float        h[3], l[3], rgb[3];
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        h[c] = t[c] * s[0] + b[c] * s[1] + n[c] * s[2];
+                        l[c] = 2.0f * s[2] * h[c] - n[c];
+                    }
+                    sampleChain(pChain, l, s[4], rgb);
+                    sum[0] += rgb[0] * s[3];
+                    sum[1] += rgb[1] * s[3];
+                    sum[2] += rgb[2] * s[3];
+                    total  += s[3];
+                }
+
+                pOut[0] = encode(sum[0] / total);
+                pOut[1] = encode(sum[1] / total);
+                pOut[2] = encode(sum[2] / total);
+            }
+        }
+    }
+}
+
+static int convolve(const char *const faces[6], uint32_t faceSize, Ibl *pIbl, uint8_t *pTexels)
+{
+    CubeChain chain = {};
+    if (0 != loadChain(faces, faceSize, &chain))
+        return -1;
+
+    projectSH(&chain, pIbl->sh);
+
+    /* level 0 is the mirror, the source itself */
+    size_t texels = 6U * (size_t)chain.size * chain.size * 3U;
+    for (size_t i = 0U; i < texels; ++i)
+    {
+        pTexels[i] = encode(chain.pLevels[0][i]);
+    }
+    pTexels += texels;
+
+    for (uint32_t level = 1U; level < pIbl->nLevels; ++level)
+    {
+        prefilterLevel(&chain, level, pIbl->nLevels, pTexels);
+        pTexels += 6U * 3U * (size_t)(chain.size >> level) * (chain.size >> level);
+    }
+
+    freeChain(&chain);
+    return 0;
+}
+
+/* the key of a cache file, from the file system and image headers without decoding */
+static bool cacheKey(const char *const faces[6], IblCacheHeader *pHeader)
+{
+    memset(pHeader, 0, sizeof(*pHeader));
+    pHeader->magic    = IBL_CACHE_MAGIC;
+    pHeader->version  = IBL_CACHE_VERSION;
+    pHeader->size     = IBL_SIZE;
+    pHeader->nLevels  = IBL_LEVELS;
+    pHeader->nSamples = IBL_SAMPLES;
+
+    for (uint32_t face = 0U; face < 6U; ++face)
+    {
+        struct stat status;
+        int         width, height, nChannels;
+
+        if (0 != stat(faces[face], &status) || 0 == stbi_info(faces[face], &width, &height, &nChannels))
+        {
+            fprintf(stderr, "%s: failed to read %s\n", __func__, faces[face]);
+            return false;
+        }
+        if (width != height || (0U != face && (uint32_t)width != pHeader->faceSize))
+        {
+            fprintf(stderr, "%s: %s is %dx%d, faces must be square and of equal size\n", __func__, faces[face], width, height);
+            return false;
+        }
+
+        pHeader->faceSize        = (uint32_t)width;
+        pHeader->faceBytes[face] = (int64_t)status.st_size;
+        pHeader->faceTimes[face] = (int64_t)status.st_mtime;
+    }
+
+    return true;
+}
+
+static bool readCache(const char *pPath, const IblCacheHeader *pKey, float sh[9][3], uint8_t *pTexels, size_t bytes)
+{
+    IblCacheHeader header = {};
+
+    FILE *pFile = fopen(pPath, "rb");
+    if (nullptr == pFile)
+        return false;
+
+    bool bDone = 1 == fread(&header, sizeof(header), 1, pFile) && 0 == memcmp(&header, pKey, sizeof(header)) &&
+                 1 == fread(sh, 9U * 3U * sizeof(float), 1, pFile) && 1 == fread(pTexels, bytes, 1, pFile);
+    fclose(pFile);
+
+    return bDone;
+}
+
+static void writeCache(const char *pPath, const IblCacheHeader *pKey, const float sh[9][3], const uint8_t *pTexels, size_t bytes)
+{
+    char temporary[512];
+
+    /* write to a temporary file and rename, other instances never see a partial file */
+    snprintf(temporary, sizeof(temporary), "%s.tmp", pPath);
+    FILE *pFile = fopen(temporary, "wb");
+    bool  bDone = (nullptr != pFile) && (1 == fwrite(pKey, sizeof(*pKey), 1, pFile)) &&
+                 (1 == fwrite(sh, 9U * 3U * sizeof(float), 1, pFile)) && (1 == fwrite(pTexels, bytes, 1, pFile));
+    if (nullptr != pFile)
+        bDone = (0 == fclose(pFile)) && bDone;
+    bDone = bDone && (0 == rename(temporary, pPath));
+
+    if (!bDone)
+    {
+        fprintf(stderr, "%s: failed to write %s\n", __func__, pPath);
+        remove(temporary);
+    }
+}
+
+static void setCubeParameters(GLint maxLevel)
+{
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, (0 < maxLevel) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, maxLevel);
+}
+
+static int createTextures(Ibl *pIbl, const uint8_t *pTexels)
+{
+    uint8_t irradiance[IBL_IRRADIANCE_SIZE * IBL_IRRADIANCE_SIZE * 3U];
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glGenTextures(1, &pIbl->specularTexture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, pIbl->specularTexture);
+    setCubeParameters((GLint)pIbl->nLevels - 1);
+    for (uint32_t level = 0U; level < pIbl->nLevels; ++level)
+    {
+        GLsizei size = (GLsizei)(pIbl->size >> level);
+        for (uint32_t face = 0U; face < 6U; ++face, pTexels += 3U * (size_t)size * size)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, (GLint)level, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pTexels);
+        }
+    }
+
+    /* irradiance is smooth, a few texels evaluated from SH9 carry it */
+    glGenTextures(1, &pIbl->irradianceTexture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, pIbl->irradianceTexture);
+    setCubeParameters(0);
+    for (uint32_t face = 0U; face < 6U; ++face)
+    {
+        uint8_t *pTexel = irradiance;
+        for (uint32_t y = 0U; y < IBL_IRRADIANCE_SIZE; ++y)
+        {
+            for (uint32_t x = 0U; x < IBL_IRRADIANCE_SIZE; ++x, pTexel += 3)
+            {
+                float direction[3], basis[9];
+                faceDirection(face, 2.0f * ((float)x + 0.5f) / (float)IBL_IRRADIANCE_SIZE - 1.0f,
+                              2.0f * ((float)y + 0.5f) / (float)IBL_IRRADIANCE_SIZE - 1.0f, direction);
+                shBasis(direction, basis);
+                for (int c = 0; c < 3; ++c)
+                {
+                    float value = 0.0f;
+                    for (int i = 0; i < 9; ++i)
+                    {
+                        value += pIbl->sh[i][c] * basis[i];
+                    }
+                    pTexel[c] = encode(value);
+                }
+            }
+        }
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB8, IBL_IRRADIANCE_SIZE, IBL_IRRADIANCE_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, irradiance);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0U);
+
+    GLenum error = glGetError();
+    if (GL_NO_ERROR != error)
+    {
+        fprintf(stderr, "%s: failed to create cube maps, error 0x%x\n", __func__, error);
+        return -1;
+    }
+    return 0;
+}
+
+int iblInitialize(Ibl *pIbl, const char *const faces[6], const char *cachePath)
+{
+    IblCacheHeader key;
+
+    memset(pIbl, 0, sizeof(*pIbl));
+    if (!cacheKey(faces, &key))
+        return -1;
+
+    pIbl->size      = baseSize(key.faceSize);
+    pIbl->nLevels   = levelCount(pIbl->size);
+    size_t   bytes   = chainBytes(pIbl->size, pIbl->nLevels);
+    uint8_t *pTexels = (uint8_t *)malloc(bytes);
+    if (nullptr == pTexels)
+    {
+        fprintf(stderr, "%s: out of memory\n", __func__);
+        return -1;
+    }
+
+    double start = now();
+    if (nullptr != cachePath && readCache(cachePath, &key, pIbl->sh, pTexels, bytes))
+    {
+        printf("IBL: loaded %s in %.1f ms\n", cachePath, now() - start);
+    }
+    else
+    {
+        if (0 != convolve(faces, key.faceSize, pIbl, pTexels))
+        {
+            free(pTexels);
+            return -1;
+        }
+        printf("IBL: prefiltered %u levels of %u texels, %u samples, in %.1f ms\n", pIbl->nLevels, pIbl->size, IBL_SAMPLES, now() - start);
+
+        if (nullptr != cachePath)
+            writeCache(cachePath, &key, pIbl->sh, pTexels, bytes);
+    }
+
+    int result = createTextures(pIbl, pTexels);
+    free(pTexels);
+    if (0 != result)
+        iblUninitialize(pIbl);
+
+    return result;
+}
+
+void iblBind(const Ibl *pIbl)
+{
+    /* albedo * irradiance(N) */
+    glActiveTexture(GL_TEXTURE0 + IBL_IRRADIANCE_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, pIbl->irradianceTexture);
+    glEnable(GL_TEXTURE_CUBE_MAP);
+    glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_NORMAL_MAP);
+    glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_NORMAL_MAP);
+    glTexGeni(GL_R, GL_TEXTURE_GEN_MODE, GL_NORMAL_MAP);
+    glEnable(GL_TEXTURE_GEN_S);
+    glEnable(GL_TEXTURE_GEN_T);
+    glEnable(GL_TEXTURE_GEN_R);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    /* mix(previous, prefiltered(R), reflectance), reflectance is the alpha of the env color */
+    glActiveTexture(GL_TEXTURE0 + IBL_SPECULAR_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, pIbl->specularTexture);
+    glEnable(GL_TEXTURE_CUBE_MAP);
+    glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_REFLECTION_MAP);
+    glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_REFLECTION_MAP);
+    glTexGeni(GL_R, GL_TEXTURE_GEN_MODE, GL_REFLECTION_MAP);
+    glEnable(GL_TEXTURE_GEN_S);
+    glEnable(GL_TEXTURE_GEN_T);
+    glEnable(GL_TEXTURE_GEN_R);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_INTERPOLATE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_TEXTURE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_PREVIOUS);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_RGB, GL_SRC_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE2_RGB, GL_CONSTANT);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND2_RGB, GL_SRC_ALPHA);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_REPLACE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PREVIOUS);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA);
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void iblSetViewMatrix(const GLfloat viewMatrix[16])
+{
+    /* eye to world is the transpose of the rotation of the view */
+    GLfloat rotation[16] = {0.0f};
+    for (int column = 0; column < 3; ++column)
+    {
+        for (int row = 0; row < 3; ++row)
+        {
+            rotation[column * 4 + row] = viewMatrix[row * 4 + column];
+        }
+    }
+    rotation[15] = 1.0f;
+
+    glMatrixMode(GL_TEXTURE);
+    glActiveTexture(GL_TEXTURE0 + IBL_IRRADIANCE_UNIT);
+    glLoadMatrixf(rotation);
+    glActiveTexture(GL_TEXTURE0 + IBL_SPECULAR_UNIT);
+    glLoadMatrixf(rotation);
+    glActiveTexture(GL_TEXTURE0);
+    glMatrixMode(GL_MODELVIEW);
+}
+
+void iblSetMaterial(const Ibl *pIbl, GLfloat roughness, GLfloat reflectance)
+{
+    const GLfloat color[4] = {0.0f, 0.0f, 0.0f, reflectance};
+
+    glActiveTexture(GL_TEXTURE0 + IBL_SPECULAR_UNIT);
+    glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, color);
+    glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_LOD, roughness * (GLfloat)(pIbl->nLevels - 1U));
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void iblUninitialize(Ibl *pIbl)
+{
+    if (0U != pIbl->irradianceTexture)
+    {
+        glDeleteTextures(1, &pIbl->irradianceTexture);
+        pIbl->irradianceTexture = 0U;
+    }
+
+    if (0U != pIbl->specularTexture)
+    {
+        glDeleteTextures(1, &pIbl->specularTexture);
+        pIbl->specularTexture = 0U;
+    }
+}
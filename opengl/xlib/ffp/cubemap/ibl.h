@@ -0,0 +1,88 @@
+#ifndef IBL_H
+#define IBL_H
+
+/**
+ * @file   ibl.h
+ * @brief  Image based lighting of the fixed function pipeline from six cube faces
+ *
+ * The faces are convolved once on the CPU, then every pixel takes one lookup
+ * per term instead of integrating the environment:
+ *
+ * 1. specular   - GGX prefiltered mip chain, level l holds roughness
+ *    l / (nLevels - 1) for N = V = R (split sum). Each texel importance samples
+ *    the GGX lobe and reads the source at the mip that matches the solid angle
+ *    of the sample (filtered importance sampling), so few samples suffice.
+ * 2. irradiance - the environment projected on the first nine spherical
+ *    harmonics and convolved with the clamped cosine, baked into a small cube
+ *    map for the diffuse term.
+ *
+ * Chain and coefficients are written to a cache file keyed by the size and
+ * modification time of the faces, a later launch only reads it back.
+ *
+ * Texture unit IBL_IRRADIANCE_UNIT modulates the primary color (albedo) with
+ * the irradiance in the normal direction, unit IBL_SPECULAR_UNIT blends the
+ * prefiltered environment in the reflected direction on top by reflectance.
+ * Roughness picks the mip through GL_TEXTURE_MIN_LOD.
+ *
+ * The other cube map samples (cocoa/pp/cubemap, win32/CubeMap) draw their
+ * faces only as a skybox sampled at level 0 and light nothing with them, so
+ * there is no chain or irradiance for them to use and they keep loading the
+ * faces directly.
+ */
+
+#include <GL/gl.h>
+#include <stdint.h>
+
+#define IBL_SIZE            512U /**< texels per side of level 0, the mirror reflection */
+#define IBL_LEVELS          7U   /**< prefiltered levels, 512 to 8 texels, roughness 0 to 1 */
+#define IBL_SAMPLES         64U  /**< GGX samples per texel */
+#define IBL_IRRADIANCE_SIZE 32U  /**< texels per side of the irradiance cube map */
+#define IBL_IRRADIANCE_UNIT 0U
+#define IBL_SPECULAR_UNIT   1U
+
+typedef struct Ibl
+{
+    uint32_t size;    /**< texels per side of level 0 */
+    uint32_t nLevels; /**< levels of the specular chain */
+    float    sh[9][3]; /**< irradiance / pi as SH9 coefficients per color, linear */
+
+    GLuint specularTexture;   /**< prefiltered chain, GL_TEXTURE_CUBE_MAP */
+    GLuint irradianceTexture; /**< GL_TEXTURE_CUBE_MAP */
+} Ibl;
+
+/**
+ * @brief Load the prefiltered environment from cache or convolve the faces, create textures
+ *
+ * @param faces     [in] - +X, -X, +Y, -Y, +Z, -Z images, square and of equal size
+ * @param cachePath [in] - file of the convolved environment, nullptr disables the cache
+ *
+ * @returns 0 on success else negative value
+ */
+int iblInitialize(Ibl *pIbl, const char *const faces[6], const char *cachePath);
+
+/**
+ * @brief Set up both texture units, texture generation and combiners
+ */
+void iblBind(const Ibl *pIbl);
+
+/**
+ * @brief Rotate generated directions from eye to world space, call after the view transform
+ *
+ * @param viewMatrix [in] - column major world to eye transform
+ */
+void iblSetViewMatrix(const GLfloat viewMatrix[16]);
+
+/**
+ * @brief Surface of the following geometry, may be compiled into display lists
+ *
+ * @param roughness   [in] - 0 for a mirror to 1
+ * @param reflectance [in] - share of the specular term, 0 to 1
+ */
+void iblSetMaterial(const Ibl *pIbl, GLfloat roughness, GLfloat reflectance);
+
+/**
+ * @brief Delete textures
+ */
+void iblUninitialize(Ibl *pIbl);
+
+#endif // !IBL_H
@@ -10,7 +10,9 @@
 #include <iostream>
 #define _USE_MATH_DEFINES
 #include <math.h>
-#include "stb_image.h"
+#include "ibl.h"
+
+#define IBL_CACHE_PATH "res/cubemap.ibl" /**< prefiltered environment, rebuilt when a face changes */
 
 static void quadloop(GLfloat r, GLfloat R, GLint nsides, GLfloat sideDelta, GLfloat cosTheta, GLfloat sinTheta, GLfloat cosTheta1, GLfloat sinTheta1);
 static void doughnut(GLfloat r, GLfloat R, GLint nsides, GLint rings);
@@ -40,6 +42,7 @@ GLfloat     colorBlack[4] = {0.0f, 0.0f, 0.0f, 1.0f};
 GLfloat     zPos          = 0.1f;
 GLfloat     xPos          = 0.1f;
 GLUquadric *pQuadric;
+Ibl         ibl;
 
 /* Light properties */
 GLfloat lightPosition[4]       = {3.0f, 0.0f, 2.0f, 1.0f};
@@ -224,20 +227,11 @@ GLuint torus;
 void makeImages(void)
 {
     const char *names[] = {"res/right.jpg", "res/left.jpg", "res/top.jpg", "res/bottom.jpg", "res/front.jpg", "res/back.jpg"};
-    int         width, height, nrChannels;
 
-    for (uint32_t idx = 0U; idx < 6U; ++idx)
+    /* specular mip chain and irradiance are convolved on the first launch only */
+    if (0 != iblInitialize(&ibl, names, IBL_CACHE_PATH))
     {
-        unsigned char *data = stbi_load(names[idx], &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X_EXT + idx, 0, GL_RGBA, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        }
-        else
-        {
-            std::cout << "Failed to load texture" << std::endl;
-        }
-        stbi_image_free(data);
+        std::cout << "Failed to load texture" << std::endl;
     }
 }
 void drawCube()
@@ -311,26 +305,9 @@ static void initialize()
     glLightfv(GL_LIGHT0, GL_DIFFUSE, lightDiffuse);
     glLightfv(GL_LIGHT0, GL_SPECULAR, lightSpecular);
 
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP_EXT, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    /* diffuse from the irradiance in the normal direction, specular from the prefiltered chain in the reflected one */
     makeImages();
-    // glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_NORMAL_MAP_EXT);
-    // glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_NORMAL_MAP_EXT);
-    // glTexGeni(GL_R, GL_TEXTURE_GEN_MODE, GL_NORMAL_MAP_EXT);
-    glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_REFLECTION_MAP_EXT);
-    glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_REFLECTION_MAP_EXT);
-    glTexGeni(GL_R, GL_TEXTURE_GEN_MODE, GL_REFLECTION_MAP_EXT);
-    glEnable(GL_TEXTURE_GEN_S);
-    glEnable(GL_TEXTURE_GEN_T);
-    glEnable(GL_TEXTURE_GEN_R);
-
-    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-
-    glEnable(GL_TEXTURE_CUBE_MAP_EXT);
+    iblBind(&ibl);
     // glEnable(GL_LIGHTING);
     // glEnable(GL_LIGHT0);
     // glMaterialfv(GL_FRONT, GL_DIFFUSE, colorWhite);
@@ -339,12 +316,20 @@ static void initialize()
 
     torus = glGenLists(1);
     glNewList(torus, GL_COMPILE);
+    /* chrome */
+    glColor4fv(colorWhite);
+    iblSetMaterial(&ibl, 0.0f, 1.0f);
     glTranslatef(-4.0f, 0.0f, 0.0f);
     gluSphere(pQuadric, 1.0f, 100, 100);
     glTranslatef(4.0f, 0.0f, 0.0f);
-    
+
+    /* brushed metal */
+    iblSetMaterial(&ibl, 0.45f, 0.8f);
     drawCube();
 
+    /* yellow plastic */
+    glColor4fv(materialYellow);
+    iblSetMaterial(&ibl, 0.8f, 0.1f);
     glTranslatef(4.0f, 0.0f, 0.0f);
     doughnut(0.3f, 0.8f, 50, 50);
     glEndList();
@@ -358,6 +343,7 @@ void uninitialize()
 {
     glDeleteLists(torus, 1);
     gluDeleteQuadric(pQuadric);
+    iblUninitialize(&ibl);
 }
 
 float angle = 0.0f;
@@ -371,6 +357,11 @@ static void display()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     gluLookAt(xPos, 2.0f, zPos, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
 
+    /* the environment stays put in world space while the camera circles */
+    GLfloat viewMatrix[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, viewMatrix);
+    iblSetViewMatrix(viewMatrix);
+
     // Load and enable the appropriate texture for each face of the cube
     // Assuming you have loaded and bound textures for each face (front, back, left, right, top, bottom)
 
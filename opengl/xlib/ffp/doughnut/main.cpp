@@ -22,7 +22,6 @@ static void update();
 static void resize(GLsizei width, GLsizei height);
 static void toggleFullscreen(Display *display, Window window);
 
-void setShadowMatrix(GLfloat *destMat, float *lightPos, float *plane);
 void        DrawGround(void);
 
 /* Windowing related variables */
@@ -40,8 +39,6 @@ GLUquadric *pQuadric;
 GLfloat     colorWhite[4] = {1.0f, 1.0f, 1.0f, 1.0f};
 GLfloat     colorBlack[4] = {0.0f, 0.0f, 0.0f, 1.0f};
 GLfloat     yPos          = 0.1f;
-float   plane[4]     = {0.0, 1.0, 0.0, 0.0};
-GLfloat g_shadowMatrix[16];
 
 /* Light properties */
 GLfloat lightPosition[4]       = {3.0f, 0.0f, 2.0f, 1.0f};
@@ -266,7 +263,6 @@ static void initialize()
     DrawGround();
     glPopAttrib();
     glEndList();
-    setShadowMatrix(g_shadowMatrix, lightPosition, plane);
 
     // Set the clipping plane equation
     resize(xattr.width, xattr.height);
@@ -519,35 +515,4 @@ void DrawGround(void)
         glEnd();
     }
     glShadeModel(GL_SMOOTH);
-}
-void setShadowMatrix(GLfloat *destMat, float *lightPos, float *plane)
-{
-    GLfloat dot;
-
-    // dot product of plane and light position
-    dot = plane[0] * lightPos[0] + plane[1] * lightPos[1] + plane[1] * lightPos[2] + plane[3] * lightPos[3];
-
-    // first column
-    destMat[0]  = dot - lightPos[0] * plane[0];
-    destMat[4]  = 0.0f - lightPos[0] * plane[1];
-    destMat[8]  = 0.0f - lightPos[0] * plane[2];
-    destMat[12] = 0.0f - lightPos[0] * plane[3];
-
-    // second column
-    destMat[1]  = 0.0f - lightPos[1] * plane[0];
-    destMat[5]  = dot - lightPos[1] * plane[1];
-    destMat[9]  = 0.0f - lightPos[1] * plane[2];
-    destMat[13] = 0.0f - lightPos[1] * plane[3];
-
-    // third column
-    destMat[2]  = 0.0f - lightPos[2] * plane[0];
-    destMat[6]  = 0.0f - lightPos[2] * plane[1];
-    destMat[10] = dot - lightPos[2] * plane[2];
-    destMat[14] = 0.0f - lightPos[2] * plane[3];
-
-    // fourth column
-    destMat[3]  = 0.0f - lightPos[3] * plane[0];
-    destMat[7]  = 0.0f - lightPos[3] * plane[1];
-    destMat[11] = 0.0f - lightPos[3] * plane[2];
-    destMat[15] = dot - lightPos[3] * plane[3];
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
+#include <GL/glext.h>
 #include <GL/glu.h>
 #include <GL/glut.h>
 #include <GL/glx.h>
@@ -12,6 +14,12 @@
 #include "stb_image.h"
 #include <math.h>
 
+#define SHADOW_MAP_SIZE 1024  // texels per side of the depth texture
+#define SHADOW_FOVY     40.0f // field of view of the light, wide enough for the cube
+#define SHADOW_NEAR     1.0f  // near plane of the light
+#define SHADOW_FAR      30.0f // far plane of the light, beyond every receiver
+#define SHADOW_DARKNESS 0.6f  // share of the colour taken away in shadow
+
 /* function declaration */
 static void initialize();
 static void uninitialize();
@@ -25,7 +33,10 @@ void        DrawCube();
 void        DrawSurface();
 void        loadTexture(const char *pFilename, uint32_t *pTextureID);
 
-void setShadowMatrix(GLfloat *result, float *lightPost, float *plane);
+static void initializeShadowMap(void);
+static void renderShadowMap(void);
+static void applyShadowMap(void);
+static void uninitializeShadowMap(void);
 
 /* Windowing related variables */
 Display   *dpy          = nullptr; // connection to server
@@ -59,8 +70,10 @@ GLfloat fFogColor[4] = {0.847656f, 0.84375f, 0.83984f, 1.0f};
 
 float g_rotationAngle = 0.0;
 
-GLfloat g_lightPos[4] = {5.0, 5.0, 5.0, 1.0};
-GLfloat g_shadowMatrix[16];
+/* Shadow map, depth of the cube seen from the light */
+GLuint  shadowTexture = 0U;
+GLuint  shadowFbo     = 0U;
+GLfloat g_lightMatrix[16]; // world to shadow map texture coordinates, column major
 
 /* Material Diffuse */
 GLfloat materialDiffuse[4] = {1.0f, 1.0f, 1.0f, 1.0f};
@@ -267,6 +280,8 @@ static void initialize()
     glPopAttrib();
     glEndList();
 
+    initializeShadowMap();
+
     // Set the clipping plane equation
     resize(xattr.width, xattr.height);
     // toggleFullscreen(dpy, w);
@@ -274,6 +289,7 @@ static void initialize()
 
 void uninitialize()
 {
+    uninitializeShadowMap();
     glDeleteLists(cube, 2);
 }
 
@@ -281,6 +297,9 @@ float angle = 0.0f;
 
 static void display()
 {
+    /* depth of the occluders from the light, before the camera clears its buffers */
+    renderShadowMap();
+
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
@@ -310,20 +329,6 @@ static void display()
     glFrontFace(GL_CCW);
     glPopMatrix();
 
-    glPushMatrix();
-    glPushAttrib(GL_LIGHTING_BIT);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_LIGHTING);
-    glEnable(GL_BLEND);
-
-    // glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
-    glMultMatrixf(g_shadowMatrix);
-    glCallList(cube);
-
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-    glPopAttrib();
-    glPopMatrix();
     glDisable(GL_STENCIL_TEST);
 
     /* draw actual object */
@@ -337,13 +342,15 @@ static void display()
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glCallList(cube + 1);
     glDisable(GL_BLEND);
+
+    /* darken every receiver where the shadow map says the light is blocked */
+    applyShadowMap();
 }
 
 void drawScene()
 {
 }
 
-float       plane[4] = {0.0, 1.0, 0.0, 0.0};
 static void update()
 {
     angle += 0.01;
@@ -353,7 +360,6 @@ static void update()
     }
     lightPosition[0] = 5 * cosf(angle);
     lightPosition[2] = 5 * sinf(angle);
-    setShadowMatrix(g_shadowMatrix, lightPosition, plane);
 }
 
 static void resize(GLsizei width, GLsizei height)
@@ -532,34 +538,148 @@ void drawCube()
 
     glEnd();
 }
-void setShadowMatrix(GLfloat *destMat, float *lightPos, float *plane)
+static void initializeShadowMap(void)
+{
+    const GLfloat border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    /* the comparison is done by the texture unit, linear filtering averages four results (PCF) */
+    glGenTextures(1, &shadowTexture);
+    glBindTexture(GL_TEXTURE_2D, shadowTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_TEXTURE_MODE, GL_INTENSITY);
+    glBindTexture(GL_TEXTURE_2D, 0U);
+
+    glGenFramebuffers(1, &shadowFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadowFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadowTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER))
+    {
+        fprintf(stderr, "Error: shadow map framebuffer is incomplete\n");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0U);
+}
+
+static void renderShadowMap(void)
+{
+    GLint   viewport[4];
+    GLfloat projection[16];
+    GLfloat view[16];
+
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadowFbo);
+    glViewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    /* the light looks at the cube */
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluPerspective(SHADOW_FOVY, 1.0, SHADOW_NEAR, SHADOW_FAR);
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    gluLookAt(lightPosition[0], lightPosition[1], lightPosition[2], 0.0, 1.0, 0.0, 0.0, 1.0, 0.0);
+    glGetFloatv(GL_MODELVIEW_MATRIX, view);
+
+    /* clip space -1..1 into texture space 0..1, let the texture stack do the multiplication */
+    glMatrixMode(GL_TEXTURE);
+    glPushMatrix();
+    glLoadIdentity();
+    glTranslatef(0.5f, 0.5f, 0.5f);
+    glScalef(0.5f, 0.5f, 0.5f);
+    glMultMatrixf(projection);
+    glMultMatrixf(view);
+    glGetFloatv(GL_TEXTURE_MATRIX, g_lightMatrix);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    /* depth only, slope scaled offset keeps lit faces from shadowing themselves */
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    glPushMatrix();
+    glCallList(cube);
+    glPopMatrix();
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0U);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+static void applyShadowMap(void)
 {
-    GLfloat dot;
-
-    // dot product of plane and light position
-    dot = plane[0] * lightPos[0] + plane[1] * lightPos[1] + plane[1] * lightPos[2] + plane[3] * lightPos[3];
-
-    // first column
-    destMat[0]  = dot - lightPos[0] * plane[0];
-    destMat[4]  = 0.0f - lightPos[0] * plane[1];
-    destMat[8]  = 0.0f - lightPos[0] * plane[2];
-    destMat[12] = 0.0f - lightPos[0] * plane[3];
-
-    // second column
-    destMat[1]  = 0.0f - lightPos[1] * plane[0];
-    destMat[5]  = dot - lightPos[1] * plane[1];
-    destMat[9]  = 0.0f - lightPos[1] * plane[2];
-    destMat[13] = 0.0f - lightPos[1] * plane[3];
-
-    // third column
-    destMat[2]  = 0.0f - lightPos[2] * plane[0];
-    destMat[6]  = 0.0f - lightPos[2] * plane[1];
-    destMat[10] = dot - lightPos[2] * plane[2];
-    destMat[14] = 0.0f - lightPos[2] * plane[3];
-
-    // fourth column
-    destMat[3]  = 0.0f - lightPos[3] * plane[0];
-    destMat[7]  = 0.0f - lightPos[3] * plane[1];
-    destMat[11] = 0.0f - lightPos[3] * plane[2];
-    destMat[15] = dot - lightPos[3] * plane[3];
+    /* 1 where lit, 1 - SHADOW_DARKNESS in shadow: texture * alpha + 1 * (1 - alpha) */
+    const GLfloat  shadowColor[4] = {1.0f, 1.0f, 1.0f, SHADOW_DARKNESS};
+    const GLenum   coords[4]      = {GL_S, GL_T, GL_R, GL_Q};
+    const GLenum   genEnables[4]  = {GL_TEXTURE_GEN_S, GL_TEXTURE_GEN_T, GL_TEXTURE_GEN_R, GL_TEXTURE_GEN_Q};
+
+    glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT | GL_LIGHTING_BIT);
+
+    /* eye planes are taken through the inverse of the current modelview, the camera view, so s t r q come out in light space */
+    for (int i = 0; i < 4; ++i)
+    {
+        GLfloat plane[4] = {g_lightMatrix[i], g_lightMatrix[i + 4], g_lightMatrix[i + 8], g_lightMatrix[i + 12]};
+        glTexGeni(coords[i], GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+        glTexGenfv(coords[i], GL_EYE_PLANE, plane);
+        glEnable(genEnables[i]);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, shadowTexture);
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, shadowColor);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_INTERPOLATE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_TEXTURE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_CONSTANT);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_RGB, GL_SRC_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE2_RGB, GL_CONSTANT);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND2_RGB, GL_SRC_ALPHA);
+
+    /* multiply what is already in the colour buffer, same geometry so the depth test passes on equal */
+    glDisable(GL_LIGHTING);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_DST_COLOR, GL_ZERO);
+
+    glPushMatrix();
+    glCallList(cube);
+    glPopMatrix();
+    glCallList(cube + 1);
+
+    glBindTexture(GL_TEXTURE_2D, 0U);
+    glPopAttrib();
+}
+
+static void uninitializeShadowMap(void)
+{
+    if (0U != shadowFbo)
+    {
+        glDeleteFramebuffers(1, &shadowFbo);
+        shadowFbo = 0U;
+    }
+
+    if (0U != shadowTexture)
+    {
+        glDeleteTextures(1, &shadowTexture);
+        shadowTexture = 0U;
+    }
 }
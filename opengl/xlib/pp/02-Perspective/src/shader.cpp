@@ -16,30 +16,276 @@
 #include <fstream>
 #include <algorithm>
 #include <sstream>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "shader.h"
-#include <GL/gl.h>
-GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path, GLuint* pProgram)
+
+#define SHADER_CACHE_MAGIC   0x42505347U /**< "GSPB" */
+#define SHADER_CACHE_VERSION 1U
+
+/* header of a cache file, followed by the program binary */
+struct ShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format; /**< binaryFormat of glGetProgramBinary */
+    uint32_t length; /**< bytes of binary */
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool readSource(const char* pFilename, std::string& source)
+{
+    std::ifstream sourceInputStream(pFilename, std::ios::in);
+
+    if (!sourceInputStream.is_open())
+    {
+        std::cerr << "failed to read shader" << pFilename << std::endl;
+        return false;
+    }
+
+    std::stringstream sstr;
+    sstr << sourceInputStream.rdbuf();
+    source = sstr.str();
+    return true;
+}
+
+/* defines go after the #version line, which has to come first */
+static std::string addDefines(const std::string& source, const char* pDefines)
+{
+    if (NULL == pDefines || '\0' == pDefines[0])
+        return source;
+
+    size_t position = 0;
+    if (0 == source.compare(0, 8, "#version"))
+    {
+        position = source.find('\n');
+        position = (std::string::npos == position) ? source.size() : position + 1;
+    }
+
+    std::string result = source.substr(0, position) + pDefines;
+    if ('\n' != result[result.size() - 1])
+        result += '\n';
+    return result + source.substr(position);
+}
+
+/* FNV-1a, strings are hashed with their terminating zero so "ab" + "c" != "a" + "bc" */
+static uint64_t hashString(uint64_t hash, const char* pString)
+{
+    if (NULL == pString)
+        pString = "";
+
+    do
+    {
+        hash = (hash ^ (uint8_t)*pString) * 1099511628211ULL;
+    } while ('\0' != *pString++);
+
+    return hash;
+}
+
+/* cache is disabled when SHADER_CACHE_DIR is set to an empty string */
+static std::string cachePath(uint64_t key)
+{
+    const char* pDirectory = getenv("SHADER_CACHE_DIR");
+    if (NULL == pDirectory)
+        pDirectory = "shadercache";
+    if ('\0' == pDirectory[0])
+        return std::string();
+
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return std::string(pDirectory) + name;
+}
+
+static bool programBinarySupported(void)
 {
+    GLint formats = 0;
+
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+        return false;
+
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return 0 < formats;
+}
+
+static bool loadProgramBinary(GLuint program, const std::string& path, uint64_t key)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    ShaderCacheHeader header;
+
+    if (!file.is_open() || !file.read((char*)&header, sizeof(header)))
+        return false;
+
+    if (SHADER_CACHE_MAGIC != header.magic || SHADER_CACHE_VERSION != header.version || key != header.key)
+        return false;
+
+    /* the length is read from the file, it has to match what the file holds before anything is allocated */
+    file.seekg(0, std::ios::end);
+    std::streamoff available = (std::streamoff)file.tellg() - (std::streamoff)sizeof(header);
+    if (0U == header.length || (std::streamoff)header.length != available)
+        return false;
+    file.seekg(sizeof(header), std::ios::beg);
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), header.length))
+        return false;
+
+    /* a driver update may reject binaries it wrote itself, the program is then left unlinked */
+    GLint result = GL_FALSE;
+    glProgramBinary(program, header.format, binary.data(), (GLsizei)header.length);
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+    return GL_TRUE == result;
+}
+
+/* mkdir -p, creates every missing directory of the path */
+static void makeDirectories(const std::string& directory)
+{
+    size_t position = directory.find('/', 1);
+    while (std::string::npos != position)
+    {
+        mkdir(directory.substr(0, position).c_str(), 0755);
+        position = directory.find('/', position + 1);
+    }
+    mkdir(directory.c_str(), 0755);
+}
+
+static void saveProgramBinary(GLuint program, const std::string& path, uint64_t key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (0 >= length)
+        return;
+
+    ShaderCacheHeader header = {SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, key, 0U, 0U};
+    std::vector<char> binary(length);
+    GLenum format = 0;
+
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    header.format = format;
+    header.length = (uint32_t)length;
+
+    makeDirectories(path.substr(0, path.rfind('/')));
+
+    /* write to a temporary file of unique name and rename, other instances never see a partial file */
+    std::string temporary = path + ".XXXXXX";
+    int         fd        = mkstemp(&temporary[0]);
+    FILE*       pFile     = (-1 == fd) ? NULL : fdopen(fd, "wb");
+    if (NULL == pFile)
+    {
+        std::cerr << "Failed to write shader cache " << temporary << std::endl;
+        if (-1 != fd)
+        {
+            close(fd);
+            remove(temporary.c_str());
+        }
+        return;
+    }
+    fchmod(fd, 0644);
+
+    bool bWritten = (1 == fwrite(&header, sizeof(header), 1, pFile)) && (1 == fwrite(binary.data(), length, 1, pFile));
+    bWritten      = (0 == fclose(pFile)) && bWritten;
+
+    if (!bWritten || 0 != rename(temporary.c_str(), path.c_str()))
+    {
+        std::cerr << "Failed to write shader cache " << path << std::endl;
+        remove(temporary.c_str());
+    }
+}
+
+static GLint compileShader(GLuint shaderId, const char* pFilename, const std::string& sourceString)
+{
+    GLint result = GL_FALSE;
+
+    // Compile shader
+    std::cout << "Compiling shader: " << pFilename << std::endl;
+    char const* pSourceCode = sourceString.c_str();
+    glShaderSource(shaderId, 1, &pSourceCode, NULL);
+    glCompileShader(shaderId);
+
+    // validate compilation status
+    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &result);
+    if (GL_TRUE != result)
+    {
+        int infoLogLen = 0;
+        std::cerr << "Failed to compile shader: " << pFilename << std::endl;
+
+        glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &infoLogLen);
+        if (infoLogLen > 0)
+        {
+            std::vector<char> msg(infoLogLen);
+            glGetShaderInfoLog(shaderId, infoLogLen, NULL, msg.data());
+            std::cerr << msg.data() << std::endl;
+        }
+    }
+    return (result);
+}
+
+GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path, GLuint* pProgram, const char* pDefines)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string vertexSource;
+    std::string fragmentSource;
+
+    if (!readSource(vertex_file_path, vertexSource) || !readSource(fragment_file_path, fragmentSource))
+        return (GL_FALSE);
+
+    vertexSource   = addDefines(vertexSource, pDefines);
+    fragmentSource = addDefines(fragmentSource, pDefines);
+
+    // Key covers sources and driver, binaries of another GPU or driver version are never tried
+    uint64_t key = 14695981039346656037ULL;
+    key = hashString(key, vertexSource.c_str());
+    key = hashString(key, fragmentSource.c_str());
+    key = hashString(key, (const char*)glGetString(GL_VENDOR));
+    key = hashString(key, (const char*)glGetString(GL_RENDERER));
+    key = hashString(key, (const char*)glGetString(GL_VERSION));
+
+    const bool bCache = programBinarySupported();
+    const std::string path = bCache ? cachePath(key) : std::string();
+
+    // Created up front for the cached binary, a failed glProgramBinary leaves it reusable for the link below
+    *pProgram = glCreateProgram();
+    if (!path.empty() && loadProgramBinary(*pProgram, path, key))
+    {
+        std::cout << "Loaded program from " << path << " in " << elapsedMs(start) << " ms\n";
+        return (GL_TRUE);
+    }
+
     // Create the shaders
     GLuint vertexShader   = glCreateShader(GL_VERTEX_SHADER);
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 
     GLint result;
 
-    result = loadShader(vertexShader, vertex_file_path);
-    if (GL_TRUE != result) { return (result); }
-    result = loadShader(fragmentShader, fragment_file_path);
+    start  = std::chrono::steady_clock::now();
+    result = compileShader(vertexShader, vertex_file_path, vertexSource);
+    if (GL_TRUE == result)
+        result = compileShader(fragmentShader, fragment_file_path, fragmentSource);
     if (GL_TRUE != result)
     {
-        std::cout << "Deleting vertex shader\n";
+        std::cout << "Deleting shaders\n";
         glDeleteShader(vertexShader);
-        std::cout << "Deleting vertex shader\n";
+        glDeleteShader(fragmentShader);
+        glDeleteProgram(*pProgram);
+        *pProgram = 0U;
         return (result);
     }
+    double compileMs = elapsedMs(start);
 
     // Link the program
     std::cout << "Linking program\n";
-    *pProgram = glCreateProgram();
+    start = std::chrono::steady_clock::now();
+    if (bCache)
+        glProgramParameteri(*pProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glAttachShader(*pProgram, vertexShader);
     glAttachShader(*pProgram, fragmentShader);
     glLinkProgram(*pProgram);
@@ -50,16 +296,23 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path,
     {
         // linking Failed
         int infoLogLen = 0;
-        std::cerr << "Failed to link program\nwooreogieogieroigeorni";
+        std::cerr << "Failed to link program\n";
         glGetProgramiv(*pProgram, GL_INFO_LOG_LENGTH, &infoLogLen);
         if (infoLogLen > 0)
         {
-            char msg[infoLogLen + 1];
-            glGetProgramInfoLog(*pProgram, infoLogLen, nullptr, msg);
-            std::cerr << msg << std::endl;
+            std::vector<char> msg(infoLogLen + 1);
+            glGetProgramInfoLog(*pProgram, infoLogLen, nullptr, msg.data());
+            std::cerr << msg.data() << std::endl;
         }
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        glDeleteProgram(*pProgram);
+        *pProgram = 0U;
         return (result);
     }
+    double linkMs = elapsedMs(start);
+
+    std::cout << "Compiled shaders in " << compileMs << " ms, linked in " << linkMs << " ms\n";
 
     glDetachShader(*pProgram, vertexShader);
     glDetachShader(*pProgram, fragmentShader);
@@ -67,48 +320,18 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path,
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
+    if (!path.empty())
+        saveProgramBinary(*pProgram, path, key);
+
     return (result);
 }
 
 GLint loadShader(GLuint shaderId, const char* pFilename)
 {
-    GLint result = GL_FALSE;
     std::string sourceString;
-    std::ifstream sourceInputStream(pFilename, std::ios::in);
 
-    if (sourceInputStream.is_open())
-    {
-        std::stringstream sstr;
-        sstr << sourceInputStream.rdbuf();
-        sourceString = sstr.str();
-        sourceInputStream.close();
-    }
-    else
-    {
-        std::cerr << "failed to read shader" << pFilename << std::endl;
+    if (!readSource(pFilename, sourceString))
         return (GL_FALSE);
-    }
-
-    // Compile shader
-    std::cout << "Compiling shader: " << pFilename << std::endl;
-    char const* pSourceCode = sourceString.c_str();
-    glShaderSource(shaderId, 1, &pSourceCode, NULL);
-    glCompileShader(shaderId);
-
-    // validate compilation status
-    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &result);
-    if (GL_TRUE != result)
-    {
-        int infoLogLen = 0;
-        std::cerr << "Failed to compile shader: " << pFilename << std::endl;
 
-        glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &infoLogLen);
-        if (infoLogLen > 0)
-        {
-            char msg[infoLogLen];
-            glGetShaderInfoLog(shaderId, infoLogLen, NULL, msg);
-            std::cerr << msg << std::endl;
-        }
-    }
-    return (result);
+    return compileShader(shaderId, pFilename, sourceString);
 }
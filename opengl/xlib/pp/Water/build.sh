@@ -1,5 +1,6 @@
 #!/bin/bash
 
-rm ogl ogl.o
+rm ogl ogl.o ocean.o
 g++ -c -o ogl.o -g3 -I/usr/include ./ogl.cpp -g3
-g++ -o ogl -g3 -L/usr/lib/x86_64-linux-gnu -L . ogl.o -lX11 -lGL -lGLEW -lSphere
+g++ -c -o ocean.o -g3 -I/usr/include ./ocean.cpp
+g++ -o ogl -g3 -L/usr/lib/x86_64-linux-gnu -L . ogl.o ocean.o -lX11 -lGL -lGLEW -lSphere
@@ -0,0 +1,392 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ocean.h"
+
+#define OCEAN_GRAVITY    9.81f
+#define OCEAN_LOCAL_SIZE 16U /**< work group side of the spectrum and resolve passes */
+
+/* texel (n, m) is the wave vector 2 pi (n - N / 2, m - N / 2) / patchLength */
+static const char *oceanSpectrumSource = "layout(local_size_x = 16, local_size_y = 16) in;"
+                                         "\n"
+                                         "layout(binding = 0, rgba32f) uniform readonly  image2D uSpectrum;"
+                                         "layout(binding = 1, rgba32f) uniform writeonly image2D uFields;"
+                                         "\n"
+                                         "layout(location = 0) uniform float uTime;"
+                                         "layout(location = 1) uniform float uPatchLength;"
+                                         "\n"
+                                         "vec2 cmul(vec2 a, vec2 b)"
+                                         "{"
+                                         "    return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);"
+                                         "}"
+                                         "\n"
+                                         "void main(void)"
+                                         "{"
+                                         "    ivec2 id      = ivec2(gl_GlobalInvocationID.xy);"
+                                         "    vec2  k       = (vec2(id) - float(OCEAN_N / 2)) * (6.28318530718 / uPatchLength);"
+                                         "    float kLength = length(k);"
+                                         "    vec2  kUnit   = (kLength > 1e-6) ? k / kLength : vec2(0.0);"
+                                         "\n"
+                                         "    float omega = sqrt(9.81 * kLength) * uTime;"
+                                         "    vec2  e     = vec2(cos(omega), sin(omega));"
+                                         "    vec4  h0    = imageLoad(uSpectrum, id);"
+                                         "    vec2  h     = cmul(h0.xy, e) + cmul(h0.zw, vec2(e.x, -e.y));"
+                                         "\n"
+                                         /* all fields are real, height + i dx is one complex, dx = -i kx / |k| h */
+                                         "    vec2 heightDx = h * (1.0 + kUnit.x);"
+                                         "    vec2 dz       = vec2(h.y, -h.x) * kUnit.y;"
+                                         "    imageStore(uFields, id, vec4(heightDx, dz));"
+                                         "}";
+
+static const char *oceanFftSource = "layout(local_size_x = OCEAN_N / 2) in;"
+                                    "\n"
+                                    "layout(binding = 0, rgba32f) uniform readonly  image2D uInput;"
+                                    "layout(binding = 1, rgba32f) uniform writeonly image2D uOutput;"
+                                    "\n"
+                                    "layout(location = 0) uniform int uVertical;"
+                                    "\n"
+                                    "shared vec4 lines[2][OCEAN_N];"
+                                    "\n"
+                                    "vec2 cmul(vec2 a, vec2 b)"
+                                    "{"
+                                    "    return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);"
+                                    "}"
+                                    "\n"
+                                    "void main(void)"
+                                    "{"
+                                    "    int   j    = int(gl_LocalInvocationID.x);"
+                                    "    int   line = int(gl_WorkGroupID.x);"
+                                    "    ivec2 p0   = (0 != uVertical) ? ivec2(line, j) : ivec2(j, line);"
+                                    "    ivec2 p1   = (0 != uVertical) ? ivec2(line, j + OCEAN_N / 2) : ivec2(j + OCEAN_N / 2, line);"
+                                    "\n"
+                                    "    lines[0][j]               = imageLoad(uInput, p0);"
+                                    "    lines[0][j + OCEAN_N / 2] = imageLoad(uInput, p1);"
+                                    "    barrier();"
+                                    "\n"
+                                    /* every texel holds two complex numbers, both are transformed at once */
+                                    "    int source = 0;"
+                                    "    for (int span = 1; span < OCEAN_N; span <<= 1)"
+                                    "    {"
+                                    "        int   k     = j & (span - 1);"
+                                    "        float angle = 3.14159265359 * float(k) / float(span);"
+                                    "        vec2  w     = vec2(cos(angle), sin(angle));"
+                                    "        vec4  v0    = lines[source][j];"
+                                    "        vec4  v1    = lines[source][j + OCEAN_N / 2];"
+                                    "        v1          = vec4(cmul(v1.xy, w), cmul(v1.zw, w));"
+                                    "\n"
+                                    "        int target = ((j - k) << 1) + k;"
+                                    "        lines[1 - source][target]        = v0 + v1;"
+                                    "        lines[1 - source][target + span] = v0 - v1;"
+                                    "        source = 1 - source;"
+                                    "        barrier();"
+                                    "    }"
+                                    "\n"
+                                    "    imageStore(uOutput, p0, lines[source][j]);"
+                                    "    imageStore(uOutput, p1, lines[source][j + OCEAN_N / 2]);"
+                                    "}";
+
+static const char *oceanResolveSource = "layout(local_size_x = 16, local_size_y = 16) in;"
+                                        "\n"
+                                        "layout(binding = 0, rgba32f) uniform readonly  image2D uFields;"
+                                        "layout(binding = 1, rgba16f) uniform writeonly image2D uDisplacement;"
+                                        "layout(binding = 2, rgba16f) uniform writeonly image2D uNormal;"
+                                        "\n"
+                                        "layout(location = 0) uniform float uPatchLength;"
+                                        "layout(location = 1) uniform float uChoppiness;"
+                                        "\n"
+                                        /* the spectrum is centered on k = 0, which flips the sign of every other texel */
+                                        "vec3 displacement(ivec2 p)"
+                                        "{"
+                                        "    p       = p & (OCEAN_N - 1);"
+                                        "    vec4  v = imageLoad(uFields, p);"
+                                        "    float s = (0 == ((p.x + p.y) & 1)) ? 1.0 : -1.0;"
+                                        "    return s * vec3(uChoppiness * v.y, v.x, uChoppiness * v.z);"
+                                        "}"
+                                        "\n"
+                                        "void main(void)"
+                                        "{"
+                                        "    ivec2 id    = ivec2(gl_GlobalInvocationID.xy);"
+                                        "    float texel = uPatchLength / float(OCEAN_N);"
+                                        "    vec3  dx    = displacement(id + ivec2(1, 0)) - displacement(id - ivec2(1, 0));"
+                                        "    vec3  dz    = displacement(id + ivec2(0, 1)) - displacement(id - ivec2(0, 1));"
+                                        "\n"
+                                        "    vec3  normal   = normalize(cross(vec3(0.0, 0.0, 2.0 * texel) + dz, vec3(2.0 * texel, 0.0, 0.0) + dx));"
+                                        "    vec2  diagonal = vec2(1.0) + vec2(dx.x, dz.z) / (2.0 * texel);"
+                                        "    float jacobian = diagonal.x * diagonal.y - (dx.z * dz.x) / (4.0 * texel * texel);"
+                                        "\n"
+                                        "    imageStore(uDisplacement, id, vec4(displacement(id), 1.0));"
+                                        "    imageStore(uNormal, id, vec4(normal, jacobian));"
+                                        "}";
+
+/* gaussian random numbers of a fixed sequence, the same ocean every run */
+static float gaussian(uint32_t *pState)
+{
+    float u[2];
+    for (int i = 0; i < 2; i++)
+    {
+        *pState ^= *pState << 13;
+        *pState ^= *pState >> 17;
+        *pState ^= *pState << 5;
+        u[i] = ((float)(*pState >> 8) + 1.0f) / 16777217.0f;
+    }
+    return sqrtf(-2.0f * logf(u[0])) * cosf(6.28318530718f * u[1]);
+}
+
+static float phillips(float kx, float kz, float windSpeed, const vmath::vec2 &windDirection, float amplitude)
+{
+    float k2 = kx * kx + kz * kz;
+    if (k2 < 1e-12f)
+        return 0.0f;
+
+    /* largest wave of the wind, waves much shorter than a thousandth of it are damped */
+    float largest = windSpeed * windSpeed / OCEAN_GRAVITY;
+    float small   = largest / 1000.0f;
+    float along   = (kx * windDirection[0] + kz * windDirection[1]) / sqrtf(k2);
+    float p       = amplitude * expf(-1.0f / (k2 * largest * largest)) / (k2 * k2) * along * along * expf(-k2 * small * small);
+
+    /* waves travelling against the wind */
+    return (along < 0.0f) ? 0.07f * p : p;
+}
+
+static GLuint loadComputeProgram(const char *pName, uint32_t size, const char *pSource)
+{
+    char header[64];
+    snprintf(header, sizeof(header), "#version 460 core\n#define OCEAN_N %u\n", size);
+
+    const GLchar *sources[2] = {header, pSource};
+    GLuint        shader     = glCreateShader(GL_COMPUTE_SHADER);
+    GLuint        program    = glCreateProgram();
+    GLint         status     = GL_FALSE;
+    GLchar        log[1024];
+
+    glShaderSource(shader, 2, sources, NULL);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (GL_TRUE != status)
+    {
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "%s: %s shader failed to compile\n%s\n", __func__, pName, log);
+    }
+    else
+    {
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDetachShader(program, shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (GL_TRUE != status)
+        {
+            glGetProgramInfoLog(program, sizeof(log), NULL, log);
+            fprintf(stderr, "%s: %s program failed to link\n%s\n", __func__, pName, log);
+        }
+    }
+    glDeleteShader(shader);
+
+    if (GL_TRUE != status)
+    {
+        glDeleteProgram(program);
+        program = 0U;
+    }
+    return program;
+}
+
+static GLuint createTexture(GLenum format, GLsizei size, GLsizei levels)
+{
+    GLuint texture = 0U;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, levels, format, size, size);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (1 < levels) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0U);
+    return texture;
+}
+
+int oceanInitialize(Ocean *pOcean, uint32_t size, float patchLength, float windSpeed, const vmath::vec2 &windDirection, float amplitude, float choppiness)
+{
+    *pOcean = Ocean{};
+
+    if (size < OCEAN_LOCAL_SIZE || OCEAN_SIZE_MAX < size || 0U != (size & (size - 1U)))
+    {
+        fprintf(stderr, "%s: size %u is not a power of two from %u to %u\n", __func__, size, OCEAN_LOCAL_SIZE, OCEAN_SIZE_MAX);
+        return -1;
+    }
+
+    pOcean->size        = size;
+    pOcean->patchLength = patchLength;
+    pOcean->choppiness  = choppiness;
+
+    /* h0(k) = (xi_r + i xi_i) sqrt(P(k) / 2) */
+    vmath::vec2 wind  = vmath::normalize(windDirection);
+    float      *pH0   = (float *)malloc(sizeof(float) * 2U * size * size);
+    float      *pData = (float *)malloc(sizeof(float) * 4U * size * size);
+    if (NULL == pH0 || NULL == pData)
+    {
+        fprintf(stderr, "%s: out of memory for a %ux%u spectrum\n", __func__, size, size);
+        free(pH0);
+        free(pData);
+        return -1;
+    }
+
+    uint32_t state = 0x9e3779b9U;
+    for (uint32_t m = 0U; m < size; m++)
+    {
+        for (uint32_t n = 0U; n < size; n++)
+        {
+            float kx    = 6.28318530718f * ((float)n - (float)(size / 2U)) / patchLength;
+            float kz    = 6.28318530718f * ((float)m - (float)(size / 2U)) / patchLength;
+            float scale = sqrtf(0.5f * phillips(kx, kz, windSpeed, wind, amplitude));
+
+            /* -k of the first row and column is out of range, without them all fields stay real */
+            if (0U == n || 0U == m)
+                scale = 0.0f;
+
+            pH0[2U * (m * size + n)]      = gaussian(&state) * scale;
+            pH0[2U * (m * size + n) + 1U] = gaussian(&state) * scale;
+        }
+    }
+
+    /* conj(h0(-k)) next to h0(k), -k of the centered index n is N - n */
+    for (uint32_t m = 0U; m < size; m++)
+    {
+        for (uint32_t n = 0U; n < size; n++)
+        {
+            uint32_t opposite               = ((size - m) & (size - 1U)) * size + ((size - n) & (size - 1U));
+            pData[4U * (m * size + n)]      = pH0[2U * (m * size + n)];
+            pData[4U * (m * size + n) + 1U] = pH0[2U * (m * size + n) + 1U];
+            pData[4U * (m * size + n) + 2U] = pH0[2U * opposite];
+            pData[4U * (m * size + n) + 3U] = -pH0[2U * opposite + 1U];
+        }
+    }
+
+    pOcean->spectrumTexture = createTexture(GL_RGBA32F, size, 1);
+    glBindTexture(GL_TEXTURE_2D, pOcean->spectrumTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGBA, GL_FLOAT, pData);
+    glBindTexture(GL_TEXTURE_2D, 0U);
+    free(pH0);
+    free(pData);
+
+    GLsizei levels = 1;
+    while ((1U << levels) <= size)
+        levels++;
+
+    pOcean->fftTextures[0]      = createTexture(GL_RGBA32F, size, 1);
+    pOcean->fftTextures[1]      = createTexture(GL_RGBA32F, size, 1);
+    pOcean->displacementTexture = createTexture(GL_RGBA16F, size, 1);
+    pOcean->normalTexture       = createTexture(GL_RGBA16F, size, levels);
+
+    pOcean->spectrumProgram = loadComputeProgram("spectrum", size, oceanSpectrumSource);
+    pOcean->fftProgram      = loadComputeProgram("fft", size, oceanFftSource);
+    pOcean->resolveProgram  = loadComputeProgram("resolve", size, oceanResolveSource);
+
+    glGenQueries(OCEAN_QUERIES, pOcean->queries);
+
+    GLenum error = glGetError();
+    if (0U == pOcean->spectrumProgram || 0U == pOcean->fftProgram || 0U == pOcean->resolveProgram || GL_NO_ERROR != error)
+    {
+        fprintf(stderr, "%s: failed to create %ux%u ocean, error 0x%x\n", __func__, size, size, error);
+        oceanUninitialize(pOcean);
+        return -1;
+    }
+    return 0;
+}
+
+void oceanUpdate(Ocean *pOcean, float time)
+{
+    GLuint groups = pOcean->size / OCEAN_LOCAL_SIZE;
+
+    /* result of the query issued OCEAN_QUERIES updates ago, if the GPU is done with it */
+    GLuint query = pOcean->queries[pOcean->nUpdates % OCEAN_QUERIES];
+    if (OCEAN_QUERIES <= pOcean->nUpdates)
+    {
+        GLint bAvailable = GL_FALSE;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+        if (GL_TRUE == bAvailable)
+        {
+            GLuint64 elapsed = 0U;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            pOcean->lastGpuMs = (double)elapsed * 1e-6;
+            pOcean->totalGpuMs += pOcean->lastGpuMs;
+            pOcean->nTimed++;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+
+    glUseProgram(pOcean->spectrumProgram);
+    glUniform1f(0, time);
+    glUniform1f(1, pOcean->patchLength);
+    glBindImageTexture(0, pOcean->spectrumTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, pOcean->fftTextures[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glDispatchCompute(groups, groups, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    /* rows from 0 into 1, columns from 1 back into 0 */
+    glUseProgram(pOcean->fftProgram);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        glUniform1i(0, pass);
+        glBindImageTexture(0, pOcean->fftTextures[pass], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, pOcean->fftTextures[1 - pass], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glDispatchCompute(pOcean->size, 1, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    glUseProgram(pOcean->resolveProgram);
+    glUniform1f(0, pOcean->patchLength);
+    glUniform1f(1, pOcean->choppiness);
+    glBindImageTexture(0, pOcean->fftTextures[0], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, pOcean->displacementTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindImageTexture(2, pOcean->normalTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glDispatchCompute(groups, groups, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glUseProgram(0U);
+
+    /* far away normals are averaged instead of aliased */
+    glBindTexture(GL_TEXTURE_2D, pOcean->normalTexture);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0U);
+
+    glEndQuery(GL_TIME_ELAPSED);
+    pOcean->nUpdates++;
+}
+
+void oceanBind(const Ocean *pOcean, GLuint displacementUnit, GLuint normalUnit)
+{
+    glActiveTexture(GL_TEXTURE0 + displacementUnit);
+    glBindTexture(GL_TEXTURE_2D, pOcean->displacementTexture);
+    glActiveTexture(GL_TEXTURE0 + normalUnit);
+    glBindTexture(GL_TEXTURE_2D, pOcean->normalTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void oceanUninitialize(Ocean *pOcean)
+{
+    GLuint *pTextures[] = {&pOcean->spectrumTexture, &pOcean->fftTextures[0], &pOcean->fftTextures[1], &pOcean->displacementTexture, &pOcean->normalTexture};
+    for (size_t i = 0; i < sizeof(pTextures) / sizeof(pTextures[0]); i++)
+    {
+        if (0U != *pTextures[i])
+        {
+            glDeleteTextures(1, pTextures[i]);
+            *pTextures[i] = 0U;
+        }
+    }
+
+    GLuint *pPrograms[] = {&pOcean->spectrumProgram, &pOcean->fftProgram, &pOcean->resolveProgram};
+    for (size_t i = 0; i < sizeof(pPrograms) / sizeof(pPrograms[0]); i++)
+    {
+        if (0U != *pPrograms[i])
+        {
+            glDeleteProgram(*pPrograms[i]);
+            *pPrograms[i] = 0U;
+        }
+    }
+
+    if (0U != pOcean->queries[0])
+    {
+        glDeleteQueries(OCEAN_QUERIES, pOcean->queries);
+        for (uint32_t i = 0U; i < OCEAN_QUERIES; i++)
+            pOcean->queries[i] = 0U;
+    }
+}
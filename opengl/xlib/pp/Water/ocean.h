@@ -0,0 +1,92 @@
+#ifndef OCEAN_H
+#define OCEAN_H
+
+/**
+ * @file   ocean.h
+ * @brief  FFT ocean surface after Tessendorf, evolved with GL compute shaders
+ *
+ * An NxN patch of ocean is described by its Phillips spectrum h0(k), drawn
+ * once on the CPU from gaussian random numbers. Every frame three compute
+ * passes run on the GPU:
+ *
+ * 1. spectrum - advances h0(k) to time t with the deep water dispersion
+ *    w(k) = sqrt(g |k|), packs height and horizontal displacement of every
+ *    wave vector into two complex numbers of one texel.
+ * 2. fft      - inverse FFT of the rows, then of the columns, one work group
+ *    per line, radix 2 Stockham in shared memory.
+ * 3. resolve  - signs of the centered spectrum, choppiness, normal and the
+ *    jacobian of the horizontal displacement (below 1 the surface folds,
+ *    where foam goes) by central differences.
+ *
+ * Results are a displacement and a mipmapped normal texture that tile the
+ * plane with a period of patchLength, for a tessellated grid to sample.
+ * Every update is timed with a query that is read back frames later, it
+ * never waits for the GPU.
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+
+#include "vmath.h"
+
+#define OCEAN_SIZE_MAX 1024U /**< lines of the fft fit into a work group of size / 2 and 32 KB of shared memory */
+#define OCEAN_QUERIES  4U    /**< timer queries in flight */
+
+typedef struct Ocean
+{
+    uint32_t size;        /**< texels per side, power of two */
+    float    patchLength; /**< world size of the patch */
+    float    choppiness;  /**< scale of the horizontal displacement */
+
+    GLuint spectrumTexture;     /**< h0(k) and conj(h0(-k)), RGBA32F */
+    GLuint fftTextures[2];      /**< ping pong of the packed complex fields, RGBA32F */
+    GLuint displacementTexture; /**< xyz displacement, RGBA16F, repeat */
+    GLuint normalTexture;       /**< xyz normal, w jacobian, RGBA16F, mipmapped, repeat */
+
+    GLuint spectrumProgram;
+    GLuint fftProgram;
+    GLuint resolveProgram;
+
+    /* gpu time of the updates */
+    GLuint   queries[OCEAN_QUERIES];
+    uint32_t nUpdates;
+    uint32_t nTimed;
+    double   lastGpuMs;
+    double   totalGpuMs;
+} Ocean;
+
+/**
+ * @brief Draw the spectrum and create textures and programs
+ *
+ * @param size          [in] - texels per side, power of two from 16 to OCEAN_SIZE_MAX
+ * @param patchLength   [in] - world size of the patch in meters
+ * @param windSpeed     [in] - meters per second, the largest waves are windSpeed^2 / g long
+ * @param windDirection [in] - direction of the wind on the xz plane
+ * @param amplitude     [in] - Phillips constant A
+ * @param choppiness    [in] - 0 for round crests, around 1 for sharp ones
+ *
+ * @returns 0 on success else negative value
+ */
+int oceanInitialize(Ocean *pOcean, uint32_t size, float patchLength, float windSpeed, const vmath::vec2 &windDirection, float amplitude, float choppiness);
+
+/**
+ * @brief Evolve the surface to a time
+ *
+ * @param time [in] - seconds
+ */
+void oceanUpdate(Ocean *pOcean, float time);
+
+/**
+ * @brief Bind displacement and normal textures
+ *
+ * @param displacementUnit [in] - texture unit of the displacement
+ * @param normalUnit       [in] - texture unit of normal and jacobian
+ */
+void oceanBind(const Ocean *pOcean, GLuint displacementUnit, GLuint normalUnit);
+
+/**
+ * @brief Delete textures, programs and queries
+ */
+void oceanUninitialize(Ocean *pOcean);
+
+#endif // !OCEAN_H
@@ -3,6 +3,19 @@
  * @brief  Per Vertex Shading
  * @author Rohit Nimkar
  * @date   19/04/2024
+ *
+ * The water plane is not a second render of the scene into the backbuffer.
+ * Reflection and refraction are rendered into off screen targets at
+ * 1 / WATER_TARGET_DIVISOR of the window size, with the near plane of the
+ * projection tilted onto the water plane (oblique near plane clipping) so
+ * nothing below, resp. above, the surface leaks in and no clip distance is
+ * needed in the scene shaders. The water shader looks both targets up in
+ * screen space, distorts them with ripples and blends them by Fresnel.
+ * Targets are refreshed every waterRefreshFrames frames, the two passes half
+ * a period apart, so most frames render the scene once.
+ *
+ * The surface itself is an FFT ocean (ocean.h), a WATER_GRID x WATER_GRID
+ * grid displaced by the ocean textures in the vertex shader.
  */
 
 /*--- System Headers ---*/
@@ -10,6 +23,10 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 /*--- XWindows Headers ---*/
 #include <X11/XKBlib.h>
@@ -26,14 +43,30 @@
 using namespace vmath;
 
 #include "Sphere.h"
+#include "ocean.h"
 
 /*--- Macro Definitions ---*/
 #define WIN_WIDTH  1600U
 #define WIN_HEIGHT 1200U
-#define FBO_WIDTH  512
-#define FBO_HEIGHT 512
 #define N_LIGHTS   3
 
+#define SHADER_CACHE_DIR     "shadercache" /**< default, SHADER_CACHE_DIR in the environment overrides, empty disables */
+#define SHADER_CACHE_MAGIC   0x42505347U   /**< "GSPB" */
+#define SHADER_CACHE_VERSION 1U
+
+#define WATER_TARGET_DIVISOR 2U    /**< reflection and refraction are 1 / divisor of the window size */
+#define WATER_REFRESH_FRAMES 2U    /**< default, WATER_REFRESH_FRAMES in the environment overrides */
+#define WATER_HEIGHT         0.0f  /**< y of the water plane */
+#define WATER_EXTENT         20.0f /**< half size of the water plane */
+#define WATER_CLIP_OFFSET    0.05f /**< clip planes overlap the surface so ripples show no gap */
+#define WATER_GRID           256U  /**< quads per side of the water grid */
+
+#define OCEAN_SIZE         256U  /**< texels per side of the ocean patch */
+#define OCEAN_PATCH_LENGTH 20.0f /**< meters, the patch repeats beyond */
+#define OCEAN_WIND_SPEED   6.0f  /**< meters per second */
+#define OCEAN_AMPLITUDE    6e-5f /**< Phillips constant, about 0.12 m rms height at 256 */
+#define OCEAN_CHOPPINESS   0.8f
+
 /*--- Type declarations ---*/
 enum
 {
@@ -43,6 +76,14 @@ enum
     AMC_ATTRIBUTE_TEXCOORD
 };
 
+/* off screen targets of the water */
+enum
+{
+    WATER_REFLECTION = 0,
+    WATER_REFRACTION,
+    WATER_TARGETS
+};
+
 typedef struct Light
 {
     vec3 ambient;
@@ -51,6 +92,16 @@ typedef struct Light
     vec4 position;
 } Light;
 
+/* header of a program binary cache file, followed by the binary */
+typedef struct ShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format; /**< binaryFormat of glGetProgramBinary */
+    uint32_t length; /**< bytes of binary */
+} ShaderCacheHeader;
+
 typedef GLXContext (*glXCreateContextAttribsARBProc)(Display *, GLXFBConfig, GLXContext, Bool, const int *);
 
 /*--- Function declarations ---*/
@@ -116,6 +167,10 @@ GLint linkProgram(GLuint programId);
 /**
  * @brief Load shaders into memory
  *
+ * Restores the program from the program binary cache when a binary of the
+ * same sources from the same driver is there. The program is then already
+ * linked, has no shaders attached and linkProgram() leaves it as is.
+ *
  * @param vertexSource   [in] - Vertex Shader source code
  * @param fragmentSource [in] - Fragment shader source code
  *
@@ -123,7 +178,97 @@ GLint linkProgram(GLuint programId);
  */
 GLuint loadShaders(const char *vertexSource, const char *fragmentSource);
 
-Bool CreateFBO(GLint textureWidth, GLint textureHeight);
+/**
+ * @brief Hash of shader sources and driver strings, key of the program binary cache
+ */
+uint64_t shaderCacheKey(const char *vertexSource, const char *fragmentSource);
+
+/**
+ * @brief Path of the cache file for key
+ *
+ * @returns false if the cache is disabled or not supported by the driver
+ */
+bool shaderCachePath(uint64_t key, char *pPath, size_t size);
+
+/**
+ * @brief Restore program from the cache
+ *
+ * @returns GL_TRUE if the program is linked from the cached binary
+ */
+GLint loadProgramBinary(GLuint programId, uint64_t key);
+
+/**
+ * @brief Save binary of a linked program to the cache
+ */
+void saveProgramBinary(GLuint programId, uint64_t key);
+
+/**
+ * @brief Milliseconds on the monotonic clock
+ */
+double shaderTimeMs(void);
+
+/**
+ * @brief Create framebuffer with a color texture and a depth render buffer
+ *
+ * @param textureWidth  [in]  - width of the color texture
+ * @param textureHeight [in]  - height of the color texture
+ * @param pFbo          [out] - framebuffer
+ * @param pTexture      [out] - color texture
+ * @param pRbo          [out] - depth render buffer
+ *
+ * @returns True on success
+ */
+Bool CreateFBO(GLint textureWidth, GLint textureHeight, GLuint *pFbo, GLuint *pTexture, GLuint *pRbo);
+
+/**
+ * @brief Delete framebuffer, color texture and depth render buffer of CreateFBO()
+ */
+void deleteFBO(GLuint *pFbo, GLuint *pTexture, GLuint *pRbo);
+
+/**
+ * @brief Load water shaders and plane
+ *
+ * @returns 0 on success else negative value
+ */
+int initializeWaterSurface(void);
+
+/**
+ * @brief (Re)create reflection and refraction targets for a window size
+ */
+void createWaterTargets(int width, int height);
+
+/**
+ * @brief Render the scene into a water target
+ *
+ * @param target     [in] - WATER_REFLECTION or WATER_REFRACTION
+ * @param viewMatrix [in] - view of the camera
+ */
+void renderWaterTarget(int target, const mat4 &viewMatrix);
+
+/**
+ * @brief Draw the water plane with reflection and refraction
+ */
+void displayWaterSurface(const mat4 &viewMatrix);
+
+/**
+ * @brief Plane of world space in view space
+ *
+ * @param viewMatrix [in] - world to view transform
+ * @param plane      [in] - (normal, d), points p with dot(normal, p) + d >= 0 are kept
+ */
+vec4 viewSpacePlane(const mat4 &viewMatrix, const vec4 &plane);
+
+/**
+ * @brief Move the near plane of a perspective projection onto a view space plane
+ *
+ * Depth precision is lost far from the plane, but the clipping is free and
+ * needs no gl_ClipDistance in the shaders. The camera must be on the clipped
+ * side of the plane.
+ *
+ * @param projectionMatrix [in] - perspective projection
+ * @param viewPlane        [in] - plane of viewSpacePlane()
+ */
+mat4 obliqueProjection(const mat4 &projectionMatrix, const vec4 &viewPlane);
 
 
 /*--- Global variable declarations ---*/
@@ -162,6 +307,7 @@ int gnSphereIndices  = 0U;
 /*--- Matrix Uniforms ---*/
 GLuint modelMatrixUniformSphere      = 0U;
 GLuint viewMatrixUniformSphere       = 0U;
+GLuint normalMatrixUniformSphere     = 0U;
 GLuint projectionMatrixUniformSphere = 0U;
 
 mat4 sphereProjectionMatrix = {0};
@@ -185,6 +331,30 @@ vec3  materialDiffuse   = vec3(1.0f, 1.0f, 1.0f);
 vec3  materialSpecular  = vec3(1.0f, 1.0f, 1.0f);
 float materialShininess = 50.0f;
 
+/*--- Water ---*/
+GLuint waterShaderObject  = 0U;
+GLuint vaoWater           = 0U;
+GLuint vboWaterPositions  = 0U;
+GLuint eboWater           = 0U;
+GLint  gnWaterIndices     = 0;
+
+GLuint waterViewMatrixUniform       = 0U;
+GLuint waterProjectionMatrixUniform = 0U;
+GLuint waterCameraPositionUniform   = 0U;
+GLuint waterReflectionUniform       = 0U;
+GLuint waterRefractionUniform       = 0U;
+GLuint waterDisplacementUniform     = 0U;
+GLuint waterNormalMapUniform        = 0U;
+GLuint waterPatchLengthUniform      = 0U;
+
+Ocean ocean = {};
+
+vec3     cameraPosition     = vec3(0.0f, 3.0f, 12.0f);
+GLfloat  waterTime          = 0.0f;
+uint32_t waterFrame         = 0U;
+uint32_t waterRefreshFrames = WATER_REFRESH_FRAMES;
+Bool     bWaterDirty        = True; /**< targets are refreshed on the next frame regardless of waterRefreshFrames */
+
 /*--- Functional ---*/
 GLuint keyPressedUniform = 0U;
 Bool   keyPressed        = False;
@@ -194,13 +364,13 @@ Bool    bAnimationEnabled = False;
 GLint   winWidth          = 0;
 GLint   winHeight         = 0;
 
-/* FBO */
-GLuint fbo = 0U;
-GLuint rbo = 0U;
-
-GLuint fboSamplerUniform = 0U;
-GLuint textureFbo        = 0U;
-Bool   bFboResult        = False;
+/* FBO, reflection and refraction of the water */
+GLuint fbo[WATER_TARGETS]        = {0U};
+GLuint rbo[WATER_TARGETS]        = {0U};
+GLuint textureFbo[WATER_TARGETS] = {0U};
+GLint  fboWidth                  = 0;
+GLint  fboHeight                 = 0;
+Bool   bFboResult                = False;
 
 int main(void)
 {
@@ -426,6 +596,14 @@ int main(void)
                             bAnimationEnabled = !bAnimationEnabled;
                             break;
                         }
+                        case 'r':
+                        case 'R':
+                        {
+                            /* 1, 2, 4, 8 frames between refreshes of the water targets */
+                            waterRefreshFrames = (8U <= waterRefreshFrames) ? 1U : 2U * waterRefreshFrames;
+                            fprintf(gpFile, "Water targets refreshed every %u frames\n", waterRefreshFrames);
+                            break;
+                        }
                         default:
                             break;
                     }
@@ -532,6 +710,7 @@ GLuint initializeSphere()
                                              "uniform mat4 uModelMatrix;"
                                              "uniform mat4 uViewMatrix;"
                                              "uniform mat4 uProjectionMatrix;"
+                                             "uniform mat3 uNormalMatrix;"
                                              "\n"
                                              "uniform vec4 uLightPosition[N_LIGHTS];"
                                              "\n"
@@ -542,9 +721,7 @@ GLuint initializeSphere()
                                              "    vec4 ePosition = uViewMatrix * uModelMatrix * aPosition;"
                                              "    if(uKeyPressed == 1)"
                                              "    {"
-                                             "        mat3 normalMatrix = mat3(transpose(inverse(uViewMatrix * uModelMatrix)));"
-                                             "\n"
-                                             "        wNormal              = normalMatrix * aNormal;"
+                                             "        wNormal              = uNormalMatrix * aNormal;"
                                              "        wCameraDirection     = -ePosition.xyz;"
                                              "        for (int i = 0; i < N_LIGHTS; i++)"
                                              "        {"
@@ -626,6 +803,7 @@ GLuint initializeSphere()
     /* Setup up uniforms */
     modelMatrixUniformSphere      = glGetUniformLocation(shaderProgramObject, "uModelMatrix");
     viewMatrixUniformSphere       = glGetUniformLocation(shaderProgramObject, "uViewMatrix");
+    normalMatrixUniformSphere     = glGetUniformLocation(shaderProgramObject, "uNormalMatrix");
     projectionMatrixUniformSphere = glGetUniformLocation(shaderProgramObject, "uProjectionMatrix");
 
     lightAmbientUniform[0]  = glGetUniformLocation(shaderProgramObject, "uLightAmbient[0]");
@@ -700,21 +878,176 @@ int initializeWaterSurface(void)
 {
     const GLchar *waterSurfaceVertexShaderSource   = "#version 460 core"
                                                      "\n"
-                                                     "void main()"
-                                                     "{"
                                                      "in vec4 aPosition;"
-                                                     "in vec2 aTexCoord;"
+                                                     "\n"
+                                                     "out vec4 vClipPosition;"
+                                                     "out vec3 vWorldPosition;"
+                                                     "out vec2 vTexCoord;"
+                                                     "\n"
+                                                     "uniform mat4 uViewMatrix;"
+                                                     "uniform mat4 uProjectionMatrix;"
+                                                     "uniform float uPatchLength;"
+                                                     "uniform sampler2D uDisplacement;"
+                                                     "\n"
+                                                     "void main(void)"
+                                                     "{"
+                                                     "    vTexCoord      = aPosition.xz / uPatchLength;"
+                                                     "    vWorldPosition = aPosition.xyz + textureLod(uDisplacement, vTexCoord, 0.0).xyz;"
+                                                     "    vClipPosition  = uProjectionMatrix * uViewMatrix * vec4(vWorldPosition, 1.0);"
+                                                     "    gl_Position    = vClipPosition;"
                                                      "}";
 
     const GLchar *waterSurfaceFragmentShaderSource = "#version 460 core"
                                                      "\n"
+                                                     "in vec4 vClipPosition;"
+                                                     "in vec3 vWorldPosition;"
                                                      "in vec2 vTexCoord;"
-                                                     "uniform sampler2D samplerReflection;"
-                                                     "void main()"
+                                                     "out vec4 FragColor;"
+                                                     "\n"
+                                                     "uniform sampler2D uReflection;"
+                                                     "uniform sampler2D uRefraction;"
+                                                     "uniform sampler2D uNormalMap;"
+                                                     "uniform vec3  uCameraPosition;"
+                                                     "\n"
+                                                     "void main(void)"
                                                      "{"
-                                                     "    vec4 colorReflection = texture(samplerReflection, vTexCoord);"
-                                                     "    FragColor = colorReflection;"
+                                                     "    vec4 normalJacobian = texture(uNormalMap, vTexCoord);"
+                                                     "    vec3 normal         = normalize(normalJacobian.xyz);"
+                                                     "\n"
+                                                     "    vec2 screen = vClipPosition.xy / vClipPosition.w * 0.5 + 0.5;"
+                                                     "    vec2 offset = normal.xz * 0.3 / vClipPosition.w;"
+                                                     "    vec3 reflection = texture(uReflection, clamp(screen + offset, 0.001, 0.999)).rgb;"
+                                                     "    vec3 refraction = texture(uRefraction, clamp(screen - offset, 0.001, 0.999)).rgb * vec3(0.5, 0.8, 0.9) + vec3(0.0, 0.03, 0.05);"
+                                                     "\n"
+                                                     "    vec3  toCamera = normalize(uCameraPosition - vWorldPosition);"
+                                                     "    float fresnel  = 0.02 + 0.98 * pow(1.0 - max(dot(toCamera, normal), 0.0), 5.0);"
+                                                     "    vec3  color    = mix(refraction, reflection, fresnel);"
+                                                     "\n"
+                                                     /* the surface folds over where the jacobian drops, crests break into foam */
+                                                     "    float foam = smoothstep(0.6, 0.1, normalJacobian.w);"
+                                                     "    FragColor  = vec4(mix(color, vec3(0.8, 0.85, 0.9), foam * 0.6), 1.0);"
                                                      "}";
+
+    waterShaderObject = loadShaders(waterSurfaceVertexShaderSource, waterSurfaceFragmentShaderSource);
+    if (0U == waterShaderObject)
+    {
+        fprintf(gpFile, "Failed to load shaders for water surface\n");
+        return -1;
+    }
+
+    glBindAttribLocation(waterShaderObject, AMC_ATTRIBUTE_POSITION, "aPosition");
+
+    if (GL_TRUE != linkProgram(waterShaderObject))
+    {
+        fprintf(gpFile, "Failed to link shaders for water surface\n");
+        return -1;
+    }
+
+    fprintf(gpFile, "----- Shader Program Linked Successfully for water surface -----\n");
+
+    waterViewMatrixUniform       = glGetUniformLocation(waterShaderObject, "uViewMatrix");
+    waterProjectionMatrixUniform = glGetUniformLocation(waterShaderObject, "uProjectionMatrix");
+    waterCameraPositionUniform   = glGetUniformLocation(waterShaderObject, "uCameraPosition");
+    waterReflectionUniform       = glGetUniformLocation(waterShaderObject, "uReflection");
+    waterRefractionUniform       = glGetUniformLocation(waterShaderObject, "uRefraction");
+    waterDisplacementUniform     = glGetUniformLocation(waterShaderObject, "uDisplacement");
+    waterNormalMapUniform        = glGetUniformLocation(waterShaderObject, "uNormalMap");
+    waterPatchLengthUniform      = glGetUniformLocation(waterShaderObject, "uPatchLength");
+
+    if (0 != oceanInitialize(&ocean, OCEAN_SIZE, OCEAN_PATCH_LENGTH, OCEAN_WIND_SPEED, vec2(1.0f, 0.6f), OCEAN_AMPLITUDE, OCEAN_CHOPPINESS))
+    {
+        fprintf(gpFile, "Failed to initialize %ux%u ocean\n", OCEAN_SIZE, OCEAN_SIZE);
+        return -1;
+    }
+
+    /* grid of (WATER_GRID + 1)^2 vertices, quads counter clockwise seen from above */
+    const GLuint nVertices  = WATER_GRID + 1U;
+    GLfloat     *pPositions = (GLfloat *)malloc(sizeof(GLfloat) * 3U * nVertices * nVertices);
+    GLuint      *pIndices   = (GLuint *)malloc(sizeof(GLuint) * 6U * WATER_GRID * WATER_GRID);
+    if (NULL == pPositions || NULL == pIndices)
+    {
+        fprintf(gpFile, "Out of memory for the water grid\n");
+        free(pPositions);
+        free(pIndices);
+        return -1;
+    }
+
+    for (GLuint z = 0U; z < nVertices; z++)
+    {
+        for (GLuint x = 0U; x < nVertices; x++)
+        {
+            GLfloat *pPosition = &pPositions[3U * (z * nVertices + x)];
+            pPosition[0]       = -WATER_EXTENT + 2.0f * WATER_EXTENT * (GLfloat)x / (GLfloat)WATER_GRID;
+            pPosition[1]       = WATER_HEIGHT;
+            pPosition[2]       = -WATER_EXTENT + 2.0f * WATER_EXTENT * (GLfloat)z / (GLfloat)WATER_GRID;
+        }
+    }
+
+    gnWaterIndices = 0;
+    for (GLuint z = 0U; z < WATER_GRID; z++)
+    {
+        for (GLuint x = 0U; x < WATER_GRID; x++)
+        {
+            GLuint corner              = z * nVertices + x;
+            pIndices[gnWaterIndices++] = corner;
+            pIndices[gnWaterIndices++] = corner + nVertices;
+            pIndices[gnWaterIndices++] = corner + 1U;
+            pIndices[gnWaterIndices++] = corner + 1U;
+            pIndices[gnWaterIndices++] = corner + nVertices;
+            pIndices[gnWaterIndices++] = corner + nVertices + 1U;
+        }
+    }
+
+    glGenVertexArrays(1, &vaoWater);
+    glBindVertexArray(vaoWater);
+
+    glGenBuffers(1, &vboWaterPositions);
+    glBindBuffer(GL_ARRAY_BUFFER, vboWaterPositions);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3U * nVertices * nVertices, pPositions, GL_STATIC_DRAW);
+    glVertexAttribPointer(AMC_ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(AMC_ATTRIBUTE_POSITION);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &eboWater);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboWater);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * gnWaterIndices, pIndices, GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    free(pPositions);
+    free(pIndices);
+
+    const char *pRefresh = getenv("WATER_REFRESH_FRAMES");
+    if (nullptr != pRefresh && 0 < atoi(pRefresh))
+        waterRefreshFrames = (uint32_t)atoi(pRefresh);
+    fprintf(gpFile, "Water targets refreshed every %u frames\n", waterRefreshFrames);
+
+    return 0;
+}
+
+void createWaterTargets(int width, int height)
+{
+    GLint targetWidth  = (width + WATER_TARGET_DIVISOR - 1) / WATER_TARGET_DIVISOR;
+    GLint targetHeight = (height + WATER_TARGET_DIVISOR - 1) / WATER_TARGET_DIVISOR;
+
+    if (True == bFboResult && targetWidth == fboWidth && targetHeight == fboHeight)
+        return;
+
+    bFboResult = True;
+    for (int i = 0; i < WATER_TARGETS; i++)
+    {
+        deleteFBO(&fbo[i], &textureFbo[i], &rbo[i]);
+        if (True != CreateFBO(targetWidth, targetHeight, &fbo[i], &textureFbo[i], &rbo[i]))
+        {
+            fprintf(gpFile, "Failed to create %dx%d water target %d\n", targetWidth, targetHeight, i);
+            bFboResult = False;
+        }
+    }
+
+    fboWidth    = targetWidth;
+    fboHeight   = targetHeight;
+    bWaterDirty = True;
 }
 
 int initialize(void)
@@ -788,13 +1121,6 @@ int initialize(void)
         return (-6);
     }
 
-    /* FBO related code */
-    // if (CreateFBO(FBO_WIDTH, FBO_HEIGHT) == True)
-    // {
-    //     bFboResult = True;
-    //     fprintf(gpFile, "Failed to create FBO\n");
-    // }
-
     sphereShaderObject = initializeSphere();
     if (0U == sphereShaderObject)
     {
@@ -802,6 +1128,13 @@ int initialize(void)
         return -6;
     }
 
+    /* water targets are created by resize() */
+    if (0 != initializeWaterSurface())
+    {
+        fprintf(gpFile, "Failed to initialize water surface\n");
+        return -7;
+    }
+
     /* Enable Depth testing */
     glClearDepth(1.0f);
     glEnable(GL_DEPTH_TEST);
@@ -831,22 +1164,18 @@ void resize(int width, int height)
 
     glViewport(0, 0, (GLsizei)width, (GLsizei)height);
     sphereProjectionMatrix = vmath::perspective(45.0f, (float)width / (float)height, 0.1f, 100.0f);
+
+    createWaterTargets(width, height);
 }
 
-void displaySphere(void)
+void displaySphere(const mat4 &viewMatrix, const mat4 &projectionMatrix)
 {
     mat4 modelMatrix       = mat4::identity();
-    mat4 viewMatrix        = mat4::identity();
-    mat4 rotationMatrix    = mat4::identity();
     mat4 translationMatrix = mat4::identity();
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
     glUseProgram(sphereShaderObject);
 
-    glUniformMatrix4fv(projectionMatrixUniformSphere, 1, GL_FALSE, sphereProjectionMatrix);
-
-    viewMatrix = lookat(vec3(0.0f, 0.0f, 12.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 1.0f, 0.0f));
+    glUniformMatrix4fv(projectionMatrixUniformSphere, 1, GL_FALSE, projectionMatrix);
     glUniformMatrix4fv(viewMatrixUniformSphere, 1, GL_FALSE, viewMatrix);
 
     if (keyPressed == True)
@@ -880,26 +1209,128 @@ void displaySphere(void)
 
     glBindVertexArray(vaoSphere);
 
-    translationMatrix = translate(0.0f, 1.0f, 0.0f);
+    /* partly under water, the refraction has something to show */
+    translationMatrix = translate(0.0f, 0.6f, 0.0f);
     modelMatrix       = translationMatrix;
     glUniformMatrix4fv(modelMatrixUniformSphere, 1, GL_FALSE, modelMatrix);
+    glUniformMatrix3fv(normalMatrixUniformSphere, 1, GL_FALSE, inverseTranspose3x3(viewMatrix * modelMatrix));
     glDrawElements(GL_TRIANGLES, gnSphereIndices, GL_UNSIGNED_SHORT, NULL);
 
-    /* Render reflection */
+    glBindVertexArray(0);
 
-    viewMatrix = lookat(vec3(0.0f, 0.0f, 12.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, -1.0f, 0.0f));
-    glUniformMatrix4fv(viewMatrixUniformSphere, 1, GL_FALSE, viewMatrix);
-    glDrawElements(GL_TRIANGLES, gnSphereIndices, GL_UNSIGNED_SHORT, NULL);
+    glUseProgram(0);
+}
+
+vec4 viewSpacePlane(const mat4 &viewMatrix, const vec4 &plane)
+{
+    /* planes transform with the inverse transpose */
+    mat4 viewToWorld = inverseAffine(viewMatrix);
+    return vec4(dot(viewToWorld[0], plane), dot(viewToWorld[1], plane), dot(viewToWorld[2], plane), dot(viewToWorld[3], plane));
+}
+
+static inline float signOf(float value)
+{
+    return (0.0f < value) ? 1.0f : ((0.0f > value) ? -1.0f : 0.0f);
+}
+
+mat4 obliqueProjection(const mat4 &projectionMatrix, const vec4 &viewPlane)
+{
+    /* Lengyel, the far plane is moved too, q is the corner of the view volume opposite to the plane */
+    mat4 result = projectionMatrix;
+    vec4 q      = vec4((signOf(viewPlane[0]) + projectionMatrix[2][0]) / projectionMatrix[0][0], (signOf(viewPlane[1]) + projectionMatrix[2][1]) / projectionMatrix[1][1], -1.0f,
+                       (1.0f + projectionMatrix[2][2]) / projectionMatrix[3][2]);
+    vec4 c      = viewPlane * (2.0f / dot(viewPlane, q));
+
+    /* third row becomes the plane minus the fourth row */
+    result[0][2] = c[0] - projectionMatrix[0][3];
+    result[1][2] = c[1] - projectionMatrix[1][3];
+    result[2][2] = c[2] - projectionMatrix[2][3];
+    result[3][2] = c[3] - projectionMatrix[3][3];
+    return result;
+}
+
+void renderWaterTarget(int target, const mat4 &viewMatrix)
+{
+    mat4 targetViewMatrix = viewMatrix;
+    vec4 plane            = vec4(0.0f, -1.0f, 0.0f, WATER_HEIGHT + WATER_CLIP_OFFSET);
+
+    if (WATER_REFLECTION == target)
+    {
+        /* camera mirrored at the water plane, what is above the water is kept */
+        targetViewMatrix = viewMatrix * translate(0.0f, 2.0f * WATER_HEIGHT, 0.0f) * scale(1.0f, -1.0f, 1.0f);
+        plane            = vec4(0.0f, 1.0f, 0.0f, -(WATER_HEIGHT - WATER_CLIP_OFFSET));
+    }
 
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo[target]);
+    glViewport(0, 0, fboWidth, fboHeight);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    /* the mirror turns front faces clockwise */
+    glFrontFace((WATER_REFLECTION == target) ? GL_CW : GL_CCW);
+    displaySphere(targetViewMatrix, obliqueProjection(sphereProjectionMatrix, viewSpacePlane(targetViewMatrix, plane)));
+    glFrontFace(GL_CCW);
 
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, winWidth, winHeight);
+}
+
+void displayWaterSurface(const mat4 &viewMatrix)
+{
+    glUseProgram(waterShaderObject);
+
+    glUniformMatrix4fv(waterViewMatrixUniform, 1, GL_FALSE, viewMatrix);
+    glUniformMatrix4fv(waterProjectionMatrixUniform, 1, GL_FALSE, sphereProjectionMatrix);
+    glUniform3fv(waterCameraPositionUniform, 1, cameraPosition);
+    glUniform1f(waterPatchLengthUniform, OCEAN_PATCH_LENGTH);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textureFbo[WATER_REFLECTION]);
+    glUniform1i(waterReflectionUniform, 0);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, textureFbo[WATER_REFRACTION]);
+    glUniform1i(waterRefractionUniform, 1);
+
+    oceanBind(&ocean, 2U, 3U);
+    glUniform1i(waterDisplacementUniform, 2);
+    glUniform1i(waterNormalMapUniform, 3);
+
+    glBindVertexArray(vaoWater);
+    glDrawElements(GL_TRIANGLES, gnWaterIndices, GL_UNSIGNED_INT, NULL);
     glBindVertexArray(0);
 
+    for (int unit = 3; unit >= 0; unit--)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
     glUseProgram(0);
 }
 
 void display()
 {
-    displaySphere();
+    mat4 viewMatrix = lookat(cameraPosition, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+
+    oceanUpdate(&ocean, waterTime);
+
+    /* a period of waterRefreshFrames, reflection at its start and refraction half way */
+    if (True == bFboResult)
+    {
+        if (True == bWaterDirty || 0U == waterFrame % waterRefreshFrames)
+            renderWaterTarget(WATER_REFLECTION, viewMatrix);
+        if (True == bWaterDirty || waterRefreshFrames / 2U == waterFrame % waterRefreshFrames)
+            renderWaterTarget(WATER_REFRACTION, viewMatrix);
+        bWaterDirty = False;
+    }
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    displaySphere(viewMatrix, sphereProjectionMatrix);
+    if (True == bFboResult)
+        displayWaterSurface(viewMatrix);
+
+    waterTime += 0.016f;
+    ++waterFrame;
 }
 
 void update()
@@ -959,23 +1390,40 @@ void uninitializeShader(GLuint shaderProgramObject)
 void uninitialize(void)
 {
     GLXContext currentGLXContext = NULL;
-    if (0U != textureFbo)
+    for (int i = 0; i < WATER_TARGETS; i++)
+    {
+        deleteFBO(&fbo[i], &textureFbo[i], &rbo[i]);
+    }
+    bFboResult = False;
+
+    if (0U != vaoWater)
     {
-        fprintf(gpFile, "%s: deleting texture FBO %d", __func__, textureFbo);
-        glDeleteTextures(1, &textureFbo);
-        textureFbo = 0U;
+        glDeleteVertexArrays(1, &vaoWater);
+        vaoWater = 0;
     }
 
-    if (0U != fbo)
+    if (0U != vboWaterPositions)
     {
-        glDeleteFramebuffers(1, &fbo);
-        fbo = 0U;
+        glDeleteBuffers(1, &vboWaterPositions);
+        vboWaterPositions = 0;
     }
 
-    if (0U != rbo)
+    if (0U != eboWater)
     {
-        glDeleteRenderbuffers(1, &rbo);
-        rbo = 0U;
+        glDeleteBuffers(1, &eboWater);
+        eboWater = 0;
+    }
+
+    if (0U < ocean.nTimed && NULL != gpFile)
+    {
+        fprintf(gpFile, "Ocean %ux%u: %.3f ms average GPU time of %u updates\n", ocean.size, ocean.size, ocean.totalGpuMs / ocean.nTimed, ocean.nTimed);
+    }
+    oceanUninitialize(&ocean);
+
+    if (0U != waterShaderObject)
+    {
+        uninitializeShader(waterShaderObject);
+        waterShaderObject = 0U;
     }
 
     if (0U != vaoSphere)
@@ -1052,7 +1500,15 @@ void uninitialize(void)
 
 GLuint loadShaders(const char *vertexShaderSourceCode, const char *fragmentShaderSourceCode)
 {
-    GLuint programId = 0U;
+    GLuint   programId = glCreateProgram();
+    uint64_t key       = shaderCacheKey(vertexShaderSourceCode, fragmentShaderSourceCode);
+    double   start     = shaderTimeMs();
+
+    if (GL_TRUE == loadProgramBinary(programId, key))
+    {
+        fprintf(gpFile, "Program %016llx loaded from cache in %.2f ms\n", (unsigned long long)key, shaderTimeMs() - start);
+        return programId;
+    }
 
     GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
 
@@ -1061,21 +1517,25 @@ GLuint loadShaders(const char *vertexShaderSourceCode, const char *fragmentShade
         GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
         if (GL_TRUE == compileShader(fragmentShaderId, fragmentShaderSourceCode))
         {
-            programId = glCreateProgram();
             glAttachShader(programId, vertexShaderId);
             glAttachShader(programId, fragmentShaderId);
+            fprintf(gpFile, "Program %016llx compiled in %.2f ms\n", (unsigned long long)key, shaderTimeMs() - start);
         }
         else
         {
             fprintf(gpFile, "Failed to compile fragment shader: \n");
             glDeleteShader(vertexShaderId);
             glDeleteShader(fragmentShaderId);
+            glDeleteProgram(programId);
+            programId = 0U;
         }
     }
     else
     {
         fprintf(gpFile, "Failed to compile vertex shader: \n");
         glDeleteShader(vertexShaderId);
+        glDeleteProgram(programId);
+        programId = 0U;
     }
     return programId;
 }
@@ -1111,6 +1571,43 @@ GLint linkProgram(GLuint programId)
     GLint status   = GL_FALSE;
     GLint nShaders = 0;
 
+    /* restored from the cache by loadShaders() */
+    glGetProgramiv(programId, GL_ATTACHED_SHADERS, &nShaders);
+    glGetProgramiv(programId, GL_LINK_STATUS, &status);
+    if (0 == nShaders && GL_TRUE == status)
+        return status;
+
+    /* key from the attached sources, vertex shader first as in loadShaders() */
+    GLuint   shaders[2] = {0U, 0U};
+    GLchar  *sources[2] = {nullptr, nullptr};
+    uint64_t key        = 0U;
+    bool     bCache     = (2 == nShaders);
+
+    if (bCache)
+    {
+        glGetAttachedShaders(programId, 2, nullptr, shaders);
+        for (int i = 0; i < 2; i++)
+        {
+            GLint type   = 0;
+            GLint length = 0;
+            glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+            glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length);
+
+            int index      = (GL_VERTEX_SHADER == type) ? 0 : 1;
+            sources[index] = (GLchar *)malloc(length + 1);
+            if (nullptr != sources[index])
+                glGetShaderSource(shaders[i], length + 1, nullptr, sources[index]);
+        }
+        bCache = (nullptr != sources[0]) && (nullptr != sources[1]);
+        if (bCache)
+            key = shaderCacheKey(sources[0], sources[1]);
+        free(sources[0]);
+        free(sources[1]);
+
+        glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    double start = shaderTimeMs();
     glLinkProgram(programId);
     glGetProgramiv(programId, GL_LINK_STATUS, &status);
     if (GL_FALSE == status)
@@ -1130,10 +1627,154 @@ GLint linkProgram(GLuint programId)
             }
         }
     }
+    else
+    {
+        fprintf(gpFile, "Program %016llx linked in %.2f ms\n", (unsigned long long)key, shaderTimeMs() - start);
+        if (bCache)
+            saveProgramBinary(programId, key);
+    }
+    return status;
+}
+
+double shaderTimeMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec * 1e-6;
+}
+
+/* FNV-1a, strings are hashed with their terminating zero so "ab" + "c" != "a" + "bc" */
+static uint64_t hashString(uint64_t hash, const char *pString)
+{
+    if (nullptr == pString)
+        pString = "";
+
+    do
+    {
+        hash = (hash ^ (uint8_t)*pString) * 1099511628211ULL;
+    } while ('\0' != *pString++);
+
+    return hash;
+}
+
+uint64_t shaderCacheKey(const char *vertexSource, const char *fragmentSource)
+{
+    /* binaries of another GPU or driver version are never tried */
+    uint64_t key = 14695981039346656037ULL;
+    key          = hashString(key, vertexSource);
+    key          = hashString(key, fragmentSource);
+    key          = hashString(key, (const char *)glGetString(GL_VENDOR));
+    key          = hashString(key, (const char *)glGetString(GL_RENDERER));
+    key          = hashString(key, (const char *)glGetString(GL_VERSION));
+    return key;
+}
+
+bool shaderCachePath(uint64_t key, char *pPath, size_t size)
+{
+    const char *pDirectory = getenv("SHADER_CACHE_DIR");
+    GLint       nFormats   = 0;
+
+    if (nullptr == pDirectory)
+        pDirectory = SHADER_CACHE_DIR;
+    if ('\0' == pDirectory[0] || (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary))
+        return false;
+
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+    if (0 == nFormats)
+        return false;
+
+    return (int)size > snprintf(pPath, size, "%s/%016llx.bin", pDirectory, (unsigned long long)key);
+}
+
+GLint loadProgramBinary(GLuint programId, uint64_t key)
+{
+    ShaderCacheHeader header = {};
+    GLint             status = GL_FALSE;
+    char              path[512];
+
+    if (!shaderCachePath(key, path, sizeof(path)))
+        return GL_FALSE;
+
+    FILE *pFile = fopen(path, "rb");
+    if (nullptr == pFile)
+        return GL_FALSE;
+
+    if (1 == fread(&header, sizeof(header), 1, pFile) && SHADER_CACHE_MAGIC == header.magic &&
+        SHADER_CACHE_VERSION == header.version && key == header.key &&
+        0 == fseek(pFile, 0L, SEEK_END) && 0U != header.length &&
+        (long)(sizeof(header) + header.length) == ftell(pFile) &&
+        0 == fseek(pFile, (long)sizeof(header), SEEK_SET))
+    {
+        /* the length read from the file has to match what the file holds before anything is allocated */
+        void *pBinary = malloc(header.length);
+        if (nullptr != pBinary && 1 == fread(pBinary, header.length, 1, pFile))
+        {
+            /* a driver update may reject binaries it wrote itself, the program is then left unlinked */
+            glProgramBinary(programId, header.format, pBinary, (GLsizei)header.length);
+            glGetProgramiv(programId, GL_LINK_STATUS, &status);
+            if (GL_TRUE != status)
+                fprintf(gpFile, "Cached program %s rejected by driver, compiling\n", path);
+        }
+        free(pBinary);
+    }
+    fclose(pFile);
+
     return status;
 }
 
-Bool CreateFBO(GLint textureWidth, GLint textureHeight)
+void saveProgramBinary(GLuint programId, uint64_t key)
+{
+    ShaderCacheHeader header = {SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, key, 0U, 0U};
+    GLint             length = 0;
+    GLenum            format = 0;
+    char              path[512];
+    char              temporary[520];
+
+    if (!shaderCachePath(key, path, sizeof(path)))
+        return;
+
+    glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+    void *pBinary = (0 < length) ? malloc(length) : nullptr;
+    if (nullptr == pBinary)
+        return;
+
+    glGetProgramBinary(programId, length, &length, &format, pBinary);
+    header.format = format;
+    header.length = (uint32_t)length;
+
+    /* every level of the directory of path, $XDG_CACHE_HOME itself may not exist yet */
+    snprintf(temporary, sizeof(temporary), "%s", path);
+    *strrchr(temporary, '/') = '\0';
+    for (char *pSlash = strchr(temporary + 1, '/'); nullptr != pSlash; pSlash = strchr(pSlash + 1, '/'))
+    {
+        *pSlash = '\0';
+        mkdir(temporary, 0755);
+        *pSlash = '/';
+    }
+    mkdir(temporary, 0755);
+
+    /* write to a temporary file of a unique name and rename, other instances never see a partial file */
+    snprintf(temporary, sizeof(temporary), "%s.XXXXXX", path);
+    int   fd    = mkstemp(temporary);
+    FILE *pFile = (-1 != fd) ? fdopen(fd, "wb") : nullptr;
+    if (-1 != fd && nullptr == pFile)
+        close(fd);
+    bool bDone = (nullptr != pFile) && (0 == fchmod(fd, 0644)) && (1 == fwrite(&header, sizeof(header), 1, pFile)) &&
+                 (1 == fwrite(pBinary, length, 1, pFile));
+    if (nullptr != pFile)
+        bDone = (0 == fclose(pFile)) && bDone;
+    bDone = bDone && (0 == rename(temporary, path));
+
+    if (!bDone)
+    {
+        fprintf(gpFile, "Failed to write program cache %s\n", path);
+        if (-1 != fd)
+            remove(temporary);
+    }
+    free(pBinary);
+}
+
+Bool CreateFBO(GLint textureWidth, GLint textureHeight, GLuint *pFbo, GLuint *pTexture, GLuint *pRbo)
 {
     GLint maxRenderBufferSize = 0;
 
@@ -1148,40 +1789,66 @@ Bool CreateFBO(GLint textureWidth, GLint textureHeight)
     }
 
     /* Step 2: Create custom frame buffer*/
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenFramebuffers(1, pFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, *pFbo);
 
-    /* Step 3: Create texture in which we are going to render sphere */
-    glGenTextures(1, &textureFbo);
-    glBindTexture(GL_TEXTURE_2D, textureFbo);
+    /* Step 3: Create texture in which we are going to render the scene */
+    glGenTextures(1, pTexture);
+    glBindTexture(GL_TEXTURE_2D, *pTexture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
     /* Attach above texture tp framebuffer at efault color attachment 0 */
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureFbo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *pTexture, 0);
 
     /* CReate render buffer to hold depth */
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+    glGenRenderbuffers(1, pRbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, *pRbo);
 
     /* Set storage of above render buffer of texture size for depth */
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, textureWidth, textureHeight);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, textureWidth, textureHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
     /* Attach above render buffer for depth to fbo */
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, *pRbo);
 
     /* Check frame buffer status, wether successfull or not */
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+    /* Unbind with the framebuffer */
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
     {
         fprintf(gpFile, "Framebuffer creation status is not complete\n");
+        deleteFBO(pFbo, pTexture, pRbo);
         return False;
     }
-
-    /* Unbind with the framebuffer */
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
     return True;
 }
+
+void deleteFBO(GLuint *pFbo, GLuint *pTexture, GLuint *pRbo)
+{
+    if (0U != *pTexture)
+    {
+        glDeleteTextures(1, pTexture);
+        *pTexture = 0U;
+    }
+
+    if (0U != *pFbo)
+    {
+        glDeleteFramebuffers(1, pFbo);
+        *pFbo = 0U;
+    }
+
+    if (0U != *pRbo)
+    {
+        glDeleteRenderbuffers(1, pRbo);
+        *pRbo = 0U;
+    }
+}
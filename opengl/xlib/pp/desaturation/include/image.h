@@ -0,0 +1,100 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file    image.h
+ * @brief   CPU versions of the GrayScale, Desaturation and DirectionalDesaturation
+ *          fragment shaders for batch processing of images
+ *
+ * Kernels follow the shader math operation by operation
+ *   gsc   = (r * 0.3) + (g * 0.59) + (b * 0.11)
+ *   color = mix(color, vec4(gsc, gsc, gsc, 1.0), uConversionFactor)
+ * in single precision without fused multiply-add, RGBA8 texels are read as
+ * c / 255 and written as round(clamp(x, 0, 1) * 255) like a UNORM render target.
+ * The AVX2 (x86-64) and NEON (AArch64) paths produce exactly the bytes of the
+ * scalar path; build with -ffp-contract=off so the compiler does not fuse them.
+ * AVX2 is chosen at run time, CPUs without AVX2 and F16C use the scalar path.
+ *
+ * Rows are stored bottom up like a GL texture, row 0 is gl_FragCoord.y = 0.5.
+ */
+
+#define IMAGE_FLAG_SCALAR        0x1U /**< use the scalar reference kernels */
+#define IMAGE_FLAG_SINGLE_THREAD 0x2U /**< do not split rows across threads */
+
+#define IMAGE_PARALLEL_PIXELS (512U * 512U) /**< smaller images are processed on the calling thread */
+
+typedef enum ImageFormat
+{
+    IMAGE_FORMAT_RGBA8   = 0, /**< 4 x uint8_t, unsigned normalized */
+    IMAGE_FORMAT_RGBA16F = 1  /**< 4 x IEEE 754 half */
+} ImageFormat;
+
+typedef struct Image
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t format; /**< ImageFormat */
+    size_t   stride; /**< bytes between rows */
+    uint8_t* pData;
+} Image;
+
+/**
+ * @brief Allocate tightly packed image
+ *
+ * @returns 0 on success else negative value
+ */
+int createImage(Image* pImage, uint32_t width, uint32_t height, uint32_t format);
+
+/**
+ * @brief Free pixels allocated by createImage
+ */
+void destroyImage(Image* pImage);
+
+/**
+ * @brief Convert between formats, pDst must already be created with source dimensions
+ *
+ * @returns 0 on success else negative value
+ */
+int convertImage(const Image* pSrc, Image* pDst);
+
+/**
+ * @brief Replace every texel with its luminance and alpha with 1 (GrayScale)
+ *
+ * pSrc and pDst may be the same image.
+ *
+ * @returns 0 on success else negative value
+ */
+int grayscaleImage(const Image* pSrc, Image* pDst, uint32_t flags);
+
+/**
+ * @brief Blend every texel towards its luminance (Desaturation)
+ *
+ * @param conversionFactor [in] - uConversionFactor, 0 keeps colour, 1 is grayscale
+ *
+ * @returns 0 on success else negative value
+ */
+int desaturateImage(const Image* pSrc, Image* pDst, float conversionFactor, uint32_t flags);
+
+/**
+ * @brief Desaturate rows below a sweep line, copy the rest (DirectionalDesaturation)
+ *
+ * A row is desaturated when (y + 0.5) / height < sweepFactor.
+ *
+ * @param conversionFactor [in] - uConversionFactor
+ * @param sweepFactor      [in] - uGrayscaleAnimationFactor, 0 to 1 from bottom to top
+ *
+ * @returns 0 on success else negative value
+ */
+int desaturateImageDirectional(const Image* pSrc, Image* pDst, float conversionFactor, float sweepFactor, uint32_t flags);
+
+/**
+ * @brief Name of kernels used on this CPU ("avx2", "neon" or "scalar")
+ */
+const char* imageKernelName(void);
+
+uint16_t floatToHalf(float val);
+float    halfToFloat(uint16_t val);
+
+#endif // !IMAGE_H
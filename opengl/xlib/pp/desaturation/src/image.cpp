@@ -0,0 +1,565 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "image.h"
+
+/* AVX2 kernels are built for their own target and only called when the CPU reports AVX2 and F16C */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(IMAGE_NO_AVX2)
+#include <immintrin.h>
+#define IMAGE_AVX2
+#define IMAGE_AVX2_TARGET __attribute__((target("avx2,f16c")))
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define IMAGE_NEON
+#endif
+
+/* luminance weights of the shaders */
+#define RED_WEIGHT   0.3f
+#define GREEN_WEIGHT 0.59f
+#define BLUE_WEIGHT  0.11f
+
+typedef void (*RowKernel)(const uint8_t* pSrc, uint8_t* pDst, uint32_t width, float factor, bool gray);
+
+/* ------------------------------------------------------------------------- */
+/* scalar reference                                                          */
+/* ------------------------------------------------------------------------- */
+
+uint16_t floatToHalf(float val)
+{
+    uint32_t bits = 0U;
+    memcpy(&bits, &val, sizeof(bits));
+
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000U);
+    bits &= 0x7fffffffU;
+
+    if (bits > 0x7f800000U)
+    {
+        /* NaN, quieted with truncated payload like F16C */
+        return (uint16_t)(sign | 0x7e00U | ((bits >> 13) & 0x3ffU));
+    }
+    if (bits >= 0x477ff000U)
+    {
+        /* rounds to a value above 65504 */
+        return (uint16_t)(sign | 0x7c00U);
+    }
+    if (bits < 0x38800000U)
+    {
+        /* half subnormal or zero, let the FPU round by aligning the mantissa to 2^-24 */
+        float    magic     = 0.5f;
+        uint32_t magicBits = 0x3f000000U;
+        float    absVal    = 0.0f;
+        memcpy(&absVal, &bits, sizeof(bits));
+        absVal += magic;
+        memcpy(&bits, &absVal, sizeof(bits));
+        return (uint16_t)(sign | (bits - magicBits));
+    }
+
+    /* normal, rebias exponent and round to nearest even */
+    uint32_t odd = (bits >> 13) & 1U;
+    bits += 0xc8000fffU + odd; // ((15 - 127) << 23) + 0xfff
+    return (uint16_t)(sign | (bits >> 13));
+}
+
+float halfToFloat(uint16_t val)
+{
+    uint32_t sign     = (uint32_t)(val & 0x8000U) << 16;
+    uint32_t exponent = (val >> 10) & 0x1fU;
+    uint32_t mantissa = val & 0x3ffU;
+    uint32_t bits     = 0U;
+    float    res      = 0.0f;
+
+    if (0U == exponent)
+    {
+        /* zero or subnormal, exact in single precision */
+        res = (float)mantissa * 5.9604644775390625e-8f; // 2^-24
+        return sign ? -res : res;
+    }
+
+    if (31U == exponent)
+        bits = sign | 0x7f800000U | (mantissa << 13) | (mantissa ? 0x00400000U : 0U); // NaN is quieted like F16C
+    else
+        bits = sign | ((exponent + 112U) << 23) | (mantissa << 13);
+
+    memcpy(&res, &bits, sizeof(res));
+    return res;
+}
+
+static inline uint8_t toUnorm8(float val)
+{
+    /* NaN maps to 0 like maxps/minps */
+    val = (val > 0.0f) ? val : 0.0f;
+    val = (val < 1.0f) ? val : 1.0f;
+    return (uint8_t)(val * 255.0f + 0.5f);
+}
+
+/**
+ * @brief Fragment shader body on one texel
+ */
+static inline void shadeTexel(float* pColor, float factor, bool gray)
+{
+    float gsc = (pColor[0] * RED_WEIGHT) + (pColor[1] * GREEN_WEIGHT) + (pColor[2] * BLUE_WEIGHT);
+    if (gray)
+    {
+        pColor[0] = gsc;
+        pColor[1] = gsc;
+        pColor[2] = gsc;
+        pColor[3] = 1.0f;
+    }
+    else
+    {
+        /* mix(x, y, a) = x * (1 - a) + y * a */
+        float keep = 1.0f - factor;
+        pColor[0]  = pColor[0] * keep + gsc * factor;
+        pColor[1]  = pColor[1] * keep + gsc * factor;
+        pColor[2]  = pColor[2] * keep + gsc * factor;
+        pColor[3]  = pColor[3] * keep + 1.0f * factor;
+    }
+}
+
+static void shadeRowRGBA8Scalar(const uint8_t* pSrc, uint8_t* pDst, uint32_t width, float factor, bool gray)
+{
+    for (uint32_t x = 0U; x < width; ++x)
+    {
+        float color[4];
+        for (int c = 0; c < 4; ++c)
+            color[c] = (float)pSrc[4U * x + c] / 255.0f;
+
+        shadeTexel(color, factor, gray);
+
+        for (int c = 0; c < 4; ++c)
+            pDst[4U * x + c] = toUnorm8(color[c]);
+    }
+}
+
+static void shadeRowRGBA16FScalar(const uint8_t* pSrc, uint8_t* pDst, uint32_t width, float factor, bool gray)
+{
+    const uint16_t* pIn  = (const uint16_t*)pSrc;
+    uint16_t*       pOut = (uint16_t*)pDst;
+    for (uint32_t x = 0U; x < width; ++x)
+    {
+        float color[4];
+        for (int c = 0; c < 4; ++c)
+            color[c] = halfToFloat(pIn[4U * x + c]);
+
+        shadeTexel(color, factor, gray);
+
+        /* float render target, no clamping */
+        for (int c = 0; c < 4; ++c)
+            pOut[4U * x + c] = floatToHalf(color[c]);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX2 + F16C, 8 texels per iteration                                       */
+/* ------------------------------------------------------------------------- */
+#if defined(IMAGE_AVX2)
+
+IMAGE_AVX2_TARGET static inline void shade8(__m256& r, __m256& g, __m256& b, __m256& a, float factor, bool gray)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 gsc = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, _mm256_set1_ps(RED_WEIGHT)), _mm256_mul_ps(g, _mm256_set1_ps(GREEN_WEIGHT))),
+                               _mm256_mul_ps(b, _mm256_set1_ps(BLUE_WEIGHT)));
+    if (gray)
+    {
+        r = gsc;
+        g = gsc;
+        b = gsc;
+        a = one;
+    }
+    else
+    {
+        const __m256 keep = _mm256_set1_ps(1.0f - factor);
+        const __m256 mix  = _mm256_set1_ps(factor);
+        const __m256 y    = _mm256_mul_ps(gsc, mix);
+        r                 = _mm256_add_ps(_mm256_mul_ps(r, keep), y);
+        g                 = _mm256_add_ps(_mm256_mul_ps(g, keep), y);
+        b                 = _mm256_add_ps(_mm256_mul_ps(b, keep), y);
+        a                 = _mm256_add_ps(_mm256_mul_ps(a, keep), _mm256_mul_ps(one, mix));
+    }
+}
+
+IMAGE_AVX2_TARGET static inline __m256i toUnorm8x8(__m256 val)
+{
+    val = _mm256_max_ps(val, _mm256_setzero_ps());
+    val = _mm256_min_ps(val, _mm256_set1_ps(1.0f));
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(val, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+}
+
+IMAGE_AVX2_TARGET static void shadeRowRGBA8AVX2(const uint8_t* pSrc, uint8_t* pDst, uint32_t width, float factor, bool gray)
+{
+    const __m256i mask  = _mm256_set1_epi32(0xff);
+    const __m256  scale = _mm256_set1_ps(255.0f);
+
+    uint32_t x = 0U;
+    for (; x + 8U <= width; x += 8U)
+    {
+        /* one texel per 32 bit lane, channels by shift and mask */
+        __m256i texels = _mm256_loadu_si256((const __m256i*)(pSrc + 4U * x));
+        __m256  r      = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(texels, mask)), scale);
+        __m256  g      = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), mask)), scale);
+        __m256  b      = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), mask)), scale);
+        __m256  a      = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(texels, 24)), scale);
+
+        shade8(r, g, b, a, factor, gray);
+
+        texels = _mm256_or_si256(_mm256_or_si256(toUnorm8x8(r), _mm256_slli_epi32(toUnorm8x8(g), 8)),
+                                 _mm256_or_si256(_mm256_slli_epi32(toUnorm8x8(b), 16), _mm256_slli_epi32(toUnorm8x8(a), 24)));
+        _mm256_storeu_si256((__m256i*)(pDst + 4U * x), texels);
+    }
+
+    shadeRowRGBA8Scalar(pSrc + 4U * x, pDst + 4U * x, width - x, factor, gray);
+}
+
+IMAGE_AVX2_TARGET static void shadeRowRGBA16FAVX2(const uint8_t* pSrc, uint8_t* pDst, uint32_t width, float factor, bool gray)
+{
+    uint32_t x = 0U;
+    for (; x + 8U <= width; x += 8U)
+    {
+        /* 2 texels per register, transpose within 128 bit lanes to r, g, b, a of texels 0 2 4 6 | 1 3 5 7 */
+        const __m128i* pIn = (const __m128i*)(pSrc + 8U * x);
+        __m256         v0  = _mm256_cvtph_ps(_mm_loadu_si128(pIn + 0));
+        __m256         v1  = _mm256_cvtph_ps(_mm_loadu_si128(pIn + 1));
+        __m256         v2  = _mm256_cvtph_ps(_mm_loadu_si128(pIn + 2));
+        __m256         v3  = _mm256_cvtph_ps(_mm_loadu_si128(pIn + 3));
+
+        __m256 t0 = _mm256_unpacklo_ps(v0, v1);
+        __m256 t1 = _mm256_unpackhi_ps(v0, v1);
+        __m256 t2 = _mm256_unpacklo_ps(v2, v3);
+        __m256 t3 = _mm256_unpackhi_ps(v2, v3);
+        __m256 r  = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 g  = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 b  = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 a  = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+        shade8(r, g, b, a, factor, gray);
+
+        t0 = _mm256_unpacklo_ps(r, g);
+        t1 = _mm256_unpacklo_ps(b, a);
+        t2 = _mm256_unpackhi_ps(r, g);
+        t3 = _mm256_unpackhi_ps(b, a);
+        v0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+        v1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+        v2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        v3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+        __m128i* pOut = (__m128i*)(pDst + 8U * x);
+        _mm_storeu_si128(pOut + 0, _mm256_cvtps_ph(v0, _MM_FROUND_TO_NEAREST_INT));
+        _mm_storeu_si128(pOut + 1, _mm256_cvtps_ph(v1, _MM_FROUND_TO_NEAREST_INT));
+        _mm_storeu_si128(pOut + 2, _mm256_cvtps_ph(v2, _MM_FROUND_TO_NEAREST_INT));
+        _mm_storeu_si128(pOut + 3, _mm256_cvtps_ph(v3, _MM_FROUND_TO_NEAREST_INT));
+    }
+
+    shadeRowRGBA16FScalar(pSrc + 8U * x, pDst + 8U * x, width - x, factor, gray);
+}
+
+static bool cpuHasAVX2(void)
+{
+    static const bool bSupported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    return bSupported;
+}
+
+/* scalar kernels on CPUs without AVX2, the binary runs everywhere */
+static RowKernel simdKernel(uint32_t format)
+{
+    if (!cpuHasAVX2())
+        return NULL;
+    return (IMAGE_FORMAT_RGBA16F == format) ? shadeRowRGBA16FAVX2 : shadeRowRGBA8AVX2;
+}
+
+const char* imageKernelName(void)
+{
+    return cpuHasAVX2() ? "avx2" : "scalar";
+}
+
+/* ------------------------------------------------------------------------- */
+/* NEON (AArch64), 16 texels per iteration for RGBA8, 4 for RGBA16F          */
+/* ------------------------------------------------------------------------- */
+#elif defined(IMAGE_NEON)
+
+static inline void shade4(float32x4_t& r, float32x4_t& g, float32x4_t& b, float32x4_t& a, float factor, bool gray)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    float32x4_t gsc = vaddq_f32(vaddq_f32(vmulq_n_f32(r, RED_WEIGHT), vmulq_n_f32(g, GREEN_WEIGHT)), vmulq_n_f32(b, BLUE_WEIGHT));
+    if (gray)
+    {
+        r = gsc;
+        g = gsc;
+        b = gsc;
+        a = one;
+    }
+    else
+    {
+        const float keep = 1.0f - factor;
+        const float32x4_t y = vmulq_n_f32(gsc, factor);
+        r                   = vaddq_f32(vmulq_n_f32(r, keep), y);
+        g                   = vaddq_f32(vmulq_n_f32(g, keep), y);
+        b                   = vaddq_f32(vmulq_n_f32(b, keep), y);
+        a                   = vaddq_f32(vmulq_n_f32(a, keep), vmulq_n_f32(one, factor));
+    }
+}
+
+static inline float32x4_t fromUnorm8x4(uint16x8_t val, bool high)
+{
+    uint32x4_t wide = high ? vmovl_high_u16(val) : vmovl_u16(vget_low_u16(val));
+    return vdivq_f32(vcvtq_f32_u32(wide), vdupq_n_f32(255.0f));
+}
+
+static inline uint32x4_t toUnorm8x4(float32x4_t val)
+{
+    /* maxnm maps NaN to 0 */
+    val = vminq_f32(vmaxnmq_f32(val, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+    return vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(val, 255.0f), vdupq_n_f32(0.5f)));
+}
+
+static void shadeRowRGBA8(const uint8_t* pSrc, uint8_t* pDst, uint32_t width, float factor, bool gray)
+{
+    uint32_t x = 0U;
+    for (; x + 16U <= width; x += 16U)
+    {
+        uint8x16x4_t texels = vld4q_u8(pSrc + 4U * x);
+        uint16x8_t   lo[4];
+        uint16x8_t   hi[4];
+        for (int c = 0; c < 4; ++c)
+        {
+            lo[c] = vmovl_u8(vget_low_u8(texels.val[c]));
+            hi[c] = vmovl_high_u8(texels.val[c]);
+        }
+
+        for (int quarter = 0; quarter < 4; ++quarter)
+        {
+            const uint16x8_t* pHalf = (quarter < 2) ? lo : hi;
+            bool              high  = (1 == (quarter & 1));
+            float32x4_t       r     = fromUnorm8x4(pHalf[0], high);
+            float32x4_t       g     = fromUnorm8x4(pHalf[1], high);
+            float32x4_t       b     = fromUnorm8x4(pHalf[2], high);
+            float32x4_t       a     = fromUnorm8x4(pHalf[3], high);
+
+            shade4(r, g, b, a, factor, gray);
+
+            /* results replace the 4 lanes just read, other quarters are untouched */
+            uint32x4_t out[4] = {toUnorm8x4(r), toUnorm8x4(g), toUnorm8x4(b), toUnorm8x4(a)};
+            for (int c = 0; c < 4; ++c)
+            {
+                uint16x4_t narrow = vmovn_u32(out[c]);
+                if (0 == quarter)
+                    lo[c] = vcombine_u16(narrow, vget_high_u16(lo[c]));
+                else if (1 == quarter)
+                    lo[c] = vcombine_u16(vget_low_u16(lo[c]), narrow);
+                else if (2 == quarter)
+                    hi[c] = vcombine_u16(narrow, vget_high_u16(hi[c]));
+                else
+                    hi[c] = vcombine_u16(vget_low_u16(hi[c]), narrow);
+            }
+        }
+
+        for (int c = 0; c < 4; ++c)
+            texels.val[c] = vcombine_u8(vmovn_u16(lo[c]), vmovn_u16(hi[c]));
+        vst4q_u8(pDst + 4U * x, texels);
+    }
+
+    shadeRowRGBA8Scalar(pSrc + 4U * x, pDst + 4U * x, width - x, factor, gray);
+}
+
+static void shadeRowRGBA16F(const uint8_t* pSrc, uint8_t* pDst, uint32_t width, float factor, bool gray)
+{
+    uint32_t x = 0U;
+    for (; x + 4U <= width; x += 4U)
+    {
+        uint16x4x4_t texels = vld4_u16((const uint16_t*)(pSrc + 8U * x));
+        float32x4_t  r      = vcvt_f32_f16(vreinterpret_f16_u16(texels.val[0]));
+        float32x4_t  g      = vcvt_f32_f16(vreinterpret_f16_u16(texels.val[1]));
+        float32x4_t  b      = vcvt_f32_f16(vreinterpret_f16_u16(texels.val[2]));
+        float32x4_t  a      = vcvt_f32_f16(vreinterpret_f16_u16(texels.val[3]));
+
+        shade4(r, g, b, a, factor, gray);
+
+        texels.val[0] = vreinterpret_u16_f16(vcvt_f16_f32(r));
+        texels.val[1] = vreinterpret_u16_f16(vcvt_f16_f32(g));
+        texels.val[2] = vreinterpret_u16_f16(vcvt_f16_f32(b));
+        texels.val[3] = vreinterpret_u16_f16(vcvt_f16_f32(a));
+        vst4_u16((uint16_t*)(pDst + 8U * x), texels);
+    }
+
+    shadeRowRGBA16FScalar(pSrc + 8U * x, pDst + 8U * x, width - x, factor, gray);
+}
+
+static RowKernel simdKernel(uint32_t format)
+{
+    return (IMAGE_FORMAT_RGBA16F == format) ? shadeRowRGBA16F : shadeRowRGBA8;
+}
+
+const char* imageKernelName(void)
+{
+    return "neon";
+}
+
+#else
+
+static RowKernel simdKernel(uint32_t)
+{
+    return NULL;
+}
+
+const char* imageKernelName(void)
+{
+    return "scalar";
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* images                                                                    */
+/* ------------------------------------------------------------------------- */
+
+static inline size_t texelBytes(uint32_t format)
+{
+    return (IMAGE_FORMAT_RGBA16F == format) ? 8U : 4U;
+}
+
+int createImage(Image* pImage, uint32_t width, uint32_t height, uint32_t format)
+{
+    if (NULL == pImage || 0U == width || 0U == height || (IMAGE_FORMAT_RGBA8 != format && IMAGE_FORMAT_RGBA16F != format))
+    {
+        fprintf(stderr, "%s: invalid arguments\n", __func__);
+        return -1;
+    }
+
+    pImage->width  = width;
+    pImage->height = height;
+    pImage->format = format;
+    pImage->stride = (size_t)width * texelBytes(format);
+    pImage->pData  = (uint8_t*)malloc(pImage->stride * height);
+    if (NULL == pImage->pData)
+    {
+        fprintf(stderr, "%s: failed to allocate %ux%u image\n", __func__, width, height);
+        return -1;
+    }
+    return 0;
+}
+
+void destroyImage(Image* pImage)
+{
+    if (NULL != pImage && NULL != pImage->pData)
+    {
+        free(pImage->pData);
+        pImage->pData = NULL;
+    }
+}
+
+int convertImage(const Image* pSrc, Image* pDst)
+{
+    if (NULL == pSrc || NULL == pDst || NULL == pSrc->pData || NULL == pDst->pData || pSrc->width != pDst->width || pSrc->height != pDst->height)
+    {
+        fprintf(stderr, "%s: invalid arguments\n", __func__);
+        return -1;
+    }
+
+    for (uint32_t y = 0U; y < pSrc->height; ++y)
+    {
+        const uint8_t* pIn  = pSrc->pData + y * pSrc->stride;
+        uint8_t*       pOut = pDst->pData + y * pDst->stride;
+        for (uint32_t idx = 0U; idx < 4U * pSrc->width; ++idx)
+        {
+            float val = (IMAGE_FORMAT_RGBA8 == pSrc->format) ? (float)pIn[idx] / 255.0f : halfToFloat(((const uint16_t*)pIn)[idx]);
+            if (IMAGE_FORMAT_RGBA8 == pDst->format)
+                pOut[idx] = toUnorm8(val);
+            else
+                ((uint16_t*)pOut)[idx] = floatToHalf(val);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Run the kernel over rows, split in horizontal bands for large images
+ *
+ * @param sweepFactor [in] - rows at or above the sweep line are copied, > 1 processes every row
+ */
+static int processImage(const Image* pSrc, Image* pDst, float conversionFactor, float sweepFactor, bool gray, uint32_t flags)
+{
+    if (NULL == pSrc || NULL == pDst || NULL == pSrc->pData || NULL == pDst->pData)
+    {
+        fprintf(stderr, "%s: invalid image\n", __func__);
+        return -1;
+    }
+    if (pSrc->width != pDst->width || pSrc->height != pDst->height || pSrc->format != pDst->format)
+    {
+        fprintf(stderr, "%s: source and destination differ in size or format\n", __func__);
+        return -1;
+    }
+
+    RowKernel kernel = NULL;
+    if (IMAGE_FORMAT_RGBA8 == pSrc->format)
+        kernel = shadeRowRGBA8Scalar;
+    else if (IMAGE_FORMAT_RGBA16F == pSrc->format)
+        kernel = shadeRowRGBA16FScalar;
+    else
+    {
+        fprintf(stderr, "%s: unknown format %u\n", __func__, pSrc->format);
+        return -1;
+    }
+    if (0U == (flags & IMAGE_FLAG_SCALAR) && NULL != simdKernel(pSrc->format))
+        kernel = simdKernel(pSrc->format);
+
+    const size_t rowBytes = (size_t)pSrc->width * texelBytes(pSrc->format);
+    auto         band     = [=](uint32_t first, uint32_t last) {
+        for (uint32_t y = first; y < last; ++y)
+        {
+            const uint8_t* pIn  = pSrc->pData + y * pSrc->stride;
+            uint8_t*       pOut = pDst->pData + y * pDst->stride;
+            if (((float)y + 0.5f) / (float)pSrc->height < sweepFactor)
+                kernel(pIn, pOut, pSrc->width, conversionFactor, gray);
+            else if (pIn != pOut)
+                memcpy(pOut, pIn, rowBytes);
+        }
+    };
+
+    uint32_t nThreads = 1U;
+    if (0U == (flags & IMAGE_FLAG_SINGLE_THREAD) && (uint64_t)pSrc->width * pSrc->height >= IMAGE_PARALLEL_PIXELS)
+    {
+        nThreads = std::thread::hardware_concurrency();
+        nThreads = (0U == nThreads) ? 1U : nThreads;
+        nThreads = (nThreads > pSrc->height) ? pSrc->height : nThreads;
+    }
+
+    if (1U == nThreads)
+    {
+        band(0U, pSrc->height);
+        return 0;
+    }
+
+    /* calling thread takes the first band */
+    std::vector<std::thread> workers;
+    uint32_t                 rowsPerBand = (pSrc->height + nThreads - 1U) / nThreads;
+    for (uint32_t first = rowsPerBand; first < pSrc->height; first += rowsPerBand)
+    {
+        uint32_t last = (first + rowsPerBand < pSrc->height) ? first + rowsPerBand : pSrc->height;
+        workers.emplace_back(band, first, last);
+    }
+    band(0U, rowsPerBand);
+
+    for (std::thread& worker : workers)
+        worker.join();
+    return 0;
+}
+
+int grayscaleImage(const Image* pSrc, Image* pDst, uint32_t flags)
+{
+    return processImage(pSrc, pDst, 1.0f, 2.0f, true, flags);
+}
+
+int desaturateImage(const Image* pSrc, Image* pDst, float conversionFactor, uint32_t flags)
+{
+    return processImage(pSrc, pDst, conversionFactor, 2.0f, false, flags);
+}
+
+int desaturateImageDirectional(const Image* pSrc, Image* pDst, float conversionFactor, float sweepFactor, uint32_t flags)
+{
+    return processImage(pSrc, pDst, conversionFactor, sweepFactor, false, flags);
+}
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "image.h"
+#include "stb_image.h"
+
+/**
+ * Batch version of the desaturation samples
+ *
+ *   desaturation [-half] [-scalar] [-verify] <grayscale|desaturate|directional> <factor> [sweep] <input> <output.ppm|output.pam>
+ *
+ * -half    process as RGBA16F instead of RGBA8
+ * -scalar  use the reference kernels
+ * -verify  also run the reference kernels and compare every byte
+ */
+
+enum Effect
+{
+    EFFECT_GRAYSCALE = 0,
+    EFFECT_DESATURATE,
+    EFFECT_DIRECTIONAL
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static int applyEffect(int effect, const Image* pSrc, Image* pDst, float factor, float sweep, uint32_t flags)
+{
+    switch (effect)
+    {
+    case EFFECT_GRAYSCALE:
+        return grayscaleImage(pSrc, pDst, flags);
+    case EFFECT_DESATURATE:
+        return desaturateImage(pSrc, pDst, factor, flags);
+    default:
+        return desaturateImageDirectional(pSrc, pDst, factor, sweep, flags);
+    }
+}
+
+/**
+ * @brief Write RGBA8 image as binary PPM, or PAM with alpha if the name ends in .pam
+ *
+ * Rows are written top down, i.e. flipped back from GL order.
+ */
+static int writeImage(const Image* pImage, const char* pFileName)
+{
+    const char* pExt   = strrchr(pFileName, '.');
+    bool        bAlpha = (NULL != pExt) && (0 == strcmp(pExt, ".pam"));
+
+    FILE* pFile = fopen(pFileName, "wb");
+    if (NULL == pFile)
+    {
+        fprintf(stderr, "Failed to open output file %s\n", pFileName);
+        return -1;
+    }
+
+    if (bAlpha)
+        fprintf(pFile, "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", pImage->width, pImage->height);
+    else
+        fprintf(pFile, "P6\n%u %u\n255\n", pImage->width, pImage->height);
+
+    int      res  = 0;
+    uint8_t* pRow = (uint8_t*)malloc((size_t)pImage->width * 4U);
+    for (uint32_t y = pImage->height; (0 == res) && (NULL != pRow) && (y-- > 0U);)
+    {
+        const uint8_t* pIn    = pImage->pData + y * pImage->stride;
+        size_t         nBytes = 0U;
+        for (uint32_t x = 0U; x < pImage->width; ++x)
+        {
+            pRow[nBytes++] = pIn[4U * x + 0U];
+            pRow[nBytes++] = pIn[4U * x + 1U];
+            pRow[nBytes++] = pIn[4U * x + 2U];
+            if (bAlpha)
+                pRow[nBytes++] = pIn[4U * x + 3U];
+        }
+        if (1 != fwrite(pRow, nBytes, 1, pFile))
+            res = -1;
+    }
+
+    if (NULL == pRow || 0 != res)
+    {
+        fprintf(stderr, "Failed to write %s\n", pFileName);
+        res = -1;
+    }
+    free(pRow);
+    fclose(pFile);
+    return res;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t format  = IMAGE_FORMAT_RGBA8;
+    uint32_t flags   = 0U;
+    bool     bVerify = false;
+
+    int arg = 1;
+    for (; arg < argc && '-' == argv[arg][0]; ++arg)
+    {
+        if (0 == strcmp(argv[arg], "-half"))
+            format = IMAGE_FORMAT_RGBA16F;
+        else if (0 == strcmp(argv[arg], "-scalar"))
+            flags |= IMAGE_FLAG_SCALAR;
+        else if (0 == strcmp(argv[arg], "-verify"))
+            bVerify = true;
+        else
+            break;
+    }
+
+    int effect = -1;
+    if (arg < argc)
+    {
+        if (0 == strcmp(argv[arg], "grayscale"))
+            effect = EFFECT_GRAYSCALE;
+        else if (0 == strcmp(argv[arg], "desaturate"))
+            effect = EFFECT_DESATURATE;
+        else if (0 == strcmp(argv[arg], "directional"))
+            effect = EFFECT_DIRECTIONAL;
+    }
+
+    int nArgs = (EFFECT_DIRECTIONAL == effect) ? 5 : 4;
+    if (0 > effect || argc - arg != nArgs)
+    {
+        fprintf(stderr, "Usage: %s [-half] [-scalar] [-verify] <grayscale|desaturate|directional> <factor> [sweep] <input> <output.ppm|output.pam>\n", argv[0]);
+        return -1;
+    }
+
+    float       factor  = (float)atof(argv[arg + 1]);
+    float       sweep   = (EFFECT_DIRECTIONAL == effect) ? (float)atof(argv[arg + 2]) : 1.0f;
+    const char* pInput  = argv[argc - 2];
+    const char* pOutput = argv[argc - 1];
+
+    /* same orientation as the textures of the samples */
+    int width     = 0;
+    int height    = 0;
+    int nChannels = 0;
+    stbi_set_flip_vertically_on_load(true);
+    uint8_t* pPixels = stbi_load(pInput, &width, &height, &nChannels, 4);
+    if (NULL == pPixels)
+    {
+        fprintf(stderr, "Failed to load image %s\n", pInput);
+        return -1;
+    }
+
+    Image source    = {(uint32_t)width, (uint32_t)height, IMAGE_FORMAT_RGBA8, (size_t)width * 4U, pPixels};
+    Image work      = {};
+    Image reference = {};
+    Image output    = {};
+    int   res       = createImage(&work, source.width, source.height, format);
+    if (0 == res)
+        res = convertImage(&source, &work);
+    if (0 == res && bVerify)
+    {
+        res = createImage(&reference, source.width, source.height, format);
+        if (0 == res)
+            res = applyEffect(effect, &work, &reference, factor, sweep, flags | IMAGE_FLAG_SCALAR);
+    }
+
+    if (0 == res)
+    {
+        double start = now();
+        res          = applyEffect(effect, &work, &work, factor, sweep, flags);
+        fprintf(stdout, "%ux%u %s %s kernels: %.3f ms\n", source.width, source.height, (IMAGE_FORMAT_RGBA16F == format) ? "RGBA16F" : "RGBA8",
+                (flags & IMAGE_FLAG_SCALAR) ? "scalar" : imageKernelName(), now() - start);
+    }
+
+    if (0 == res && bVerify)
+    {
+        size_t nBytes      = work.stride * work.height;
+        size_t nMismatches = 0U;
+        for (size_t idx = 0U; idx < nBytes; ++idx)
+        {
+            if (work.pData[idx] != reference.pData[idx])
+                ++nMismatches;
+        }
+        fprintf(stdout, "verify: %zu of %zu bytes differ from reference\n", nMismatches, nBytes);
+        res = (0U == nMismatches) ? 0 : -1;
+    }
+
+    if (0 == res)
+    {
+        res = createImage(&output, source.width, source.height, IMAGE_FORMAT_RGBA8);
+        if (0 == res)
+            res = convertImage(&work, &output);
+        if (0 == res)
+            res = writeImage(&output, pOutput);
+    }
+
+    destroyImage(&output);
+    destroyImage(&reference);
+    destroyImage(&work);
+    stbi_image_free(pPixels);
+    return res;
+}
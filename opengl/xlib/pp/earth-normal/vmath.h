@@ -4,6 +4,74 @@
 
 #define _USE_MATH_DEFINES  1 // Include constants defined in math.h
 #include <math.h>
+#include <stddef.h>
+
+// define VMATH_THREADS to split large batches of transformPoints and
+// transformNormals across threads
+#if defined(VMATH_THREADS)
+#include <thread>
+#include <vector>
+#endif
+
+// float mat4 uses SSE (AVX when enabled by the compiler) or NEON, vec4
+// arithmetic stays on the generic loops which the compiler keeps in registers
+// across a whole expression,
+// define VMATH_NO_SIMD to build the generic templates only
+#if !defined(VMATH_NO_SIMD)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define VMATH_SSE 1
+#include <xmmintrin.h>
+#if defined(__AVX__)
+#define VMATH_AVX 1
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VMATH_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(VMATH_SSE) || defined(VMATH_NEON)
+#define VMATH_SIMD 1
+#endif
+
+// Construction and arithmetic are constexpr from C++14 on. SIMD paths are
+// skipped during constant evaluation, which needs __builtin_is_constant_evaluated
+// (GCC 9, clang 9, MSVC 19.25); without it float mat4 is only
+// constexpr with VMATH_NO_SIMD. VMATH_HAS_CONSTEXPR is set when all types are.
+#if (__cplusplus >= 201402L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#define VMATH_CONSTEXPR constexpr
+#if (__cplusplus < 202002L) && !(defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+// constexpr constructors must initialize every member before C++20
+#define VMATH_CONSTEXPR_ZERO_INIT 1
+#endif
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define VMATH_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#if !defined(VMATH_CONSTANT_EVALUATED) && ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+#define VMATH_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#if defined(VMATH_CONSTANT_EVALUATED) || !defined(VMATH_SIMD)
+#define VMATH_HAS_CONSTEXPR 1
+#endif
+#else
+#define VMATH_CONSTEXPR inline
+#endif
+
+#if !defined(VMATH_CONSTANT_EVALUATED)
+#define VMATH_CONSTANT_EVALUATED() false
+#endif
+
+// For tables computed with vmath, e.g.
+// VMATH_CONSTEXPR_DATA mat4 bias = translate(0.5f, 0.5f, 0.5f) * scale(0.5f);
+// is built at compile time when possible and at start up otherwise
+#if defined(VMATH_HAS_CONSTEXPR)
+#define VMATH_CONSTEXPR_DATA constexpr
+#else
+#define VMATH_CONSTEXPR_DATA const
+#endif
 
 namespace vmath
 {
@@ -12,6 +80,23 @@ template <typename T, const int w, const int h> class matNM;
 template <typename T, const int len> class vecN;
 template <typename T> class Tquaternion;
 
+namespace simd
+{
+// Kernels on raw column major data. These return false and the generic
+// loops run instead, float mat4 versions are specialized further down.
+template <typename T, const int len> static VMATH_CONSTEXPR bool add(T*, const T*, const T*) { return false; }
+template <typename T, const int len> static VMATH_CONSTEXPR bool sub(T*, const T*, const T*) { return false; }
+template <typename T, const int len> static VMATH_CONSTEXPR bool mul(T*, const T*, const T*) { return false; }
+template <typename T, const int len> static VMATH_CONSTEXPR bool div(T*, const T*, const T*) { return false; }
+template <typename T, const int len> static VMATH_CONSTEXPR bool scale(T*, const T*, T) { return false; }
+template <typename T, const int w, const int h> static VMATH_CONSTEXPR bool multiply(T*, const T*, const T*) { return false; }
+template <typename T, const int w, const int h> static VMATH_CONSTEXPR bool multiplyVector(T*, const T*, const T*) { return false; }
+template <typename T, const int w, const int h> static VMATH_CONSTEXPR bool transpose(T*, const T*) { return false; }
+template <typename T> static VMATH_CONSTEXPR bool inverse(T*, const T*) { return false; }
+template <typename T> static VMATH_CONSTEXPR bool inverseAffine(T*, const T*) { return false; }
+template <typename T> static VMATH_CONSTEXPR bool inverseTranspose3x3(T*, const T*) { return false; }
+} // namespace simd
+
 template <typename T> 
 inline T degrees(T angleInRadians)
 {
@@ -89,147 +174,155 @@ public:
     typedef T element_type;
 
     // Default constructor does nothing, just like built-in types
-    inline vecN()
+#if defined(VMATH_CONSTEXPR_ZERO_INIT)
+    VMATH_CONSTEXPR vecN() : data()
+    {
+        // Zero filled, constexpr constructors have to initialize members
+    }
+#else
+    VMATH_CONSTEXPR vecN()
     {
         // Uninitialized variable
     }
+#endif
 
     // Copy constructor
-    inline vecN(const vecN& that)
+    VMATH_CONSTEXPR vecN(const vecN& that) : vecN()
     {
         assign(that);
     }
 
     // Construction from scalar
-    inline vecN(T s)
+    VMATH_CONSTEXPR vecN(T s) : vecN()
     {
-        int n;
-        for (n = 0; n < len; n++)
+        for (int n = 0; n < len; n++)
         {
             data[n] = s;
         }
     }
 
     // Assignment operator
-    inline vecN& operator=(const vecN& that)
+    VMATH_CONSTEXPR vecN& operator=(const vecN& that)
     {
         assign(that);
         return *this;
     }
 
-    inline vecN& operator=(const T& that)
+    VMATH_CONSTEXPR vecN& operator=(const T& that)
     {
-        int n;
-        for (n = 0; n < len; n++)
+        for (int n = 0; n < len; n++)
             data[n] = that;
 
         return *this;
     }
 
-    inline vecN operator+(const vecN& that) const
+    VMATH_CONSTEXPR vecN operator+(const vecN& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < len; n++)
+        if (!VMATH_CONSTANT_EVALUATED() && simd::add<T,len>(result.data, data, that.data))
+            return result;
+        for (int n = 0; n < len; n++)
             result.data[n] = data[n] + that.data[n];
         return result;
     }
 
-    inline vecN& operator+=(const vecN& that)
+    VMATH_CONSTEXPR vecN& operator+=(const vecN& that)
     {
         return (*this = *this + that);
     }
 
-    inline vecN operator-() const
+    VMATH_CONSTEXPR vecN operator-() const
     {
         my_type result;
-        int n;
-        for (n = 0; n < len; n++)
+        for (int n = 0; n < len; n++)
             result.data[n] = -data[n];
         return result;
     }
 
-    inline vecN operator-(const vecN& that) const
+    VMATH_CONSTEXPR vecN operator-(const vecN& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < len; n++)
+        if (!VMATH_CONSTANT_EVALUATED() && simd::sub<T,len>(result.data, data, that.data))
+            return result;
+        for (int n = 0; n < len; n++)
             result.data[n] = data[n] - that.data[n];
         return result;
     }
 
-    inline vecN& operator-=(const vecN& that)
+    VMATH_CONSTEXPR vecN& operator-=(const vecN& that)
     {
         return (*this = *this - that);
     }
 
-    inline vecN operator*(const vecN& that) const
+    VMATH_CONSTEXPR vecN operator*(const vecN& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < len; n++)
+        if (!VMATH_CONSTANT_EVALUATED() && simd::mul<T,len>(result.data, data, that.data))
+            return result;
+        for (int n = 0; n < len; n++)
             result.data[n] = data[n] * that.data[n];
         return result;
     }
 
-    inline vecN& operator*=(const vecN& that)
+    VMATH_CONSTEXPR vecN& operator*=(const vecN& that)
     {
         return (*this = *this * that);
     }
 
-    inline vecN operator*(const T& that) const
+    VMATH_CONSTEXPR vecN operator*(const T& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < len; n++)
+        if (!VMATH_CONSTANT_EVALUATED() && simd::scale<T,len>(result.data, data, that))
+            return result;
+        for (int n = 0; n < len; n++)
             result.data[n] = data[n] * that;
         return result;
     }
 
-    inline vecN& operator*=(const T& that)
+    VMATH_CONSTEXPR vecN& operator*=(const T& that)
     {
         assign(*this * that);
 
         return *this;
     }
 
-    inline vecN operator/(const vecN& that) const
+    VMATH_CONSTEXPR vecN operator/(const vecN& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < len; n++)
+        if (!VMATH_CONSTANT_EVALUATED() && simd::div<T,len>(result.data, data, that.data))
+            return result;
+        for (int n = 0; n < len; n++)
             result.data[n] = data[n] / that.data[n];
         return result;
     }
 
-    inline vecN& operator/=(const vecN& that)
+    VMATH_CONSTEXPR vecN& operator/=(const vecN& that)
     {
         assign(*this / that);
 
         return *this;
     }
 
-    inline vecN operator/(const T& that) const
+    VMATH_CONSTEXPR vecN operator/(const T& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < len; n++)
+        for (int n = 0; n < len; n++)
             result.data[n] = data[n] / that;
         return result;
     }
 
-    inline vecN& operator/=(const T& that)
+    VMATH_CONSTEXPR vecN& operator/=(const T& that)
     {
         assign(*this / that);
         return *this;
     }
 
-    inline T& operator[](int n) { return data[n]; }
-    inline const T& operator[](int n) const { return data[n]; }
+    VMATH_CONSTEXPR T& operator[](int n) { return data[n]; }
+    VMATH_CONSTEXPR const T& operator[](int n) const { return data[n]; }
 
-    inline static int size(void) { return len; }
+    VMATH_CONSTEXPR static int size(void) { return len; }
 
-    inline operator const T* () const { return &data[0]; }
+    VMATH_CONSTEXPR operator const T* () const { return &data[0]; }
 
     static inline vecN random()
     {
@@ -246,10 +339,9 @@ public:
 protected:
     T data[len];
 
-    inline void assign(const vecN& that)
+    VMATH_CONSTEXPR void assign(const vecN& that)
     {
-        int n;
-        for (n = 0; n < len; n++)
+        for (int n = 0; n < len; n++)
             data[n] = that.data[n];
     }
 };
@@ -261,12 +353,12 @@ public:
     typedef vecN<T,2> base;
 
     // Uninitialized variable
-    inline Tvec2() {}
+    VMATH_CONSTEXPR Tvec2() : base() {}
     // Copy constructor
-    inline Tvec2(const base& v) : base(v) {}
+    VMATH_CONSTEXPR Tvec2(const base& v) : base(v) {}
 
     // vec2(x, y);
-    inline Tvec2(T x, T y)
+    VMATH_CONSTEXPR Tvec2(T x, T y) : base()
     {
         base::data[0] = x;
         base::data[1] = y;
@@ -280,13 +372,13 @@ public:
     typedef vecN<T,3> base;
 
     // Uninitialized variable
-    inline Tvec3() {}
+    VMATH_CONSTEXPR Tvec3() : base() {}
 
     // Copy constructor
-    inline Tvec3(const base& v) : base(v) {}
+    VMATH_CONSTEXPR Tvec3(const base& v) : base(v) {}
 
     // vec3(x, y, z);
-    inline Tvec3(T x, T y, T z)
+    VMATH_CONSTEXPR Tvec3(T x, T y, T z) : base()
     {
         base::data[0] = x;
         base::data[1] = y;
@@ -294,7 +386,7 @@ public:
     }
 
     // vec3(v, z);
-    inline Tvec3(const Tvec2<T>& v, T z)
+    VMATH_CONSTEXPR Tvec3(const Tvec2<T>& v, T z) : base()
     {
         base::data[0] = v[0];
         base::data[1] = v[1];
@@ -302,7 +394,7 @@ public:
     }
 
     // vec3(x, v)
-    inline Tvec3(T x, const Tvec2<T>& v)
+    VMATH_CONSTEXPR Tvec3(T x, const Tvec2<T>& v) : base()
     {
         base::data[0] = x;
         base::data[1] = v[0];
@@ -317,13 +409,13 @@ public:
     typedef vecN<T,4> base;
 
     // Uninitialized variable
-    inline Tvec4() {}
+    VMATH_CONSTEXPR Tvec4() : base() {}
 
     // Copy constructor
-    inline Tvec4(const base& v) : base(v) {}
+    VMATH_CONSTEXPR Tvec4(const base& v) : base(v) {}
 
     // vec4(x, y, z, w);
-    inline Tvec4(T x, T y, T z, T w)
+    VMATH_CONSTEXPR Tvec4(T x, T y, T z, T w) : base()
     {
         base::data[0] = x;
         base::data[1] = y;
@@ -332,7 +424,7 @@ public:
     }
 
     // vec4(v, z, w);
-    inline Tvec4(const Tvec2<T>& v, T z, T w)
+    VMATH_CONSTEXPR Tvec4(const Tvec2<T>& v, T z, T w) : base()
     {
         base::data[0] = v[0];
         base::data[1] = v[1];
@@ -341,7 +433,7 @@ public:
     }
 
     // vec4(x, v, w);
-    inline Tvec4(T x, const Tvec2<T>& v, T w)
+    VMATH_CONSTEXPR Tvec4(T x, const Tvec2<T>& v, T w) : base()
     {
         base::data[0] = x;
         base::data[1] = v[0];
@@ -350,7 +442,7 @@ public:
     }
 
     // vec4(x, y, v);
-    inline Tvec4(T x, T y, const Tvec2<T>& v)
+    VMATH_CONSTEXPR Tvec4(T x, T y, const Tvec2<T>& v) : base()
     {
         base::data[0] = x;
         base::data[1] = y;
@@ -359,7 +451,7 @@ public:
     }
 
     // vec4(v1, v2);
-    inline Tvec4(const Tvec2<T>& u, const Tvec2<T>& v)
+    VMATH_CONSTEXPR Tvec4(const Tvec2<T>& u, const Tvec2<T>& v) : base()
     {
         base::data[0] = u[0];
         base::data[1] = u[1];
@@ -368,7 +460,7 @@ public:
     }
 
     // vec4(v, w);
-    inline Tvec4(const Tvec3<T>& v, T w)
+    VMATH_CONSTEXPR Tvec4(const Tvec3<T>& v, T w) : base()
     {
         base::data[0] = v[0];
         base::data[1] = v[1];
@@ -377,7 +469,7 @@ public:
     }
 
     // vec4(x, v);
-    inline Tvec4(T x, const Tvec3<T>& v)
+    VMATH_CONSTEXPR Tvec4(T x, const Tvec3<T>& v) : base()
     {
         base::data[0] = x;
         base::data[1] = v[0];
@@ -410,35 +502,34 @@ typedef Tvec4<unsigned int> uvec4;
 typedef Tvec4<double> dvec4;
 
 template <typename T, int n>
-static inline const vecN<T,n> operator * (T x, const vecN<T,n>& v)
+static VMATH_CONSTEXPR const vecN<T,n> operator * (T x, const vecN<T,n>& v)
 {
     return v * x;
 }
 
 template <typename T>
-static inline const Tvec2<T> operator / (T x, const Tvec2<T>& v)
+static VMATH_CONSTEXPR const Tvec2<T> operator / (T x, const Tvec2<T>& v)
 {
     return Tvec2<T>(x / v[0], x / v[1]);
 }
 
 template <typename T>
-static inline const Tvec3<T> operator / (T x, const Tvec3<T>& v)
+static VMATH_CONSTEXPR const Tvec3<T> operator / (T x, const Tvec3<T>& v)
 {
     return Tvec3<T>(x / v[0], x / v[1], x / v[2]);
 }
 
 template <typename T>
-static inline const Tvec4<T> operator / (T x, const Tvec4<T>& v)
+static VMATH_CONSTEXPR const Tvec4<T> operator / (T x, const Tvec4<T>& v)
 {
     return Tvec4<T>(x / v[0], x / v[1], x / v[2], x / v[3]);
 }
 
 template <typename T, int len>
-static inline T dot(const vecN<T,len>& a, const vecN<T,len>& b)
+static VMATH_CONSTEXPR T dot(const vecN<T,len>& a, const vecN<T,len>& b)
 {
-    int n;
     T total = T(0);
-    for (n = 0; n < len; n++)
+    for (int n = 0; n < len; n++)
     {
         total += a[n] * b[n];
     }
@@ -446,7 +537,7 @@ static inline T dot(const vecN<T,len>& a, const vecN<T,len>& b)
 }
 
 template <typename T>
-static inline vecN<T,3> cross(const vecN<T,3>& a, const vecN<T,3>& b)
+static VMATH_CONSTEXPR vecN<T,3> cross(const vecN<T,3>& a, const vecN<T,3>& b)
 {
     return Tvec3<T>(a[1] * b[2] - b[1] * a[2],
                     a[2] * b[0] - b[2] * a[0],
@@ -488,61 +579,63 @@ template <typename T>
 class Tquaternion
 {
 public:
-    inline Tquaternion()
+    VMATH_CONSTEXPR Tquaternion()
+        : r(),
+          v()
     {
 
     }
 
-    inline Tquaternion(const Tquaternion& q)
+    VMATH_CONSTEXPR Tquaternion(const Tquaternion& q)
         : r(q.r),
           v(q.v)
     {
 
     }
 
-    inline Tquaternion(T _r)
+    VMATH_CONSTEXPR Tquaternion(T _r)
         : r(_r),
           v(T(0))
     {
 
     }
 
-    inline Tquaternion(T _r, const Tvec3<T>& _v)
+    VMATH_CONSTEXPR Tquaternion(T _r, const Tvec3<T>& _v)
         : r(_r),
           v(_v)
     {
 
     }
 
-    inline Tquaternion(const Tvec4<T>& _v)
+    VMATH_CONSTEXPR Tquaternion(const Tvec4<T>& _v)
         : r(_v[0]),
           v(_v[1], _v[2], _v[3])
     {
     }
 
-    inline Tquaternion(T _x, T _y, T _z, T _w)
+    VMATH_CONSTEXPR Tquaternion(T _x, T _y, T _z, T _w)
         : r(_x),
           v(_y, _z, _w)
     {
 
     }
 
-    inline T& operator[](int n)
+    VMATH_CONSTEXPR T& operator[](int n)
     {
-        return a[n];
+        return (0 == n) ? r : v[n - 1];
     }
 
-    inline const T& operator[](int n) const
+    VMATH_CONSTEXPR const T& operator[](int n) const
     {
-        return a[n];
+        return (0 == n) ? r : v[n - 1];
     }
 
-    inline Tquaternion operator+(const Tquaternion& q) const
+    VMATH_CONSTEXPR Tquaternion operator+(const Tquaternion& q) const
     {
-        return quaternion(r + q.r, v + q.v);
+        return Tquaternion(r + q.r, v + q.v);
     }
 
-    inline Tquaternion& operator+=(const Tquaternion& q)
+    VMATH_CONSTEXPR Tquaternion& operator+=(const Tquaternion& q)
     {
         r += q.r;
         v += q.v;
@@ -550,12 +643,12 @@ public:
         return *this;
     }
 
-    inline Tquaternion operator-(const Tquaternion& q) const
+    VMATH_CONSTEXPR Tquaternion operator-(const Tquaternion& q) const
     {
-        return quaternion(r - q.r, v - q.v);
+        return Tquaternion(r - q.r, v - q.v);
     }
 
-    inline Tquaternion& operator-=(const Tquaternion& q)
+    VMATH_CONSTEXPR Tquaternion& operator-=(const Tquaternion& q)
     {
         r -= q.r;
         v -= q.v;
@@ -563,17 +656,17 @@ public:
         return *this;
     }
 
-    inline Tquaternion operator-() const
+    VMATH_CONSTEXPR Tquaternion operator-() const
     {
         return Tquaternion(-r, -v);
     }
 
-    inline Tquaternion operator*(const T s) const
+    VMATH_CONSTEXPR Tquaternion operator*(const T s) const
     {
-        return Tquaternion(a[0] * s, a[1] * s, a[2] * s, a[3] * s);
+        return Tquaternion(r * s, v * s);
     }
 
-    inline Tquaternion& operator*=(const T s)
+    VMATH_CONSTEXPR Tquaternion& operator*=(const T s)
     {
         r *= s;
         v *= s;
@@ -581,16 +674,16 @@ public:
         return *this;
     }
 
-    inline Tquaternion operator*(const Tquaternion& q) const
+    VMATH_CONSTEXPR Tquaternion operator*(const Tquaternion& q) const
     {
-        const T x1 = a[0];
-        const T y1 = a[1];
-        const T z1 = a[2];
-        const T w1 = a[3];
-        const T x2 = q.a[0];
-        const T y2 = q.a[1];
-        const T z2 = q.a[2];
-        const T w2 = q.a[3];
+        const T x1 = r;
+        const T y1 = v[0];
+        const T z1 = v[1];
+        const T w1 = v[2];
+        const T x2 = q.r;
+        const T y2 = q.v[0];
+        const T z2 = q.v[1];
+        const T w2 = q.v[2];
 
         return Tquaternion(w1 * x2 + x1 * w2 + y1 * z2 - z1 * y2,
                            w1 * y2 + y1 * w2 + z1 * x2 - x1 * z2,
@@ -598,12 +691,12 @@ public:
                            w1 * w2 - x1 * x2 - y1 * y2 - z1 * z2);
     }
 
-    inline Tquaternion operator/(const T s) const
+    VMATH_CONSTEXPR Tquaternion operator/(const T s) const
     {
-        return Tquaternion(a[0] / s, a[1] / s, a[2] / s, a[3] / s);
+        return Tquaternion(r / s, v / s);
     }
 
-    inline Tquaternion& operator/=(const T s)
+    VMATH_CONSTEXPR Tquaternion& operator/=(const T s)
     {
         r /= s;
         v /= s;
@@ -621,20 +714,25 @@ public:
         return *(const Tvec4<T>*)&a[0];
     }
 
-    inline bool operator==(const Tquaternion& q) const
+    VMATH_CONSTEXPR bool operator==(const Tquaternion& q) const
     {
-        return (r == q.r) && (v == q.v);
+        return (r == q.r) && (v[0] == q.v[0]) && (v[1] == q.v[1]) && (v[2] == q.v[2]);
     }
 
-    inline bool operator!=(const Tquaternion& q) const
+    VMATH_CONSTEXPR bool operator!=(const Tquaternion& q) const
     {
-        return (r != q.r) || (v != q.v);
+        return !(*this == q);
     }
 
-    inline matNM<T,4,4> asMatrix() const
+    VMATH_CONSTEXPR matNM<T,4,4> asMatrix() const
     {
         matNM<T,4,4> m;
 
+        // x, y, z, w of the union, read through the active member
+        const T x = r;
+        const T y = v[0];
+        const T z = v[1];
+        const T w = v[2];
         const T xx = x * x;
         const T yy = y * y;
         const T zz = z * z;
@@ -701,13 +799,13 @@ typedef Tquaternion<unsigned int> uquaternion;
 typedef Tquaternion<double> dquaternion;
 
 template <typename T>
-static inline Tquaternion<T> operator*(T a, const Tquaternion<T>& b)
+static VMATH_CONSTEXPR Tquaternion<T> operator*(T a, const Tquaternion<T>& b)
 {
     return b * a;
 }
 
 template <typename T>
-static inline Tquaternion<T> operator/(T a, const Tquaternion<T>& b)
+static VMATH_CONSTEXPR Tquaternion<T> operator/(T a, const Tquaternion<T>& b)
 {
     return Tquaternion<T>(a / b[0], a / b[1], a / b[2], a / b[3]);
 }
@@ -726,20 +824,20 @@ public:
     typedef class vecN<T,h> vector_type;
 
     // Default constructor does nothing, just like built-in types
-    inline matNM()
+    VMATH_CONSTEXPR matNM()
     {
         // Uninitialized variable
     }
 
     // Copy constructor
-    inline matNM(const matNM& that)
+    VMATH_CONSTEXPR matNM(const matNM& that)
     {
         assign(that);
     }
 
     // Construction from element type
     // explicit to prevent assignment from T
-    explicit inline matNM(T f)
+    explicit VMATH_CONSTEXPR matNM(T f)
     {
         for (int n = 0; n < w; n++)
         {
@@ -748,7 +846,7 @@ public:
     }
 
     // Construction from vector
-    inline matNM(const vector_type& v)
+    VMATH_CONSTEXPR matNM(const vector_type& v)
     {
         for (int n = 0; n < w; n++)
         {
@@ -757,62 +855,61 @@ public:
     }
 
     // Assignment operator
-    inline matNM& operator=(const my_type& that)
+    VMATH_CONSTEXPR matNM& operator=(const my_type& that)
     {
         assign(that);
         return *this;
     }
 
-    inline matNM operator+(const my_type& that) const
+    VMATH_CONSTEXPR matNM operator+(const my_type& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < w; n++)
+        for (int n = 0; n < w; n++)
             result.data[n] = data[n] + that.data[n];
         return result;
     }
 
-    inline my_type& operator+=(const my_type& that)
+    VMATH_CONSTEXPR my_type& operator+=(const my_type& that)
     {
         return (*this = *this + that);
     }
 
-    inline my_type operator-(const my_type& that) const
+    VMATH_CONSTEXPR my_type operator-(const my_type& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < w; n++)
+        for (int n = 0; n < w; n++)
             result.data[n] = data[n] - that.data[n];
         return result;
     }
 
-    inline my_type& operator-=(const my_type& that)
+    VMATH_CONSTEXPR my_type& operator-=(const my_type& that)
     {
         return (*this = *this - that);
     }
 
-    inline my_type operator*(const T& that) const
+    VMATH_CONSTEXPR my_type operator*(const T& that) const
     {
         my_type result;
-        int n;
-        for (n = 0; n < w; n++)
+        for (int n = 0; n < w; n++)
             result.data[n] = data[n] * that;
         return result;
     }
 
-    inline my_type& operator*=(const T& that)
+    VMATH_CONSTEXPR my_type& operator*=(const T& that)
     {
-        int n;
-        for (n = 0; n < w; n++)
+        for (int n = 0; n < w; n++)
             data[n] = data[n] * that;
         return *this;
     }
 
     // Matrix multiply.
     // TODO: This only works for square matrices. Need more template skill to make a non-square version.
-    inline my_type operator*(const my_type& that) const
+    VMATH_CONSTEXPR my_type operator*(const my_type& that) const
     {
-        my_type result(0);
+        my_type result;
+
+        if (!VMATH_CONSTANT_EVALUATED() && simd::multiply<T,w,h>(&result[0][0], &data[0][0], &that[0][0]))
+            return result;
 
         for (int j = 0; j < w; j++)
         {
@@ -832,24 +929,47 @@ public:
         return result;
     }
 
-    inline my_type& operator*=(const my_type& that)
+    VMATH_CONSTEXPR my_type& operator*=(const my_type& that)
     {
         return (*this = *this * that);
     }
 
-    inline vector_type& operator[](int n) { return data[n]; }
-    inline const vector_type& operator[](int n) const { return data[n]; }
-    inline operator T*() { return &data[0][0]; }
-    inline operator const T*() const { return &data[0][0]; }
+    // Matrix * column vector
+    VMATH_CONSTEXPR vector_type operator*(const vecN<T,w>& v) const
+    {
+        vector_type result;
+
+        if (!VMATH_CONSTANT_EVALUATED() && simd::multiplyVector<T,w,h>(&result[0], &data[0][0], &v[0]))
+            return result;
+
+        result = T(0);
+
+        for (int n = 0; n < w; n++)
+        {
+            for (int i = 0; i < h; i++)
+            {
+                result[i] += data[n][i] * v[n];
+            }
+        }
+
+        return result;
+    }
+
+    VMATH_CONSTEXPR vector_type& operator[](int n) { return data[n]; }
+    VMATH_CONSTEXPR const vector_type& operator[](int n) const { return data[n]; }
+    VMATH_CONSTEXPR operator T*() { return &data[0][0]; }
+    VMATH_CONSTEXPR operator const T*() const { return &data[0][0]; }
 
-    inline matNM<T,h,w> transpose(void) const
+    VMATH_CONSTEXPR matNM<T,h,w> transpose(void) const
     {
         matNM<T,h,w> result;
-        int x, y;
 
-        for (y = 0; y < w; y++)
+        if (!VMATH_CONSTANT_EVALUATED() && simd::transpose<T,w,h>(&result[0][0], &data[0][0]))
+            return result;
+
+        for (int y = 0; y < w; y++)
         {
-            for (x = 0; x < h; x++)
+            for (int x = 0; x < h; x++)
             {
                 result[x][y] = data[y][x];
             }
@@ -858,7 +978,7 @@ public:
         return result;
     }
 
-    static inline my_type identity()
+    static VMATH_CONSTEXPR my_type identity()
     {
         my_type result(0);
 
@@ -870,18 +990,17 @@ public:
         return result;
     }
 
-    static inline int width(void) { return w; }
-    static inline int height(void) { return h; }
+    static VMATH_CONSTEXPR int width(void) { return w; }
+    static VMATH_CONSTEXPR int height(void) { return h; }
 
 protected:
     // Column primary data (essentially, array of vectors)
     vecN<T,h> data[w];
 
     // Assignment function - called from assignment operator and copy constructor.
-    inline void assign(const matNM& that)
+    VMATH_CONSTEXPR void assign(const matNM& that)
     {
-        int n;
-        for (n = 0; n < w; n++)
+        for (int n = 0; n < w; n++)
             data[n] = that.data[n];
     }
 };
@@ -924,14 +1043,14 @@ public:
     typedef matNM<T,4,4> base;
     typedef Tmat4<T> my_type;
 
-    inline Tmat4() {}
-    inline Tmat4(const my_type& that) : base(that) {}
-    inline Tmat4(const base& that) : base(that) {}
-    inline Tmat4(const vecN<T,4>& v) : base(v) {}
-    inline Tmat4(const vecN<T,4>& v0,
-                 const vecN<T,4>& v1,
-                 const vecN<T,4>& v2,
-                 const vecN<T,4>& v3)
+    VMATH_CONSTEXPR Tmat4() : base() {}
+    VMATH_CONSTEXPR Tmat4(const my_type& that) : base(that) {}
+    VMATH_CONSTEXPR Tmat4(const base& that) : base(that) {}
+    VMATH_CONSTEXPR Tmat4(const vecN<T,4>& v) : base(v) {}
+    VMATH_CONSTEXPR Tmat4(const vecN<T,4>& v0,
+                          const vecN<T,4>& v1,
+                          const vecN<T,4>& v2,
+                          const vecN<T,4>& v3) : base()
     {
         base::data[0] = v0;
         base::data[1] = v1;
@@ -945,6 +1064,467 @@ typedef Tmat4<int> imat4;
 typedef Tmat4<unsigned int> umat4;
 typedef Tmat4<double> dmat4;
 
+// Transform count vectors, pOut may be the same array as pIn
+template <typename T>
+static inline void transform(const matNM<T,4,4>& m, const Tvec4<T>* pIn, Tvec4<T>* pOut, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        pOut[i] = m * pIn[i];
+    }
+}
+
+// Structure of arrays of 3 component vectors, e.g. positions of a mesh
+template <typename T>
+struct Tsoa3
+{
+    T* x;
+    T* y;
+    T* z;
+};
+
+typedef Tsoa3<float> soa3;
+
+// Gather count vectors that start stride bytes apart into a structure of
+// arrays, e.g. deinterleave(&pVertices[0].position.x, sizeof(Vertex), soa, n)
+template <typename T>
+static inline void deinterleave(const T* pSrc, size_t stride, const Tsoa3<T>& dst, size_t count)
+{
+    const char* p = (const char*)pSrc;
+
+    for (size_t i = 0; i < count; i++, p += stride)
+    {
+        const T* v = (const T*)p;
+        dst.x[i] = v[0];
+        dst.y[i] = v[1];
+        dst.z[i] = v[2];
+    }
+}
+
+// Scatter a structure of arrays back to vectors stride bytes apart
+template <typename T>
+static inline void interleave(const Tsoa3<T>& src, T* pDst, size_t stride, size_t count)
+{
+    char* p = (char*)pDst;
+
+    for (size_t i = 0; i < count; i++, p += stride)
+    {
+        T* v = (T*)p;
+        v[0] = src.x[i];
+        v[1] = src.y[i];
+        v[2] = src.z[i];
+    }
+}
+
+// out = m * vec4(in, 1), w of the result is dropped so m must be affine.
+// out may be the same arrays as in.
+template <typename T>
+static inline void transformPoints(const matNM<T,4,4>& m, const Tsoa3<T>& in, const Tsoa3<T>& out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const T x = in.x[i];
+        const T y = in.y[i];
+        const T z = in.z[i];
+
+        out.x[i] = m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0];
+        out.y[i] = m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1];
+        out.z[i] = m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2];
+    }
+}
+
+// out = mat3(m) * in, pass the inverse transpose of the model matrix when it
+// scales non uniformly. Results are not normalized.
+template <typename T>
+static inline void transformNormals(const matNM<T,4,4>& m, const Tsoa3<T>& in, const Tsoa3<T>& out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const T x = in.x[i];
+        const T y = in.y[i];
+        const T z = in.z[i];
+
+        out.x[i] = m[0][0] * x + m[1][0] * y + m[2][0] * z;
+        out.y[i] = m[0][1] * x + m[1][1] * y + m[2][1] * z;
+        out.z[i] = m[0][2] * x + m[1][2] * y + m[2][2] * z;
+    }
+}
+
+#if defined(VMATH_SIMD)
+// Kernels below do the multiplies and adds in the same order as the generic
+// loops, so results match them bit for bit unless FMA is enabled.
+namespace simd
+{
+#if defined(VMATH_SSE)
+typedef __m128 float4;
+
+static inline float4 load4(const float* p) { return _mm_loadu_ps(p); }
+static inline void store4(float* p, float4 v) { _mm_storeu_ps(p, v); }
+static inline float store1(float4 v) { return _mm_cvtss_f32(v); }
+static inline float4 set4(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+static inline float4 splat4(float s) { return _mm_set1_ps(s); }
+static inline float4 add4(float4 a, float4 b) { return _mm_add_ps(a, b); }
+static inline float4 sub4(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+static inline float4 mul4(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+static inline float4 div4(float4 a, float4 b) { return _mm_div_ps(a, b); }
+
+// a * b + c
+static inline float4 madd4(float4 a, float4 b, float4 c)
+{
+#if defined(__FMA__)
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+template <const int i>
+static inline float4 lane4(float4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i)); }
+
+// (a[i], a[j], b[k], b[l])
+template <const int i, const int j, const int k, const int l>
+static inline float4 shuffle4(float4 a, float4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(l, k, j, i)); }
+
+static inline void transpose4x4(float* pResult, const float* pA)
+{
+    float4 c0 = load4(pA + 0);
+    float4 c1 = load4(pA + 4);
+    float4 c2 = load4(pA + 8);
+    float4 c3 = load4(pA + 12);
+
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    store4(pResult + 0, c0);
+    store4(pResult + 4, c1);
+    store4(pResult + 8, c2);
+    store4(pResult + 12, c3);
+}
+#else
+typedef float32x4_t float4;
+
+static inline float4 load4(const float* p) { return vld1q_f32(p); }
+static inline void store4(float* p, float4 v) { vst1q_f32(p, v); }
+static inline float store1(float4 v) { return vgetq_lane_f32(v, 0); }
+static inline float4 set4(float x, float y, float z, float w)
+{
+    const float v[4] = { x, y, z, w };
+    return vld1q_f32(v);
+}
+static inline float4 splat4(float s) { return vdupq_n_f32(s); }
+static inline float4 add4(float4 a, float4 b) { return vaddq_f32(a, b); }
+static inline float4 sub4(float4 a, float4 b) { return vsubq_f32(a, b); }
+static inline float4 mul4(float4 a, float4 b) { return vmulq_f32(a, b); }
+
+static inline float4 div4(float4 a, float4 b)
+{
+#if defined(__aarch64__)
+    return vdivq_f32(a, b);
+#else
+    float x[4], y[4];
+    vst1q_f32(x, a);
+    vst1q_f32(y, b);
+    return set4(x[0] / y[0], x[1] / y[1], x[2] / y[2], x[3] / y[3]);
+#endif
+}
+
+// a * b + c
+static inline float4 madd4(float4 a, float4 b, float4 c) { return vmlaq_f32(c, a, b); }
+
+template <const int i>
+static inline float4 lane4(float4 v)
+{
+    return (i < 2) ? vdupq_lane_f32(vget_low_f32(v), i & 1) : vdupq_lane_f32(vget_high_f32(v), i & 1);
+}
+
+// (a[i], a[j], b[k], b[l])
+template <const int i, const int j, const int k, const int l>
+static inline float4 shuffle4(float4 a, float4 b)
+{
+#if defined(__clang__)
+    return __builtin_shufflevector(a, b, i, j, k + 4, l + 4);
+#else
+    const uint32x4_t mask = { i, j, k + 4, l + 4 };
+    return __builtin_shuffle(a, b, mask);
+#endif
+}
+
+static inline void transpose4x4(float* pResult, const float* pA)
+{
+    float32x4x2_t t01 = vtrnq_f32(load4(pA + 0), load4(pA + 4));
+    float32x4x2_t t23 = vtrnq_f32(load4(pA + 8), load4(pA + 12));
+
+    store4(pResult + 0, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+    store4(pResult + 4, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+    store4(pResult + 8, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+    store4(pResult + 12, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+}
+#endif
+
+// a x b, w is 0 when both w are finite
+static inline float4 cross4(float4 a, float4 b)
+{
+    return sub4(mul4(shuffle4<1, 2, 0, 3>(a, a), shuffle4<2, 0, 1, 3>(b, b)),
+                mul4(shuffle4<2, 0, 1, 3>(a, a), shuffle4<1, 2, 0, 3>(b, b)));
+}
+
+// a.xyz . b.xyz in all lanes
+static inline float4 dot3(float4 a, float4 b)
+{
+    const float4 p = mul4(a, b);
+    return add4(add4(lane4<0>(p), lane4<1>(p)), lane4<2>(p));
+}
+
+// Column major matrix in four registers times a vector
+static inline float4 transform4(float4 c0, float4 c1, float4 c2, float4 c3, float4 v)
+{
+    float4 r = mul4(c0, lane4<0>(v));
+    r = madd4(c1, lane4<1>(v), r);
+    r = madd4(c2, lane4<2>(v), r);
+    r = madd4(c3, lane4<3>(v), r);
+    return r;
+}
+
+// pResult = pA * pB, none of them may overlap
+static inline void multiply4x4(float* pResult, const float* pA, const float* pB)
+{
+#if defined(VMATH_AVX)
+    // two columns of the result per iteration
+    const __m256 c0 = _mm256_broadcast_ps((const __m128*)(pA + 0));
+    const __m256 c1 = _mm256_broadcast_ps((const __m128*)(pA + 4));
+    const __m256 c2 = _mm256_broadcast_ps((const __m128*)(pA + 8));
+    const __m256 c3 = _mm256_broadcast_ps((const __m128*)(pA + 12));
+
+    for (int j = 0; j < 16; j += 8)
+    {
+        const __m256 b = _mm256_loadu_ps(pB + j);
+        __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(b, 0x00));
+#if defined(__FMA__)
+        r = _mm256_fmadd_ps(c1, _mm256_permute_ps(b, 0x55), r);
+        r = _mm256_fmadd_ps(c2, _mm256_permute_ps(b, 0xAA), r);
+        r = _mm256_fmadd_ps(c3, _mm256_permute_ps(b, 0xFF), r);
+#else
+        r = _mm256_add_ps(_mm256_mul_ps(c1, _mm256_permute_ps(b, 0x55)), r);
+        r = _mm256_add_ps(_mm256_mul_ps(c2, _mm256_permute_ps(b, 0xAA)), r);
+        r = _mm256_add_ps(_mm256_mul_ps(c3, _mm256_permute_ps(b, 0xFF)), r);
+#endif
+        _mm256_storeu_ps(pResult + j, r);
+    }
+#else
+    const float4 c0 = load4(pA + 0);
+    const float4 c1 = load4(pA + 4);
+    const float4 c2 = load4(pA + 8);
+    const float4 c3 = load4(pA + 12);
+
+    for (int j = 0; j < 16; j += 4)
+    {
+        store4(pResult + j, transform4(c0, c1, c2, c3, load4(pB + j)));
+    }
+#endif
+}
+
+// Widest registers available for streams of floats
+#if defined(__AVX512F__)
+typedef __m512 floatw;
+static const size_t WIDTH = 16;
+static inline floatw loadw(const float* p) { return _mm512_loadu_ps(p); }
+static inline void storew(float* p, floatw v) { _mm512_storeu_ps(p, v); }
+static inline floatw splatw(float s) { return _mm512_set1_ps(s); }
+static inline floatw addw(floatw a, floatw b) { return _mm512_add_ps(a, b); }
+static inline floatw mulw(floatw a, floatw b) { return _mm512_mul_ps(a, b); }
+#elif defined(VMATH_AVX)
+typedef __m256 floatw;
+static const size_t WIDTH = 8;
+static inline floatw loadw(const float* p) { return _mm256_loadu_ps(p); }
+static inline void storew(float* p, floatw v) { _mm256_storeu_ps(p, v); }
+static inline floatw splatw(float s) { return _mm256_set1_ps(s); }
+static inline floatw addw(floatw a, floatw b) { return _mm256_add_ps(a, b); }
+static inline floatw mulw(floatw a, floatw b) { return _mm256_mul_ps(a, b); }
+#else
+typedef float4 floatw;
+static const size_t WIDTH = 4;
+static inline floatw loadw(const float* p) { return load4(p); }
+static inline void storew(float* p, floatw v) { store4(p, v); }
+static inline floatw splatw(float s) { return splat4(s); }
+static inline floatw addw(floatw a, floatw b) { return add4(a, b); }
+static inline floatw mulw(floatw a, floatw b) { return mul4(a, b); }
+#endif
+
+// Rows of the upper 3x4 of a matrix splatted across registers
+struct rows3x4
+{
+    floatw m[3][4];
+
+    inline rows3x4(const float* pMatrix)
+    {
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                m[r][c] = splatw(pMatrix[c * 4 + r]);
+            }
+        }
+    }
+
+    // row . (x, y, z, 1)
+    inline floatw point(int r, floatw x, floatw y, floatw z) const
+    {
+        return addw(addw(addw(mulw(m[r][0], x), mulw(m[r][1], y)), mulw(m[r][2], z)), m[r][3]);
+    }
+
+    // row . (x, y, z, 0)
+    inline floatw direction(int r, floatw x, floatw y, floatw z) const
+    {
+        return addw(addw(mulw(m[r][0], x), mulw(m[r][1], y)), mulw(m[r][2], z));
+    }
+};
+
+template <>
+inline bool multiply<float,4,4>(float* pResult, const float* pA, const float* pB)
+{
+    multiply4x4(pResult, pA, pB);
+    return true;
+}
+
+template <>
+inline bool multiplyVector<float,4,4>(float* pResult, const float* pA, const float* pV)
+{
+    store4(pResult, transform4(load4(pA + 0), load4(pA + 4), load4(pA + 8), load4(pA + 12), load4(pV)));
+    return true;
+}
+
+template <>
+inline bool transpose<float,4,4>(float* pResult, const float* pA)
+{
+    transpose4x4(pResult, pA);
+    return true;
+}
+} // namespace simd
+
+template <>
+inline void transform<float>(const matNM<float,4,4>& m, const Tvec4<float>* pIn, Tvec4<float>* pOut, int count)
+{
+    const simd::float4 c0 = simd::load4(&m[0][0]);
+    const simd::float4 c1 = simd::load4(&m[1][0]);
+    const simd::float4 c2 = simd::load4(&m[2][0]);
+    const simd::float4 c3 = simd::load4(&m[3][0]);
+
+    for (int i = 0; i < count; i++)
+    {
+        simd::store4(&pOut[i][0], simd::transform4(c0, c1, c2, c3, simd::load4(&pIn[i][0])));
+    }
+}
+
+template <>
+inline void transformPoints<float>(const matNM<float,4,4>& m, const Tsoa3<float>& in, const Tsoa3<float>& out, size_t count)
+{
+    const simd::rows3x4 rows(&m[0][0]);
+    size_t i = 0;
+
+    for (; i + simd::WIDTH <= count; i += simd::WIDTH)
+    {
+        const simd::floatw x = simd::loadw(in.x + i);
+        const simd::floatw y = simd::loadw(in.y + i);
+        const simd::floatw z = simd::loadw(in.z + i);
+
+        simd::storew(out.x + i, rows.point(0, x, y, z));
+        simd::storew(out.y + i, rows.point(1, x, y, z));
+        simd::storew(out.z + i, rows.point(2, x, y, z));
+    }
+
+    for (; i < count; i++)
+    {
+        const float x = in.x[i];
+        const float y = in.y[i];
+        const float z = in.z[i];
+
+        out.x[i] = m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0];
+        out.y[i] = m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1];
+        out.z[i] = m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2];
+    }
+}
+
+template <>
+inline void transformNormals<float>(const matNM<float,4,4>& m, const Tsoa3<float>& in, const Tsoa3<float>& out, size_t count)
+{
+    const simd::rows3x4 rows(&m[0][0]);
+    size_t i = 0;
+
+    for (; i + simd::WIDTH <= count; i += simd::WIDTH)
+    {
+        const simd::floatw x = simd::loadw(in.x + i);
+        const simd::floatw y = simd::loadw(in.y + i);
+        const simd::floatw z = simd::loadw(in.z + i);
+
+        simd::storew(out.x + i, rows.direction(0, x, y, z));
+        simd::storew(out.y + i, rows.direction(1, x, y, z));
+        simd::storew(out.z + i, rows.direction(2, x, y, z));
+    }
+
+    for (; i < count; i++)
+    {
+        const float x = in.x[i];
+        const float y = in.y[i];
+        const float z = in.z[i];
+
+        out.x[i] = m[0][0] * x + m[1][0] * y + m[2][0] * z;
+        out.y[i] = m[0][1] * x + m[1][1] * y + m[2][1] * z;
+        out.z[i] = m[0][2] * x + m[1][2] * y + m[2][2] * z;
+    }
+}
+#endif // VMATH_SIMD
+
+#if defined(VMATH_THREADS)
+// Batches smaller than this per thread are not worth starting a thread for
+#define VMATH_THREAD_MIN_COUNT 65536
+
+// Run pfnBatch on bands of the streams, nThreads 0 for one per hardware thread
+template <typename T>
+static inline void parallelBatch(void (*pfnBatch)(const matNM<T,4,4>&, const Tsoa3<T>&, const Tsoa3<T>&, size_t),
+                                 const matNM<T,4,4>& m, const Tsoa3<T>& in, const Tsoa3<T>& out, size_t count, unsigned int nThreads)
+{
+    if (0 == nThreads)
+        nThreads = std::thread::hardware_concurrency();
+    if (nThreads > count / VMATH_THREAD_MIN_COUNT)
+        nThreads = (unsigned int)(count / VMATH_THREAD_MIN_COUNT);
+    if (nThreads < 2)
+    {
+        pfnBatch(m, in, out, count);
+        return;
+    }
+
+    // bands are multiples of 64 elements so only the last one has a scalar tail
+    const size_t band = ((count + nThreads - 1) / nThreads + 63) & ~(size_t)63;
+    std::vector<std::thread> threads;
+
+    for (size_t first = band; first < count; first += band)
+    {
+        const size_t n = (count - first < band) ? count - first : band;
+        const Tsoa3<T> bandIn = { in.x + first, in.y + first, in.z + first };
+        const Tsoa3<T> bandOut = { out.x + first, out.y + first, out.z + first };
+        threads.push_back(std::thread(pfnBatch, m, bandIn, bandOut, n));
+    }
+
+    pfnBatch(m, in, out, band);
+
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+}
+
+template <typename T>
+static inline void transformPoints(const matNM<T,4,4>& m, const Tsoa3<T>& in, const Tsoa3<T>& out, size_t count, unsigned int nThreads)
+{
+    parallelBatch<T>(transformPoints<T>, m, in, out, count, nThreads);
+}
+
+template <typename T>
+static inline void transformNormals(const matNM<T,4,4>& m, const Tsoa3<T>& in, const Tsoa3<T>& out, size_t count, unsigned int nThreads)
+{
+    parallelBatch<T>(transformNormals<T>, m, in, out, count, nThreads);
+}
+#endif // VMATH_THREADS
+
 template <typename T>
 class Tmat2 : public matNM<T,2,2>
 {
@@ -952,12 +1532,12 @@ public:
     typedef matNM<T,2,2> base;
     typedef Tmat2<T> my_type;
 
-    inline Tmat2() {}
-    inline Tmat2(const my_type& that) : base(that) {}
-    inline Tmat2(const base& that) : base(that) {}
-    inline Tmat2(const vecN<T,2>& v) : base(v) {}
-    inline Tmat2(const vecN<T,2>& v0,
-                 const vecN<T,2>& v1)
+    VMATH_CONSTEXPR Tmat2() : base() {}
+    VMATH_CONSTEXPR Tmat2(const my_type& that) : base(that) {}
+    VMATH_CONSTEXPR Tmat2(const base& that) : base(that) {}
+    VMATH_CONSTEXPR Tmat2(const vecN<T,2>& v) : base(v) {}
+    VMATH_CONSTEXPR Tmat2(const vecN<T,2>& v0,
+                          const vecN<T,2>& v1) : base()
     {
         base::data[0] = v0;
         base::data[1] = v1;
@@ -966,7 +1546,31 @@ public:
 
 typedef Tmat2<float> mat2;
 
-static inline mat4 frustum(float left, float right, float bottom, float top, float n, float f)
+template <typename T>
+class Tmat3 : public matNM<T,3,3>
+{
+public:
+    typedef matNM<T,3,3> base;
+    typedef Tmat3<T> my_type;
+
+    VMATH_CONSTEXPR Tmat3() : base() {}
+    VMATH_CONSTEXPR Tmat3(const my_type& that) : base(that) {}
+    VMATH_CONSTEXPR Tmat3(const base& that) : base(that) {}
+    VMATH_CONSTEXPR Tmat3(const vecN<T,3>& v) : base(v) {}
+    VMATH_CONSTEXPR Tmat3(const vecN<T,3>& v0,
+                          const vecN<T,3>& v1,
+                          const vecN<T,3>& v2) : base()
+    {
+        base::data[0] = v0;
+        base::data[1] = v1;
+        base::data[2] = v2;
+    }
+};
+
+typedef Tmat3<float> mat3;
+typedef Tmat3<double> dmat3;
+
+static VMATH_CONSTEXPR mat4 frustum(float left, float right, float bottom, float top, float n, float f)
 {
     mat4 result(mat4::identity());
 
@@ -1000,24 +1604,31 @@ static inline mat4 perspective(float fovy, float aspect, float n, float f)
 
     mat4 result;
 
+#if defined(VMATH_SIMD)
+    simd::store4(&result[0][0], simd::set4(A, 0.0f, 0.0f, 0.0f));
+    simd::store4(&result[1][0], simd::set4(0.0f, q, 0.0f, 0.0f));
+    simd::store4(&result[2][0], simd::set4(0.0f, 0.0f, B, -1.0f));
+    simd::store4(&result[3][0], simd::set4(0.0f, 0.0f, C, 0.0f));
+#else
     result[0] = vec4(A, 0.0f, 0.0f, 0.0f);
     result[1] = vec4(0.0f, q, 0.0f, 0.0f);
     result[2] = vec4(0.0f, 0.0f, B, -1.0f);
     result[3] = vec4(0.0f, 0.0f, C, 0.0f);
+#endif
 
     return result;
 }
 
-static inline mat4 ortho(float left, float right, float bottom, float top, float n, float f)
+static VMATH_CONSTEXPR mat4 ortho(float left, float right, float bottom, float top, float n, float f)
 {
     return mat4( vec4(2.0f / (right - left), 0.0f, 0.0f, 0.0f),
                  vec4(0.0f, 2.0f / (top - bottom), 0.0f, 0.0f),
                  vec4(0.0f, 0.0f, 2.0f / (n - f), 0.0f),
-                 vec4((left + right) / (left - right), (bottom + top) / (bottom - top), (n + f) / (f - n), 1.0f) );
+                 vec4((left + right) / (left - right), (bottom + top) / (bottom - top), (n + f) / (n - f), 1.0f) );
 }
 
 template <typename T>
-static inline Tmat4<T> translate(T x, T y, T z)
+static VMATH_CONSTEXPR Tmat4<T> translate(T x, T y, T z)
 {
     return Tmat4<T>(Tvec4<T>(1.0f, 0.0f, 0.0f, 0.0f),
                     Tvec4<T>(0.0f, 1.0f, 0.0f, 0.0f),
@@ -1026,7 +1637,7 @@ static inline Tmat4<T> translate(T x, T y, T z)
 }
 
 template <typename T>
-static inline Tmat4<T> translate(const vecN<T,3>& v)
+static VMATH_CONSTEXPR Tmat4<T> translate(const vecN<T,3>& v)
 {
     return translate(v[0], v[1], v[2]);
 }
@@ -1047,7 +1658,7 @@ static inline Tmat4<T> lookat(const vecN<T,3>& eye, const vecN<T,3>& center, con
 }
 
 template <typename T>
-static inline Tmat4<T> scale(T x, T y, T z)
+static VMATH_CONSTEXPR Tmat4<T> scale(T x, T y, T z)
 {
     return Tmat4<T>(Tvec4<T>(x, 0.0f, 0.0f, 0.0f),
                     Tvec4<T>(0.0f, y, 0.0f, 0.0f),
@@ -1056,13 +1667,13 @@ static inline Tmat4<T> scale(T x, T y, T z)
 }
 
 template <typename T>
-static inline Tmat4<T> scale(const Tvec3<T>& v)
+static VMATH_CONSTEXPR Tmat4<T> scale(const Tvec3<T>& v)
 {
     return scale(v[0], v[1], v[2]);
 }
 
 template <typename T>
-static inline Tmat4<T> scale(T x)
+static VMATH_CONSTEXPR Tmat4<T> scale(T x)
 {
     return Tmat4<T>(Tvec4<T>(x, 0.0f, 0.0f, 0.0f),
                     Tvec4<T>(0.0f, x, 0.0f, 0.0f),
@@ -1091,6 +1702,50 @@ static inline Tmat4<T> rotate(T angle, T x, T y, T z)
     return result;
 }
 
+#if defined(VMATH_SIMD)
+// View rotation times translate(-eye) without the full matrix multiply
+template <>
+inline Tmat4<float> lookat<float>(const vecN<float,3>& eye, const vecN<float,3>& center, const vecN<float,3>& up)
+{
+    const Tvec3<float> f = normalize(center - eye);
+    const Tvec3<float> upN = normalize(up);
+    const Tvec3<float> s = cross(f, upN);
+    const Tvec3<float> u = cross(s, f);
+    const simd::float4 c0 = simd::set4(s[0], u[0], -f[0], 0.0f);
+    const simd::float4 c1 = simd::set4(s[1], u[1], -f[1], 0.0f);
+    const simd::float4 c2 = simd::set4(s[2], u[2], -f[2], 0.0f);
+    const simd::float4 c3 = simd::set4(0.0f, 0.0f, 0.0f, 1.0f);
+    Tmat4<float> result;
+
+    simd::store4(&result[0][0], c0);
+    simd::store4(&result[1][0], c1);
+    simd::store4(&result[2][0], c2);
+    simd::store4(&result[3][0], simd::transform4(c0, c1, c2, c3, simd::set4(-eye[0], -eye[1], -eye[2], 1.0f)));
+
+    return result;
+}
+
+// Column j is axis * axis[j] * (1 - c) plus the cosine / sine terms
+template <>
+inline Tmat4<float> rotate<float>(float angle, float x, float y, float z)
+{
+    Tmat4<float> result;
+
+    float rads = angle * 0.0174532925f;
+    const float c = cosf(rads);
+    const float s = sinf(rads);
+    const simd::float4 omc = simd::splat4(1.0f - c);
+    const simd::float4 axis = simd::set4(x, y, z, 0.0f);
+
+    simd::store4(&result[0][0], simd::add4(simd::mul4(simd::mul4(axis, simd::splat4(x)), omc), simd::set4(c, z * s, -(y * s), 0.0f)));
+    simd::store4(&result[1][0], simd::add4(simd::mul4(simd::mul4(axis, simd::splat4(y)), omc), simd::set4(-(z * s), c, x * s, 0.0f)));
+    simd::store4(&result[2][0], simd::add4(simd::mul4(simd::mul4(axis, simd::splat4(z)), omc), simd::set4(y * s, -(x * s), c, 0.0f)));
+    simd::store4(&result[3][0], simd::set4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    return result;
+}
+#endif // VMATH_SIMD
+
 template <typename T>
 static inline Tmat4<T> rotate(T angle, const vecN<T,3>& v)
 {
@@ -1105,12 +1760,322 @@ static inline Tmat4<T> rotate(T angle_x, T angle_y, T angle_z)
            rotate(angle_x, 1.0f, 0.0f, 0.0f);
 }
 
+// Last row is (0, 0, 0, 1), i.e. only rotation, scale, shear and translation
+template <typename T>
+static VMATH_CONSTEXPR bool isAffine(const matNM<T,4,4>& m)
+{
+    return (m[0][3] == T(0)) && (m[1][3] == T(0)) && (m[2][3] == T(0)) && (m[3][3] == T(1));
+}
+
+template <typename T>
+static VMATH_CONSTEXPR T determinant(const matNM<T,3,3>& m)
+{
+    return dot(m[0], cross(m[1], m[2]));
+}
+
+template <typename T>
+static VMATH_CONSTEXPR T determinant(const matNM<T,4,4>& m)
+{
+    if (isAffine(m))
+    {
+        return dot(Tvec3<T>(m[0][0], m[0][1], m[0][2]),
+                   cross(Tvec3<T>(m[1][0], m[1][1], m[1][2]), Tvec3<T>(m[2][0], m[2][1], m[2][2])));
+    }
+
+    const T s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    const T s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    const T s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    const T s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    const T s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    const T s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+    const T c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+    const T c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    const T c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    const T c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    const T c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    const T c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+
+    return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+// Inverses below return the identity for singular matrices
+
+template <typename T>
+static VMATH_CONSTEXPR Tmat3<T> inverse(const matNM<T,3,3>& m)
+{
+    const Tvec3<T> r0 = cross(m[1], m[2]);
+    const Tvec3<T> r1 = cross(m[2], m[0]);
+    const Tvec3<T> r2 = cross(m[0], m[1]);
+    const T det = dot(m[0], r0);
+
+    if (T(0) == det)
+        return Tmat3<T>::identity();
+
+    return Tmat3<T>(r0, r1, r2).transpose() * (T(1) / det);
+}
+
+// Transpose of the inverse of the upper 3x3, transforms normals of a mesh
+// drawn with model matrix m
+template <typename T>
+static VMATH_CONSTEXPR Tmat3<T> inverseTranspose3x3(const matNM<T,4,4>& m)
+{
+    Tmat3<T> result;
+
+    if (!VMATH_CONSTANT_EVALUATED() && simd::inverseTranspose3x3<T>(&result[0][0], &m[0][0]))
+        return result;
+
+    const Tvec3<T> a(m[0][0], m[0][1], m[0][2]);
+    const Tvec3<T> b(m[1][0], m[1][1], m[1][2]);
+    const Tvec3<T> c(m[2][0], m[2][1], m[2][2]);
+    const Tvec3<T> r0 = cross(b, c);
+    const Tvec3<T> r1 = cross(c, a);
+    const Tvec3<T> r2 = cross(a, b);
+    const T det = dot(a, r0);
+
+    if (T(0) == det)
+        return Tmat3<T>::identity();
+
+    const T s = T(1) / det;
+    result[0] = r0 * s;
+    result[1] = r1 * s;
+    result[2] = r2 * s;
+
+    return result;
+}
+
+// Inverse of a matrix whose last row is (0, 0, 0, 1): inverse of the upper
+// 3x3 from cross products and the translation moved back through it
+template <typename T>
+static VMATH_CONSTEXPR Tmat4<T> inverseAffine(const matNM<T,4,4>& m)
+{
+    Tmat4<T> result;
+
+    if (!VMATH_CONSTANT_EVALUATED() && simd::inverseAffine<T>(&result[0][0], &m[0][0]))
+        return result;
+
+    const Tvec3<T> a(m[0][0], m[0][1], m[0][2]);
+    const Tvec3<T> b(m[1][0], m[1][1], m[1][2]);
+    const Tvec3<T> c(m[2][0], m[2][1], m[2][2]);
+    const Tvec3<T> t(m[3][0], m[3][1], m[3][2]);
+    Tvec3<T> r0 = cross(b, c);
+    Tvec3<T> r1 = cross(c, a);
+    Tvec3<T> r2 = cross(a, b);
+    const T det = dot(a, r0);
+
+    if (T(0) == det)
+        return Tmat4<T>::identity();
+
+    const T s = T(1) / det;
+    r0 *= s;
+    r1 *= s;
+    r2 *= s;
+
+    result[0] = Tvec4<T>(r0[0], r1[0], r2[0], T(0));
+    result[1] = Tvec4<T>(r0[1], r1[1], r2[1], T(0));
+    result[2] = Tvec4<T>(r0[2], r1[2], r2[2], T(0));
+    result[3] = Tvec4<T>(-dot(r0, t), -dot(r1, t), -dot(r2, t), T(1));
+
+    return result;
+}
+
+template <typename T>
+static VMATH_CONSTEXPR Tmat4<T> inverse(const matNM<T,4,4>& m)
+{
+    if (isAffine(m))
+        return inverseAffine(m);
+
+    Tmat4<T> result;
+
+    if (!VMATH_CONSTANT_EVALUATED() && simd::inverse<T>(&result[0][0], &m[0][0]))
+        return result;
+
+    // 2x2 minors of the first two and the last two columns
+    const T s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    const T s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    const T s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    const T s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    const T s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    const T s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+    const T c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+    const T c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    const T c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    const T c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    const T c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    const T c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    const T det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+    if (T(0) == det)
+        return Tmat4<T>::identity();
+
+    const T d = T(1) / det;
+
+    result[0][0] = ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * d;
+    result[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * d;
+    result[0][2] = ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * d;
+    result[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * d;
+
+    result[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * d;
+    result[1][1] = ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * d;
+    result[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * d;
+    result[1][3] = ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * d;
+
+    result[2][0] = ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * d;
+    result[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * d;
+    result[2][2] = ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * d;
+    result[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * d;
+
+    result[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * d;
+    result[3][1] = ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * d;
+    result[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * d;
+    result[3][3] = ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * d;
+
+    return result;
+}
+
+#if defined(VMATH_SIMD)
+// Singular matrices are left to the generic code
+namespace simd
+{
+template <>
+inline bool inverseTranspose3x3<float>(float* pResult, const float* pM)
+{
+    const float4 a = load4(pM + 0);
+    const float4 b = load4(pM + 4);
+    const float4 c = load4(pM + 8);
+    const float4 r0 = cross4(b, c);
+    const float4 det = dot3(a, r0);
+
+    if (0.0f == store1(det))
+        return false;
+
+    // columns are 3 floats apart, the last one goes through a copy to not
+    // write past the end
+    const float4 s = div4(splat4(1.0f), det);
+    float last[4];
+
+    store4(pResult + 0, mul4(r0, s));
+    store4(pResult + 3, mul4(cross4(c, a), s));
+    store4(last, mul4(cross4(a, b), s));
+    pResult[6] = last[0];
+    pResult[7] = last[1];
+    pResult[8] = last[2];
+
+    return true;
+}
+
+template <>
+inline bool inverseAffine<float>(float* pResult, const float* pM)
+{
+    const float4 a = load4(pM + 0);
+    const float4 b = load4(pM + 4);
+    const float4 c = load4(pM + 8);
+    const float4 r0 = cross4(b, c);
+    const float4 det = dot3(a, r0);
+
+    if (0.0f == store1(det))
+        return false;
+
+    // rows of the inverse rotation, transposed into columns in place
+    const float4 s = div4(splat4(1.0f), det);
+
+    store4(pResult + 0, mul4(r0, s));
+    store4(pResult + 4, mul4(cross4(c, a), s));
+    store4(pResult + 8, mul4(cross4(a, b), s));
+    store4(pResult + 12, set4(0.0f, 0.0f, 0.0f, 1.0f));
+    transpose4x4(pResult, pResult);
+
+    // -(R^-1 * t), w stays 1
+    const float4 t = mul4(load4(pM + 12), set4(-1.0f, -1.0f, -1.0f, 1.0f));
+    store4(pResult + 12, transform4(load4(pResult + 0),
+                                    load4(pResult + 4),
+                                    load4(pResult + 8),
+                                    load4(pResult + 12),
+                                    t));
+
+    return true;
+}
+
+// Block wise inverse with 2x2 sub matrices
+//     M = | A B |   inverse(M) = 1 / |M| * | X Y |
+//         | C D |                          | Z W |
+// where 2x2 matrices are held column major in one register
+template <>
+inline bool inverse<float>(float* pResult, const float* pM)
+{
+    const float4 m0 = load4(pM + 0);
+    const float4 m1 = load4(pM + 4);
+    const float4 m2 = load4(pM + 8);
+    const float4 m3 = load4(pM + 12);
+
+    // as the algorithm is symmetric in rows and columns, work on the
+    // transpose and the result comes out in columns again
+    const float4 A = shuffle4<0, 1, 0, 1>(m0, m1);
+    const float4 B = shuffle4<2, 3, 2, 3>(m0, m1);
+    const float4 C = shuffle4<0, 1, 0, 1>(m2, m3);
+    const float4 D = shuffle4<2, 3, 2, 3>(m2, m3);
+
+    // (|A|, |B|, |C|, |D|)
+    const float4 detSub = sub4(mul4(shuffle4<0, 2, 0, 2>(m0, m2), shuffle4<1, 3, 1, 3>(m1, m3)),
+                               mul4(shuffle4<1, 3, 1, 3>(m0, m2), shuffle4<0, 2, 0, 2>(m1, m3)));
+    const float4 detA = lane4<0>(detSub);
+    const float4 detB = lane4<1>(detSub);
+    const float4 detC = lane4<2>(detSub);
+    const float4 detD = lane4<3>(detSub);
+
+    // adj(D) * C and adj(A) * B
+    const float4 DC = sub4(mul4(shuffle4<3, 3, 0, 0>(D, D), C),
+                           mul4(shuffle4<1, 1, 2, 2>(D, D), shuffle4<2, 3, 0, 1>(C, C)));
+    const float4 AB = sub4(mul4(shuffle4<3, 3, 0, 0>(A, A), B),
+                           mul4(shuffle4<1, 1, 2, 2>(A, A), shuffle4<2, 3, 0, 1>(B, B)));
+
+    // |D| A - B (adj(D) C), |A| D - C (adj(A) B)
+    float4 X = sub4(mul4(detD, A),
+                    add4(mul4(B, shuffle4<0, 3, 0, 3>(DC, DC)),
+                         mul4(shuffle4<1, 0, 3, 2>(B, B), shuffle4<2, 1, 2, 1>(DC, DC))));
+    float4 W = sub4(mul4(detA, D),
+                    add4(mul4(C, shuffle4<0, 3, 0, 3>(AB, AB)),
+                         mul4(shuffle4<1, 0, 3, 2>(C, C), shuffle4<2, 1, 2, 1>(AB, AB))));
+
+    // |B| C - D adj(adj(A) B), |C| B - A adj(adj(D) C)
+    float4 Y = sub4(mul4(detB, C),
+                    sub4(mul4(D, shuffle4<3, 0, 3, 0>(AB, AB)),
+                         mul4(shuffle4<1, 0, 3, 2>(D, D), shuffle4<2, 1, 2, 1>(AB, AB))));
+    float4 Z = sub4(mul4(detC, B),
+                    sub4(mul4(A, shuffle4<3, 0, 3, 0>(DC, DC)),
+                         mul4(shuffle4<1, 0, 3, 2>(A, A), shuffle4<2, 1, 2, 1>(DC, DC))));
+
+    // |M| = |A| |D| + |B| |C| - tr(adj(A) B adj(D) C)
+    float4 tr = mul4(AB, shuffle4<0, 2, 1, 3>(DC, DC));
+    tr = add4(tr, shuffle4<2, 3, 0, 1>(tr, tr));
+    tr = add4(tr, shuffle4<1, 0, 3, 2>(tr, tr));
+    const float4 det = sub4(add4(mul4(detA, detD), mul4(detB, detC)), tr);
+
+    if (0.0f == store1(det))
+        return false;
+
+    // signs of the adjugate
+    const float4 d = div4(set4(1.0f, -1.0f, -1.0f, 1.0f), det);
+    X = mul4(X, d);
+    Y = mul4(Y, d);
+    Z = mul4(Z, d);
+    W = mul4(W, d);
+
+    store4(pResult + 0, shuffle4<3, 1, 3, 1>(X, Y));
+    store4(pResult + 4, shuffle4<2, 0, 2, 0>(X, Y));
+    store4(pResult + 8, shuffle4<3, 1, 3, 1>(Z, W));
+    store4(pResult + 12, shuffle4<2, 0, 2, 0>(Z, W));
+
+    return true;
+}
+} // namespace simd
+#endif // VMATH_SIMD
+
 #ifdef min
 #undef min
 #endif
 
 template <typename T>
-static inline T min(T a, T b)
+static VMATH_CONSTEXPR T min(T a, T b)
 {
     return a < b ? a : b;
 }
@@ -1120,18 +2085,17 @@ static inline T min(T a, T b)
 #endif
 
 template <typename T>
-static inline T max(T a, T b)
+static VMATH_CONSTEXPR T max(T a, T b)
 {
     return a >= b ? a : b;
 }
 
 template <typename T, const int N>
-static inline vecN<T,N> min(const vecN<T,N>& x, const vecN<T,N>& y)
+static VMATH_CONSTEXPR vecN<T,N> min(const vecN<T,N>& x, const vecN<T,N>& y)
 {
     vecN<T,N> t;
-    int n;
 
-    for (n = 0; n < N; n++)
+    for (int n = 0; n < N; n++)
     {
         t[n] = min(x[n], y[n]);
     }
@@ -1140,12 +2104,11 @@ static inline vecN<T,N> min(const vecN<T,N>& x, const vecN<T,N>& y)
 }
 
 template <typename T, const int N>
-static inline vecN<T,N> max(const vecN<T,N>& x, const vecN<T,N>& y)
+static VMATH_CONSTEXPR vecN<T,N> max(const vecN<T,N>& x, const vecN<T,N>& y)
 {
     vecN<T,N> t;
-    int n;
 
-    for (n = 0; n < N; n++)
+    for (int n = 0; n < N; n++)
     {
         t[n] = max<T>(x[n], y[n]);
     }
@@ -1154,13 +2117,13 @@ static inline vecN<T,N> max(const vecN<T,N>& x, const vecN<T,N>& y)
 }
 
 template <typename T, const int N>
-static inline vecN<T,N> clamp(const vecN<T,N>& x, const vecN<T,N>& minVal, const vecN<T,N>& maxVal)
+static VMATH_CONSTEXPR vecN<T,N> clamp(const vecN<T,N>& x, const vecN<T,N>& minVal, const vecN<T,N>& maxVal)
 {
     return min<T>(max<T>(x, minVal), maxVal);
 }
 
 template <typename T, const int N>
-static inline vecN<T,N> smoothstep(const vecN<T,N>& edge0, const vecN<T,N>& edge1, const vecN<T,N>& x)
+static VMATH_CONSTEXPR vecN<T,N> smoothstep(const vecN<T,N>& edge0, const vecN<T,N>& edge1, const vecN<T,N>& x)
 {
     vecN<T,N> t;
     t = clamp((x - edge0) / (edge1 - edge0), vecN<T,N>(T(0)), vecN<T,N>(T(1)));
@@ -1168,7 +2131,7 @@ static inline vecN<T,N> smoothstep(const vecN<T,N>& edge0, const vecN<T,N>& edge
 }
 
 template <typename T, const int S>
-static inline vecN<T,S> reflect(const vecN<T,S>& I, const vecN<T,S>& N)
+static VMATH_CONSTEXPR vecN<T,S> reflect(const vecN<T,S>& I, const vecN<T,S>& N)
 {
     return I - 2 * dot(N, I) * N;
 }
@@ -1189,14 +2152,13 @@ static inline vecN<T,S> refract(const vecN<T,S>& I, const vecN<T,S>& N, T eta)
 }
 
 template <typename T, const int N, const int M>
-static inline matNM<T,N,M> matrixCompMult(const matNM<T,N,M>& x, const matNM<T,N,M>& y)
+static VMATH_CONSTEXPR matNM<T,N,M> matrixCompMult(const matNM<T,N,M>& x, const matNM<T,N,M>& y)
 {
     matNM<T,N,M> result;
-    int i, j;
 
-    for (j = 0; j < M; ++j)
+    for (int j = 0; j < M; ++j)
     {
-        for (i = 0; i < N; ++i)
+        for (int i = 0; i < N; ++i)
         {
             result[i][j] = x[i][j] * y[i][j];
         }
@@ -1206,14 +2168,13 @@ static inline matNM<T,N,M> matrixCompMult(const matNM<T,N,M>& x, const matNM<T,N
 }
 
 template <typename T, const int N, const int M>
-static inline vecN<T,N> operator*(const vecN<T,M>& vec, const matNM<T,N,M>& mat)
+static VMATH_CONSTEXPR vecN<T,N> operator*(const vecN<T,M>& vec, const matNM<T,N,M>& mat)
 {
-    int n, m;
     vecN<T,N> result(T(0));
 
-    for (m = 0; m < M; m++)
+    for (int m = 0; m < M; m++)
     {
-        for (n = 0; n < N; n++)
+        for (int n = 0; n < N; n++)
         {
             result[n] += vec[m] * mat[n][m];
         }
@@ -1223,12 +2184,11 @@ static inline vecN<T,N> operator*(const vecN<T,M>& vec, const matNM<T,N,M>& mat)
 }
 
 template <typename T, const int N>
-static inline vecN<T,N> operator/(const T s, const vecN<T,N>& v)
+static VMATH_CONSTEXPR vecN<T,N> operator/(const T s, const vecN<T,N>& v)
 {
-    int n;
     vecN<T,N> result;
 
-    for (n = 0; n < N; n++)
+    for (int n = 0; n < N; n++)
     {
         result[n] = s / v[n];
     }
@@ -1263,23 +2223,37 @@ static inline void quaternionToMatrix(const Tquaternion<T>& q, matNM<T,4,4>& m)
 */
 
 template <typename T>
-static inline void quaternionToMatrix(const Tquaternion<T>& q, matNM<T,4,4>& m)
+static VMATH_CONSTEXPR void quaternionToMatrix(const Tquaternion<T>& q, matNM<T,4,4>& m)
 {
     m = q.asMatrix();
 }
 
 template <typename T>
-static inline T mix(const T& A, const T& B, typename T::element_type t)
+static VMATH_CONSTEXPR T mix(const T& A, const T& B, typename T::element_type t)
 {
     return B + t * (B - A);
 }
 
 template <typename T>
-static inline T mix(const T& A, const T& B, const T& t)
+static VMATH_CONSTEXPR T mix(const T& A, const T& B, const T& t)
 {
     return B + t * (B - A);
 }
 
+#if defined(VMATH_HAS_CONSTEXPR)
+// Compile time checks of the constexpr paths, exact in float
+static_assert(translate(1.0f, 2.0f, 3.0f)[3][2] == 3.0f, "vmath: translate");
+static_assert((scale(2.0f, 3.0f, 4.0f) * vec4(1.0f, 1.0f, 1.0f, 1.0f))[2] == 4.0f, "vmath: mat4 * vec4");
+static_assert((translate(1.0f, 2.0f, 3.0f) * translate(-1.0f, -2.0f, -3.0f))[3][0] == 0.0f, "vmath: mat4 * mat4");
+static_assert(inverse(translate(1.0f, 2.0f, 3.0f))[3][1] == -2.0f, "vmath: inverse");
+static_assert((ortho(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 3.0f) * vec4(0.0f, 0.0f, -1.0f, 1.0f))[2] == -1.0f, "vmath: ortho");
+static_assert(determinant(scale(2.0f, 3.0f, 4.0f)) == 24.0f, "vmath: determinant");
+static_assert(inverseTranspose3x3(scale(2.0f, 4.0f, 8.0f))[2][2] == 0.125f, "vmath: inverseTranspose3x3");
+static_assert(mat4::identity().transpose()[0][0] == 1.0f, "vmath: transpose");
+static_assert(cross(vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f))[2] == 1.0f, "vmath: cross");
+static_assert((quaternion(0.0f, 1.0f, 0.0f, 0.0f) * quaternion(0.0f, 1.0f, 0.0f, 0.0f))[3] == -1.0f, "vmath: quaternion");
+#endif
+
 };
 
 #endif /* __VMATH_H__ */
@@ -0,0 +1,108 @@
+#ifndef VT_H
+#define VT_H
+
+/**
+ * @file    vt.h
+ * @brief   Sparse virtual texture with feedback driven tile streaming
+ *
+ * Each frame the scene is rendered once more into a small feedback target
+ * that records which (level, tile) of the virtual texture every pixel wants.
+ * The feedback is read back asynchronously through a PBO, missing tiles are
+ * read from the tile files (see tile.h) and copied into a fixed size physical
+ * page cache, and an indirection texture tells the shader which cache slot
+ * holds a tile. Missing tiles fall back to the closest resident ancestor, so
+ * GPU memory is slotsPerSide^2 tiles no matter how large the source is.
+ *
+ * Several layers (e.g. diffuse + specular) of identical dimensions share one
+ * indirection table and one residency set.
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "tile.h"
+
+#define VT_MAX_LAYERS       4U
+#define VT_FEEDBACK_DIVISOR 8  /**< feedback target is 1/8th of the window in each dimension */
+#define VT_UPLOAD_BUDGET    16U /**< tiles streamed in per frame */
+
+struct VirtualTextureSlot
+{
+    uint32_t key;      /**< packed (level, x, y) of resident tile, UINT32_MAX if free */
+    uint32_t lastUsed; /**< frame in which the tile was last requested */
+};
+
+struct VirtualTexture
+{
+    TileFile layers[VT_MAX_LAYERS];
+    uint32_t nLayers;
+
+    /* GPU resources */
+    GLuint physical[VT_MAX_LAYERS]; /**< page cache per layer */
+    GLuint indirection;             /**< RGBA8 mipmapped: slot x, slot y, resident level */
+    GLuint feedbackFbo;
+    GLuint feedbackColor;
+    GLuint feedbackDepth;
+    GLuint feedbackPbo[2];
+    int    feedbackWidth;
+    int    feedbackHeight;
+    bool   feedbackPending; /**< the other PBO holds last frame's feedback */
+    GLint  savedViewport[4];
+
+    /* page cache */
+    uint32_t                               slotsPerSide;
+    uint32_t                               slotSize; /**< tile size including border */
+    uint32_t                               frame;
+    std::vector<VirtualTextureSlot>        slots;
+    std::unordered_map<uint32_t, uint32_t> resident; /**< tile key -> slot */
+    std::vector<uint32_t>                  requests;
+    std::vector<uint8_t>                   indirectionData[TILE_MAX_LEVELS];
+    std::vector<uint8_t>                   staging;
+    bool                                   indirectionDirty;
+};
+
+/**
+ * @brief Open tile files and create page cache, indirection and feedback resources
+ *
+ * @param pVT          [out] - virtual texture
+ * @param ppFiles      [in]  - tile files, one per layer, all of same dimensions
+ * @param nFiles       [in]  - number of layers
+ * @param slotsPerSide [in]  - page cache holds slotsPerSide^2 tiles
+ *
+ * @returns 0 on success else negative value
+ */
+int vtInitialize(VirtualTexture* pVT, const char* const* ppFiles, uint32_t nFiles, uint32_t slotsPerSide);
+
+/**
+ * @brief Resize feedback target to follow the window
+ */
+void vtResize(VirtualTexture* pVT, int width, int height);
+
+/**
+ * @brief Bind and clear feedback target, caller then draws with its feedback program
+ *
+ * The feedback fragment shader writes (tile x, tile y, level, 1) / 255 for the
+ * tile it would sample; its derivatives must be divided by VT_FEEDBACK_DIVISOR.
+ */
+void vtBeginFeedback(VirtualTexture* pVT);
+
+/**
+ * @brief Queue feedback read back and collect the requests of the previous frame
+ *
+ * Restores the default framebuffer and the viewport saved by vtBeginFeedback.
+ */
+void vtEndFeedback(VirtualTexture* pVT);
+
+/**
+ * @brief Stream requested tiles into the page cache and refresh indirection
+ */
+void vtUpdate(VirtualTexture* pVT);
+
+/**
+ * @brief Release GPU resources and close tile files
+ */
+void vtUninitialize(VirtualTexture* pVT);
+
+#endif // !VT_H
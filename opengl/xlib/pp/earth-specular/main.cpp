@@ -34,12 +34,19 @@ using namespace vmath;
 #include "stb_image.h"
 
 #include "load.h"
+#include "runloop.h"
+#include "texture.h"
+#include "vt.h"
 
 /*--- Macro definitions ---*/
 #define gpFILE     stdout
 #define WIN_WIDTH  800
 #define WIN_HEIGHT 600
 
+#define ROTATION_SPEED 30.0f // degrees per second
+
+#define VT_SLOTS_PER_SIDE 16 // page cache of 16x16 tiles per layer
+
 enum
 {
     AMC_ATTRIBUTE_POSITION = 0,
@@ -122,6 +129,15 @@ GLuint loadShaders(const char* vertexSource, const char* fragmentSource);
  */
 GLuint loadGLTexture(const char* filename);
 
+/**
+ * @brief Load baked texture (see texture.h) into memory
+ *
+ * @param filename [in]  - baked texture file name
+ *
+ * @returns texture id, 0 if the file is missing or invalid
+ */
+GLuint loadGLCompressedTexture(const char* filename);
+
 /* Windowing related variables */
 Display*     dpy         = nullptr; // connection to server
 Colormap     colormap    = 0UL;
@@ -174,6 +190,22 @@ GLuint specularTextureUniform;
 GLuint textureDiffuse;
 GLuint textureSpecular;
 
+/* Virtual texture, used instead of the textures above when tile files exist */
+VirtualTexture vt                    = {};
+bool           bVirtualTexture       = false;
+GLuint         feedbackProgramObject = 0U;
+
+GLuint indirectionUniform                = 0U;
+GLuint virtualInfoUniform                = 0U;
+GLuint physicalInfoUniform               = 0U;
+GLuint feedbackModelMatrixUniform        = 0U;
+GLuint feedbackViewMatrixUniform         = 0U;
+GLuint feedbackProjectionMatrixUniform   = 0U;
+GLuint feedbackVirtualInfoUniform        = 0U;
+GLuint feedbackPhysicalInfoUniform       = 0U;
+GLfloat virtualInfo[4]                   = {}; // virtual width, height, tile size, border
+GLfloat physicalInfo[4]                  = {}; // slot size, cache size, max level, feedback divisor
+
 /* Functional uniforms */
 GLuint keyPressedUniform = 0;
 Bool   bLightingEnabled  = False;
@@ -183,6 +215,10 @@ Bool   bAnimationEnabled = False;
 Model model         = {0};
 float rotationAngle = 0.0f;
 
+/* Animation timing */
+RunLoop runLoop               = {};
+float   previousRotationAngle = 0.0f; // rotation of previous step, for interpolation
+
 int main()
 {
     int                  defaultScreen    = 0;
@@ -299,11 +335,15 @@ int main()
         exit(res);
     }
 
+    /* fixed step animation, sleep between frames instead of spinning */
+    runLoopInitialize(&runLoop, dpy, RUNLOOP_DEFAULT_FPS);
+    runLoopEnableVsync(&runLoop, window, 1);
+
     shouldDraw = false;
     while (!gbAbortFlag)
     {
         XEvent event;
-        if (XPending(dpy))
+        while (!gbAbortFlag && runLoopWait(&runLoop, !shouldDraw))
         {
             XNextEvent(dpy, &event);
             switch (event.type)
@@ -392,14 +432,15 @@ int main()
         if (!shouldDraw)
             continue;
 
-        display();
-
-        if (True == bAnimationEnabled)
+        for (uint32_t nSteps = runLoopBeginFrame(&runLoop); 0U < nSteps; --nSteps)
         {
             update();
         }
 
+        display();
+
         glXSwapBuffers(dpy, window);
+        runLoopEndFrame(&runLoop);
     }
 
     uninitialize();
@@ -434,6 +475,22 @@ int initialize()
     fprintf(gpFILE, "%-20s:%s\n", "Graphics Renderer", glGetString(GL_RENDERER));
     fprintf(gpFILE, "%-20s:%s\n", "GL Shading Language", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
+    /* stream tiles on demand when the textures have been tiled, see tile.h */
+    const char* vtFiles[] = {"8k/day.vt", "8k/specular.vt"};
+    bVirtualTexture       = (0 == vtInitialize(&vt, vtFiles, 2U, VT_SLOTS_PER_SIDE));
+    if (bVirtualTexture)
+    {
+        const TileHeader* pHeader = &vt.layers[0].header;
+        virtualInfo[0]            = (GLfloat)pHeader->width;
+        virtualInfo[1]            = (GLfloat)pHeader->height;
+        virtualInfo[2]            = (GLfloat)pHeader->tileSize;
+        virtualInfo[3]            = (GLfloat)pHeader->border;
+        physicalInfo[0]           = (GLfloat)vt.slotSize;
+        physicalInfo[1]           = (GLfloat)(vt.slotSize * vt.slotsPerSide);
+        physicalInfo[2]           = (GLfloat)(pHeader->nLevels - 1U);
+        physicalInfo[3]           = (GLfloat)VT_FEEDBACK_DIVISOR;
+    }
+
     /* Program related variables */
     const GLchar* vertexShaderSource =
         "#version 460 core"
@@ -519,7 +576,94 @@ int initialize()
         "    }"
         "}";
 
-    shaderProgramObject = loadShaders(vertexShaderSource, fragmentShaderSource);
+    /* uDiffuseSampler/uSpecularSampler are the page caches, uIndirection maps tiles to cache slots */
+    const GLchar* vtFragmentShaderSource =
+        "#version 460 core"
+        "\n"
+        "in vec3 oTransformedNormals;"
+        "in vec3 oLightDirection;"
+        "in vec3 oViewerVector;"
+        "in vec2 oTexCoord;"
+        "\n"
+        "out vec4 FragColor;"
+        "\n"
+        "uniform int   uKeyPressed;"
+        "uniform vec3  uLightAmbient;"
+        "uniform vec3  uLightDiffused;"
+        "uniform vec3  uLightSpecular;"
+
+        "uniform vec3  uMaterialAmbient;"
+        "uniform vec3  uMaterialDiffused;"
+        "uniform vec3  uMaterialSpecular;"
+        "uniform float uMaterialShininess;"
+        "uniform sampler2D uDiffuseSampler;"
+        "uniform sampler2D uSpecularSampler;"
+        "uniform sampler2D uIndirection;"
+        "uniform vec4  uVirtualInfo;"
+        "uniform vec4  uPhysicalInfo;"
+
+        "vec2 virtualToPhysical(vec2 uv)"
+        "{"
+        "    vec2  texel = uv * uVirtualInfo.xy;"
+        "    vec2  dx    = dFdx(texel);"
+        "    vec2  dy    = dFdy(texel);"
+        "    float lod   = clamp(floor(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0))), 0.0, uPhysicalInfo.z);"
+        "    ivec2 size  = textureSize(uIndirection, int(lod));"
+        "    vec4  entry = floor(texelFetch(uIndirection, clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1), int(lod)) * 255.0 + 0.5);"
+        "    vec2  levelTexel = uv * max(floor(uVirtualInfo.xy / exp2(entry.b)), vec2(1.0));"
+        "    vec2  inTile     = levelTexel - floor(levelTexel / uVirtualInfo.z) * uVirtualInfo.z;"
+        "    return (entry.rg * uPhysicalInfo.x + uVirtualInfo.w + inTile) / uPhysicalInfo.y;"
+        "}"
+
+        "void main(void)"
+        "{"
+        "    vec2 physicalCoord = virtualToPhysical(oTexCoord);"
+        "    vec3 phongADSLight;"
+        "    if (uKeyPressed == 1)"
+        "    {"
+        "        vec3 normalizedTransformedNormals = normalize(oTransformedNormals);"
+        "        vec3 color  = textureLod(uDiffuseSampler, physicalCoord, 0.0).rgb;"
+        "        vec3 spec1  = textureLod(uSpecularSampler, physicalCoord, 0.0).rrr;"
+        "        vec3 normalizedLightDirection     = normalize(oLightDirection);"
+        "        vec3 normalizedViewerVector       = normalize(oViewerVector);"
+        "        vec3 reflectionVector             = reflect(-normalizedLightDirection, normalizedTransformedNormals);"
+        "\n"
+        "        vec3 ambientLight  = uLightAmbient * uMaterialAmbient;"
+        "        vec3 diffuseLight  = uLightDiffused * color * uMaterialDiffused * max(dot(normalizedLightDirection, normalizedTransformedNormals), 0.0);"
+        "        vec3 specularLight = uLightSpecular * spec1 * pow(max(dot(reflectionVector, normalizedViewerVector), 0.0), uMaterialShininess);"
+        "\n"
+        "        phongADSLight = ambientLight + diffuseLight + specularLight;"
+        "        FragColor = vec4(phongADSLight, 1.0);"
+        "    }"
+        "    else"
+        "    {"
+        "        FragColor = vec4(1);"
+        "    }"
+        "}";
+
+    /* writes the tile and level the main pass will sample, derivatives scaled to full resolution */
+    const GLchar* feedbackFragmentShaderSource =
+        "#version 460 core"
+        "\n"
+        "in vec2 oTexCoord;"
+        "\n"
+        "out vec4 FragColor;"
+        "\n"
+        "uniform vec4 uVirtualInfo;"
+        "uniform vec4 uPhysicalInfo;"
+
+        "void main(void)"
+        "{"
+        "    vec2  texel     = oTexCoord * uVirtualInfo.xy;"
+        "    vec2  dx        = dFdx(texel) / uPhysicalInfo.w;"
+        "    vec2  dy        = dFdy(texel) / uPhysicalInfo.w;"
+        "    float lod       = clamp(floor(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0))), 0.0, uPhysicalInfo.z);"
+        "    vec2  levelSize = max(floor(uVirtualInfo.xy / exp2(lod)), vec2(1.0));"
+        "    vec2  tile      = min(floor(oTexCoord * levelSize / uVirtualInfo.z), ceil(levelSize / uVirtualInfo.z) - 1.0);"
+        "    FragColor       = vec4(tile, lod, 255.0) / 255.0;"
+        "}";
+
+    shaderProgramObject = loadShaders(vertexShaderSource, bVirtualTexture ? vtFragmentShaderSource : fragmentShaderSource);
     if (0U == shaderProgramObject)
     {
         fprintf(gpFile, "Failed to load shaders into memory\n");
@@ -557,6 +701,33 @@ int initialize()
 
     keyPressedUniform = glGetUniformLocation(shaderProgramObject, "uKeyPressed");
 
+    if (bVirtualTexture)
+    {
+        indirectionUniform  = glGetUniformLocation(shaderProgramObject, "uIndirection");
+        virtualInfoUniform  = glGetUniformLocation(shaderProgramObject, "uVirtualInfo");
+        physicalInfoUniform = glGetUniformLocation(shaderProgramObject, "uPhysicalInfo");
+
+        feedbackProgramObject = loadShaders(vertexShaderSource, feedbackFragmentShaderSource);
+        if (0U == feedbackProgramObject)
+        {
+            fprintf(gpFile, "Failed to load feedback shaders into memory\n");
+            return -1;
+        }
+        glBindAttribLocation(feedbackProgramObject, AMC_ATTRIBUTE_POSITION, "aPosition");
+        glBindAttribLocation(feedbackProgramObject, AMC_ATTRIBUTE_NORMALS, "aNormal");
+        glBindAttribLocation(feedbackProgramObject, AMC_ATTRIBUTE_UVS, "aTexCoord");
+        if (0 == linkProgram(feedbackProgramObject))
+        {
+            fprintf(gpFILE, "[%s] Failed to link feedback program\n", __func__);
+            return -1;
+        }
+        feedbackModelMatrixUniform      = glGetUniformLocation(feedbackProgramObject, "uModelMatrix");
+        feedbackViewMatrixUniform       = glGetUniformLocation(feedbackProgramObject, "uViewMatrix");
+        feedbackProjectionMatrixUniform = glGetUniformLocation(feedbackProgramObject, "uProjectionMatrix");
+        feedbackVirtualInfoUniform      = glGetUniformLocation(feedbackProgramObject, "uVirtualInfo");
+        feedbackPhysicalInfoUniform     = glGetUniformLocation(feedbackProgramObject, "uPhysicalInfo");
+    }
+
     /* Cube */
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
@@ -587,8 +758,16 @@ int initialize()
     glBindVertexArray(0U);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-    textureDiffuse  = loadGLTexture("8k/day.jpg");
-    textureSpecular = loadGLTexture("8k/specular.png");
+    if (!bVirtualTexture)
+    {
+        /* prefer baked textures, fall back to decoding the source images */
+        textureDiffuse  = loadGLCompressedTexture("8k/day.ctex");
+        textureSpecular = loadGLCompressedTexture("8k/specular.ctex");
+        if (0U == textureDiffuse)
+            textureDiffuse = loadGLTexture("8k/day.jpg");
+        if (0U == textureSpecular)
+            textureSpecular = loadGLTexture("8k/specular.png");
+    }
 
     /* Enabling Depth */
     glClearDepth(1.0f);      //[Compulsory] Make all bits in depth buffer as '1'
@@ -613,6 +792,11 @@ void resize(int width, int height)
 
     projectionMatrix = vmath::perspective(45.0f, (float)width / (float)height, 0.1f, 100.0f);
 
+    if (bVirtualTexture)
+    {
+        vtResize(&vt, width, height);
+    }
+
     glViewport(0, 0, width, height);
 }
 
@@ -625,12 +809,31 @@ void display()
     vmath::mat4 scaleMatrix       = vmath::mat4::identity();
     vmath::mat4 viewMatrix        = vmath::mat4::identity();
 
+    /* interpolate between the last two animation steps */
+    float angle = previousRotationAngle + (rotationAngle - previousRotationAngle) * runLoopAlpha(&runLoop);
+
+    translationMatrix = vmath::translate(0.0f, 0.0f, -5.0f);
+    modelMatrix       = translationMatrix * rotate(angle, 0.0f, 1.0f, 0.0f);
+
+    if (bVirtualTexture)
+    {
+        /* feedback pass: find visible tiles, then stream the missing ones */
+        vtBeginFeedback(&vt);
+        glUseProgram(feedbackProgramObject);
+        glBindVertexArray(vao);
+        glUniformMatrix4fv(feedbackModelMatrixUniform, 1, GL_FALSE, modelMatrix);
+        glUniformMatrix4fv(feedbackViewMatrixUniform, 1, GL_FALSE, viewMatrix);
+        glUniformMatrix4fv(feedbackProjectionMatrixUniform, 1, GL_FALSE, projectionMatrix);
+        glUniform4fv(feedbackVirtualInfoUniform, 1, virtualInfo);
+        glUniform4fv(feedbackPhysicalInfoUniform, 1, physicalInfo);
+        glDrawElements(GL_TRIANGLES, model.header.nIndices, GL_UNSIGNED_INT, 0);
+        vtEndFeedback(&vt);
+        vtUpdate(&vt);
+    }
+
     glUseProgram(shaderProgramObject);
     glBindVertexArray(vao);
     {
-        translationMatrix = vmath::translate(0.0f, 0.0f, -5.0f);
-
-        modelMatrix = translationMatrix * rotate(rotationAngle, 0.0f, 1.0f, 0.0f);
 
         glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, modelMatrix);
         glUniformMatrix4fv(viewMatrixUniform, 1, GL_FALSE, viewMatrix);
@@ -655,13 +858,22 @@ void display()
         }
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureDiffuse);
+        glBindTexture(GL_TEXTURE_2D, bVirtualTexture ? vt.physical[0] : textureDiffuse);
         glUniform1i(diffuseTextureUniform, 0);
 
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textureSpecular);
+        glBindTexture(GL_TEXTURE_2D, bVirtualTexture ? vt.physical[1] : textureSpecular);
         glUniform1i(specularTextureUniform, 1);
 
+        if (bVirtualTexture)
+        {
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, vt.indirection);
+            glUniform1i(indirectionUniform, 2);
+            glUniform4fv(virtualInfoUniform, 1, virtualInfo);
+            glUniform4fv(physicalInfoUniform, 1, physicalInfo);
+        }
+
         glDrawElements(GL_TRIANGLES, model.header.nIndices, GL_UNSIGNED_INT, 0);
     }
     glBindVertexArray(0);
@@ -670,10 +882,15 @@ void display()
 
 void update()
 {
-    rotationAngle += 0.5;
-    if (360.0f < rotationAngle)
+    previousRotationAngle = rotationAngle;
+    if (True == bAnimationEnabled)
     {
-        rotationAngle -= 360.0f;
+        rotationAngle += ROTATION_SPEED * (float)runLoop.step;
+        if (360.0f < rotationAngle)
+        {
+            rotationAngle -= 360.0f;
+            previousRotationAngle -= 360.0f;
+        }
     }
 }
 
@@ -774,6 +991,18 @@ void uninitialize()
         vao = 0U;
     }
 
+    if (bVirtualTexture)
+    {
+        vtUninitialize(&vt);
+        bVirtualTexture = false;
+    }
+
+    if (0U != feedbackProgramObject)
+    {
+        glDeleteProgram(feedbackProgramObject);
+        feedbackProgramObject = 0U;
+    }
+
     currentGLXContext = glXGetCurrentContext();
     if ((NULL != currentGLXContext) && (currentGLXContext == glxContext))
     {
@@ -941,3 +1170,45 @@ GLuint loadGLTexture(const char* filename)
     }
     return texture;
 }
+
+GLuint loadGLCompressedTexture(const char* filename)
+{
+    Texture data    = {};
+    GLuint  texture = 0U;
+
+    if (0 != loadTexture(&data, filename))
+    {
+        fprintf(gpFile, "Baked texture %s not available\n", filename);
+        return 0U;
+    }
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // set up texture parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)data.header.nLevels - 1);
+
+    // push every precomputed level, no glGenerateMipmap required
+    for (uint32_t level = 0U; level < data.header.nLevels; ++level)
+    {
+        const TextureLevel* pLevel = &data.levels[level];
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, (GLenum)data.header.format, (GLsizei)pLevel->width, (GLsizei)pLevel->height, 0, (GLsizei)pLevel->size, data.pData + pLevel->offset);
+    }
+
+    if (GL_NO_ERROR != glGetError())
+    {
+        fprintf(gpFile, "Error : GPU rejected compressed format 0x%X of %s\n", data.header.format, filename);
+        glDeleteTextures(1, &texture);
+        texture = 0U;
+    }
+    else
+    {
+        fprintf(gpFile, "Texture loaded %s, format 0x%X, %u levels\n", filename, data.header.format, data.header.nLevels);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    unloadTexture(&data);
+    return texture;
+}
@@ -0,0 +1,738 @@
+#include "texture.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef BAKE
+#define STB_IMAGE_IMPLEMENTATION
+#endif
+#include "stb_image.h"
+
+#ifdef BAKE
+int main(int argc, char* argv[])
+{
+    if (4 != argc)
+    {
+        fprintf(stderr, "Usage: %s <input image> <output texture> <bc1|bc3|bc4|bc5|etc2>\n", argv[0]);
+        return -1;
+    }
+
+    uint32_t format = parseTextureFormat(argv[3]);
+    if (0U == format)
+    {
+        fprintf(stderr, "Unknown texture format %s\n", argv[3]);
+        return -1;
+    }
+
+    if (0 != bakeTexture(argv[1], argv[2], format))
+    {
+        fprintf(stderr, "failed to bake texture %s\n", argv[1]);
+        return -1;
+    }
+
+    return (0);
+}
+#endif
+
+/*--- Block encoders ---*/
+
+static inline int clampi(int val, int lo, int hi)
+{
+    return (val < lo) ? lo : ((val > hi) ? hi : val);
+}
+
+static inline uint16_t packRGB565(const float* color)
+{
+    int r = clampi((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+    int g = clampi((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+    int b = clampi((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void unpackRGB565(uint16_t packed, int* color)
+{
+    int r    = (packed >> 11) & 0x1F;
+    int g    = (packed >> 5) & 0x3F;
+    int b    = packed & 0x1F;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+/**
+ * @brief Encode 4x4 RGBA block as BC1 (always 4 color mode, alpha ignored)
+ *
+ * Endpoints are the extremes of the block along its principal axis.
+ */
+static void encodeBC1(const uint8_t block[16][4], uint8_t* pOut)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        mean[0] += block[i][0];
+        mean[1] += block[i][1];
+        mean[2] += block[i][2];
+    }
+    mean[0] /= 16.0f;
+    mean[1] /= 16.0f;
+    mean[2] /= 16.0f;
+
+    float cov[6] = {0.0f}; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = block[i][0] - mean[0];
+        float g = block[i][1] - mean[1];
+        float b = block[i][2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    /* power iteration for principal axis */
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iter = 0; iter < 4; ++iter)
+    {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float m = fmaxf(fabsf(x), fmaxf(fabsf(y), fabsf(z)));
+        if (m < 1e-6f)
+            break;
+        axis[0] = x / m;
+        axis[1] = y / m;
+        axis[2] = z / m;
+    }
+
+    float minProj = 1e30f;
+    float maxProj = -1e30f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float proj = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+        minProj    = fminf(minProj, proj);
+        maxProj    = fmaxf(maxProj, proj);
+    }
+
+    float len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    if (len2 < 1e-12f)
+        len2 = 1.0f;
+    float maxColor[3];
+    float minColor[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        maxColor[c] = mean[c] + axis[c] * maxProj / len2;
+        minColor[c] = mean[c] + axis[c] * minProj / len2;
+    }
+
+    uint16_t color0 = packRGB565(maxColor);
+    uint16_t color1 = packRGB565(minColor);
+    if (color0 < color1)
+    {
+        uint16_t tmp = color0;
+        color0       = color1;
+        color1       = tmp;
+    }
+
+    uint32_t indices = 0U;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestIndex = 0;
+            int bestError = 0x7FFFFFFF;
+            for (int p = 0; p < 4; ++p)
+            {
+                int dr    = block[i][0] - palette[p][0];
+                int dg    = block[i][1] - palette[p][1];
+                int db    = block[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            indices |= (uint32_t)bestIndex << (2 * i);
+        }
+    }
+
+    pOut[0] = (uint8_t)(color0 & 0xFF);
+    pOut[1] = (uint8_t)(color0 >> 8);
+    pOut[2] = (uint8_t)(color1 & 0xFF);
+    pOut[3] = (uint8_t)(color1 >> 8);
+    pOut[4] = (uint8_t)(indices & 0xFF);
+    pOut[5] = (uint8_t)((indices >> 8) & 0xFF);
+    pOut[6] = (uint8_t)((indices >> 16) & 0xFF);
+    pOut[7] = (uint8_t)(indices >> 24);
+}
+
+/**
+ * @brief Encode one channel of 4x4 block as BC4 (8 value mode)
+ *
+ * Used directly for BC4, for the alpha half of BC3 and twice for BC5.
+ */
+static void encodeBC4(const uint8_t block[16][4], int channel, uint8_t* pOut)
+{
+    int maxValue = 0;
+    int minValue = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        maxValue = (block[i][channel] > maxValue) ? block[i][channel] : maxValue;
+        minValue = (block[i][channel] < minValue) ? block[i][channel] : minValue;
+    }
+
+    uint64_t indices = 0U;
+    if (maxValue != minValue)
+    {
+        int palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int p = 2; p < 8; ++p)
+        {
+            palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestIndex = 0;
+            int bestError = 256;
+            for (int p = 0; p < 8; ++p)
+            {
+                int error = abs(block[i][channel] - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            indices |= (uint64_t)bestIndex << (3 * i);
+        }
+    }
+
+    pOut[0] = (uint8_t)maxValue;
+    pOut[1] = (uint8_t)minValue;
+    for (int b = 0; b < 6; ++b)
+    {
+        pOut[2 + b] = (uint8_t)((indices >> (8 * b)) & 0xFF);
+    }
+}
+
+/* ETC1 modifier tables, shared by the ETC2 RGB individual/differential modes */
+static const int etcModifiers[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+/**
+ * @brief Pick best modifier table for a sub-block with a given base color
+ *
+ * @returns squared error, fills table index and 2 bit selectors per pixel
+ */
+static int fitETCSubBlock(const uint8_t block[16][4], const int* pPixels, const int* base, int* pTable, int* selectors)
+{
+    int bestError = 0x7FFFFFFF;
+    for (int t = 0; t < 8; ++t)
+    {
+        int tableError = 0;
+        int tableSelectors[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            const uint8_t* pixel    = block[pPixels[i]];
+            int            bestSel  = 0;
+            int            bestDist = 0x7FFFFFFF;
+            for (int s = 0; s < 4; ++s)
+            {
+                /* selector -> modifier: 0: +a, 1: +b, 2: -a, 3: -b */
+                int modifier = (s & 2) ? -etcModifiers[t][s & 1] : etcModifiers[t][s & 1];
+                int dist     = 0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    int d = pixel[c] - clampi(base[c] + modifier, 0, 255);
+                    dist += d * d;
+                }
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    bestSel  = s;
+                }
+            }
+            tableSelectors[i] = bestSel;
+            tableError += bestDist;
+        }
+        if (tableError < bestError)
+        {
+            bestError = tableError;
+            *pTable   = t;
+            memcpy(selectors, tableSelectors, sizeof(tableSelectors));
+        }
+    }
+    return bestError;
+}
+
+/**
+ * @brief Encode 4x4 RGBA block as ETC2 RGB8
+ *
+ * Only the ETC1 compatible individual and differential modes are emitted.
+ * Differential mode is chosen only when the delta is in range, so the
+ * overflow encodings that select the ETC2 T/H/planar modes never occur.
+ */
+static void encodeETC2(const uint8_t block[16][4], uint8_t* pOut)
+{
+    uint64_t bestBits  = 0U;
+    int      bestError = 0x7FFFFFFF;
+
+    for (int flip = 0; flip < 2; ++flip)
+    {
+        /* pixels (index y * 4 + x) of both sub-blocks */
+        int pixels[2][8];
+        int n[2] = {0, 0};
+        for (int y = 0; y < 4; ++y)
+        {
+            for (int x = 0; x < 4; ++x)
+            {
+                int sub               = flip ? (y >= 2) : (x >= 2);
+                pixels[sub][n[sub]++] = y * 4 + x;
+            }
+        }
+
+        float average[2][3];
+        for (int sub = 0; sub < 2; ++sub)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                int sum = 0;
+                for (int i = 0; i < 8; ++i)
+                    sum += block[pixels[sub][i]][c];
+                average[sub][c] = sum / 8.0f;
+            }
+        }
+
+        for (int diff = 0; diff < 2; ++diff)
+        {
+            int quant[2][3];
+            int base[2][3];
+            if (diff)
+            {
+                bool inRange = true;
+                for (int c = 0; c < 3; ++c)
+                {
+                    quant[0][c] = clampi((int)(average[0][c] * 31.0f / 255.0f + 0.5f), 0, 31);
+                    quant[1][c] = clampi((int)(average[1][c] * 31.0f / 255.0f + 0.5f), 0, 31);
+                    int delta   = quant[1][c] - quant[0][c];
+                    inRange     = inRange && (delta >= -4) && (delta <= 3);
+                    base[0][c]  = (quant[0][c] << 3) | (quant[0][c] >> 2);
+                    base[1][c]  = (quant[1][c] << 3) | (quant[1][c] >> 2);
+                }
+                if (!inRange)
+                    continue;
+            }
+            else
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    quant[0][c] = clampi((int)(average[0][c] * 15.0f / 255.0f + 0.5f), 0, 15);
+                    quant[1][c] = clampi((int)(average[1][c] * 15.0f / 255.0f + 0.5f), 0, 15);
+                    base[0][c]  = (quant[0][c] << 4) | quant[0][c];
+                    base[1][c]  = (quant[1][c] << 4) | quant[1][c];
+                }
+            }
+
+            int table[2];
+            int selectors[2][8];
+            int error = fitETCSubBlock(block, pixels[0], base[0], &table[0], selectors[0]) + fitETCSubBlock(block, pixels[1], base[1], &table[1], selectors[1]);
+            if (error >= bestError)
+                continue;
+
+            uint64_t bits = 0U;
+            if (diff)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    int delta = (quant[1][c] - quant[0][c]) & 0x7;
+                    bits |= (uint64_t)quant[0][c] << (59 - 8 * c);
+                    bits |= (uint64_t)delta << (56 - 8 * c);
+                }
+            }
+            else
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    bits |= (uint64_t)quant[0][c] << (60 - 8 * c);
+                    bits |= (uint64_t)quant[1][c] << (56 - 8 * c);
+                }
+            }
+            bits |= (uint64_t)table[0] << 37;
+            bits |= (uint64_t)table[1] << 34;
+            bits |= (uint64_t)diff << 33;
+            bits |= (uint64_t)flip << 32;
+
+            /* pixel selectors are stored column major: bit index = x * 4 + y */
+            for (int sub = 0; sub < 2; ++sub)
+            {
+                for (int i = 0; i < 8; ++i)
+                {
+                    int p   = pixels[sub][i];
+                    int bit = (p % 4) * 4 + (p / 4);
+                    int sel = selectors[sub][i];
+                    bits |= (uint64_t)(sel >> 1) << (16 + bit);
+                    bits |= (uint64_t)(sel & 1) << bit;
+                }
+            }
+
+            bestError = error;
+            bestBits  = bits;
+        }
+    }
+
+    /* ETC blocks are big endian */
+    for (int b = 0; b < 8; ++b)
+    {
+        pOut[b] = (uint8_t)(bestBits >> (56 - 8 * b));
+    }
+}
+
+/*--- Mip chain ---*/
+
+/**
+ * @brief Box filter RGBA8 image to half resolution
+ *
+ * @param isNormalMap [in] - renormalize RG(B) as a unit vector after filtering
+ */
+static uint8_t* downsample(const uint8_t* pSrc, uint32_t width, uint32_t height, uint32_t* pWidth, uint32_t* pHeight, bool isNormalMap)
+{
+    uint32_t dstWidth  = (width > 1U) ? width / 2U : 1U;
+    uint32_t dstHeight = (height > 1U) ? height / 2U : 1U;
+    uint8_t* pDst      = (uint8_t*)malloc((size_t)dstWidth * dstHeight * 4U);
+    if (NULL == pDst)
+        return NULL;
+
+    for (uint32_t y = 0U; y < dstHeight; ++y)
+    {
+        uint32_t y0 = (2U * y < height) ? 2U * y : height - 1U;
+        uint32_t y1 = (2U * y + 1U < height) ? 2U * y + 1U : height - 1U;
+        for (uint32_t x = 0U; x < dstWidth; ++x)
+        {
+            uint32_t       x0    = (2U * x < width) ? 2U * x : width - 1U;
+            uint32_t       x1    = (2U * x + 1U < width) ? 2U * x + 1U : width - 1U;
+            const uint8_t* p00   = pSrc + ((size_t)y0 * width + x0) * 4U;
+            const uint8_t* p01   = pSrc + ((size_t)y0 * width + x1) * 4U;
+            const uint8_t* p10   = pSrc + ((size_t)y1 * width + x0) * 4U;
+            const uint8_t* p11   = pSrc + ((size_t)y1 * width + x1) * 4U;
+            uint8_t*       pOut  = pDst + ((size_t)y * dstWidth + x) * 4U;
+            for (int c = 0; c < 4; ++c)
+            {
+                pOut[c] = (uint8_t)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+            }
+
+            if (isNormalMap)
+            {
+                float n[3];
+                for (int c = 0; c < 3; ++c)
+                    n[c] = pOut[c] / 127.5f - 1.0f;
+                float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                if (len > 1e-6f)
+                {
+                    for (int c = 0; c < 3; ++c)
+                        pOut[c] = (uint8_t)clampi((int)((n[c] / len + 1.0f) * 127.5f + 0.5f), 0, 255);
+                }
+            }
+        }
+    }
+
+    *pWidth  = dstWidth;
+    *pHeight = dstHeight;
+    return pDst;
+}
+
+static uint32_t blockBytesOf(uint32_t format)
+{
+    switch (format)
+    {
+        case TEXTURE_FORMAT_BC1:
+        case TEXTURE_FORMAT_BC4:
+        case TEXTURE_FORMAT_ETC2: return 8U;
+        case TEXTURE_FORMAT_BC3:
+        case TEXTURE_FORMAT_BC5: return 16U;
+        default: return 0U;
+    }
+}
+
+/**
+ * @brief Encode one RGBA8 mip level into pOut
+ */
+static void encodeLevel(const uint8_t* pPixels, uint32_t width, uint32_t height, uint32_t format, uint8_t* pOut)
+{
+    uint32_t blockBytes = blockBytesOf(format);
+    uint32_t nBlocksX   = (width + 3U) / 4U;
+    uint32_t nBlocksY   = (height + 3U) / 4U;
+
+    for (uint32_t by = 0U; by < nBlocksY; ++by)
+    {
+        for (uint32_t bx = 0U; bx < nBlocksX; ++bx)
+        {
+            /* gather block, clamping at the edges of small levels */
+            uint8_t block[16][4];
+            for (uint32_t y = 0U; y < 4U; ++y)
+            {
+                uint32_t py = (by * 4U + y < height) ? by * 4U + y : height - 1U;
+                for (uint32_t x = 0U; x < 4U; ++x)
+                {
+                    uint32_t px = (bx * 4U + x < width) ? bx * 4U + x : width - 1U;
+                    memcpy(block[y * 4U + x], pPixels + ((size_t)py * width + px) * 4U, 4U);
+                }
+            }
+
+            uint8_t* pBlock = pOut + ((size_t)by * nBlocksX + bx) * blockBytes;
+            switch (format)
+            {
+                case TEXTURE_FORMAT_BC1: encodeBC1(block, pBlock); break;
+                case TEXTURE_FORMAT_BC3:
+                {
+                    encodeBC4(block, 3, pBlock);
+                    encodeBC1(block, pBlock + 8);
+                    break;
+                }
+                case TEXTURE_FORMAT_BC4: encodeBC4(block, 0, pBlock); break;
+                case TEXTURE_FORMAT_BC5:
+                {
+                    encodeBC4(block, 0, pBlock);
+                    encodeBC4(block, 1, pBlock + 8);
+                    break;
+                }
+                case TEXTURE_FORMAT_ETC2: encodeETC2(block, pBlock); break;
+                default: break;
+            }
+        }
+    }
+}
+
+/*--- Public interface ---*/
+
+uint32_t parseTextureFormat(const char* pName)
+{
+    if (0 == strcmp(pName, "bc1"))
+        return TEXTURE_FORMAT_BC1;
+    if (0 == strcmp(pName, "bc3"))
+        return TEXTURE_FORMAT_BC3;
+    if (0 == strcmp(pName, "bc4"))
+        return TEXTURE_FORMAT_BC4;
+    if (0 == strcmp(pName, "bc5"))
+        return TEXTURE_FORMAT_BC5;
+    if (0 == strcmp(pName, "etc2"))
+        return TEXTURE_FORMAT_ETC2;
+    return 0U;
+}
+
+int bakeTexture(const char* pInput, const char* pOutput, uint32_t format)
+{
+    int      width      = 0;
+    int      height     = 0;
+    int      nChannels  = 0;
+    uint32_t blockBytes = blockBytesOf(format);
+    if (0U == blockBytes)
+    {
+        fprintf(stderr, "Invalid texture format 0x%X\n", format);
+        return -1;
+    }
+
+    /* same orientation as the runtime loader */
+    stbi_set_flip_vertically_on_load(true);
+    uint8_t* pLevel = stbi_load(pInput, &width, &height, &nChannels, 4);
+    if (NULL == pLevel)
+    {
+        fprintf(stderr, "Failed to load image %s\n", pInput);
+        return -1;
+    }
+
+    Texture texture = {};
+    memcpy(texture.header.magic, TEXTURE_MAGIC, 4);
+    texture.header.version    = TEXTURE_VERSION;
+    texture.header.format     = format;
+    texture.header.width      = (uint32_t)width;
+    texture.header.height     = (uint32_t)height;
+    texture.header.blockBytes = blockBytes;
+
+    /* total size of the full chain down to 1x1 */
+    uint32_t levelWidth  = (uint32_t)width;
+    uint32_t levelHeight = (uint32_t)height;
+    uint32_t offset      = 0U;
+    uint32_t nLevels     = 0U;
+    while (nLevels < TEXTURE_MAX_LEVELS)
+    {
+        TextureLevel* pInfo = &texture.levels[nLevels++];
+        pInfo->width        = levelWidth;
+        pInfo->height       = levelHeight;
+        pInfo->offset       = offset;
+        pInfo->size         = ((levelWidth + 3U) / 4U) * ((levelHeight + 3U) / 4U) * blockBytes;
+        offset += pInfo->size;
+        if (1U == levelWidth && 1U == levelHeight)
+            break;
+        levelWidth  = (levelWidth > 1U) ? levelWidth / 2U : 1U;
+        levelHeight = (levelHeight > 1U) ? levelHeight / 2U : 1U;
+    }
+    texture.header.nLevels = nLevels;
+
+    texture.pData = (uint8_t*)malloc(offset);
+    if (NULL == texture.pData)
+    {
+        fprintf(stderr, "Failed to allocate %u bytes for texture\n", offset);
+        stbi_image_free(pLevel);
+        return -1;
+    }
+
+    bool     isNormalMap = (TEXTURE_FORMAT_BC5 == format);
+    uint8_t* pCurrent    = pLevel;
+    for (uint32_t level = 0U; level < nLevels; ++level)
+    {
+        const TextureLevel* pInfo = &texture.levels[level];
+        encodeLevel(pCurrent, pInfo->width, pInfo->height, format, texture.pData + pInfo->offset);
+        fprintf(stdout, "level %2u: %5ux%-5u %u bytes\n", level, pInfo->width, pInfo->height, pInfo->size);
+
+        if (level + 1U < nLevels)
+        {
+            uint32_t nextWidth  = 0U;
+            uint32_t nextHeight = 0U;
+            uint8_t* pNext      = downsample(pCurrent, pInfo->width, pInfo->height, &nextWidth, &nextHeight, isNormalMap);
+            if (pCurrent == pLevel)
+                stbi_image_free(pCurrent);
+            else
+                free(pCurrent);
+            pCurrent = pNext;
+            if (NULL == pCurrent)
+            {
+                fprintf(stderr, "Failed to allocate mip level %u\n", level + 1U);
+                unloadTexture(&texture);
+                return -1;
+            }
+        }
+    }
+    if (pCurrent == pLevel)
+        stbi_image_free(pCurrent);
+    else
+        free(pCurrent);
+
+    int   res   = -1;
+    FILE* pFile = fopen(pOutput, "wb");
+    if (NULL == pFile)
+    {
+        fprintf(stderr, "Failed to open texture file %s\n", pOutput);
+    }
+    else
+    {
+        if (1 != fwrite(&texture.header, sizeof(TextureHeader), 1, pFile))
+        {
+            fprintf(stderr, "Failed to write header\n");
+        }
+        else if (nLevels != fwrite(texture.levels, sizeof(TextureLevel), nLevels, pFile))
+        {
+            fprintf(stderr, "Failed to write level table\n");
+        }
+        else if (1 != fwrite(texture.pData, offset, 1, pFile))
+        {
+            fprintf(stderr, "Failed to write level data\n");
+        }
+        else
+        {
+            fprintf(stdout, "%s: %s -> %s, %u levels, %u bytes (uncompressed RGBA %zu bytes)\n", __func__, pInput, pOutput, nLevels, offset, (size_t)width * height * 4U);
+            res = 0;
+        }
+        fclose(pFile);
+    }
+
+    unloadTexture(&texture);
+    return res;
+}
+
+/* only data up to the end of the last level is read, the uploads take offset and size of every level as they are */
+static bool validLevels(const Texture* pTexture)
+{
+    const TextureLevel* pLast = &pTexture->levels[pTexture->header.nLevels - 1U];
+    size_t              size  = (size_t)pLast->offset + pLast->size;
+
+    for (uint32_t level = 0U; level < pTexture->header.nLevels; ++level)
+    {
+        const TextureLevel* pLevel = &pTexture->levels[level];
+        size_t              blocks = (size_t)((pLevel->width + 3U) / 4U) * ((pLevel->height + 3U) / 4U);
+        if (0U == pLevel->width || 0U == pLevel->height || (size_t)pLevel->size != blocks * pTexture->header.blockBytes ||
+            (size_t)pLevel->offset + pLevel->size > size)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int loadTexture(Texture* pTexture, const char* pFileName)
+{
+    if (NULL == pTexture)
+    {
+        fprintf(stderr, "NULL texture, cannot load \n");
+        return -1;
+    }
+
+    FILE* pFile = fopen(pFileName, "rb");
+    if (NULL == pFile)
+    {
+        fprintf(stderr, "Failed to open texture file %s\n", pFileName);
+        return -1;
+    }
+
+    int res = -1;
+    memset(pTexture, 0, sizeof(Texture));
+    if (1 != fread(&pTexture->header, sizeof(TextureHeader), 1, pFile) || 0 != memcmp(pTexture->header.magic, TEXTURE_MAGIC, 4))
+    {
+        fprintf(stderr, "Invalid texture header in %s\n", pFileName);
+    }
+    else if (TEXTURE_VERSION != pTexture->header.version || 0U == pTexture->header.nLevels || TEXTURE_MAX_LEVELS < pTexture->header.nLevels)
+    {
+        fprintf(stderr, "Unsupported texture version/levels in %s\n", pFileName);
+    }
+    else if (0U == blockBytesOf(pTexture->header.format) || blockBytesOf(pTexture->header.format) != pTexture->header.blockBytes)
+    {
+        fprintf(stderr, "Unknown texture format 0x%X with %u byte blocks in %s\n", pTexture->header.format, pTexture->header.blockBytes, pFileName);
+    }
+    else if (pTexture->header.nLevels != fread(pTexture->levels, sizeof(TextureLevel), pTexture->header.nLevels, pFile))
+    {
+        fprintf(stderr, "Failed to read level table\n");
+    }
+    else if (!validLevels(pTexture))
+    {
+        fprintf(stderr, "Invalid level table in %s\n", pFileName);
+    }
+    else
+    {
+        const TextureLevel* pLast = &pTexture->levels[pTexture->header.nLevels - 1U];
+        size_t              size  = (size_t)pLast->offset + pLast->size;
+        pTexture->pData           = (uint8_t*)malloc(size);
+        if (NULL == pTexture->pData || 1 != fread(pTexture->pData, size, 1, pFile))
+        {
+            fprintf(stderr, "Failed to read level data\n");
+            unloadTexture(pTexture);
+        }
+        else
+        {
+            res = 0;
+        }
+    }
+
+    fclose(pFile);
+    return res;
+}
+
+void unloadTexture(Texture* pTexture)
+{
+    if (NULL != pTexture && NULL != pTexture->pData)
+    {
+        free(pTexture->pData);
+        pTexture->pData = NULL;
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file    texture.h
+ * @brief   Baked (block compressed, pre-mipmapped) texture container
+ *
+ * The bake tool decodes a source image once, builds the full mip chain and
+ * encodes every level into a GPU native block format. At runtime the file is
+ * read as-is and each level is handed to glCompressedTexImage2D, so there is
+ * no image decode and no glGenerateMipmap on startup.
+ *
+ * Build the tool with
+ *   g++ -O2 -DBAKE texture.cpp -o bake
+ * and run
+ *   ./bake 8k/day.jpg 8k/day.ctex bc1
+ */
+
+/* File layout: TextureHeader | TextureLevel[nLevels] | level data */
+#define TEXTURE_MAGIC      "CTEX"
+#define TEXTURE_VERSION    1U
+#define TEXTURE_MAX_LEVELS 16U
+
+/* Values match the OpenGL internal format enums so they can be passed straight to GL */
+enum TextureFormat
+{
+    TEXTURE_FORMAT_BC1  = 0x83F0, /**< GL_COMPRESSED_RGB_S3TC_DXT1_EXT  - RGB, 8 bytes/block  */
+    TEXTURE_FORMAT_BC3  = 0x83F3, /**< GL_COMPRESSED_RGBA_S3TC_DXT5_EXT - RGBA, 16 bytes/block */
+    TEXTURE_FORMAT_BC4  = 0x8DBB, /**< GL_COMPRESSED_RED_RGTC1          - R, 8 bytes/block    */
+    TEXTURE_FORMAT_BC5  = 0x8DBD, /**< GL_COMPRESSED_RG_RGTC2           - RG, 16 bytes/block  */
+    TEXTURE_FORMAT_ETC2 = 0x9274  /**< GL_COMPRESSED_RGB8_ETC2          - RGB, 8 bytes/block  */
+};
+
+typedef struct TextureHeader
+{
+    char     magic[4];   /**< TEXTURE_MAGIC */
+    uint32_t version;    /**< TEXTURE_VERSION */
+    uint32_t format;     /**< one of TextureFormat */
+    uint32_t width;      /**< width of level 0 */
+    uint32_t height;     /**< height of level 0 */
+    uint32_t nLevels;    /**< number of mip levels stored */
+    uint32_t blockBytes; /**< bytes per 4x4 block */
+    uint32_t reserved;
+} TextureHeader;
+
+typedef struct TextureLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t offset; /**< offset of level data from start of pData */
+    uint32_t size;   /**< size of level data in bytes */
+} TextureLevel;
+
+typedef struct Texture
+{
+    TextureHeader header;
+    TextureLevel  levels[TEXTURE_MAX_LEVELS];
+    uint8_t*      pData;
+} Texture;
+
+/**
+ * @brief Decode image, build mip chain, encode and write baked texture
+ *
+ * @param pInput  [in] - source image (anything stb_image can decode)
+ * @param pOutput [in] - baked texture file
+ * @param format  [in] - target block format
+ *
+ * @returns 0 on success else negative value
+ */
+int bakeTexture(const char* pInput, const char* pOutput, uint32_t format);
+
+/**
+ * @brief Read baked texture from file
+ *
+ * @param pTexture  [out] - texture to be populated
+ * @param pFileName [in]  - baked texture file
+ *
+ * @returns 0 on success else negative value
+ */
+int loadTexture(Texture* pTexture, const char* pFileName);
+
+/**
+ * @brief Release memory held by texture
+ */
+void unloadTexture(Texture* pTexture);
+
+/**
+ * @brief Parse format name (bc1, bc3, bc4, bc5, etc2)
+ *
+ * @returns format enum or 0 if the name is unknown
+ */
+uint32_t parseTextureFormat(const char* pName);
+
+#endif // !TEXTURE_H
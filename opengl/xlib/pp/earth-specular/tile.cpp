@@ -0,0 +1,328 @@
+#include "tile.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef BAKE_TILES
+#define STB_IMAGE_IMPLEMENTATION
+#endif
+#include "stb_image.h"
+
+#ifdef BAKE_TILES
+int main(int argc, char* argv[])
+{
+    if (3 != argc && 5 != argc)
+    {
+        fprintf(stderr, "Usage: %s <input image> <output tiles> [width height]\n", argv[0]);
+        return -1;
+    }
+
+    uint32_t width  = (5 == argc) ? (uint32_t)atoi(argv[3]) : 0U;
+    uint32_t height = (5 == argc) ? (uint32_t)atoi(argv[4]) : 0U;
+    if (0 != bakeTiles(argv[1], argv[2], width, height))
+    {
+        fprintf(stderr, "failed to tile %s\n", argv[1]);
+        return -1;
+    }
+
+    return (0);
+}
+#endif
+
+/**
+ * @brief Box filter RGBA8 image to half resolution
+ */
+static uint8_t* halve(const uint8_t* pSrc, uint32_t width, uint32_t height)
+{
+    uint32_t dstWidth  = (width > 1U) ? width / 2U : 1U;
+    uint32_t dstHeight = (height > 1U) ? height / 2U : 1U;
+    uint8_t* pDst      = (uint8_t*)malloc((size_t)dstWidth * dstHeight * 4U);
+    if (NULL == pDst)
+        return NULL;
+
+    for (uint32_t y = 0U; y < dstHeight; ++y)
+    {
+        uint32_t y0 = 2U * y;
+        uint32_t y1 = (2U * y + 1U < height) ? 2U * y + 1U : y0;
+        for (uint32_t x = 0U; x < dstWidth; ++x)
+        {
+            uint32_t       x0  = 2U * x;
+            uint32_t       x1  = (2U * x + 1U < width) ? 2U * x + 1U : x0;
+            const uint8_t* p00 = pSrc + ((size_t)y0 * width + x0) * 4U;
+            const uint8_t* p01 = pSrc + ((size_t)y0 * width + x1) * 4U;
+            const uint8_t* p10 = pSrc + ((size_t)y1 * width + x0) * 4U;
+            const uint8_t* p11 = pSrc + ((size_t)y1 * width + x1) * 4U;
+            uint8_t*       pOut = pDst + ((size_t)y * dstWidth + x) * 4U;
+            for (int c = 0; c < 4; ++c)
+            {
+                pOut[c] = (uint8_t)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+            }
+        }
+    }
+    return pDst;
+}
+
+static inline int clampTexel(int val, int size)
+{
+    return (val < 0) ? 0 : ((val >= size) ? size - 1 : val);
+}
+
+/**
+ * @brief Bilinear resample of RGBA8 image, lets layers of different resolution share one virtual texture
+ */
+static uint8_t* resample(const uint8_t* pSrc, uint32_t width, uint32_t height, uint32_t dstWidth, uint32_t dstHeight)
+{
+    uint8_t* pDst = (uint8_t*)malloc((size_t)dstWidth * dstHeight * 4U);
+    if (NULL == pDst)
+        return NULL;
+
+    for (uint32_t y = 0U; y < dstHeight; ++y)
+    {
+        /* texel centres line up at both resolutions */
+        float    fy = ((float)y + 0.5f) * (float)height / (float)dstHeight - 0.5f;
+        int      y0 = clampTexel((int)floorf(fy), (int)height);
+        int      y1 = clampTexel((int)floorf(fy) + 1, (int)height);
+        float    wy = fy - floorf(fy);
+        for (uint32_t x = 0U; x < dstWidth; ++x)
+        {
+            float fx = ((float)x + 0.5f) * (float)width / (float)dstWidth - 0.5f;
+            int   x0 = clampTexel((int)floorf(fx), (int)width);
+            int   x1 = clampTexel((int)floorf(fx) + 1, (int)width);
+            float wx = fx - floorf(fx);
+
+            const uint8_t* p00 = pSrc + ((size_t)y0 * width + x0) * 4U;
+            const uint8_t* p01 = pSrc + ((size_t)y0 * width + x1) * 4U;
+            const uint8_t* p10 = pSrc + ((size_t)y1 * width + x0) * 4U;
+            const uint8_t* p11 = pSrc + ((size_t)y1 * width + x1) * 4U;
+            uint8_t*       pOut = pDst + ((size_t)y * dstWidth + x) * 4U;
+            for (uint32_t c = 0U; c < 4U; ++c)
+            {
+                float top    = (float)p00[c] + ((float)p01[c] - (float)p00[c]) * wx;
+                float bottom = (float)p10[c] + ((float)p11[c] - (float)p10[c]) * wx;
+                pOut[c]      = (uint8_t)(top + (bottom - top) * wy + 0.5f);
+            }
+        }
+    }
+    return pDst;
+}
+
+static inline int isPowerOfTwo(uint32_t val)
+{
+    return (0U != val) && (0U == (val & (val - 1U)));
+}
+
+int bakeTiles(const char* pInput, const char* pOutput, uint32_t targetWidth, uint32_t targetHeight)
+{
+    int width     = 0;
+    int height    = 0;
+    int nChannels = 0;
+
+    /* same orientation as loadGLTexture */
+    stbi_set_flip_vertically_on_load(true);
+    uint8_t* pLoaded = stbi_load(pInput, &width, &height, &nChannels, 4);
+    if (NULL == pLoaded)
+    {
+        fprintf(stderr, "Failed to load image %s\n", pInput);
+        return -1;
+    }
+
+    uint8_t* pSource = pLoaded;
+    if ((0U != targetWidth && targetWidth != (uint32_t)width) || (0U != targetHeight && targetHeight != (uint32_t)height))
+    {
+        targetWidth  = (0U != targetWidth) ? targetWidth : (uint32_t)width;
+        targetHeight = (0U != targetHeight) ? targetHeight : (uint32_t)height;
+        pSource      = resample(pLoaded, (uint32_t)width, (uint32_t)height, targetWidth, targetHeight);
+        stbi_image_free(pLoaded);
+        pLoaded = NULL;
+        if (NULL == pSource)
+        {
+            fprintf(stderr, "Failed to resample %s\n", pInput);
+            return -1;
+        }
+        fprintf(stdout, "resampled %dx%d to %ux%u\n", width, height, targetWidth, targetHeight);
+        width  = (int)targetWidth;
+        height = (int)targetHeight;
+    }
+
+    if (!isPowerOfTwo((uint32_t)width) || !isPowerOfTwo((uint32_t)height) || (uint32_t)width < TILE_SIZE || (uint32_t)height < TILE_SIZE)
+    {
+        fprintf(stderr, "Image %s is %dx%d, power of two >= %u required\n", pInput, width, height, TILE_SIZE);
+        if (pSource == pLoaded)
+            stbi_image_free(pSource);
+        else
+            free(pSource);
+        return -1;
+    }
+
+    const uint32_t side = TILE_SIZE + 2U * TILE_BORDER;
+
+    TileFile tiles = {};
+    memcpy(tiles.header.magic, TILE_MAGIC, 4);
+    tiles.header.version   = TILE_VERSION;
+    tiles.header.width     = (uint32_t)width;
+    tiles.header.height    = (uint32_t)height;
+    tiles.header.tileSize  = TILE_SIZE;
+    tiles.header.border    = TILE_BORDER;
+    tiles.header.tileBytes = side * side * 4U;
+
+    /* levels down to the first one that is a single tile */
+    uint32_t levelWidth  = (uint32_t)width;
+    uint32_t levelHeight = (uint32_t)height;
+    uint32_t firstTile   = 0U;
+    uint32_t nLevels     = 0U;
+    while (nLevels < TILE_MAX_LEVELS)
+    {
+        TileLevel* pLevel = &tiles.levels[nLevels++];
+        pLevel->nTilesX   = (levelWidth + TILE_SIZE - 1U) / TILE_SIZE;
+        pLevel->nTilesY   = (levelHeight + TILE_SIZE - 1U) / TILE_SIZE;
+        pLevel->firstTile = firstTile;
+        firstTile += pLevel->nTilesX * pLevel->nTilesY;
+        if (1U == pLevel->nTilesX && 1U == pLevel->nTilesY)
+            break;
+        levelWidth  = (levelWidth > 1U) ? levelWidth / 2U : 1U;
+        levelHeight = (levelHeight > 1U) ? levelHeight / 2U : 1U;
+    }
+    tiles.header.nLevels = nLevels;
+
+    FILE* pFile = fopen(pOutput, "wb");
+    if (NULL == pFile)
+    {
+        fprintf(stderr, "Failed to open tile file %s\n", pOutput);
+        stbi_image_free(pSource);
+        return -1;
+    }
+
+    int      res   = 0;
+    uint8_t* pTile = (uint8_t*)malloc(tiles.header.tileBytes);
+    if (NULL == pTile || 1 != fwrite(&tiles.header, sizeof(TileHeader), 1, pFile) || nLevels != fwrite(tiles.levels, sizeof(TileLevel), nLevels, pFile))
+    {
+        fprintf(stderr, "Failed to write tile header\n");
+        res = -1;
+    }
+
+    uint8_t* pLevelPixels = pSource;
+    levelWidth            = (uint32_t)width;
+    levelHeight           = (uint32_t)height;
+    for (uint32_t level = 0U; (0 == res) && (level < nLevels); ++level)
+    {
+        const TileLevel* pLevel = &tiles.levels[level];
+        for (uint32_t ty = 0U; (0 == res) && (ty < pLevel->nTilesY); ++ty)
+        {
+            for (uint32_t tx = 0U; tx < pLevel->nTilesX; ++tx)
+            {
+                /* copy tile plus border, clamping to the level edges */
+                for (uint32_t y = 0U; y < side; ++y)
+                {
+                    int      sy = clampTexel((int)(ty * TILE_SIZE + y) - (int)TILE_BORDER, (int)levelHeight);
+                    uint8_t* pRow = pTile + (size_t)y * side * 4U;
+                    for (uint32_t x = 0U; x < side; ++x)
+                    {
+                        int sx = clampTexel((int)(tx * TILE_SIZE + x) - (int)TILE_BORDER, (int)levelWidth);
+                        memcpy(pRow + x * 4U, pLevelPixels + ((size_t)sy * levelWidth + sx) * 4U, 4U);
+                    }
+                }
+
+                if (1 != fwrite(pTile, tiles.header.tileBytes, 1, pFile))
+                {
+                    fprintf(stderr, "Failed to write tile %u,%u of level %u\n", tx, ty, level);
+                    res = -1;
+                    break;
+                }
+            }
+        }
+        fprintf(stdout, "level %2u: %5ux%-5u %ux%u tiles\n", level, levelWidth, levelHeight, pLevel->nTilesX, pLevel->nTilesY);
+
+        if (level + 1U < nLevels)
+        {
+            uint8_t* pNext = halve(pLevelPixels, levelWidth, levelHeight);
+            if (pLevelPixels == pLoaded)
+                stbi_image_free(pLevelPixels);
+            else
+                free(pLevelPixels);
+            pLevelPixels = pNext;
+            levelWidth   = (levelWidth > 1U) ? levelWidth / 2U : 1U;
+            levelHeight  = (levelHeight > 1U) ? levelHeight / 2U : 1U;
+            if (NULL == pLevelPixels)
+            {
+                fprintf(stderr, "Failed to allocate level %u\n", level + 1U);
+                res = -1;
+            }
+        }
+    }
+
+    if (pLevelPixels == pLoaded)
+        stbi_image_free(pLevelPixels);
+    else
+        free(pLevelPixels);
+    free(pTile);
+    fclose(pFile);
+
+    if (0 == res)
+        fprintf(stdout, "%s: %s -> %s, %u levels, %u tiles\n", __func__, pInput, pOutput, nLevels, firstTile);
+    return res;
+}
+
+int openTiles(TileFile* pTiles, const char* pFileName)
+{
+    if (NULL == pTiles)
+    {
+        fprintf(stderr, "NULL tile file, cannot open \n");
+        return -1;
+    }
+
+    memset(pTiles, 0, sizeof(TileFile));
+    pTiles->fd = open(pFileName, O_RDONLY);
+    if (0 > pTiles->fd)
+    {
+        fprintf(stderr, "Failed to open tile file %s\n", pFileName);
+        return -1;
+    }
+
+    if (sizeof(TileHeader) != pread(pTiles->fd, &pTiles->header, sizeof(TileHeader), 0) || 0 != memcmp(pTiles->header.magic, TILE_MAGIC, 4) ||
+        TILE_VERSION != pTiles->header.version || 0U == pTiles->header.nLevels || TILE_MAX_LEVELS < pTiles->header.nLevels)
+    {
+        fprintf(stderr, "Invalid tile header in %s\n", pFileName);
+        closeTiles(pTiles);
+        return -1;
+    }
+
+    ssize_t tableSize = (ssize_t)(sizeof(TileLevel) * pTiles->header.nLevels);
+    if (tableSize != pread(pTiles->fd, pTiles->levels, tableSize, sizeof(TileHeader)))
+    {
+        fprintf(stderr, "Failed to read level table of %s\n", pFileName);
+        closeTiles(pTiles);
+        return -1;
+    }
+
+    pTiles->dataOffset = (long)(sizeof(TileHeader) + tableSize);
+    return 0;
+}
+
+int readTile(const TileFile* pTiles, uint32_t level, uint32_t x, uint32_t y, uint8_t* pOut)
+{
+    if (level >= pTiles->header.nLevels || x >= pTiles->levels[level].nTilesX || y >= pTiles->levels[level].nTilesY)
+    {
+        return -1;
+    }
+
+    uint32_t index  = pTiles->levels[level].firstTile + y * pTiles->levels[level].nTilesX + x;
+    off_t    offset = (off_t)pTiles->dataOffset + (off_t)index * pTiles->header.tileBytes;
+    if ((ssize_t)pTiles->header.tileBytes != pread(pTiles->fd, pOut, pTiles->header.tileBytes, offset))
+    {
+        fprintf(stderr, "Failed to read tile %u,%u of level %u\n", x, y, level);
+        return -1;
+    }
+    return 0;
+}
+
+void closeTiles(TileFile* pTiles)
+{
+    if (NULL != pTiles && 0 < pTiles->fd)
+    {
+        close(pTiles->fd);
+        pTiles->fd = -1;
+    }
+}
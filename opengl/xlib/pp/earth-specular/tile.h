@@ -0,0 +1,89 @@
+#ifndef TILE_H
+#define TILE_H
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file    tile.h
+ * @brief   On-disk tile pyramid used by the virtual texture (see vt.h)
+ *
+ * Every mip level of the source image is split into tiles of tileSize x tileSize
+ * texels. Each tile is stored with a border of duplicated neighbour texels so it
+ * can be filtered bilinearly in isolation once it is placed in the page cache.
+ * Tiles are fixed size, so a tile is located with a single seek.
+ *
+ * Build the tiling tool with
+ *   g++ -O2 -DBAKE_TILES tile.cpp -o tiler
+ * and run
+ *   ./tiler 8k/day.jpg 8k/day.vt
+ * Layers of one virtual texture must match in size, a smaller map can be resampled with
+ *   ./tiler 2k/normal.png 8k/normal.vt 8192 4096
+ */
+
+/* File layout: TileHeader | TileLevel[nLevels] | tiles (RGBA8, row major per level) */
+#define TILE_MAGIC      "VTEX"
+#define TILE_VERSION    1U
+#define TILE_SIZE       128U
+#define TILE_BORDER     4U
+#define TILE_MAX_LEVELS 16U
+
+typedef struct TileHeader
+{
+    char     magic[4];  /**< TILE_MAGIC */
+    uint32_t version;   /**< TILE_VERSION */
+    uint32_t width;     /**< width of level 0, power of two */
+    uint32_t height;    /**< height of level 0, power of two */
+    uint32_t tileSize;  /**< payload texels per tile side */
+    uint32_t border;    /**< border texels on each side of a tile */
+    uint32_t nLevels;   /**< levels down to the one that fits a single tile */
+    uint32_t tileBytes; /**< bytes of one stored tile including border */
+} TileHeader;
+
+typedef struct TileLevel
+{
+    uint32_t nTilesX;
+    uint32_t nTilesY;
+    uint32_t firstTile; /**< index of first tile of this level in the file */
+    uint32_t reserved;
+} TileLevel;
+
+typedef struct TileFile
+{
+    TileHeader header;
+    TileLevel  levels[TILE_MAX_LEVELS];
+    long       dataOffset; /**< file offset of first tile */
+    int        fd;
+} TileFile;
+
+/**
+ * @brief Split image and its mip chain into bordered tiles
+ *
+ * @param pInput  [in] - source image, dimensions must be power of two
+ * @param pOutput [in] - tile file
+ * @param width   [in] - resample to this width first, 0 keeps the source width
+ * @param height  [in] - resample to this height first, 0 keeps the source height
+ *
+ * @returns 0 on success else negative value
+ */
+int bakeTiles(const char* pInput, const char* pOutput, uint32_t width = 0U, uint32_t height = 0U);
+
+/**
+ * @brief Open tile file and read its header and level table
+ *
+ * @returns 0 on success else negative value
+ */
+int openTiles(TileFile* pTiles, const char* pFileName);
+
+/**
+ * @brief Read one tile (tileBytes bytes) into pOut
+ *
+ * @returns 0 on success else negative value
+ */
+int readTile(const TileFile* pTiles, uint32_t level, uint32_t x, uint32_t y, uint8_t* pOut);
+
+/**
+ * @brief Close tile file
+ */
+void closeTiles(TileFile* pTiles);
+
+#endif // !TILE_H
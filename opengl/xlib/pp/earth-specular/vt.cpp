@@ -0,0 +1,393 @@
+/**
+ * @file    vt.cpp
+ * @brief   Definitions of methods declared in vt.h
+ */
+
+#include "vt.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define VT_FREE_SLOT   UINT32_MAX
+#define VT_LOCKED_SLOT UINT32_MAX
+
+static inline uint32_t packTileKey(uint32_t level, uint32_t x, uint32_t y)
+{
+    return (level << 24) | (y << 12) | x;
+}
+
+static inline uint32_t tileKeyLevel(uint32_t key)
+{
+    return key >> 24;
+}
+
+static inline uint32_t tileKeyX(uint32_t key)
+{
+    return key & 0xFFFU;
+}
+
+static inline uint32_t tileKeyY(uint32_t key)
+{
+    return (key >> 12) & 0xFFFU;
+}
+
+/**
+ * @brief Copy tile of every layer into the given cache slot
+ */
+static int uploadTile(VirtualTexture* pVT, uint32_t key, uint32_t slot)
+{
+    GLint x = (GLint)((slot % pVT->slotsPerSide) * pVT->slotSize);
+    GLint y = (GLint)((slot / pVT->slotsPerSide) * pVT->slotSize);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t layer = 0U; layer < pVT->nLayers; ++layer)
+    {
+        if (0 != readTile(&pVT->layers[layer], tileKeyLevel(key), tileKeyX(key), tileKeyY(key), pVT->staging.data()))
+        {
+            return -1;
+        }
+        glBindTexture(GL_TEXTURE_2D, pVT->physical[layer]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, (GLsizei)pVT->slotSize, (GLsizei)pVT->slotSize, GL_RGBA, GL_UNSIGNED_BYTE, pVT->staging.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return 0;
+}
+
+/**
+ * @brief Point every indirection entry at its own tile or its closest resident ancestor
+ */
+static void rebuildIndirection(VirtualTexture* pVT)
+{
+    const TileFile* pTiles  = &pVT->layers[0];
+    uint32_t        nLevels = pTiles->header.nLevels;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, pVT->indirection);
+    for (int level = (int)nLevels - 1; level >= 0; --level)
+    {
+        const TileLevel* pLevel = &pTiles->levels[level];
+        uint8_t*         pData  = pVT->indirectionData[level].data();
+        for (uint32_t y = 0U; y < pLevel->nTilesY; ++y)
+        {
+            for (uint32_t x = 0U; x < pLevel->nTilesX; ++x)
+            {
+                uint8_t* pEntry = pData + (y * pLevel->nTilesX + x) * 4U;
+                auto     it     = pVT->resident.find(packTileKey((uint32_t)level, x, y));
+                if (pVT->resident.end() != it)
+                {
+                    pEntry[0] = (uint8_t)(it->second % pVT->slotsPerSide);
+                    pEntry[1] = (uint8_t)(it->second / pVT->slotsPerSide);
+                    pEntry[2] = (uint8_t)level;
+                    pEntry[3] = 255U;
+                }
+                else if (level + 1 < (int)nLevels)
+                {
+                    const TileLevel* pParent = &pTiles->levels[level + 1];
+                    memcpy(pEntry, pVT->indirectionData[level + 1].data() + ((y / 2U) * pParent->nTilesX + (x / 2U)) * 4U, 4U);
+                }
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, (GLsizei)pLevel->nTilesX, (GLsizei)pLevel->nTilesY, GL_RGBA, GL_UNSIGNED_BYTE, pData);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    pVT->indirectionDirty = false;
+}
+
+int vtInitialize(VirtualTexture* pVT, const char* const* ppFiles, uint32_t nFiles, uint32_t slotsPerSide)
+{
+    if (NULL == pVT || 0U == nFiles || VT_MAX_LAYERS < nFiles || 0U == slotsPerSide || 256U < slotsPerSide)
+    {
+        fprintf(stderr, "%s: invalid arguments\n", __func__);
+        return -1;
+    }
+
+    pVT->nLayers = 0U;
+    for (uint32_t layer = 0U; layer < nFiles; ++layer)
+    {
+        if (0 != openTiles(&pVT->layers[layer], ppFiles[layer]))
+        {
+            vtUninitialize(pVT);
+            return -1;
+        }
+        pVT->nLayers++;
+
+        const TileHeader* pFirst = &pVT->layers[0].header;
+        const TileHeader* pThis  = &pVT->layers[layer].header;
+        if (pFirst->width != pThis->width || pFirst->height != pThis->height || pFirst->tileBytes != pThis->tileBytes)
+        {
+            fprintf(stderr, "%s: %s does not match dimensions of %s\n", __func__, ppFiles[layer], ppFiles[0]);
+            vtUninitialize(pVT);
+            return -1;
+        }
+    }
+
+    const TileFile* pTiles = &pVT->layers[0];
+    uint32_t        nSlots = slotsPerSide * slotsPerSide;
+    pVT->slotsPerSide      = slotsPerSide;
+    pVT->slotSize          = pTiles->header.tileSize + 2U * pTiles->header.border;
+    pVT->frame             = 1U;
+    pVT->slots.assign(nSlots, VirtualTextureSlot{VT_FREE_SLOT, 0U});
+    pVT->resident.clear();
+    pVT->resident.reserve(nSlots);
+    pVT->staging.resize(pTiles->header.tileBytes);
+
+    /* page cache, one per layer */
+    GLsizei physicalSize = (GLsizei)(slotsPerSide * pVT->slotSize);
+    glGenTextures((GLsizei)pVT->nLayers, pVT->physical);
+    for (uint32_t layer = 0U; layer < pVT->nLayers; ++layer)
+    {
+        glBindTexture(GL_TEXTURE_2D, pVT->physical[layer]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, physicalSize, physicalSize);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    /* indirection, one texel per tile per level */
+    glGenTextures(1, &pVT->indirection);
+    glBindTexture(GL_TEXTURE_2D, pVT->indirection);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)pTiles->header.nLevels, GL_RGBA8, (GLsizei)pTiles->levels[0].nTilesX, (GLsizei)pTiles->levels[0].nTilesY);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    for (uint32_t level = 0U; level < pTiles->header.nLevels; ++level)
+    {
+        pVT->indirectionData[level].assign(pTiles->levels[level].nTilesX * pTiles->levels[level].nTilesY * 4U, 0U);
+    }
+
+    /* coarsest tile covers the whole texture, keep it resident so every lookup has a fallback */
+    uint32_t rootKey = packTileKey(pTiles->header.nLevels - 1U, 0U, 0U);
+    if (0 != uploadTile(pVT, rootKey, 0U))
+    {
+        vtUninitialize(pVT);
+        return -1;
+    }
+    pVT->slots[0]         = VirtualTextureSlot{rootKey, VT_LOCKED_SLOT};
+    pVT->resident[rootKey] = 0U;
+    rebuildIndirection(pVT);
+
+    glGenFramebuffers(1, &pVT->feedbackFbo);
+    glGenBuffers(2, pVT->feedbackPbo);
+
+    fprintf(stdout, "%s: %ux%u virtual, %u layers, %u slot cache (%d x %d)\n", __func__, pTiles->header.width, pTiles->header.height, pVT->nLayers, nSlots, physicalSize, physicalSize);
+    return 0;
+}
+
+void vtResize(VirtualTexture* pVT, int width, int height)
+{
+    pVT->feedbackWidth   = std::max(1, width / VT_FEEDBACK_DIVISOR);
+    pVT->feedbackHeight  = std::max(1, height / VT_FEEDBACK_DIVISOR);
+    pVT->feedbackPending = false;
+
+    if (0U != pVT->feedbackColor)
+    {
+        glDeleteTextures(1, &pVT->feedbackColor);
+        pVT->feedbackColor = 0U;
+    }
+    if (0U != pVT->feedbackDepth)
+    {
+        glDeleteRenderbuffers(1, &pVT->feedbackDepth);
+        pVT->feedbackDepth = 0U;
+    }
+
+    glGenTextures(1, &pVT->feedbackColor);
+    glBindTexture(GL_TEXTURE_2D, pVT->feedbackColor);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, pVT->feedbackWidth, pVT->feedbackHeight);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &pVT->feedbackDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, pVT->feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, pVT->feedbackWidth, pVT->feedbackHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, pVT->feedbackFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pVT->feedbackColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, pVT->feedbackDepth);
+    if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER))
+    {
+        fprintf(stderr, "%s: feedback framebuffer incomplete\n", __func__);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLsizeiptr size = (GLsizeiptr)pVT->feedbackWidth * pVT->feedbackHeight * 4;
+    for (int idx = 0; idx < 2; ++idx)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pVT->feedbackPbo[idx]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void vtBeginFeedback(VirtualTexture* pVT)
+{
+    glGetIntegerv(GL_VIEWPORT, pVT->savedViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, pVT->feedbackFbo);
+    glViewport(0, 0, pVT->feedbackWidth, pVT->feedbackHeight);
+
+    /* alpha 0 marks pixels without a request */
+    const GLfloat clearColor[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const GLfloat clearDepth   = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, clearColor);
+    glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+}
+
+void vtEndFeedback(VirtualTexture* pVT)
+{
+    uint32_t current  = pVT->frame & 1U;
+    uint32_t previous = current ^ 1U;
+
+    /* queue read back of this frame, it completes while the next frame is built */
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pVT->feedbackPbo[current]);
+    glReadPixels(0, 0, pVT->feedbackWidth, pVT->feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    pVT->requests.clear();
+    if (pVT->feedbackPending)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pVT->feedbackPbo[previous]);
+        const uint8_t* pPixels = (const uint8_t*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (nullptr != pPixels)
+        {
+            size_t nPixels = (size_t)pVT->feedbackWidth * pVT->feedbackHeight;
+            for (size_t idx = 0U; idx < nPixels; ++idx)
+            {
+                const uint8_t* pPixel = pPixels + idx * 4U;
+                if (0U != pPixel[3])
+                {
+                    pVT->requests.push_back(packTileKey(pPixel[2], pPixel[0], pPixel[1]));
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        std::sort(pVT->requests.begin(), pVT->requests.end());
+        pVT->requests.erase(std::unique(pVT->requests.begin(), pVT->requests.end()), pVT->requests.end());
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(pVT->savedViewport[0], pVT->savedViewport[1], pVT->savedViewport[2], pVT->savedViewport[3]);
+
+    pVT->feedbackPending = true;
+}
+
+void vtUpdate(VirtualTexture* pVT)
+{
+    const TileFile*       pTiles  = &pVT->layers[0];
+    uint32_t              nLevels = pTiles->header.nLevels;
+    std::vector<uint32_t> missing;
+
+    /* touch requested tiles and their ancestors, collect the ones not resident */
+    for (uint32_t key : pVT->requests)
+    {
+        uint32_t level = tileKeyLevel(key);
+        uint32_t x     = tileKeyX(key);
+        uint32_t y     = tileKeyY(key);
+        if (level >= nLevels || x >= pTiles->levels[level].nTilesX || y >= pTiles->levels[level].nTilesY)
+            continue;
+
+        for (; level < nLevels; ++level, x /= 2U, y /= 2U)
+        {
+            uint32_t ancestor = packTileKey(level, x, y);
+            auto     it       = pVT->resident.find(ancestor);
+            if (pVT->resident.end() == it)
+            {
+                missing.push_back(ancestor);
+            }
+            else if (VT_LOCKED_SLOT != pVT->slots[it->second].lastUsed)
+            {
+                pVT->slots[it->second].lastUsed = pVT->frame;
+            }
+        }
+    }
+
+    /* coarse tiles first, they give the widest fallback coverage */
+    std::sort(missing.begin(), missing.end(), [](uint32_t a, uint32_t b) { return tileKeyLevel(a) != tileKeyLevel(b) ? tileKeyLevel(a) > tileKeyLevel(b) : a < b; });
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+    uint32_t nUploaded = 0U;
+    for (uint32_t key : missing)
+    {
+        if (VT_UPLOAD_BUDGET <= nUploaded)
+            break;
+
+        /* free slot, else least recently used slot not needed this frame */
+        uint32_t victim   = VT_FREE_SLOT;
+        uint32_t lastUsed = VT_LOCKED_SLOT;
+        for (uint32_t slot = 0U; slot < pVT->slots.size(); ++slot)
+        {
+            const VirtualTextureSlot* pSlot = &pVT->slots[slot];
+            if (VT_FREE_SLOT == pSlot->key)
+            {
+                victim = slot;
+                break;
+            }
+            if (pSlot->lastUsed < lastUsed && pSlot->lastUsed != pVT->frame)
+            {
+                lastUsed = pSlot->lastUsed;
+                victim   = slot;
+            }
+        }
+        if (VT_FREE_SLOT == victim)
+            break; // cache is full of tiles visible this frame
+
+        if (VT_FREE_SLOT != pVT->slots[victim].key)
+        {
+            pVT->resident.erase(pVT->slots[victim].key);
+            pVT->slots[victim].key = VT_FREE_SLOT;
+        }
+        if (0 != uploadTile(pVT, key, victim))
+            continue;
+
+        pVT->slots[victim]  = VirtualTextureSlot{key, pVT->frame};
+        pVT->resident[key]  = victim;
+        pVT->indirectionDirty = true;
+        ++nUploaded;
+    }
+
+    if (pVT->indirectionDirty)
+    {
+        rebuildIndirection(pVT);
+    }
+    pVT->frame++;
+}
+
+void vtUninitialize(VirtualTexture* pVT)
+{
+    if (0U != pVT->feedbackPbo[0])
+    {
+        glDeleteBuffers(2, pVT->feedbackPbo);
+        pVT->feedbackPbo[0] = pVT->feedbackPbo[1] = 0U;
+    }
+    if (0U != pVT->feedbackFbo)
+    {
+        glDeleteFramebuffers(1, &pVT->feedbackFbo);
+        pVT->feedbackFbo = 0U;
+    }
+    if (0U != pVT->feedbackColor)
+    {
+        glDeleteTextures(1, &pVT->feedbackColor);
+        pVT->feedbackColor = 0U;
+    }
+    if (0U != pVT->feedbackDepth)
+    {
+        glDeleteRenderbuffers(1, &pVT->feedbackDepth);
+        pVT->feedbackDepth = 0U;
+    }
+    if (0U != pVT->indirection)
+    {
+        glDeleteTextures(1, &pVT->indirection);
+        pVT->indirection = 0U;
+    }
+    for (uint32_t layer = 0U; layer < pVT->nLayers; ++layer)
+    {
+        if (0U != pVT->physical[layer])
+        {
+            glDeleteTextures(1, &pVT->physical[layer]);
+            pVT->physical[layer] = 0U;
+        }
+        closeTiles(&pVT->layers[layer]);
+    }
+    pVT->nLayers = 0U;
+    pVT->slots.clear();
+    pVT->resident.clear();
+    pVT->requests.clear();
+}
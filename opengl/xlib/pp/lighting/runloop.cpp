@@ -0,0 +1,124 @@
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <GL/glx.h>
+
+#include "runloop.h"
+
+typedef int (*PFNSWAPINTERVALPROC)(int interval);
+
+double runLoopNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void runLoopInitialize(RunLoop* pLoop, Display* dpy, double targetFps)
+{
+    memset(pLoop, 0, sizeof(RunLoop));
+    pLoop->dpy           = dpy;
+    pLoop->fd            = ConnectionNumber(dpy);
+    pLoop->step          = 1.0 / RUNLOOP_STEP_HZ;
+    pLoop->frameInterval = (0.0 < targetFps) ? 1.0 / targetFps : 0.0;
+    pLoop->previous      = runLoopNow();
+    pLoop->nextFrame     = pLoop->previous;
+}
+
+static bool hasExtension(const char* pExtensions, const char* pName)
+{
+    size_t length = strlen(pName);
+    for (const char* p = pExtensions; NULL != p && NULL != (p = strstr(p, pName)); p += length)
+    {
+        if ((p == pExtensions || ' ' == p[-1]) && (' ' == p[length] || '\0' == p[length]))
+            return true;
+    }
+    return false;
+}
+
+bool runLoopEnableVsync(RunLoop* pLoop, Window window, int interval)
+{
+    const char* pExtensions = glXQueryExtensionsString(pLoop->dpy, DefaultScreen(pLoop->dpy));
+
+    if (hasExtension(pExtensions, "GLX_EXT_swap_control"))
+    {
+        PFNGLXSWAPINTERVALEXTPROC glXSwapIntervalEXT = (PFNGLXSWAPINTERVALEXTPROC)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalEXT");
+        glXSwapIntervalEXT(pLoop->dpy, window, interval);
+    }
+    else if (hasExtension(pExtensions, "GLX_MESA_swap_control"))
+    {
+        PFNSWAPINTERVALPROC glXSwapIntervalMESA = (PFNSWAPINTERVALPROC)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalMESA");
+        glXSwapIntervalMESA(interval);
+    }
+    else if (hasExtension(pExtensions, "GLX_SGI_swap_control"))
+    {
+        PFNSWAPINTERVALPROC glXSwapIntervalSGI = (PFNSWAPINTERVALPROC)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+        glXSwapIntervalSGI(interval);
+    }
+    else
+    {
+        fprintf(stderr, "%s: no swap control extension, limiting frame rate instead\n", __func__);
+        return false;
+    }
+
+    pLoop->bVsync = (0 != interval);
+    return true;
+}
+
+bool runLoopWait(RunLoop* pLoop, bool bBlock)
+{
+    while (0 == XPending(pLoop->dpy))
+    {
+        int timeout = -1;
+        if (!bBlock)
+        {
+            /* swaps block on vblank, sleeping here as well could miss one */
+            double remaining = pLoop->bVsync ? 0.0 : pLoop->nextFrame - runLoopNow();
+            if (0.0 >= remaining)
+                return false;
+            timeout = (int)(remaining * 1000.0 + 0.999);
+        }
+
+        struct pollfd pfd = {pLoop->fd, POLLIN, 0};
+        if (0 == poll(&pfd, 1, timeout))
+            return false;
+    }
+    return true;
+}
+
+uint32_t runLoopBeginFrame(RunLoop* pLoop)
+{
+    double now      = runLoopNow();
+    double elapsed  = now - pLoop->previous;
+    pLoop->previous = now;
+
+    if (elapsed > pLoop->step * RUNLOOP_MAX_STEPS)
+        elapsed = pLoop->step * RUNLOOP_MAX_STEPS;
+
+    pLoop->accumulator += elapsed;
+    uint32_t nSteps = (uint32_t)(pLoop->accumulator / pLoop->step);
+    pLoop->accumulator -= nSteps * pLoop->step;
+    return nSteps;
+}
+
+float runLoopAlpha(const RunLoop* pLoop)
+{
+    return (float)(pLoop->accumulator / pLoop->step);
+}
+
+void runLoopEndFrame(RunLoop* pLoop)
+{
+    double now = runLoopNow();
+    if (pLoop->bVsync || 0.0 == pLoop->frameInterval)
+    {
+        pLoop->nextFrame = now;
+        return;
+    }
+
+    /* keep a steady cadence, but do not try to catch up on missed frames */
+    pLoop->nextFrame += pLoop->frameInterval;
+    if (pLoop->nextFrame < now)
+        pLoop->nextFrame = now;
+}
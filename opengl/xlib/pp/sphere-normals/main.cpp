@@ -34,12 +34,15 @@ using namespace vmath;
 #include "stb_image.h"
 
 #include "load.h"
+#include "runloop.h"
 
 /*--- Macro definitions ---*/
 #define gpFILE     stdout
 #define WIN_WIDTH  800
 #define WIN_HEIGHT 600
 
+#define ROTATION_SPEED 30.0f // degrees per second
+
 enum
 {
     AMC_ATTRIBUTE_POSITION = 0,
@@ -156,6 +159,10 @@ Bool   bAnimationEnabled = False;
 Model model         = {0};
 float rotationAngle = 0.0f;
 
+/* Animation timing */
+RunLoop runLoop               = {};
+float   previousRotationAngle = 0.0f; // rotation of previous step, for interpolation
+
 int main()
 {
     int                  defaultScreen    = 0;
@@ -272,11 +279,15 @@ int main()
         exit(res);
     }
 
+    /* fixed step animation, sleep between frames instead of spinning */
+    runLoopInitialize(&runLoop, dpy, RUNLOOP_DEFAULT_FPS);
+    runLoopEnableVsync(&runLoop, window, 1);
+
     shouldDraw = false;
     while (!gbAbortFlag)
     {
         XEvent event;
-        if (XPending(dpy))
+        while (!gbAbortFlag && runLoopWait(&runLoop, !shouldDraw))
         {
             XNextEvent(dpy, &event);
             switch (event.type)
@@ -365,14 +376,15 @@ int main()
         if (!shouldDraw)
             continue;
 
-        display();
-
-        if (True == bAnimationEnabled)
+        for (uint32_t nSteps = runLoopBeginFrame(&runLoop); 0U < nSteps; --nSteps)
         {
             update();
         }
 
+        display();
+
         glXSwapBuffers(dpy, window);
+        runLoopEndFrame(&runLoop);
     }
 
     uninitialize();
@@ -532,7 +544,9 @@ void display()
     glBindVertexArray(vao);
     translationMatrix = vmath::translate(0.0f, 0.0f, -5.0f);
 
-    modelMatrix = translationMatrix * rotate(rotationAngle, 0.0f, 1.0f, 0.0f);
+    /* interpolate between the last two animation steps */
+    float angle = previousRotationAngle + (rotationAngle - previousRotationAngle) * runLoopAlpha(&runLoop);
+    modelMatrix = translationMatrix * rotate(angle, 0.0f, 1.0f, 0.0f);
 
     glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, modelMatrix);
     glUniformMatrix4fv(viewMatrixUniform, 1, GL_FALSE, viewMatrix);
@@ -545,10 +559,15 @@ void display()
 
 void update()
 {
-    rotationAngle += 0.5;
-    if (360.0f < rotationAngle)
+    previousRotationAngle = rotationAngle;
+    if (True == bAnimationEnabled)
     {
-        rotationAngle -= 360.0f;
+        rotationAngle += ROTATION_SPEED * (float)runLoop.step;
+        if (360.0f < rotationAngle)
+        {
+            rotationAngle -= 360.0f;
+            previousRotationAngle -= 360.0f;
+        }
     }
 }
 
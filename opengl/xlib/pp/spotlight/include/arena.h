@@ -0,0 +1,166 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+ * @file    arena.h
+ * @brief   Meshes of many models in shared buffers, drawn with one glMultiDrawElementsIndirect
+ *
+ * Vertices and indices of every model added to the arena are appended to one
+ * vertex and one element buffer, each mesh remembers its first index and base
+ * vertex, so the whole scene uses a single vertex array. A frame lists its
+ * draws as DrawElementsIndirectCommands plus a DrawRecord each (transform and
+ * material index) and submits all of them with one call. Each command carries
+ * the index of its record as base instance, so the vertex shader fetches
+ * draws[gl_BaseInstanceARB] and a pass may submit any range of the draws. It
+ * passes the material index on, the fragment shader reads materials[index].
+ * ARENA_GLSL declares both buffers. gl_BaseInstance is core only in GLSL 4.60,
+ * the shaders stay at 4.50 with GL_ARB_shader_draw_parameters so they also run
+ * on 4.5 drivers such as llvmpipe.
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <vector>
+
+#include "instancing.h"
+#include "material.h"
+#include "model.h"
+#include "vmath.h"
+
+/* storage buffer binding points, after the ones of instancing */
+#define ARENA_BINDING_DRAWS     3U
+#define ARENA_BINDING_MATERIALS 4U
+
+/* GLSL of the per draw records and materials, std430 layout of DrawRecord and MaterialBlock */
+#define ARENA_GLSL                                                    \
+    "struct Material"                                                 \
+    "{"                                                               \
+    "    vec4  ambient;"                                              \
+    "    vec4  diffuse;"                                              \
+    "    vec4  specular;"                                             \
+    "    float shininess;"                                            \
+    "};"                                                              \
+    "\n"                                                              \
+    "struct DrawRecord"                                               \
+    "{"                                                               \
+    "    mat4 modelMatrix;"                                           \
+    "    mat3 normalMatrix;"                                          \
+    "    uint material;"                                              \
+    "};"                                                              \
+    "\n"                                                              \
+    "layout(std430, binding = 3) readonly buffer DrawRecords"         \
+    "{"                                                               \
+    "    DrawRecord draws[];"                                         \
+    "};"                                                              \
+    "layout(std430, binding = 4) readonly buffer Materials"           \
+    "{"                                                               \
+    "    Material materials[];"                                       \
+    "};"                                                              \
+    "\n"
+
+/**
+ * @brief Location of one model in the shared buffers
+ */
+struct ArenaMesh
+{
+    uint32_t firstIndex;
+    uint32_t nIndices;
+    int32_t  baseVertex;
+    uint32_t nVertices;
+};
+
+/**
+ * @brief Per draw data indexed by gl_BaseInstanceARB, std430 layout
+ */
+struct DrawRecord
+{
+    vmath::mat4 modelMatrix;
+    vmath::vec4 normalMatrix[3]; /**< mat3 columns are padded to vec4 */
+    uint32_t    material;        /**< index into the material buffer */
+    uint32_t    padding[3];
+};
+
+static_assert(sizeof(DrawRecord) == 128, "DrawRecord does not match std430");
+
+typedef struct GeometryArena
+{
+    GLuint   vao;
+    GLuint   vertices;
+    GLuint   indices;
+    uint32_t maxVertices;
+    uint32_t maxIndices;
+    uint32_t nVertices; /**< vertices in use */
+    uint32_t nIndices;  /**< indices in use */
+
+    std::vector<ArenaMesh> meshes;
+
+    /* draws of the current frame, uploaded by arenaDraw */
+    uint32_t                                 maxDraws;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawRecord>                  records;
+    GLuint                                   commandBuffer;
+    GLuint                                   recordBuffer;
+    GLuint                                   materialBuffer;
+    bool                                     bUploaded; /**< queued draws are in the buffers, e.g. after a shadow pass */
+} GeometryArena;
+
+/**
+ * @brief Create shared buffers and vertex array
+ *
+ * @param maxVertices [in] - vertices of all models
+ * @param maxIndices  [in] - indices of all models
+ * @param maxDraws    [in] - draws per frame
+ *
+ * @returns 0 on success else negative value
+ */
+int arenaInitialize(GeometryArena* pArena, uint32_t maxVertices, uint32_t maxIndices, uint32_t maxDraws);
+
+/**
+ * @brief Copy vertices and indices of a model into the shared buffers
+ *
+ * @returns index of mesh else negative value if the arena is full
+ */
+int arenaAddModel(GeometryArena* pArena, const Model* pModel);
+
+/**
+ * @brief Replace the material buffer
+ */
+void arenaSetMaterials(GeometryArena* pArena, const MaterialBlock* pMaterials, uint32_t nMaterials);
+
+/**
+ * @brief Forget the draws of the previous frame
+ */
+void arenaBeginFrame(GeometryArena* pArena);
+
+/**
+ * @brief Queue a draw of a mesh
+ *
+ * @param mesh        [in] - index returned by arenaAddModel
+ * @param modelMatrix [in] - model to world transform
+ * @param material    [in] - index into the materials of arenaSetMaterials
+ *
+ * @returns false if maxDraws draws are queued already or mesh is not in the arena
+ */
+bool arenaAddDraw(GeometryArena* pArena, int mesh, const vmath::mat4& modelMatrix, uint32_t material);
+
+/**
+ * @brief Upload queued draws and submit them, a program declaring ARENA_GLSL must be in use
+ *
+ * Draws are uploaded once, further calls in the same frame (one per pass) only submit them again.
+ */
+void arenaDraw(GeometryArena* pArena);
+
+/**
+ * @brief Upload queued draws like arenaDraw and submit only some of them
+ *
+ * @param first [in] - first queued draw
+ * @param count [in] - draws from first on
+ */
+void arenaDrawRange(GeometryArena* pArena, uint32_t first, uint32_t count);
+
+/**
+ * @brief Delete buffers and vertex array
+ */
+void arenaUninitialize(GeometryArena* pArena);
+
+#endif // !ARENA_H
@@ -0,0 +1,137 @@
+#ifndef CLUSTERS_H
+#define CLUSTERS_H
+
+/**
+ * @file    clusters.h
+ * @brief   Clustered forward shading of many point lights
+ *
+ * The view frustum is split into a grid of froxels, CLUSTERS_X by CLUSTERS_Y
+ * screen tiles and CLUSTERS_Z depth slices spaced logarithmically between the
+ * near and far plane. Every frame the CPU bins each light into the froxels its
+ * bounding sphere can touch and writes one compact list of light indices per
+ * froxel. The fragment shader finds its froxel from gl_FragCoord and its view
+ * depth and loops over that list only, so shading cost follows the number of
+ * lights near a fragment and not the number of lights in the scene.
+ *
+ * Shaders declare the buffers with CLUSTERS_GLSL and call clusterLights() for
+ * the offset and count of their list in lightIndices[].
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <vector>
+
+#include "vmath.h"
+
+#define CLUSTERS_X 16U /**< screen tiles across */
+#define CLUSTERS_Y 9U  /**< screen tiles down */
+#define CLUSTERS_Z 24U /**< depth slices */
+
+/* storage buffer binding points, after the ones of the geometry arena */
+#define CLUSTERS_BINDING_LIGHTS  5U
+#define CLUSTERS_BINDING_GRID    6U
+#define CLUSTERS_BINDING_INDICES 7U
+
+/* GLSL of the lights and froxel lists, std430 layout of PointLight and the grid written by clustersBuild */
+#define CLUSTERS_GLSL                                                                                          \
+    "struct PointLight"                                                                                        \
+    "{"                                                                                                        \
+    "    vec4 positionRadius;"                                                                                 \
+    "    vec4 color;"                                                                                          \
+    "};"                                                                                                       \
+    "\n"                                                                                                       \
+    "layout(std430, binding = 5) readonly buffer PointLights"                                                  \
+    "{"                                                                                                        \
+    "    PointLight pointLights[];"                                                                            \
+    "};"                                                                                                       \
+    "layout(std430, binding = 6) readonly buffer ClusterGrid"                                                  \
+    "{"                                                                                                        \
+    "    uvec4 clusterCount;"                                                                                  \
+    "    vec4  clusterScale;"                                                                                  \
+    "    uvec2 clusters[];"                                                                                    \
+    "};"                                                                                                       \
+    "layout(std430, binding = 7) readonly buffer ClusterLightIndices"                                          \
+    "{"                                                                                                        \
+    "    uint lightIndices[];"                                                                                 \
+    "};"                                                                                                       \
+    "\n"                                                                                                       \
+    "uvec2 clusterLights(vec2 fragCoord, float viewDepth)"                                                     \
+    "{"                                                                                                        \
+    "    vec3  cell    = vec3(fragCoord / clusterScale.xy, log(viewDepth) * clusterScale.z + clusterScale.w);" \
+    "    uvec3 clamped = uvec3(clamp(ivec3(cell), ivec3(0), ivec3(clusterCount.xyz) - 1));"                    \
+    "    return clusters[(clamped.z * clusterCount.y + clamped.y) * clusterCount.x + clamped.x];"              \
+    "}"                                                                                                        \
+    "\n"
+
+/**
+ * @brief One point light, std430 layout
+ */
+struct PointLight
+{
+    vmath::vec4 positionRadius; /**< world position xyz, radius of influence w */
+    vmath::vec4 color;          /**< rgb, a unused */
+};
+
+typedef struct LightClusters
+{
+    /* lights written by the caller */
+    uint32_t                maxLights;
+    std::vector<PointLight> lights;
+
+    /* froxel lists built on the CPU */
+    uint32_t              maxIndices;
+    std::vector<uint32_t> grid;    /**< header of 8 words, then offset and count per froxel */
+    std::vector<uint32_t> indices; /**< light indices of all froxels */
+    std::vector<uint32_t> ranges;  /**< froxel bounds of each light, min and max of x, y, z */
+
+    /* statistics of the last build */
+    uint32_t nVisible; /**< lights touching at least one froxel */
+    uint32_t maxCount; /**< longest list of a froxel */
+    uint32_t nDropped; /**< indices that did not fit into maxIndices */
+
+    GLuint lightBuffer;
+    GLuint gridBuffer;
+    GLuint indexBuffer;
+} LightClusters;
+
+/**
+ * @brief Create buffers of lights and froxel lists
+ *
+ * @param maxLights  [in] - lights per frame
+ * @param maxIndices [in] - light indices of all froxels together, lists are cut short beyond it
+ *
+ * @returns 0 on success else negative value
+ */
+int clustersInitialize(LightClusters* pClusters, uint32_t maxLights, uint32_t maxIndices);
+
+/**
+ * @brief Lights of this frame
+ *
+ * @returns maxLights lights to be written by the caller
+ */
+PointLight* clustersBeginFrame(LightClusters* pClusters);
+
+/**
+ * @brief Bin the first nLights lights into froxels and upload lights and lists
+ *
+ * @param viewMatrix       [in] - world to view transform
+ * @param projectionMatrix [in] - perspective projection with the near and far plane below
+ * @param zNear            [in] - distance of the near plane
+ * @param zFar             [in] - distance of the far plane
+ * @param width            [in] - viewport width in pixels
+ * @param height           [in] - viewport height in pixels
+ */
+void clustersBuild(LightClusters* pClusters, uint32_t nLights, const vmath::mat4& viewMatrix, const vmath::mat4& projectionMatrix, float zNear,
+                   float zFar, int width, int height);
+
+/**
+ * @brief Bind lights and froxel lists for programs declaring CLUSTERS_GLSL
+ */
+void clustersBind(const LightClusters* pClusters);
+
+/**
+ * @brief Delete buffers
+ */
+void clustersUninitialize(LightClusters* pClusters);
+
+#endif // !CLUSTERS_H
@@ -0,0 +1,102 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+/**
+ * @file
+ *   headless.h
+ *
+ * @brief
+ *   Offscreen replacement for the X11 window and GLX context
+ *
+ * Creates an OpenGL context on the EGL surfaceless platform (Mesa, works with
+ * llvmpipe on machines without a display or GPU) or on the first EGL device,
+ * and renders into a framebuffer object of fixed size. Every frame is read back
+ * through a pair of pixel buffers so the readback of frame N overlaps
+ * rendering of frame N + 1, and timed on the CPU and with GL_TIME_ELAPSED
+ * queries collected a few frames later so the GPU is never stalled. The first
+ * frame pays for shader compilation and lazy allocations and is not timed.
+ *
+ * Only spotlight uses it. Every xlib sample is a self-contained tree that
+ * creates its own window and GLX context, so another sample adopts it by
+ * copying headless.h/.cpp, creating its GLX context in main() instead of
+ * initialize() and driving initialize/display from a runHeadless() loop as
+ * spotlight's main.cpp does.
+ */
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#define HEADLESS_QUERY_LATENCY 3U /**< frames in flight before a timer query is read */
+#define HEADLESS_GL_MAJOR      4  /**< core context requested, what the shaders need */
+#define HEADLESS_GL_MINOR      5
+
+struct Headless
+{
+    EGLDisplay display;
+    EGLContext context;
+
+    /* render target */
+    int    width;
+    int    height;
+    GLuint fbo;
+    GLuint color;
+    GLuint depth;
+    GLuint pbo[2];
+
+    /* timing */
+    GLuint              queries[HEADLESS_QUERY_LATENCY];
+    uint32_t            frame;
+    double              frameStart;
+    std::vector<double> cpuTimes; /**< ms from headlessBeginFrame to headlessEndFrame */
+    std::vector<double> gpuTimes; /**< ms of GPU work between the same calls */
+
+    std::vector<uint8_t> pixels; /**< RGBA8 of last frame read back, bottom row first */
+};
+
+/**
+ * @brief Create context and render target, then make them current
+ *
+ * @param pHeadless [out] - offscreen context
+ * @param width     [in]  - width of render target
+ * @param height    [in]  - height of render target
+ *
+ * @returns 0 on success else negative value
+ */
+int headlessInitialize(Headless* pHeadless, int width, int height);
+
+/**
+ * @brief Bind render target and start timing a frame
+ */
+void headlessBeginFrame(Headless* pHeadless);
+
+/**
+ * @brief Stop timing, queue read back of this frame and collect the previous one
+ */
+void headlessEndFrame(Headless* pHeadless);
+
+/**
+ * @brief Wait for outstanding read back and timer queries
+ */
+void headlessFinish(Headless* pHeadless);
+
+/**
+ * @brief Print min / average / median / 95th percentile / max of CPU and GPU frame times
+ */
+void headlessReport(const Headless* pHeadless, FILE* pFile);
+
+/**
+ * @brief Write last frame read back as binary PPM
+ *
+ * @returns 0 on success else negative value
+ */
+int headlessWriteFrame(const Headless* pHeadless, const char* pFileName);
+
+/**
+ * @brief Release render target and context
+ */
+void headlessUninitialize(Headless* pHeadless);
+
+#endif // !HEADLESS_H
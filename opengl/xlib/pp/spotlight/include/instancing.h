@@ -0,0 +1,159 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+/**
+ * @file    instancing.h
+ * @brief   Many copies of one mesh, culled on the GPU and drawn with one indirect call
+ *
+ * Instances are written by the CPU every frame as a quaternion, a position and
+ * a uniform scale (32 bytes instead of a 64 byte mat4) into a persistently
+ * mapped buffer split into INSTANCING_FRAMES fenced regions, like the uniform
+ * ring. A compute shader tests the bounding sphere of every instance against
+ * the view frustum and appends the visible ones to a second buffer, counting
+ * them in the instanceCount of a DrawElementsIndirectCommand. The draw is a
+ * single glDrawElementsIndirect, the CPU never learns how many were visible.
+ *
+ * The vertex shader of the draw declares the visible instances with
+ * INSTANCING_GLSL and transforms with instancePosition() / instanceNormal().
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+
+#include "vmath.h"
+
+#define INSTANCING_FRAMES     3U   /**< regions, frames the CPU may run ahead of the GPU */
+#define INSTANCING_GROUP_SIZE 256U /**< local size of the cull shader */
+
+/* storage buffer binding points, cull shader reads 0 and writes 1 and 2 */
+#define INSTANCING_BINDING_INSTANCES 0U
+#define INSTANCING_BINDING_VISIBLE   1U
+#define INSTANCING_BINDING_COMMAND   2U
+
+/* GLSL of the visible instances for the vertex shader, std430 layout of Instance */
+#define INSTANCING_GLSL                                                                            \
+    "struct Instance"                                                                              \
+    "{"                                                                                            \
+    "    vec4 rotation;"                                                                           \
+    "    vec4 positionScale;"                                                                      \
+    "};"                                                                                           \
+    "\n"                                                                                           \
+    "layout(std430, binding = 1) readonly buffer VisibleInstances"                                 \
+    "{"                                                                                            \
+    "    Instance visible[];"                                                                      \
+    "};"                                                                                           \
+    "\n"                                                                                           \
+    "vec3 rotateByQuaternion(vec4 q, vec3 v)"                                                      \
+    "{"                                                                                            \
+    "    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);"                                \
+    "}"                                                                                            \
+    "\n"                                                                                           \
+    "vec3 instancePosition(vec3 position)"                                                         \
+    "{"                                                                                            \
+    "    Instance instance = visible[gl_InstanceID];"                                              \
+    "    return rotateByQuaternion(instance.rotation, position * instance.positionScale.w) +"      \
+    "           instance.positionScale.xyz;"                                                       \
+    "}"                                                                                            \
+    "\n"                                                                                           \
+    "vec3 instanceNormal(vec3 normal)"                                                             \
+    "{"                                                                                            \
+    "    return rotateByQuaternion(visible[gl_InstanceID].rotation, normal);"                      \
+    "}"                                                                                            \
+    "\n"
+
+/**
+ * @brief One instance, std430 layout
+ */
+struct Instance
+{
+    vmath::vec4 rotation;      /**< unit quaternion x, y, z, w */
+    vmath::vec4 positionScale; /**< translation xyz, uniform scale w */
+};
+
+/**
+ * @brief Layout of a command in GL_DRAW_INDIRECT_BUFFER
+ */
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+typedef struct Instancing
+{
+    /* mesh */
+    GLuint   vao;    /**< vertex array with element buffer of the mesh */
+    uint32_t nIndices;
+    float    radius; /**< bounding sphere of the mesh around its origin */
+
+    /* instances written by the CPU */
+    uint32_t   maxInstances;
+    uint32_t   nInstances;                /**< instances culled this frame */
+    GLuint     instances;
+    Instance*  pMapped;                   /**< persistent, coherent mapping of instances */
+    GLsizeiptr regionSize;                /**< bytes per region, aligned for glBindBufferRange */
+    uint32_t   region;                    /**< region of current frame */
+    GLsync     fences[INSTANCING_FRAMES]; /**< signalled when the GPU finished a region */
+    uint32_t   nStalls;                   /**< frames that had to wait for a fence */
+
+    /* written by the cull shader */
+    GLuint visible;
+    GLuint command;
+
+    /* cull shader */
+    GLuint cullProgram;
+    GLint  planesUniform;
+    GLint  countUniform;
+    GLint  radiusUniform;
+} Instancing;
+
+/**
+ * @brief Create buffers and compile cull shader, needs GL 4.4 or ARB_buffer_storage
+ *
+ * @param maxInstances [in] - instances per frame
+ * @param vao          [in] - vertex array of the mesh with its element buffer bound
+ * @param nIndices     [in] - indices of the mesh, GL_UNSIGNED_INT
+ * @param radius       [in] - radius of a sphere around the mesh origin containing all vertices
+ *
+ * @returns 0 on success else negative value
+ */
+int instancingInitialize(Instancing* pInstancing, uint32_t maxInstances, GLuint vao, uint32_t nIndices, float radius);
+
+/**
+ * @brief Move to the next region, waits if the GPU still reads it
+ *
+ * @returns maxInstances instances to be written by the caller
+ */
+Instance* instancingBeginFrame(Instancing* pInstancing);
+
+/**
+ * @brief Dispatch frustum culling of the first nInstances instances of this frame
+ *
+ * @param viewProjection [in] - projection * view, planes are extracted from it
+ */
+void instancingCull(Instancing* pInstancing, uint32_t nInstances, const vmath::mat4& viewProjection);
+
+/**
+ * @brief Draw visible instances, a program declaring INSTANCING_GLSL must be in use
+ */
+void instancingDraw(const Instancing* pInstancing);
+
+/**
+ * @brief Fence the current region, call after instancingDraw
+ */
+void instancingEndFrame(Instancing* pInstancing);
+
+/**
+ * @brief Read back visible instances of the last cull, stalls until the GPU is done
+ */
+uint32_t instancingVisibleCount(const Instancing* pInstancing);
+
+/**
+ * @brief Delete buffers and cull shader, waits for frames in flight
+ */
+void instancingUninitialize(Instancing* pInstancing);
+
+#endif // !INSTANCING_H
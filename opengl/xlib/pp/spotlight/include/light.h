@@ -140,19 +140,32 @@ struct Light
     }
 };
 
-struct LightUniform
+/**
+ * @brief std140 layout of Light in a uniform block
+ *
+ * A vec3 is aligned to 16 bytes in std140 and a following float fills the
+ * gap, so each vec3 is paired with one of the scalars. The GLSL struct has to
+ * declare the members in this order.
+ */
+struct LightBlock
 {
-    unsigned int position;  /**< Position uniform of light*/
-    unsigned int direction; /**< Direction uniform of light */
-    unsigned int ambient;   /**< Ambient uniform of light */
-    unsigned int diffuse;   /**< Diffuse uniform of light */
-    unsigned int specular;  /**< Specular uniform of light */
-    unsigned int constant;  /**< Specular uniform of light */
-    unsigned int linear;    /**< Specular uniform of light */
-    unsigned int quadratic; /**< Specular uniform of light */
-    unsigned int cutOff; /**< Specular uniform of light */
-    unsigned int outerCutOff; /**< Specular uniform of light */
-
+    vec3  position;
+    float constant;
+    vec3  direction;
+    float linear;
+    vec3  ambient;
+    float quadratic;
+    vec3  diffuse;
+    float cutOff;
+    vec3  specular;
+    float outerCutOff;
 };
 
+static_assert(sizeof(LightBlock) == 80, "LightBlock does not match std140");
+
+/**
+ * @brief Copy light into its uniform block layout
+ */
+void packLight(const Light* pLight, LightBlock* pBlock);
+
 #endif // !LIGHT_H
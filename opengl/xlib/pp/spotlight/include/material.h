@@ -67,12 +67,23 @@ struct Material
 
 };
 
-struct MaterialUniform
+/**
+ * @brief std140 layout of Material in a uniform block, padded to a vec4
+ */
+struct MaterialBlock
 {
-    unsigned int ambient;   /**< Ambient uniform of material */
-    unsigned int diffuse;   /**< Diffuse uniform of material */
-    unsigned int specular;  /**< Specular uniform of material */
-    unsigned int shininess; /**< Shininess uniform of material */
+    vec4  ambient;
+    vec4  diffuse;
+    vec4  specular;
+    float shininess;
+    float padding[3];
 };
 
+static_assert(sizeof(MaterialBlock) == 64, "MaterialBlock does not match std140");
+
+/**
+ * @brief Copy material into its uniform block layout
+ */
+void packMaterial(const Material* pMaterial, MaterialBlock* pBlock);
+
 #endif // !MATERIAL_H
@@ -0,0 +1,81 @@
+#ifndef RUNLOOP_H
+#define RUNLOOP_H
+
+/**
+ * @file    runloop.h
+ * @brief   Frame rate independent main loop for the xlib samples
+ *
+ * Simulation advances in fixed steps of RunLoop::step seconds however long a
+ * frame takes, display interpolates between the last two simulated states with
+ * runLoopAlpha(). Between frames the loop sleeps in poll() on the X connection
+ * until an event arrives or the next frame is due instead of spinning on
+ * XPending(). With vsync enabled the swap paces the loop and it never sleeps
+ * past a vblank.
+ */
+
+#include <X11/Xlib.h>
+#include <stdint.h>
+
+#define RUNLOOP_STEP_HZ     120.0 /**< simulation steps per second */
+#define RUNLOOP_DEFAULT_FPS 60.0  /**< frame limit when vsync is not available */
+#define RUNLOOP_MAX_STEPS   8U    /**< longer frames drop time, e.g. after a breakpoint */
+
+typedef struct RunLoop
+{
+    Display* dpy;
+    int      fd;            /**< X connection, ConnectionNumber(dpy) */
+    double   step;          /**< seconds per simulation step */
+    double   frameInterval; /**< minimum seconds between frames, 0 for no limit */
+    double   previous;      /**< time of previous runLoopBeginFrame */
+    double   accumulator;   /**< time not yet simulated */
+    double   nextFrame;     /**< deadline of next frame */
+    bool     bVsync;        /**< swap interval is set, swaps pace the loop */
+} RunLoop;
+
+/**
+ * @brief Seconds on the monotonic clock
+ */
+double runLoopNow(void);
+
+/**
+ * @brief Start clock
+ *
+ * @param dpy       [in] - display whose connection is polled for events
+ * @param targetFps [in] - frame limit without vsync, 0 for none
+ */
+void runLoopInitialize(RunLoop* pLoop, Display* dpy, double targetFps);
+
+/**
+ * @brief Set swap interval through GLX_EXT/MESA/SGI_swap_control, context must be current
+ *
+ * @returns true if one of the extensions is available
+ */
+bool runLoopEnableVsync(RunLoop* pLoop, Window window, int interval);
+
+/**
+ * @brief Wait for the next X event until the next frame is due
+ *
+ * @param bBlock [in] - wait for events only, e.g. while nothing is drawn
+ *
+ * @returns true if an event is ready for XNextEvent, false when it is time to draw
+ */
+bool runLoopWait(RunLoop* pLoop, bool bBlock);
+
+/**
+ * @brief Advance clock
+ *
+ * @returns number of fixed steps to simulate before drawing this frame
+ */
+uint32_t runLoopBeginFrame(RunLoop* pLoop);
+
+/**
+ * @brief Fraction of a step between the last simulated state and now, for interpolation
+ */
+float runLoopAlpha(const RunLoop* pLoop);
+
+/**
+ * @brief Schedule next frame, call after swapping buffers
+ */
+void runLoopEndFrame(RunLoop* pLoop);
+
+#endif // !RUNLOOP_H
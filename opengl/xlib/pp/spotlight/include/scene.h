@@ -0,0 +1,208 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+/**
+ * @file    scene.h
+ * @brief   Static objects in a bounding volume hierarchy, culled on the CPU before they reach the arena
+ *
+ * Every mesh gets an axis aligned box and a sphere around its vertices when it
+ * is added, every object the box of its mesh transformed to world space.
+ * sceneBuild sorts the objects into a binary tree of boxes, split at the
+ * median of the longest axis until SCENE_LEAF_SIZE objects remain. Culling
+ * walks the tree once per view: a node outside one plane of the frustum drops
+ * all its objects, a node inside all planes takes them without further tests.
+ * The planes are kept as structure of arrays so one box is tested against
+ * four planes per vmath::simd operation.
+ *
+ * The shadow passes share the queued draws, so sceneCull takes the light
+ * matrices too and orders draws as [camera only | both | shadow casters only].
+ * The camera pass draws the first two ranges, the shadow passes the last two.
+ *
+ * With occlusion enabled the depth buffer of a frame is reduced on the GPU to
+ * the farthest depth per SCENE_HIZ_TILE pixels and read back a few frames
+ * later without waiting. The CPU builds a max pyramid of it and rejects boxes
+ * whose nearest point lies behind every tile they cover, at the pyramid level
+ * where they cover 2x2 texels. The depth is from a past frame, with a moving
+ * camera objects may show up a frame late.
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+#include <vector>
+
+#include "arena.h"
+#include "model.h"
+#include "vmath.h"
+
+#define SCENE_LEAF_SIZE        4U  /**< objects per leaf of the hierarchy at most */
+#define SCENE_HIZ_TILE         16U /**< pixels per side of a texel of the finest occlusion level */
+#define SCENE_HIZ_FRAMES       3U  /**< depth readbacks in flight */
+#define SCENE_HIZ_TEXTURE_UNIT 2U  /**< texture unit of the depth copy during the reduction */
+#define SCENE_BINDING_HIZ      8U  /**< storage buffer binding of the reduced depth */
+
+/**
+ * @brief Axis aligned box
+ */
+struct SceneBounds
+{
+    vmath::vec3 min;
+    vmath::vec3 max;
+};
+
+/**
+ * @brief Mesh in the geometry arena with its bounds in model space
+ */
+struct SceneMesh
+{
+    int         arenaMesh; /**< index returned by arenaAddModel */
+    SceneBounds bounds;
+    vmath::vec4 sphere; /**< center xyz, radius w */
+};
+
+struct SceneObject
+{
+    int         mesh; /**< index returned by sceneAddMesh */
+    uint32_t    material;
+    vmath::mat4 modelMatrix;
+    SceneBounds bounds; /**< world space */
+};
+
+/**
+ * @brief Node of the hierarchy, depth first, the first child of an inner node is the next node
+ */
+struct SceneNode
+{
+    SceneBounds bounds;
+    uint32_t    first; /**< first entry of order in the subtree */
+    uint32_t    count; /**< objects in the subtree */
+    uint32_t    right; /**< index of the second child, 0 for a leaf */
+};
+
+/**
+ * @brief Reduced depth of one frame on its way back to the CPU
+ */
+struct SceneDepthReadback
+{
+    GLsync      fence; /**< signalled when the reduction finished */
+    vmath::mat4 viewProjection;
+    uint32_t    width; /**< pixels */
+    uint32_t    height;
+};
+
+typedef struct Scene
+{
+    std::vector<SceneMesh>   meshes;
+    std::vector<SceneObject> objects;
+    std::vector<SceneNode>   nodes;
+    std::vector<uint32_t>    order; /**< objects sorted into the leaves */
+    std::vector<uint8_t>     flags; /**< visibility of the current frame per object */
+
+    /* draws queued by sceneCull, in the arena */
+    uint32_t firstVisible; /**< first draw of the camera pass */
+    uint32_t nVisible;     /**< draws of the camera pass */
+    uint32_t firstCaster;  /**< first draw of the shadow passes */
+    uint32_t nCasters;     /**< draws of the shadow passes */
+
+    /* statistics of the last sceneCull */
+    uint32_t nFrustumCulled; /**< objects outside the view */
+    uint32_t nOccluded;      /**< objects in the view behind the depth of a past frame */
+    uint32_t nNodesVisited;
+    double   cullMs;
+    double   totalCullMs;
+    uint32_t nCulls;
+
+    /* occlusion against reduced depth of past frames */
+    bool               bOcclusion;
+    GLuint             reduceProgram;
+    GLint              sizeUniform;
+    GLint              offsetUniform;
+    GLuint             depthTexture; /**< copy of the depth buffer */
+    int                depthWidth;
+    int                depthHeight;
+    GLuint             readbackBuffer; /**< SCENE_HIZ_FRAMES regions of tiles */
+    float*             pReadback;      /**< persistent mapping of readbackBuffer */
+    uint32_t           regionTiles;    /**< floats per region */
+    uint32_t           region;         /**< region written by the next capture */
+    SceneDepthReadback readbacks[SCENE_HIZ_FRAMES];
+
+    /* max pyramid of the newest readback, level 0 first */
+    std::vector<float> pyramid;
+    uint32_t           levelOffsets[16];
+    uint32_t           levelWidths[16];
+    uint32_t           levelHeights[16];
+    uint32_t           nLevels; /**< 0 until a readback arrived */
+    SceneDepthReadback pyramidSource; /**< view the pyramid was drawn with, without fence */
+} Scene;
+
+/**
+ * @brief Start an empty scene
+ *
+ * @param bOcclusion [in] - also cull against the depth of past frames, needs GL 4.4 or ARB_buffer_storage
+ *
+ * @returns 0 on success else negative value
+ */
+int sceneInitialize(Scene* pScene, bool bOcclusion);
+
+/**
+ * @brief Bound a model that was added to the arena
+ *
+ * @param pModel    [in] - model loaded with loadModel
+ * @param arenaMesh [in] - index returned by arenaAddModel for it
+ *
+ * @returns index of mesh
+ */
+int sceneAddMesh(Scene* pScene, const Model* pModel, int arenaMesh);
+
+/**
+ * @brief Place a mesh in the world, call sceneBuild after the last one
+ *
+ * @param mesh        [in] - index returned by sceneAddMesh
+ * @param modelMatrix [in] - model to world transform
+ * @param material    [in] - index into the materials of the arena
+ *
+ * @returns index of object
+ */
+uint32_t sceneAddObject(Scene* pScene, int mesh, const vmath::mat4& modelMatrix, uint32_t material);
+
+/**
+ * @brief Move an object, call sceneRefit after the last one of a frame
+ */
+void sceneSetTransform(Scene* pScene, uint32_t object, const vmath::mat4& modelMatrix);
+
+/**
+ * @brief Build the hierarchy from scratch
+ */
+void sceneBuild(Scene* pScene);
+
+/**
+ * @brief Grow and shrink the boxes of the hierarchy to moved objects, keeps its structure
+ */
+void sceneRefit(Scene* pScene);
+
+/**
+ * @brief Queue the draws of visible objects and shadow casters, after arenaBeginFrame
+ *
+ * @param viewProjection  [in] - projection * view of the camera
+ * @param pCasterMatrices [in] - projection * view of the light per shadow pass, may be nullptr
+ * @param nCasterMatrices [in] - entries of pCasterMatrices
+ */
+void sceneCull(Scene* pScene, GeometryArena* pArena, const vmath::mat4& viewProjection, const vmath::mat4* pCasterMatrices,
+               uint32_t nCasterMatrices);
+
+/**
+ * @brief Reduce the depth of the frame drawn so far for the occlusion tests of later frames
+ *
+ * Reads the depth of the bound read framebuffer, does nothing without occlusion.
+ *
+ * @param viewProjection [in] - projection * view the depth was drawn with
+ * @param width          [in] - width of the depth buffer
+ * @param height         [in] - height of the depth buffer
+ */
+void sceneCaptureDepth(Scene* pScene, const vmath::mat4& viewProjection, int width, int height);
+
+/**
+ * @brief Delete programs, textures and buffers
+ */
+void sceneUninitialize(Scene* pScene);
+
+#endif // !SCENE_H
@@ -0,0 +1,154 @@
+#ifndef SHADOWMAP_H
+#define SHADOWMAP_H
+
+/**
+ * @file    shadowmap.h
+ * @brief   Shadow maps of a spot or directional light with PCF and cascades
+ *
+ * Depth of the occluders is rendered from the light into the layers of one
+ * depth texture array, one extra depth only pass per layer, and every
+ * receiver looks itself up in it, whatever its shape. A spot light uses one
+ * layer with a perspective projection around its cone. A directional light
+ * splits the view frustum into up to SHADOW_MAX_CASCADES depth ranges and
+ * fits an orthographic projection around each, so near receivers get as many
+ * texels as far ones. Cascades are fitted to a bounding sphere and snapped to
+ * whole texels, the map does not shimmer when the camera turns or moves.
+ *
+ * The texture compares in hardware with linear filtering (2x2 PCF per tap),
+ * the shader takes a 3x3 grid of taps. Besides a slope scaled polygon offset
+ * in the depth pass the receiver moves its lookup a texel and a half along its
+ * normal, which keeps curved surfaces free of acne without detaching shadows.
+ * Shaders declare the lookup with SHADOWMAP_GLSL and multiply the direct light
+ * with shadowFactor().
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+
+#include "vmath.h"
+
+#define SHADOW_MAX_CASCADES  4U /**< layers of the depth texture array */
+#define SHADOW_TEXTURE_UNIT  1U /**< texture unit of the depth texture array */
+#define SHADOW_BINDING_BLOCK 1U /**< uniform block binding of ShadowBlock */
+
+/* GLSL of the shadow lookup, std140 layout of ShadowBlock */
+#define SHADOWMAP_GLSL                                                                                               \
+    "layout(std140, binding = 1) uniform ShadowBlock"                                                                \
+    "{"                                                                                                              \
+    "    mat4 uShadowMatrices[4];"                                                                                   \
+    "    vec4 uShadowSplits;"                                                                                        \
+    "    vec4 uShadowTexels;"                                                                                        \
+    "    vec4 uShadowParams;"                                                                                        \
+    "};"                                                                                                             \
+    "layout(binding = 1) uniform sampler2DArrayShadow uShadowMap;"                                                   \
+    "\n"                                                                                                             \
+    "float shadowFactor(vec3 worldPosition, vec3 normal, float viewDepth)"                                           \
+    "{"                                                                                                              \
+    "    int cascade = 0;"                                                                                           \
+    "    for (int i = 0; i < int(uShadowParams.x) - 1; ++i)"                                                         \
+    "        cascade += (viewDepth > uShadowSplits[i]) ? 1 : 0;"                                                     \
+    "\n"                                                                                                             \
+    "    float texel    = uShadowTexels[cascade] * (uShadowMatrices[cascade] * vec4(worldPosition, 1.0)).w;"         \
+    "    vec4  position = uShadowMatrices[cascade] * vec4(worldPosition + normal * 1.5 * texel, 1.0);"               \
+    "    position.xyz /= position.w;"                                                                                \
+    "    if (any(lessThan(position.xyz, vec3(0.0))) || any(greaterThan(position.xyz, vec3(1.0))))"                   \
+    "        return 1.0;"                                                                                            \
+    "\n"                                                                                                             \
+    "    float lit = 0.0;"                                                                                           \
+    "    for (int y = -1; y <= 1; ++y)"                                                                              \
+    "        for (int x = -1; x <= 1; ++x)"                                                                          \
+    "            lit += texture(uShadowMap, vec4(position.xy + vec2(x, y) * uShadowParams.y, cascade, position.z));" \
+    "    return lit / 9.0;"                                                                                          \
+    "}"                                                                                                              \
+    "\n"
+
+/**
+ * @brief std140 layout of the uniform block read by SHADOWMAP_GLSL
+ */
+struct ShadowBlock
+{
+    vmath::mat4 matrices[SHADOW_MAX_CASCADES]; /**< world to shadow texture coordinates and depth, 0 to 1 */
+    vmath::vec4 splits;                        /**< view depth where each cascade ends */
+    vmath::vec4 texels;                        /**< world size of a texel per cascade, at distance 1 for a spot light */
+    vmath::vec4 params;                        /**< cascades in use, texel size, unused, unused */
+};
+
+static_assert(sizeof(ShadowBlock) == 304, "ShadowBlock does not match std140");
+
+typedef struct ShadowMap
+{
+    GLsizei  size;      /**< width and height of each layer */
+    uint32_t nCascades; /**< layers in use */
+    GLuint   texture;   /**< GL_TEXTURE_2D_ARRAY of depth */
+    GLuint   fbo;
+
+    /* state restored by shadowMapEnd */
+    GLint previousFramebuffer;
+    GLint previousViewport[4];
+
+    vmath::mat4 lightMatrices[SHADOW_MAX_CASCADES]; /**< projection * view of the light per cascade, for the depth pass */
+    ShadowBlock block;                               /**< lookup data of the receivers */
+} ShadowMap;
+
+/**
+ * @brief Create depth texture array and framebuffer
+ *
+ * @param size      [in] - width and height of a layer in texels
+ * @param nCascades [in] - layers, 1 for a spot light, up to SHADOW_MAX_CASCADES for a directional one
+ *
+ * @returns 0 on success else negative value
+ */
+int shadowMapInitialize(ShadowMap* pShadowMap, GLsizei size, uint32_t nCascades);
+
+/**
+ * @brief Fit the first layer to the cone of a spot light
+ *
+ * @param position    [in] - world position of the light
+ * @param direction   [in] - direction of the cone axis
+ * @param outerCutOff [in] - cosine of the half angle of the cone
+ * @param range       [in] - distance beyond which nothing casts or receives
+ */
+void shadowMapUpdateSpot(ShadowMap* pShadowMap, const vmath::vec3& position, const vmath::vec3& direction, float outerCutOff, float range);
+
+/**
+ * @brief Split the view frustum into cascades and fit one layer to each
+ *
+ * @param direction      [in] - direction the light travels in
+ * @param viewMatrix     [in] - world to view transform of the camera
+ * @param fovy           [in] - vertical field of view of the camera in degrees
+ * @param aspect         [in] - width / height of the camera
+ * @param zNear          [in] - near plane of the camera
+ * @param shadowDistance [in] - view depth beyond which receivers are not shadowed
+ * @param casterDistance [in] - how far beyond a cascade towards the light occluders are caught
+ */
+void shadowMapUpdateDirectional(ShadowMap* pShadowMap, const vmath::vec3& direction, const vmath::mat4& viewMatrix, float fovy, float aspect,
+                                float zNear, float shadowDistance, float casterDistance);
+
+/**
+ * @brief Start the depth passes, binds framebuffer and viewport of the shadow map
+ */
+void shadowMapBegin(ShadowMap* pShadowMap);
+
+/**
+ * @brief Render into a layer from here on, clears its depth
+ *
+ * @returns light projection * view of the cascade, for the depth only program of the caller
+ */
+const vmath::mat4& shadowMapBeginCascade(ShadowMap* pShadowMap, uint32_t cascade);
+
+/**
+ * @brief Restore framebuffer and viewport bound before shadowMapBegin
+ */
+void shadowMapEnd(ShadowMap* pShadowMap);
+
+/**
+ * @brief Bind the depth texture array for programs declaring SHADOWMAP_GLSL, ShadowBlock is bound by the caller
+ */
+void shadowMapBind(const ShadowMap* pShadowMap);
+
+/**
+ * @brief Delete texture and framebuffer
+ */
+void shadowMapUninitialize(ShadowMap* pShadowMap);
+
+#endif // !SHADOWMAP_H
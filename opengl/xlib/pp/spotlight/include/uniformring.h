@@ -0,0 +1,69 @@
+#ifndef UNIFORMRING_H
+#define UNIFORMRING_H
+
+/**
+ * @file    uniformring.h
+ * @brief   Per frame uniform data in a persistently mapped ring buffer
+ *
+ * One buffer is created with glBufferStorage and mapped once for the lifetime
+ * of the ring. It is split into UNIFORM_RING_FRAMES regions, a frame writes
+ * its uniform blocks into the next region with plain memcpy and binds each
+ * with glBindBufferRange, there is no glUniform* or glBufferSubData call per
+ * draw. A fence is placed at the end of the frame, a region is only reused
+ * when the GPU is done with the frame that wrote it, which with three regions
+ * happens only when the CPU runs more than two frames ahead.
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+
+#define UNIFORM_RING_FRAMES 3U /**< regions, frames the CPU may run ahead of the GPU */
+
+typedef struct UniformRing
+{
+    GLuint     buffer;
+    uint8_t*   pMapped;                     /**< persistent, coherent mapping of buffer */
+    GLsizeiptr regionSize;                  /**< bytes available to one frame */
+    GLint      alignment;                   /**< GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT */
+    uint32_t   region;                      /**< region of current frame */
+    GLsizeiptr offset;                      /**< first free byte in region */
+    GLsync     fences[UNIFORM_RING_FRAMES]; /**< signalled when the GPU finished a region */
+    uint32_t   nStalls;                     /**< frames that had to wait for a fence */
+} UniformRing;
+
+/**
+ * @brief Create and map buffer, needs GL 4.4 or ARB_buffer_storage
+ *
+ * @param regionSize [in] - bytes of uniform data per frame, including alignment of each block
+ *
+ * @returns 0 on success else negative value
+ */
+int uniformRingInitialize(UniformRing* pRing, GLsizeiptr regionSize);
+
+/**
+ * @brief Move to the next region, waits if the GPU still reads it
+ */
+void uniformRingBeginFrame(UniformRing* pRing);
+
+/**
+ * @brief Copy a uniform block into the current region and bind it
+ *
+ * @param binding [in] - binding point of the block, layout(binding = N) in GLSL
+ * @param pData   [in] - block in std140 layout
+ * @param size    [in] - bytes of block
+ *
+ * @returns false if the region is full, the previous binding is left in place
+ */
+bool uniformRingBind(UniformRing* pRing, GLuint binding, const void* pData, GLsizeiptr size);
+
+/**
+ * @brief Fence the current region, call after the last draw of the frame
+ */
+void uniformRingEndFrame(UniformRing* pRing);
+
+/**
+ * @brief Unmap and delete buffer, waits for frames in flight
+ */
+void uniformRingUninitialize(UniformRing* pRing);
+
+#endif // !UNIFORMRING_H
@@ -0,0 +1,195 @@
+#include <stdio.h>
+
+#include "arena.h"
+
+/* same attribute locations as the programs of main.cpp */
+#define ARENA_ATTRIBUTE_POSITION 0U
+#define ARENA_ATTRIBUTE_UVS      2U
+#define ARENA_ATTRIBUTE_NORMALS  3U
+
+int arenaInitialize(GeometryArena* pArena, uint32_t maxVertices, uint32_t maxIndices, uint32_t maxDraws)
+{
+    pArena->maxVertices = maxVertices;
+    pArena->maxIndices  = maxIndices;
+    pArena->maxDraws    = maxDraws;
+    pArena->nVertices   = 0U;
+    pArena->nIndices    = 0U;
+    pArena->bUploaded   = false;
+    pArena->meshes.clear();
+    pArena->commands.reserve(maxDraws);
+    pArena->records.reserve(maxDraws);
+
+    glGenVertexArrays(1, &pArena->vao);
+    glBindVertexArray(pArena->vao);
+
+    /* immutable storage, models are copied in with glBufferSubData */
+    glGenBuffers(1, &pArena->vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, pArena->vertices);
+    glBufferStorage(GL_ARRAY_BUFFER, sizeof(Vertex) * maxVertices, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    glVertexAttribPointer(ARENA_ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+    glEnableVertexAttribArray(ARENA_ATTRIBUTE_POSITION);
+
+    glVertexAttribPointer(ARENA_ATTRIBUTE_NORMALS, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(ARENA_ATTRIBUTE_NORMALS);
+
+    glVertexAttribPointer(ARENA_ATTRIBUTE_UVS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texel));
+    glEnableVertexAttribArray(ARENA_ATTRIBUTE_UVS);
+    glBindBuffer(GL_ARRAY_BUFFER, 0U);
+
+    glGenBuffers(1, &pArena->indices);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pArena->indices);
+    glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * maxIndices, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    /* vertex array first, it keeps the element buffer binding */
+    glBindVertexArray(0U);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0U);
+
+    /* per frame data is orphaned and rewritten by arenaDraw */
+    glGenBuffers(1, &pArena->commandBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pArena->commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * maxDraws, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0U);
+
+    glGenBuffers(1, &pArena->recordBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pArena->recordBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawRecord) * maxDraws, nullptr, GL_STREAM_DRAW);
+
+    glGenBuffers(1, &pArena->materialBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+
+    GLenum error = glGetError();
+    if (GL_NO_ERROR != error)
+    {
+        fprintf(stderr, "%s: failed to create arena buffers, error 0x%x\n", __func__, error);
+        arenaUninitialize(pArena);
+        return -1;
+    }
+    return 0;
+}
+
+int arenaAddModel(GeometryArena* pArena, const Model* pModel)
+{
+    if (pArena->maxVertices - pArena->nVertices < pModel->header.nVertices || pArena->maxIndices - pArena->nIndices < pModel->header.nIndices)
+    {
+        fprintf(stderr, "%s: no room for %s, %u vertices and %u indices\n", __func__, pModel->header.name, pModel->header.nVertices,
+                pModel->header.nIndices);
+        return -1;
+    }
+
+    /* indices stay relative to the model, baseVertex moves them */
+    ArenaMesh mesh = {pArena->nIndices, pModel->header.nIndices, (int32_t)pArena->nVertices, pModel->header.nVertices};
+
+    glBindBuffer(GL_ARRAY_BUFFER, pArena->vertices);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(Vertex) * mesh.baseVertex, sizeof(Vertex) * mesh.nVertices, pModel->pVertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0U);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pArena->indices);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(uint32_t) * mesh.firstIndex, sizeof(uint32_t) * mesh.nIndices, pModel->pIndices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0U);
+
+    pArena->nVertices += mesh.nVertices;
+    pArena->nIndices += mesh.nIndices;
+    pArena->meshes.push_back(mesh);
+    return (int)pArena->meshes.size() - 1;
+}
+
+void arenaSetMaterials(GeometryArena* pArena, const MaterialBlock* pMaterials, uint32_t nMaterials)
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pArena->materialBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(MaterialBlock) * nMaterials, pMaterials, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+}
+
+void arenaBeginFrame(GeometryArena* pArena)
+{
+    pArena->commands.clear();
+    pArena->records.clear();
+    pArena->bUploaded = false;
+}
+
+bool arenaAddDraw(GeometryArena* pArena, int mesh, const vmath::mat4& modelMatrix, uint32_t material)
+{
+    if (pArena->maxDraws <= pArena->commands.size())
+        return false;
+
+    /* a failed arenaAddModel returns a negative index, anything else out of the table is a caller bug */
+    if (0 > mesh || pArena->meshes.size() <= (size_t)mesh)
+    {
+        fprintf(stderr, "%s: mesh %d out of %zu meshes, draw dropped\n", __func__, mesh, pArena->meshes.size());
+        return false;
+    }
+
+    const ArenaMesh&            arenaMesh = pArena->meshes[mesh];
+    DrawElementsIndirectCommand command   = {arenaMesh.nIndices, 1U, arenaMesh.firstIndex, arenaMesh.baseVertex, (uint32_t)pArena->records.size()};
+    pArena->commands.push_back(command);
+    pArena->bUploaded = false;
+
+    DrawRecord   record       = {};
+    vmath::mat3  normalMatrix = vmath::inverseTranspose3x3(modelMatrix);
+    record.modelMatrix        = modelMatrix;
+    for (int column = 0; column < 3; ++column)
+    {
+        record.normalMatrix[column] = vmath::vec4(normalMatrix[column], 0.0f);
+    }
+    record.material = material;
+    pArena->records.push_back(record);
+    return true;
+}
+
+void arenaDraw(GeometryArena* pArena)
+{
+    arenaDrawRange(pArena, 0U, (uint32_t)pArena->commands.size());
+}
+
+void arenaDrawRange(GeometryArena* pArena, uint32_t first, uint32_t count)
+{
+    GLsizei nDraws = (GLsizei)pArena->commands.size();
+    if (0 == nDraws || 0U == count)
+        return;
+
+    /* orphan, a draw of the previous frame may still read the old contents */
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pArena->commandBuffer);
+    if (!pArena->bUploaded)
+    {
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * pArena->maxDraws, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawElementsIndirectCommand) * nDraws, pArena->commands.data());
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pArena->recordBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawRecord) * pArena->maxDraws, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DrawRecord) * nDraws, pArena->records.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+        pArena->bUploaded = true;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ARENA_BINDING_DRAWS, pArena->recordBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ARENA_BINDING_MATERIALS, pArena->materialBuffer);
+
+    glBindVertexArray(pArena->vao);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(sizeof(DrawElementsIndirectCommand) * first), (GLsizei)count, 0);
+    glBindVertexArray(0U);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0U);
+}
+
+void arenaUninitialize(GeometryArena* pArena)
+{
+    if (0U != pArena->vao)
+    {
+        glDeleteVertexArrays(1, &pArena->vao);
+        pArena->vao = 0U;
+    }
+
+    GLuint* pBuffers[] = {&pArena->vertices, &pArena->indices, &pArena->commandBuffer, &pArena->recordBuffer, &pArena->materialBuffer};
+    for (size_t i = 0; i < sizeof(pBuffers) / sizeof(pBuffers[0]); ++i)
+    {
+        if (0U != *pBuffers[i])
+        {
+            glDeleteBuffers(1, pBuffers[i]);
+            *pBuffers[i] = 0U;
+        }
+    }
+
+    pArena->meshes.clear();
+    pArena->commands.clear();
+    pArena->records.clear();
+}
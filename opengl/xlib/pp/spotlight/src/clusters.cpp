@@ -0,0 +1,221 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "clusters.h"
+
+#define CLUSTERS_COUNT       (CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z)
+#define CLUSTERS_GRID_HEADER 8U /**< words of clusterCount and clusterScale before the lists */
+
+static inline uint32_t clampCell(float value, uint32_t count)
+{
+    if (value <= 0.0f)
+        return 0U;
+    return (value < (float)count) ? (uint32_t)value : count - 1U;
+}
+
+int clustersInitialize(LightClusters* pClusters, uint32_t maxLights, uint32_t maxIndices)
+{
+    /* buffers bound to a binding point must not be empty */
+    pClusters->maxLights  = (0U < maxLights) ? maxLights : 1U;
+    pClusters->maxIndices = (0U < maxIndices) ? maxIndices : 1U;
+    pClusters->nVisible   = 0U;
+    pClusters->maxCount   = 0U;
+    pClusters->nDropped   = 0U;
+    pClusters->lights.assign(pClusters->maxLights, PointLight{});
+    pClusters->grid.assign(CLUSTERS_GRID_HEADER + 2U * CLUSTERS_COUNT, 0U);
+    pClusters->indices.reserve(pClusters->maxIndices);
+    pClusters->ranges.reserve(6U * pClusters->maxLights);
+
+    glGenBuffers(1, &pClusters->lightBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pClusters->lightBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(PointLight) * pClusters->maxLights, nullptr, GL_STREAM_DRAW);
+
+    glGenBuffers(1, &pClusters->gridBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pClusters->gridBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * pClusters->grid.size(), nullptr, GL_STREAM_DRAW);
+
+    glGenBuffers(1, &pClusters->indexBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pClusters->indexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * pClusters->maxIndices, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+
+    GLenum error = glGetError();
+    if (GL_NO_ERROR != error)
+    {
+        fprintf(stderr, "%s: failed to create cluster buffers, error 0x%x\n", __func__, error);
+        clustersUninitialize(pClusters);
+        return -1;
+    }
+    return 0;
+}
+
+PointLight* clustersBeginFrame(LightClusters* pClusters)
+{
+    return pClusters->lights.data();
+}
+
+void clustersBuild(LightClusters* pClusters, uint32_t nLights, const vmath::mat4& viewMatrix, const vmath::mat4& projectionMatrix, float zNear,
+                   float zFar, int width, int height)
+{
+    if (pClusters->maxLights < nLights)
+        nLights = pClusters->maxLights;
+
+    /* froxel of a view depth d is log(d) * sliceScale + sliceBias */
+    float tileWidth  = (float)width / (float)CLUSTERS_X;
+    float tileHeight = (float)height / (float)CLUSTERS_Y;
+    float sliceScale = (float)CLUSTERS_Z / logf(zFar / zNear);
+    float sliceBias  = -logf(zNear) * sliceScale;
+
+    uint32_t* pGrid = pClusters->grid.data();
+    pGrid[0]        = CLUSTERS_X;
+    pGrid[1]        = CLUSTERS_Y;
+    pGrid[2]        = CLUSTERS_Z;
+    pGrid[3]        = 0U;
+    float header[4] = {tileWidth, tileHeight, sliceScale, sliceBias};
+    memcpy(&pGrid[4], header, sizeof(header));
+
+    uint32_t* pCounts = pGrid + CLUSTERS_GRID_HEADER;
+    for (uint32_t cluster = 0U; cluster < CLUSTERS_COUNT; ++cluster)
+    {
+        pCounts[2U * cluster + 1U] = 0U;
+    }
+
+    /* first pass, froxel range of every light and count per froxel */
+    pClusters->ranges.clear();
+    pClusters->nVisible = 0U;
+    for (uint32_t i = 0U; i < nLights; ++i)
+    {
+        const PointLight& light  = pClusters->lights[i];
+        float             radius = light.positionRadius[3];
+        vmath::vec4       center = viewMatrix * vmath::vec4(light.positionRadius[0], light.positionRadius[1], light.positionRadius[2], 1.0f);
+        float             depth  = -center[2];
+        if (depth + radius < zNear || depth - radius > zFar)
+        {
+            pClusters->ranges.insert(pClusters->ranges.end(), {1U, 0U, 0U, 0U, 0U, 0U});
+            continue;
+        }
+
+        uint32_t zMin = clampCell(logf(fmaxf(depth - radius, zNear)) * sliceScale + sliceBias, CLUSTERS_Z);
+        uint32_t zMax = clampCell(logf(fminf(depth + radius, zFar)) * sliceScale + sliceBias, CLUSTERS_Z);
+
+        /* project the box around the sphere, a sphere reaching the near plane may cover the whole screen */
+        float xMin = 0.0f, xMax = (float)width, yMin = 0.0f, yMax = (float)height;
+        if (depth - radius > zNear)
+        {
+            xMin = yMin = 1.0f;
+            xMax = yMax = -1.0f;
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                vmath::vec4 position = projectionMatrix * vmath::vec4(center[0] + ((corner & 1) ? radius : -radius),
+                                                                      center[1] + ((corner & 2) ? radius : -radius),
+                                                                      center[2] + ((corner & 4) ? radius : -radius), 1.0f);
+                float       x        = position[0] / position[3];
+                float       y        = position[1] / position[3];
+                xMin = fminf(xMin, x);
+                xMax = fmaxf(xMax, x);
+                yMin = fminf(yMin, y);
+                yMax = fmaxf(yMax, y);
+            }
+            if (xMax < -1.0f || xMin > 1.0f || yMax < -1.0f || yMin > 1.0f)
+            {
+                pClusters->ranges.insert(pClusters->ranges.end(), {1U, 0U, 0U, 0U, 0U, 0U});
+                continue;
+            }
+
+            /* gl_FragCoord has its origin at the bottom left, like normalized device coordinates */
+            xMin = (xMin * 0.5f + 0.5f) * (float)width;
+            xMax = (xMax * 0.5f + 0.5f) * (float)width;
+            yMin = (yMin * 0.5f + 0.5f) * (float)height;
+            yMax = (yMax * 0.5f + 0.5f) * (float)height;
+        }
+
+        uint32_t range[6] = {clampCell(xMin / tileWidth, CLUSTERS_X), clampCell(xMax / tileWidth, CLUSTERS_X),
+                             clampCell(yMin / tileHeight, CLUSTERS_Y), clampCell(yMax / tileHeight, CLUSTERS_Y), zMin, zMax};
+        pClusters->ranges.insert(pClusters->ranges.end(), range, range + 6);
+        ++pClusters->nVisible;
+
+        for (uint32_t z = range[4]; z <= range[5]; ++z)
+            for (uint32_t y = range[2]; y <= range[3]; ++y)
+                for (uint32_t x = range[0]; x <= range[1]; ++x)
+                    ++pCounts[2U * ((z * CLUSTERS_Y + y) * CLUSTERS_X + x) + 1U];
+    }
+
+    /* offsets of the lists, lists past maxIndices are cut short */
+    uint32_t offset     = 0U;
+    pClusters->maxCount = 0U;
+    pClusters->nDropped = 0U;
+    for (uint32_t cluster = 0U; cluster < CLUSTERS_COUNT; ++cluster)
+    {
+        uint32_t count = pCounts[2U * cluster + 1U];
+        if (pClusters->maxCount < count)
+            pClusters->maxCount = count;
+        if (pClusters->maxIndices - offset < count)
+        {
+            pClusters->nDropped += count - (pClusters->maxIndices - offset);
+            count = pClusters->maxIndices - offset;
+        }
+        pCounts[2U * cluster]      = offset;
+        pCounts[2U * cluster + 1U] = 0U;
+        offset += count;
+    }
+    pClusters->indices.assign(offset, 0U);
+
+    /* second pass, append each light to its froxels, count is the fill level until the end */
+    uint32_t* pIndices = pClusters->indices.data();
+    for (uint32_t i = 0U; i < nLights; ++i)
+    {
+        const uint32_t* range = &pClusters->ranges[6U * i];
+        for (uint32_t z = range[4]; z <= range[5]; ++z)
+            for (uint32_t y = range[2]; y <= range[3]; ++y)
+                for (uint32_t x = range[0]; x <= range[1]; ++x)
+                {
+                    uint32_t cluster = (z * CLUSTERS_Y + y) * CLUSTERS_X + x;
+                    uint32_t slot    = pCounts[2U * cluster] + pCounts[2U * cluster + 1U];
+                    uint32_t end     = (cluster + 1U < CLUSTERS_COUNT) ? pCounts[2U * (cluster + 1U)] : offset;
+                    if (slot < end)
+                    {
+                        pIndices[slot] = i;
+                        ++pCounts[2U * cluster + 1U];
+                    }
+                }
+    }
+
+    /* orphan, a draw of the previous frame may still read the old contents */
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pClusters->lightBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(PointLight) * pClusters->maxLights, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(PointLight) * nLights, pClusters->lights.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pClusters->gridBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * pClusters->grid.size(), pClusters->grid.data(), GL_STREAM_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pClusters->indexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * pClusters->maxIndices, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(uint32_t) * offset, pIndices);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+}
+
+void clustersBind(const LightClusters* pClusters)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTERS_BINDING_LIGHTS, pClusters->lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTERS_BINDING_GRID, pClusters->gridBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTERS_BINDING_INDICES, pClusters->indexBuffer);
+}
+
+void clustersUninitialize(LightClusters* pClusters)
+{
+    GLuint* pBuffers[] = {&pClusters->lightBuffer, &pClusters->gridBuffer, &pClusters->indexBuffer};
+    for (size_t i = 0; i < sizeof(pBuffers) / sizeof(pBuffers[0]); ++i)
+    {
+        if (0U != *pBuffers[i])
+        {
+            glDeleteBuffers(1, pBuffers[i]);
+            *pBuffers[i] = 0U;
+        }
+    }
+
+    pClusters->lights.clear();
+    pClusters->grid.clear();
+    pClusters->indices.clear();
+    pClusters->ranges.clear();
+}
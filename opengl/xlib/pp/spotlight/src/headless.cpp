@@ -0,0 +1,311 @@
+/**
+ * @file
+ *   headless.cpp
+ *
+ * @brief
+ *   Definations of functions declared in headless.h
+ */
+
+#include <algorithm>
+#include <string.h>
+#include <time.h>
+
+#include "headless.h"
+
+#include <EGL/eglext.h>
+
+static double nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static bool hasExtension(const char* pExtensions, const char* pName)
+{
+    size_t length = strlen(pName);
+    for (const char* p = pExtensions; NULL != p && NULL != (p = strstr(p, pName)); p += length)
+    {
+        if ((p == pExtensions || ' ' == p[-1]) && (' ' == p[length] || '\0' == p[length]))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Surfaceless platform if available, else first EGL device, else the default display
+ */
+static EGLDisplay getDisplay(void)
+{
+    const char* pExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (NULL != eglGetPlatformDisplayEXT && hasExtension(pExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        return eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+
+    PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+    if (NULL != eglGetPlatformDisplayEXT && NULL != eglQueryDevicesEXT && hasExtension(pExtensions, "EGL_EXT_platform_device"))
+    {
+        EGLDeviceEXT device   = NULL;
+        EGLint       nDevices = 0;
+        if (EGL_TRUE == eglQueryDevicesEXT(1, &device, &nDevices) && 0 < nDevices)
+            return eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, device, NULL);
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+int headlessInitialize(Headless* pHeadless, int width, int height)
+{
+    EGLint major = 0;
+    EGLint minor = 0;
+
+    pHeadless->width   = width;
+    pHeadless->height  = height;
+    pHeadless->display = getDisplay();
+    if (EGL_NO_DISPLAY == pHeadless->display || EGL_TRUE != eglInitialize(pHeadless->display, &major, &minor))
+    {
+        fprintf(stderr, "%s: failed to initialize EGL display 0x%x\n", __func__, eglGetError());
+        return -1;
+    }
+
+    if (EGL_TRUE != eglBindAPI(EGL_OPENGL_API))
+    {
+        fprintf(stderr, "%s: EGL %d.%d does not support desktop OpenGL\n", __func__, major, minor);
+        headlessUninitialize(pHeadless);
+        return -1;
+    }
+
+    /* no surface is ever created, any config renders into the FBO */
+    EGLConfig   config      = (EGLConfig)0; // EGL_NO_CONFIG_KHR
+    const char* pExtensions = eglQueryString(pHeadless->display, EGL_EXTENSIONS);
+    if (!hasExtension(pExtensions, "EGL_KHR_no_config_context"))
+    {
+        // clang-format off
+        const EGLint configAttributes[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        // clang-format on
+        EGLint nConfigs = 0;
+        if (EGL_TRUE != eglChooseConfig(pHeadless->display, configAttributes, &config, 1, &nConfigs) || 0 == nConfigs)
+        {
+            fprintf(stderr, "%s: no OpenGL capable EGL config\n", __func__);
+            headlessUninitialize(pHeadless);
+            return -1;
+        }
+    }
+
+    /* without attributes Mesa hands out its highest compatibility profile, which may be older than the shaders */
+    // clang-format off
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION,       HEADLESS_GL_MAJOR,
+        EGL_CONTEXT_MINOR_VERSION,       HEADLESS_GL_MINOR,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    // clang-format on
+    pHeadless->context = eglCreateContext(pHeadless->display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (EGL_NO_CONTEXT == pHeadless->context || EGL_TRUE != eglMakeCurrent(pHeadless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, pHeadless->context))
+    {
+        fprintf(stderr, "%s: failed to create OpenGL %d.%d core surfaceless context 0x%x\n", __func__, HEADLESS_GL_MAJOR, HEADLESS_GL_MINOR,
+                eglGetError());
+        headlessUninitialize(pHeadless);
+        return -1;
+    }
+
+    /* an implementation may still return an older context, e.g. when the attributes are ignored */
+    GLint glMajor = 0;
+    GLint glMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &glMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &glMinor);
+    if (glMajor < HEADLESS_GL_MAJOR || (glMajor == HEADLESS_GL_MAJOR && glMinor < HEADLESS_GL_MINOR))
+    {
+        fprintf(stderr, "%s: OpenGL %d.%d needed, the context is %s\n", __func__, HEADLESS_GL_MAJOR, HEADLESS_GL_MINOR,
+                (const char*)glGetString(GL_VERSION));
+        headlessUninitialize(pHeadless);
+        return -1;
+    }
+
+    /* GLEW also looks for GLX, which an EGL context does not have */
+    glewExperimental = GL_TRUE;
+    GLenum res       = glewInit();
+    if (GLEW_OK != res && GLEW_ERROR_NO_GLX_DISPLAY != res)
+    {
+        fprintf(stderr, "%s: failed to initialize glew\n", __func__);
+        headlessUninitialize(pHeadless);
+        return -1;
+    }
+
+    glGenRenderbuffers(1, &pHeadless->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, pHeadless->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &pHeadless->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, pHeadless->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0U);
+
+    glGenFramebuffers(1, &pHeadless->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, pHeadless->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, pHeadless->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, pHeadless->depth);
+    if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER))
+    {
+        fprintf(stderr, "%s: offscreen framebuffer is incomplete\n", __func__);
+        headlessUninitialize(pHeadless);
+        return -1;
+    }
+
+    glGenBuffers(2, pHeadless->pbo);
+    for (int idx = 0; idx < 2; ++idx)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pHeadless->pbo[idx]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0U);
+
+    glGenQueries(HEADLESS_QUERY_LATENCY, pHeadless->queries);
+    pHeadless->pixels.resize((size_t)width * height * 4U);
+
+    fprintf(stdout, "%s: EGL %d.%d, %s, %s, %dx%d\n", __func__, major, minor, glGetString(GL_RENDERER), glGetString(GL_VERSION), width, height);
+    return 0;
+}
+
+void headlessBeginFrame(Headless* pHeadless)
+{
+    pHeadless->frameStart = nowMs();
+    glBindFramebuffer(GL_FRAMEBUFFER, pHeadless->fbo);
+    glBeginQuery(GL_TIME_ELAPSED, pHeadless->queries[pHeadless->frame % HEADLESS_QUERY_LATENCY]);
+}
+
+/**
+ * @brief Collect timer query of an earlier frame, waits if it is not ready
+ */
+static void collectQuery(Headless* pHeadless, uint32_t frame)
+{
+    GLuint64 elapsed = 0U;
+    glGetQueryObjectui64v(pHeadless->queries[frame % HEADLESS_QUERY_LATENCY], GL_QUERY_RESULT, &elapsed);
+    if (0U < frame)
+        pHeadless->gpuTimes.push_back((double)elapsed / 1000000.0);
+}
+
+/**
+ * @brief Copy frame out of its pixel buffer
+ */
+static void collectPixels(Headless* pHeadless, uint32_t frame)
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pHeadless->pbo[frame & 1U]);
+    void* pData = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (NULL != pData)
+    {
+        memcpy(pHeadless->pixels.data(), pData, pHeadless->pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0U);
+}
+
+void headlessEndFrame(Headless* pHeadless)
+{
+    uint32_t frame = pHeadless->frame;
+
+    glEndQuery(GL_TIME_ELAPSED);
+
+    /* queue read back of this frame, it completes while the next one renders */
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, pHeadless->fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pHeadless->pbo[frame & 1U]);
+    glReadPixels(0, 0, pHeadless->width, pHeadless->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0U);
+    glFlush();
+
+    if (0U < frame)
+        pHeadless->cpuTimes.push_back(nowMs() - pHeadless->frameStart);
+
+    if (0U < frame)
+        collectPixels(pHeadless, frame - 1U);
+    if (HEADLESS_QUERY_LATENCY - 1U <= frame)
+        collectQuery(pHeadless, frame + 1U - HEADLESS_QUERY_LATENCY);
+
+    pHeadless->frame = frame + 1U;
+}
+
+void headlessFinish(Headless* pHeadless)
+{
+    uint32_t frame = pHeadless->frame;
+    if (0U == frame)
+        return;
+
+    collectPixels(pHeadless, frame - 1U);
+    for (uint32_t pending = (frame >= HEADLESS_QUERY_LATENCY - 1U) ? frame + 1U - HEADLESS_QUERY_LATENCY : 0U; pending < frame; ++pending)
+        collectQuery(pHeadless, pending);
+}
+
+static void reportTimes(FILE* pFile, const char* pName, std::vector<double> times)
+{
+    if (times.empty())
+        return;
+
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (double time : times)
+        sum += time;
+
+    fprintf(pFile, "%-4s ms: min %8.3f  avg %8.3f  median %8.3f  p95 %8.3f  max %8.3f\n", pName, times.front(), sum / (double)times.size(), times[times.size() / 2U],
+            times[(times.size() * 95U) / 100U], times.back());
+}
+
+void headlessReport(const Headless* pHeadless, FILE* pFile)
+{
+    fprintf(pFile, "%u frames at %dx%d\n", pHeadless->frame, pHeadless->width, pHeadless->height);
+    reportTimes(pFile, "CPU", pHeadless->cpuTimes);
+    reportTimes(pFile, "GPU", pHeadless->gpuTimes);
+}
+
+int headlessWriteFrame(const Headless* pHeadless, const char* pFileName)
+{
+    FILE* pFile = fopen(pFileName, "wb");
+    if (NULL == pFile)
+    {
+        fprintf(stderr, "%s: failed to open %s\n", __func__, pFileName);
+        return -1;
+    }
+
+    fprintf(pFile, "P6\n%d %d\n255\n", pHeadless->width, pHeadless->height);
+
+    /* GL rows start at the bottom */
+    std::vector<uint8_t> row((size_t)pHeadless->width * 3U);
+    for (int y = pHeadless->height - 1; y >= 0; --y)
+    {
+        const uint8_t* pRow = pHeadless->pixels.data() + (size_t)y * pHeadless->width * 4U;
+        for (int x = 0; x < pHeadless->width; ++x)
+            memcpy(&row[(size_t)x * 3U], pRow + (size_t)x * 4U, 3U);
+        fwrite(row.data(), row.size(), 1, pFile);
+    }
+
+    fclose(pFile);
+    return 0;
+}
+
+void headlessUninitialize(Headless* pHeadless)
+{
+    if (EGL_NO_CONTEXT != pHeadless->context)
+    {
+        glDeleteQueries(HEADLESS_QUERY_LATENCY, pHeadless->queries);
+        glDeleteBuffers(2, pHeadless->pbo);
+        glDeleteFramebuffers(1, &pHeadless->fbo);
+        glDeleteRenderbuffers(1, &pHeadless->depth);
+        glDeleteRenderbuffers(1, &pHeadless->color);
+
+        eglMakeCurrent(pHeadless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(pHeadless->display, pHeadless->context);
+        pHeadless->context = EGL_NO_CONTEXT;
+    }
+
+    if (EGL_NO_DISPLAY != pHeadless->display)
+    {
+        eglTerminate(pHeadless->display);
+        pHeadless->display = EGL_NO_DISPLAY;
+    }
+}
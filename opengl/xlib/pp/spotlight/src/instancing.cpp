@@ -0,0 +1,303 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "instancing.h"
+
+#define INSTANCING_TIMEOUT 1000000000ULL /**< nanoseconds to wait for a fence before reporting */
+
+/*
+ * Each group compacts its visible instances in shared memory and reserves
+ * space in the output with one atomicAdd on instanceCount, not one per instance.
+ */
+static const GLchar* cullShaderSource =
+    "#version 450 core"
+    "\n"
+    "layout(local_size_x = 256) in;"
+    "\n"
+    "struct Instance"
+    "{"
+    "    vec4 rotation;"
+    "    vec4 positionScale;"
+    "};"
+    "\n"
+    "layout(std430, binding = 0) readonly buffer Instances"
+    "{"
+    "    Instance instances[];"
+    "};"
+    "layout(std430, binding = 1) writeonly buffer VisibleInstances"
+    "{"
+    "    Instance visible[];"
+    "};"
+    "layout(std430, binding = 2) buffer Command"
+    "{"
+    "    uint count;"
+    "    uint instanceCount;"
+    "    uint firstIndex;"
+    "    int  baseVertex;"
+    "    uint baseInstance;"
+    "};"
+    "\n"
+    "uniform vec4  uPlanes[6];"
+    "uniform uint  uCount;"
+    "uniform float uRadius;"
+    "\n"
+    "shared uint groupCount;"
+    "shared uint groupFirst;"
+    "\n"
+    "void main(void)"
+    "{"
+    "    if (0u == gl_LocalInvocationIndex)"
+    "        groupCount = 0u;"
+    "    barrier();"
+    "\n"
+    "    uint     index     = gl_GlobalInvocationID.x;"
+    "    Instance instance  = instances[min(index, uCount - 1u)];"
+    "    bool     bVisible  = index < uCount;"
+    "    float    radius    = uRadius * instance.positionScale.w;"
+    "    for (int i = 0; i < 6; ++i)"
+    "        bVisible = bVisible && (dot(uPlanes[i].xyz, instance.positionScale.xyz) + uPlanes[i].w >= -radius);"
+    "\n"
+    "    uint slot = 0u;"
+    "    if (bVisible)"
+    "        slot = atomicAdd(groupCount, 1u);"
+    "    barrier();"
+    "\n"
+    "    if (0u == gl_LocalInvocationIndex && 0u < groupCount)"
+    "        groupFirst = atomicAdd(instanceCount, groupCount);"
+    "    barrier();"
+    "\n"
+    "    if (bVisible)"
+    "        visible[groupFirst + slot] = instance;"
+    "}";
+
+static GLuint buildCullProgram(void)
+{
+    GLint  status  = GL_FALSE;
+    GLint  length  = 0;
+    GLchar log[1024];
+    GLuint shader  = glCreateShader(GL_COMPUTE_SHADER);
+    GLuint program = 0U;
+
+    glShaderSource(shader, 1, &cullShaderSource, nullptr);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (GL_FALSE == status)
+    {
+        glGetShaderInfoLog(shader, sizeof(log), &length, log);
+        fprintf(stderr, "Cull shader compilation error log: %s\n", log);
+        glDeleteShader(shader);
+        return 0U;
+    }
+
+    program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (GL_FALSE == status)
+    {
+        glGetProgramInfoLog(program, sizeof(log), &length, log);
+        fprintf(stderr, "Cull program linking error log: %s\n", log);
+        glDeleteProgram(program);
+        return 0U;
+    }
+    return program;
+}
+
+int instancingInitialize(Instancing* pInstancing, uint32_t maxInstances, GLuint vao, uint32_t nIndices, float radius)
+{
+    memset(pInstancing, 0, sizeof(Instancing));
+    pInstancing->vao          = vao;
+    pInstancing->nIndices     = nIndices;
+    pInstancing->radius       = radius;
+    pInstancing->maxInstances = maxInstances;
+
+    pInstancing->cullProgram = buildCullProgram();
+    if (0U == pInstancing->cullProgram)
+        return -1;
+    pInstancing->planesUniform = glGetUniformLocation(pInstancing->cullProgram, "uPlanes");
+    pInstancing->countUniform  = glGetUniformLocation(pInstancing->cullProgram, "uCount");
+    pInstancing->radiusUniform = glGetUniformLocation(pInstancing->cullProgram, "uRadius");
+
+    /* every region starts aligned so it can be bound as the input of the cull shader */
+    GLint alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = (0 < alignment) ? alignment : 256;
+
+    pInstancing->regionSize = ((GLsizeiptr)sizeof(Instance) * maxInstances + alignment - 1) / alignment * alignment;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &pInstancing->instances);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pInstancing->instances);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, pInstancing->regionSize * INSTANCING_FRAMES, nullptr, flags);
+    pInstancing->pMapped = (Instance*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, pInstancing->regionSize * INSTANCING_FRAMES, flags);
+
+    /* only the GPU touches the visible instances */
+    glGenBuffers(1, &pInstancing->visible);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pInstancing->visible);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)sizeof(Instance) * maxInstances, nullptr, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+
+    /* instanceCount is reset every frame with glBufferSubData */
+    DrawElementsIndirectCommand command = {nIndices, 0U, 0U, 0, 0U};
+    glGenBuffers(1, &pInstancing->command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pInstancing->command);
+    glBufferStorage(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0U);
+
+    if (nullptr == pInstancing->pMapped)
+    {
+        fprintf(stderr, "%s: failed to map instance buffer, error 0x%x\n", __func__, glGetError());
+        instancingUninitialize(pInstancing);
+        return -1;
+    }
+
+    /* BeginFrame advances to region 0 */
+    pInstancing->region = INSTANCING_FRAMES - 1U;
+    return 0;
+}
+
+Instance* instancingBeginFrame(Instancing* pInstancing)
+{
+    pInstancing->region     = (pInstancing->region + 1U) % INSTANCING_FRAMES;
+    pInstancing->nInstances = 0U;
+
+    GLsync fence = pInstancing->fences[pInstancing->region];
+    if (0 != fence)
+    {
+        /* poll first, only count frames that actually waited */
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (GL_TIMEOUT_EXPIRED == result)
+        {
+            pInstancing->nStalls++;
+            do
+            {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, INSTANCING_TIMEOUT);
+            } while (GL_TIMEOUT_EXPIRED == result);
+        }
+        if (GL_WAIT_FAILED == result)
+            fprintf(stderr, "%s: waiting for region %u failed\n", __func__, pInstancing->region);
+
+        glDeleteSync(fence);
+        pInstancing->fences[pInstancing->region] = 0;
+    }
+
+    return (Instance*)((uint8_t*)pInstancing->pMapped + pInstancing->region * pInstancing->regionSize);
+}
+
+void instancingCull(Instancing* pInstancing, uint32_t nInstances, const vmath::mat4& viewProjection)
+{
+    pInstancing->nInstances = (nInstances < pInstancing->maxInstances) ? nInstances : pInstancing->maxInstances;
+
+    /* Gribb / Hartmann: planes are sums and differences of the last row with the others */
+    GLfloat planes[6][4];
+    for (int i = 0; i < 6; ++i)
+    {
+        int   row  = i / 2;
+        float sign = (0 == i % 2) ? 1.0f : -1.0f;
+        for (int column = 0; column < 4; ++column)
+            planes[i][column] = viewProjection[column][3] + sign * viewProjection[column][row];
+
+        float length = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        for (int column = 0; column < 4; ++column)
+            planes[i][column] /= length;
+    }
+
+    GLuint instanceCount = 0U;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pInstancing->command);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(DrawElementsIndirectCommand, instanceCount), sizeof(instanceCount), &instanceCount);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0U);
+
+    if (0U == pInstancing->nInstances)
+        return;
+
+    glUseProgram(pInstancing->cullProgram);
+    glUniform4fv(pInstancing->planesUniform, 6, &planes[0][0]);
+    glUniform1ui(pInstancing->countUniform, pInstancing->nInstances);
+    glUniform1f(pInstancing->radiusUniform, pInstancing->radius);
+
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCING_BINDING_INSTANCES, pInstancing->instances, pInstancing->region * pInstancing->regionSize,
+                      (GLsizeiptr)sizeof(Instance) * pInstancing->nInstances);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCING_BINDING_VISIBLE, pInstancing->visible);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCING_BINDING_COMMAND, pInstancing->command);
+    glDispatchCompute((pInstancing->nInstances + INSTANCING_GROUP_SIZE - 1U) / INSTANCING_GROUP_SIZE, 1U, 1U);
+
+    /*
+     * the draw reads the count as an indirect command and the instances as a storage buffer, the reset of the
+     * next frame (glBufferSubData) and instancingVisibleCount (glGetBufferSubData) touch the count from the client
+     */
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void instancingDraw(const Instancing* pInstancing)
+{
+    if (0U == pInstancing->nInstances)
+        return;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCING_BINDING_VISIBLE, pInstancing->visible);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pInstancing->command);
+    glBindVertexArray(pInstancing->vao);
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0U);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0U);
+}
+
+void instancingEndFrame(Instancing* pInstancing)
+{
+    pInstancing->fences[pInstancing->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+uint32_t instancingVisibleCount(const Instancing* pInstancing)
+{
+    DrawElementsIndirectCommand command = {};
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pInstancing->command);
+    glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0U);
+    return command.instanceCount;
+}
+
+void instancingUninitialize(Instancing* pInstancing)
+{
+    for (uint32_t i = 0U; i < INSTANCING_FRAMES; ++i)
+    {
+        if (0 != pInstancing->fences[i])
+        {
+            glClientWaitSync(pInstancing->fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, INSTANCING_TIMEOUT);
+            glDeleteSync(pInstancing->fences[i]);
+            pInstancing->fences[i] = 0;
+        }
+    }
+
+    if (0U != pInstancing->instances)
+    {
+        if (nullptr != pInstancing->pMapped)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, pInstancing->instances);
+            glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+            pInstancing->pMapped = nullptr;
+        }
+        glDeleteBuffers(1, &pInstancing->instances);
+        pInstancing->instances = 0U;
+    }
+
+    if (0U != pInstancing->visible)
+    {
+        glDeleteBuffers(1, &pInstancing->visible);
+        pInstancing->visible = 0U;
+    }
+
+    if (0U != pInstancing->command)
+    {
+        glDeleteBuffers(1, &pInstancing->command);
+        pInstancing->command = 0U;
+    }
+
+    if (0U != pInstancing->cullProgram)
+    {
+        glDeleteProgram(pInstancing->cullProgram);
+        pInstancing->cullProgram = 0U;
+    }
+}
@@ -7,3 +7,17 @@
  */
 
 #include "light.h"
+
+void packLight(const Light* pLight, LightBlock* pBlock)
+{
+    pBlock->position    = pLight->position;
+    pBlock->constant    = pLight->constant;
+    pBlock->direction   = pLight->direction;
+    pBlock->linear      = pLight->linear;
+    pBlock->ambient     = pLight->ambient;
+    pBlock->quadratic   = pLight->quadratic;
+    pBlock->diffuse     = pLight->diffuse;
+    pBlock->cutOff      = pLight->cutOff;
+    pBlock->specular    = pLight->specular;
+    pBlock->outerCutOff = pLight->outerCutOff;
+}
@@ -7,6 +7,7 @@
  */
 
 /*--- System Headers ---*/
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -36,13 +37,54 @@ using namespace vmath;
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "arena.h"
+#include "clusters.h"
+#include "headless.h"
+#include "instancing.h"
 #include "model.h"
+#include "runloop.h"
+#include "scene.h"
+#include "shadowmap.h"
+#include "uniformring.h"
 
 /*--- Macro definitions ---*/
 #define gpFILE     stdout
 #define WIN_WIDTH  800
 #define WIN_HEIGHT 600
 
+#define ROTATION_SPEED 0.6f // radians per second
+
+#define FOVY   45.0f  // vertical field of view of the camera in degrees
+#define Z_NEAR 0.1f   // near plane of the projection, first froxel slice
+#define Z_FAR  100.0f // far plane of the projection, last froxel slice
+
+#define SHADOW_MAP_SIZE        2048  // texels per side of a shadow map layer
+#define SHADOW_CASCADES        4U    // layers of the sun, -sun
+#define SHADOW_DISTANCE        30.0f // view depth covered by the cascades of the sun
+#define SHADOW_CASTER_DISTANCE 20.0f // occluders this far outside a cascade towards the sun still cast
+#define SPOT_SHADOW_RANGE      30.0f // reach of the spot light shadow map
+
+#define MAX_DRAWS_PER_FRAME 1024U   // draws queued in the geometry arena per frame
+#define ARENA_VERTICES      65536U  // vertices of all models in the geometry arena
+#define ARENA_INDICES       262144U // indices of all models in the geometry arena
+
+#define UNIFORM_BLOCK_ALIGNMENT 256U // largest GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, room between blocks in the ring
+
+#define SCENE_SPHERES 8U // spheres around the cube, material 1 + i each
+#define OBJECT_SPACING 1.0f  // distance between spheres of the object grid, -objects
+#define OBJECT_DEPTH   -4.0f // the object grid starts this far behind the origin
+#define WALL_DEPTH     -3.5f // the wall of -wall stands between the cube and the object grid
+#define WALL_WIDTH     1.5f  // scale of the plane model across the view, -wall
+#define WALL_HEIGHT    0.6f  // scale of the plane model upwards, -wall
+
+#define INSTANCE_SPACING 0.5f  // distance between spheres of the instance grid
+#define INSTANCE_SCALE   0.15f // scale of the unit sphere model
+#define INSTANCE_HEIGHT  3.0f  // height of the instance grid above the plane
+
+#define POINT_LIGHT_RADIUS   0.6f     // reach of a point light
+#define POINT_LIGHT_AREA     4.4f     // point lights wander within this distance of the origin
+#define MAX_CLUSTER_INDICES  1048576U // light indices of all froxels together
+
 enum
 {
     AMC_ATTRIBUTE_POSITION = 0,
@@ -51,6 +93,51 @@ enum
     AMC_ATTRIBUTE_NORMALS
 };
 
+/* uniform block binding points, layout(binding = N) in the shaders */
+enum
+{
+    AMC_BINDING_FRAME = 0
+};
+
+/**
+ * @brief std140 layout of FrameBlock, written once per frame
+ */
+struct FrameBlock
+{
+    mat4       viewMatrix;
+    mat4       projectionMatrix;
+    vec3       cameraPosition;
+    float      padding;
+    LightBlock light;
+};
+
+/* blocks have to be declared identically in every stage, both shaders paste this */
+#define FRAME_BLOCK_GLSL                             \
+    "struct Light"                                   \
+    "{"                                              \
+    "    vec3  position;"                            \
+    "    float constant;"                            \
+    "    vec3  direction;"                           \
+    "    float linear;"                              \
+    "    vec3  ambient;"                             \
+    "    float quadratic;"                           \
+    "    vec3  diffuse;"                             \
+    "    float cutOff;"                              \
+    "    vec3  specular;"                            \
+    "    float outerCutOff;"                         \
+    "};"                                             \
+    "\n"                                             \
+    "layout(std140, binding = 0) uniform FrameBlock" \
+    "{"                                              \
+    "    mat4  uViewMatrix;"                         \
+    "    mat4  uProjectionMatrix;"                   \
+    "    vec3  uCameraPosition;"                     \
+    "    Light light;"                               \
+    "};"                                             \
+    "\n"
+
+static_assert(offsetof(FrameBlock, light) == 144, "FrameBlock does not match std140");
+
 /*--- Function declarations ---*/
 /**
  * @brief initilize OpenGL context
@@ -116,6 +203,37 @@ GLint linkProgram(GLuint programId);
  */
 GLuint loadShaders(const char* vertexSource, const char* fragmentSource);
 
+/**
+ * @brief Create vertex array, vertex and element buffers of a model
+ *
+ * @param pModel   [in]  - model loaded with loadModel
+ * @param pUniform [out] - buffer identifiers
+ */
+void createModelBuffers(const Model* pModel, ModelUniform* pUniform);
+
+/**
+ * @brief Delete buffers created by createModelBuffers
+ */
+void deleteModelBuffers(ModelUniform* pUniform);
+
+/**
+ * @brief Write grid of sphere instances for this frame
+ *
+ * @param pInstances [out] - instances of the current frame
+ * @param nInstances [in]  - number of instances to write
+ * @param angle      [in]  - animation angle in radians
+ */
+void updateInstances(Instance* pInstances, uint32_t nInstances, float angle);
+
+/**
+ * @brief Write point lights for this frame
+ *
+ * @param pLights [out] - lights of the current frame
+ * @param nLights [in]  - number of lights to write
+ * @param angle   [in]  - animation angle in radians
+ */
+void updatePointLights(PointLight* pLights, uint32_t nLights, float angle);
+
 /**
  * @brief Load texture into memory
  *
@@ -125,6 +243,16 @@ GLuint loadShaders(const char* vertexSource, const char* fragmentSource);
  */
 GLuint loadGLTexture(const char* filename);
 
+/**
+ * @brief Render frames into an offscreen framebuffer instead of a window and report frame times
+ *
+ * @param nFrames [in] - number of frames to render, animated at a fixed 60 fps
+ * @param pOutput [in] - PPM file for the last frame, may be nullptr
+ *
+ * @returns 0 on success else negative value
+ */
+int runHeadless(uint32_t nFrames, const char* pOutput);
+
 /* Windowing related variables */
 Display*     dpy         = nullptr; // connection to server
 Colormap     colormap    = 0UL;
@@ -141,33 +269,59 @@ float debug = 0.0f;
 /* OpenGL identifiers */
 GLuint shaderProgramObject = 0U;
 
-/* Matrix uniforms */
-GLuint modelMatrixUniform      = 0U;
-GLuint viewMatrixUniform       = 0U;
-GLuint projectionMatrixUniform = 0U;
-GLuint cameraPositionUniform   = 0U;
-
 mat4 projectionMatrix = {};
 
-/* Light uniforms */
-Light        light        = {};
-LightUniform lightUniform = {};
+/* Uniform blocks of frames in flight */
+UniformRing uniformRing = {};
 
-/* Material uniforms */
-Material        material        = {};
-MaterialUniform materialUniform = {};
+/* Light */
+Light light = {};
+
+/* Material */
+Material material = {};
 
 /* Functional uniforms */
 Bool bAnimationEnabled = False;
 
-/* Model */
-Model        model        = {0};
-ModelUniform modelUniform = {};
+/* Models, drawn from the geometry arena */
+Model         model      = {0};
+Model         sphere     = {0};
+GeometryArena arena      = {};
+int           planeMesh  = -1;
+int           sphereMesh = -1;
+
+/* Static objects culled on the CPU, -objects <count> more spheres, -occlusion, -wall */
+Scene    scene       = {};
+uint32_t nObjects    = 0U;
+Bool     bOcclusion  = False;
+Bool     bWall       = False;
+
+/* Shadows of the spot light, or of the sun with -sun */
+Bool      bSun               = False;
+ShadowMap shadowMap          = {};
+GLuint    depthProgramObject = 0U;
+GLint     lightMatrixUniform = -1;
+
+/* Point lights shaded per froxel, -lights <count> */
+uint32_t      nPointLights   = 0U;
+LightClusters clusters       = {};
+int           viewportWidth  = WIN_WIDTH;
+int           viewportHeight = WIN_HEIGHT;
+
+/* Instanced spheres, -instances <count> */
+uint32_t     nInstances            = 0U;
+ModelUniform sphereUniform         = {};
+GLuint       instanceProgramObject = 0U;
+Instancing   instancing            = {};
 
 /* Variables */
 float rotationAngle = 0.0f;
 
-int main()
+/* Animation timing */
+RunLoop runLoop               = {};
+float   previousRotationAngle = 0.0f; // rotation of previous step, for interpolation
+
+int main(int argc, char* argv[])
 {
     int                  defaultScreen    = 0;
     XSetWindowAttributes windowAttributes = {0};
@@ -178,6 +332,8 @@ int main()
     int                  screenHeight     = 0;
     char                 keys[26]         = {0};
     XRectangle           rect             = {0}; // window dimentions rectangle
+    uint32_t             nHeadlessFrames  = 0U;  // -headless, 0 opens a window
+    const char*          pHeadlessOutput  = nullptr;
 
     // clang-format off
     GLint glxAttriutes[] = {
@@ -193,6 +349,47 @@ int main()
     };
     // clang-format on
 
+    /* -instances <count>: draw a grid of spheres culled on the GPU */
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "-instances") && i + 1 < argc)
+        {
+            nInstances = (uint32_t)atoi(argv[i + 1]);
+        }
+        else if (0 == strcmp(argv[i], "-sun"))
+        {
+            bSun = True;
+        }
+        else if (0 == strcmp(argv[i], "-lights") && i + 1 < argc)
+        {
+            nPointLights = (uint32_t)atoi(argv[i + 1]);
+        }
+        else if (0 == strcmp(argv[i], "-objects") && i + 1 < argc)
+        {
+            nObjects = (uint32_t)atoi(argv[i + 1]);
+        }
+        else if (0 == strcmp(argv[i], "-occlusion"))
+        {
+            bOcclusion = True;
+        }
+        else if (0 == strcmp(argv[i], "-wall"))
+        {
+            bWall = True;
+        }
+        /* -headless <frames> [output.ppm]: no X server needed */
+        else if (0 == strcmp(argv[i], "-headless") && i + 1 < argc)
+        {
+            nHeadlessFrames = (uint32_t)atoi(argv[i + 1]);
+            if (i + 2 < argc && '-' != argv[i + 2][0])
+                pHeadlessOutput = argv[i + 2];
+        }
+    }
+
+    if (0U < nHeadlessFrames)
+    {
+        return runHeadless(nHeadlessFrames, pHeadlessOutput);
+    }
+
     /*Step 1:  establish connection with x-server */
     dpy = XOpenDisplay(nullptr);
     if (dpy == nullptr)
@@ -276,6 +473,9 @@ int main()
     XMoveWindow(dpy, window, (screenWidth - WIN_WIDTH) / 2, (screenHeight - WIN_HEIGHT) / 2);
 
     /*--- OpenGL initialization ---*/
+    glxContext = glXCreateContext(dpy, pVisualInfo, nullptr, GL_TRUE);
+    glXMakeCurrent(dpy, window, glxContext);
+
     int res = initialize();
     if (res < 0)
     {
@@ -284,11 +484,15 @@ int main()
         exit(res);
     }
 
+    /* fixed step animation, sleep between frames instead of spinning */
+    runLoopInitialize(&runLoop, dpy, RUNLOOP_DEFAULT_FPS);
+    runLoopEnableVsync(&runLoop, window, 1);
+
     shouldDraw = false;
     while (!gbAbortFlag)
     {
         XEvent event;
-        if (XPending(dpy))
+        while (!gbAbortFlag && runLoopWait(&runLoop, !shouldDraw))
         {
             XNextEvent(dpy, &event);
             switch (event.type)
@@ -374,14 +578,15 @@ int main()
         if (!shouldDraw)
             continue;
 
-        display();
-
-        if (True == bAnimationEnabled)
+        for (uint32_t nSteps = runLoopBeginFrame(&runLoop); 0U < nSteps; --nSteps)
         {
             update();
         }
 
+        display();
+
         glXSwapBuffers(dpy, window);
+        runLoopEndFrame(&runLoop);
     }
 
     uninitialize();
@@ -399,14 +604,11 @@ int initialize()
     fprintf(gpFile, "Model loaded successfully\n");
 
     GLint result = 0; // variable to get value returned by APIS
-    glxContext   = glXCreateContext(dpy, pVisualInfo, nullptr, GL_TRUE);
-    glXMakeCurrent(dpy, window, glxContext);
-
-    fprintf(gpFile, "Model loaded successfully\n");
 
-    /* initialize glew */
-    glewExperimental = true;
-    if (glewInit() != GLEW_OK)
+    /* initialize glew, there is no GLX display with the headless context */
+    glewExperimental  = true;
+    GLenum glewResult = glewInit();
+    if (GLEW_OK != glewResult && GLEW_ERROR_NO_GLX_DISPLAY != glewResult)
     {
         fprintf(gpFILE, "%s: failed to initialize glew\n", __func__);
         uninitialize();
@@ -421,61 +623,42 @@ int initialize()
     /* Program related variables */
 
     const GLchar* vertexShaderSource =
-        "#version 460 core"
+        "#version 450 core"
         "\n"
-        "in  vec4 aPosition;"
-        "in  vec3 aNormal;"
-        "out vec3 oNormal;"
-        "out vec3 wPosition;"
+        "#extension GL_ARB_shader_draw_parameters : require"
         "\n"
-        "uniform mat4 uModelMatrix;"
-        "uniform mat4 uViewMatrix;"
-        "uniform mat4 uProjectionMatrix;"
+        "in       vec4 aPosition;"
+        "in       vec3 aNormal;"
+        "out      vec3 oNormal;"
+        "out      vec3 wPosition;"
+        "flat out uint oMaterial;"
         "\n"
+        FRAME_BLOCK_GLSL
+        ARENA_GLSL
         "void main(void)"
         "{"
-        "    mat3 normalMatrix = mat3(transpose(inverse(uModelMatrix)));"
-        "\n"
-        "    oNormal     = normalize(normalMatrix * aNormal);"
-        "    wPosition   = vec3(uModelMatrix * aPosition);"
-        "    gl_Position = uProjectionMatrix * uViewMatrix * vec4(wPosition, 1.0f);"
+        "    DrawRecord draw = draws[gl_BaseInstanceARB];"
+        "    oNormal         = normalize(draw.normalMatrix * aNormal);"
+        "    wPosition       = vec3(draw.modelMatrix * aPosition);"
+        "    oMaterial       = draw.material;"
+        "    gl_Position     = uProjectionMatrix * uViewMatrix * vec4(wPosition, 1.0f);"
         "}";
 
     const GLchar* fragmentShaderSource =
-        "#version 460 core"
+        "#version 450 core"
         "\n"
-        "struct Material"
-        "{"
-        "    vec4  ambient;"
-        "    vec4  diffuse;"
-        "    vec4  specular;"
-        "    float shininess;"
-        "};"
-        "\n"
-        "struct Light"
-        "{"
-        "    vec3  position;"
-        "    vec3  direction;"
-        "    vec3  ambient;"
-        "    vec3  diffuse;"
-        "    vec3  specular;"
-        "    float constant;"
-        "    float linear;"
-        "    float quadratic;"
-        "    float cutOff;"
-        "    float outerCutOff;"
-        "};"
-        "\n"
-        "in  vec3 oNormal;"
-        "in  vec3 wPosition;"
-        "out vec4 FragColor;"
-        "\n"
-        "uniform Light    light;"
-        "uniform Material material;"
-        "uniform vec3     uCameraPosition;"
+        "in      vec3 oNormal;"
+        "in      vec3 wPosition;"
+        "flat in uint oMaterial;"
+        "out     vec4 FragColor;"
         "\n"
+        FRAME_BLOCK_GLSL
+        ARENA_GLSL
+        CLUSTERS_GLSL
+        SHADOWMAP_GLSL
         "void main(void)"
         "{"
+        "    Material material    = materials[oMaterial];"
         "    vec3  rayDirection   = normalize(light.position - wPosition);"
         "    vec3  lightDirection = normalize(-light.direction);"
         "    float costheta       = dot(rayDirection, lightDirection);"
@@ -491,7 +674,25 @@ int initialize()
         "    vec4 ambient  = vec4(light.ambient, 1.0f) * material.ambient;"
         "    vec4 diffuse  = vec4(light.diffuse, 1.0f) * material.diffuse * max(dot(lightDirection, oNormal), 0.0f);"
         "    vec4 specular = vec4(light.specular, 1.0f) * material.specular * pow(max(dot(eReflectionDirection, eCameraDirection), 0.0f), material.shininess);"
-        "    FragColor = (ambient + (diffuse + specular) *  intensity) * attenuation + 0.01f;"
+        "\n"
+        "    float viewDepth = -(uViewMatrix * vec4(wPosition, 1.0f)).z;"
+        "    uvec2 cluster   = clusterLights(gl_FragCoord.xy, viewDepth);"
+        "    vec3  lit       = vec3(0.0f);"
+        "    for (uint i = cluster.x; i < cluster.x + cluster.y; ++i)"
+        "    {"
+        "        PointLight pointLight = pointLights[lightIndices[i]];"
+        "        vec3  toLight    = pointLight.positionRadius.xyz - wPosition;"
+        "        float distance2  = dot(toLight, toLight);"
+        "        float falloff    = clamp(1.0f - distance2 / (pointLight.positionRadius.w * pointLight.positionRadius.w), 0.0f, 1.0f);"
+        "        vec3  rayToLight = toLight * inversesqrt(max(distance2, 1e-6f));"
+        "        vec3  halfway    = normalize(rayToLight + eCameraDirection);"
+        "        lit += pointLight.color.rgb * (falloff * falloff / (1.0f + distance2)) *"
+        "               (material.diffuse.rgb * max(dot(rayToLight, oNormal), 0.0f) +"
+        "                material.specular.rgb * pow(max(dot(halfway, oNormal), 0.0f), material.shininess));"
+        "    }"
+        "\n"
+        "    float shadow = shadowFactor(wPosition, oNormal, viewDepth);"
+        "    FragColor = (ambient + (diffuse + specular) * intensity * shadow) * attenuation + 0.01f + vec4(lit, 0.0f);"
         "}";
 
     shaderProgramObject = loadShaders(vertexShaderSource, fragmentShaderSource);
@@ -514,56 +715,185 @@ int initialize()
     }
     fprintf(gpFILE, "[%s] Program linked successfully\n", __func__);
 
-    modelMatrixUniform      = glGetUniformLocation(shaderProgramObject, "uModelMatrix");
-    viewMatrixUniform       = glGetUniformLocation(shaderProgramObject, "uViewMatrix");
-    projectionMatrixUniform = glGetUniformLocation(shaderProgramObject, "uProjectionMatrix");
-
-    lightUniform.ambient     = glGetUniformLocation(shaderProgramObject, "light.ambient");
-    lightUniform.diffuse     = glGetUniformLocation(shaderProgramObject, "light.diffuse");
-    lightUniform.specular    = glGetUniformLocation(shaderProgramObject, "light.specular");
-    lightUniform.position    = glGetUniformLocation(shaderProgramObject, "light.position");
-    lightUniform.direction   = glGetUniformLocation(shaderProgramObject, "light.direction");
-    lightUniform.constant    = glGetUniformLocation(shaderProgramObject, "light.constant");
-    lightUniform.linear      = glGetUniformLocation(shaderProgramObject, "light.linear");
-    lightUniform.quadratic   = glGetUniformLocation(shaderProgramObject, "light.quadratic");
-    lightUniform.cutOff      = glGetUniformLocation(shaderProgramObject, "light.cutOff");
-    lightUniform.outerCutOff = glGetUniformLocation(shaderProgramObject, "light.outerCutOff");
-    cameraPositionUniform    = glGetUniformLocation(shaderProgramObject, "uCameraPosition");
-
-    materialUniform.ambient   = glGetUniformLocation(shaderProgramObject, "material.ambient");
-    materialUniform.diffuse   = glGetUniformLocation(shaderProgramObject, "material.diffuse");
-    materialUniform.specular  = glGetUniformLocation(shaderProgramObject, "material.specular");
-    materialUniform.shininess = glGetUniformLocation(shaderProgramObject, "material.shininess");
-
-    /* Model Buffers */
-    glGenVertexArrays(1, &modelUniform.vao);
-    glBindVertexArray(modelUniform.vao);
-
-    glGenBuffers(1, &modelUniform.positions);
-    glBindBuffer(GL_ARRAY_BUFFER, modelUniform.positions);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * model.header.nVertices, model.pVertices, GL_STATIC_DRAW);
+    /* depth of the occluders seen from the light, model matrices come from the arena */
+    const GLchar* depthVertexShaderSource =
+        "#version 450 core"
+        "\n"
+        "#extension GL_ARB_shader_draw_parameters : require"
+        "\n"
+        "in vec4 aPosition;"
+        "\n"
+        "uniform mat4 uLightMatrix;"
+        "\n"
+        ARENA_GLSL
+        "void main(void)"
+        "{"
+        "    gl_Position = uLightMatrix * draws[gl_BaseInstanceARB].modelMatrix * aPosition;"
+        "}";
 
-    glVertexAttribPointer(AMC_ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
-    glEnableVertexAttribArray(AMC_ATTRIBUTE_POSITION);
+    const GLchar* depthFragmentShaderSource =
+        "#version 450 core"
+        "\n"
+        "void main(void)"
+        "{"
+        "}";
 
-    glVertexAttribPointer(AMC_ATTRIBUTE_NORMALS, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(AMC_ATTRIBUTE_NORMALS);
+    depthProgramObject = loadShaders(depthVertexShaderSource, depthFragmentShaderSource);
+    if (0U == depthProgramObject)
+    {
+        fprintf(gpFile, "Failed to load depth shaders into memory\n");
+        uninitialize();
+        return -1;
+    }
+    glBindAttribLocation(depthProgramObject, AMC_ATTRIBUTE_POSITION, "aPosition");
+    if (0 == linkProgram(depthProgramObject))
+    {
+        fprintf(gpFILE, "[%s] Failed to link depth program\n", __func__);
+        uninitialize();
+        return -1;
+    }
+    lightMatrixUniform = glGetUniformLocation(depthProgramObject, "uLightMatrix");
 
-    glVertexAttribPointer(AMC_ATTRIBUTE_UVS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texel));
-    glEnableVertexAttribArray(AMC_ATTRIBUTE_UVS);
-    glBindBuffer(GL_ARRAY_BUFFER, 0U);
+    /* one layer follows the cone of the spot light, the sun splits the view into cascades */
+    if (0 != shadowMapInitialize(&shadowMap, SHADOW_MAP_SIZE, bSun ? SHADOW_CASCADES : 1U))
+    {
+        fprintf(gpFILE, "[%s] Failed to create shadow map\n", __func__);
+        uninitialize();
+        return -1;
+    }
 
-    glGenBuffers(1, &modelUniform.ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, modelUniform.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * model.header.nIndices, model.pIndices, GL_STATIC_DRAW);
+    /* per frame uniforms live in blocks bound from the ring, per draw data in the arena */
+    if (0 != uniformRingInitialize(&uniformRing, sizeof(FrameBlock) + UNIFORM_BLOCK_ALIGNMENT + sizeof(ShadowBlock)))
+    {
+        fprintf(gpFILE, "[%s] Failed to create uniform ring\n", __func__);
+        uninitialize();
+        return -1;
+    }
 
-    /*
-        The order of unbinding is important --
-        If Element buffer is unbound before vertex array buffer then we are indicating OpenGl
-        that we do not intend to use element buffer
-     */
-    glBindVertexArray(0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    /* empty froxel lists without -lights, the spot light alone lights the scene */
+    if (0 != clustersInitialize(&clusters, nPointLights, MAX_CLUSTER_INDICES))
+    {
+        fprintf(gpFILE, "[%s] Failed to create light clusters\n", __func__);
+        uninitialize();
+        return -1;
+    }
+
+    if (0 > loadModel(&sphere, "res/sphere.model"))
+    {
+        fprintf(gpFile, "Failed to load model sphere.model\n");
+        uninitialize();
+        return -1;
+    }
+
+    /* Model Buffers, all models share the buffers of the arena */
+    if (0 != arenaInitialize(&arena, ARENA_VERTICES, ARENA_INDICES, std::max(MAX_DRAWS_PER_FRAME, 2U + SCENE_SPHERES + nObjects)))
+    {
+        fprintf(gpFILE, "[%s] Failed to create geometry arena\n", __func__);
+        uninitialize();
+        return -1;
+    }
+    planeMesh  = arenaAddModel(&arena, &model);
+    sphereMesh = arenaAddModel(&arena, &sphere);
+    if (0 > planeMesh || 0 > sphereMesh)
+    {
+        uninitialize();
+        return -1;
+    }
+
+    /* nothing moves, the hierarchy is built once */
+    if (0 != sceneInitialize(&scene, True == bOcclusion))
+    {
+        fprintf(gpFILE, "[%s] Failed to create scene\n", __func__);
+        uninitialize();
+        return -1;
+    }
+    {
+        int planeObjectMesh  = sceneAddMesh(&scene, &model, planeMesh);
+        int sphereObjectMesh = sceneAddMesh(&scene, &sphere, sphereMesh);
+        sceneAddObject(&scene, planeObjectMesh, mat4::identity(), 0U);
+        for (uint32_t i = 0U; i < SCENE_SPHERES; ++i)
+        {
+            float sphereAngle = 2.0f * (float)M_PI * (float)i / (float)SCENE_SPHERES;
+            sceneAddObject(&scene, sphereObjectMesh, translate(2.0f * cosf(sphereAngle), 0.35f, 2.0f * sinf(sphereAngle)) * scale(0.35f), 1U + i);
+        }
+
+        /* square grid behind the cube, reaching past the sides and the far plane of the view */
+        uint32_t side = (uint32_t)ceilf(sqrtf((float)nObjects));
+        for (uint32_t i = 0U; i < nObjects; ++i)
+        {
+            float x = ((float)(i % side) - 0.5f * (float)(side - 1U)) * OBJECT_SPACING;
+            float z = OBJECT_DEPTH - (float)(i / side) * OBJECT_SPACING;
+            sceneAddObject(&scene, sphereObjectMesh, translate(x, 0.35f, z) * scale(0.35f), 1U + i % SCENE_SPHERES);
+        }
+
+        /* the plane flattened and stood up facing the camera, hides the middle of the grid for -occlusion */
+        if (True == bWall)
+        {
+            const SceneBounds& bounds = scene.meshes[planeObjectMesh].bounds;
+            float              height = (bounds.max[2] - bounds.min[2]) * WALL_HEIGHT;
+            sceneAddObject(&scene, planeObjectMesh,
+                           translate(0.0f, 0.5f * height, WALL_DEPTH) * rotate(90.0f, 1.0f, 0.0f, 0.0f) * scale(WALL_WIDTH, 0.02f, WALL_HEIGHT), 0U);
+        }
+        sceneBuild(&scene);
+    }
+
+    if (0U < nInstances)
+    {
+        createModelBuffers(&sphere, &sphereUniform);
+
+        /* bounding sphere of the model around its origin */
+        float radius = 0.0f;
+        for (uint32_t i = 0U; i < sphere.header.nVertices; ++i)
+        {
+            const Position& position = sphere.pVertices[i].position;
+            radius = fmaxf(radius, sqrtf(position.x * position.x + position.y * position.y + position.z * position.z));
+        }
+
+        if (0 != instancingInitialize(&instancing, nInstances, sphereUniform.vao, sphere.header.nIndices, radius))
+        {
+            fprintf(gpFILE, "[%s] Failed to initialize instancing\n", __func__);
+            uninitialize();
+            return -1;
+        }
+
+        const GLchar* instanceVertexShaderSource =
+            "#version 450 core"
+            "\n"
+            "in       vec4 aPosition;"
+            "in       vec3 aNormal;"
+            "out      vec3 oNormal;"
+            "out      vec3 wPosition;"
+            "flat out uint oMaterial;"
+            "\n"
+            FRAME_BLOCK_GLSL
+            ARENA_GLSL
+            INSTANCING_GLSL
+            "void main(void)"
+            "{"
+            "    oNormal     = normalize(instanceNormal(aNormal));"
+            "    wPosition   = instancePosition(aPosition.xyz);"
+            "    oMaterial   = 0u;"
+            "    gl_Position = uProjectionMatrix * uViewMatrix * vec4(wPosition, 1.0f);"
+            "}";
+
+        instanceProgramObject = loadShaders(instanceVertexShaderSource, fragmentShaderSource);
+        if (0U == instanceProgramObject)
+        {
+            fprintf(gpFile, "Failed to load instancing shaders into memory\n");
+            uninitialize();
+            return -1;
+        }
+
+        glBindAttribLocation(instanceProgramObject, AMC_ATTRIBUTE_POSITION, "aPosition");
+        glBindAttribLocation(instanceProgramObject, AMC_ATTRIBUTE_NORMALS, "aNormal");
+        if (0 == linkProgram(instanceProgramObject))
+        {
+            fprintf(gpFILE, "[%s] Failed to link instancing program\n", __func__);
+            uninitialize();
+            return -1;
+        }
+        fprintf(gpFILE, "[%s] Drawing %u instances\n", __func__, nInstances);
+    }
 
     light.setAmbient(vec3(0.2f, 0.2f, 0.2f));
     light.setDiffuse(vec3(0.8f, 0.8f, 0.8f));
@@ -576,11 +906,44 @@ int initialize()
     light.SetCutOff(cosf(radians(5.0f)));
     light.SetOuterCutOff(cosf(radians(9.0f)));
 
+    /* the sun is a spot light without cone and attenuation */
+    if (bSun)
+    {
+        light.setDirection(vec3(-0.5f, -1.0f, -0.3f));
+        light.setConstantAttenuation(1.0f);
+        light.setLinearAttenuation(0.0f);
+        light.setQuadraticAttenuation(0.0f);
+        light.SetCutOff(-1.0f);
+        light.SetOuterCutOff(-2.0f);
+    }
+
     material.setDiffuse(vec4(1.0f, 1.0f, 1.0f, 1.0f));
     material.setAmbient(vec4(0.2f, 0.2f, 0.2f, 1.0f));
     material.setSpecular(vec4(1.0f, 1.0f, 1.0f, 1.0f));
     material.setShininess(38.0f);
 
+    /* material 0 is the plane, the spheres get a colour each */
+    static const float sphereColors[SCENE_SPHERES][3] = {
+        {1.0f, 0.2f, 0.2f},
+        {1.0f, 0.6f, 0.2f},
+        {1.0f, 1.0f, 0.2f},
+        {0.2f, 1.0f, 0.2f},
+        {0.2f, 1.0f, 1.0f},
+        {0.2f, 0.4f, 1.0f},
+        {0.6f, 0.2f, 1.0f},
+        {1.0f, 0.2f, 1.0f},
+    };
+    MaterialBlock materials[1U + SCENE_SPHERES];
+    packMaterial(&material, &materials[0]);
+    for (uint32_t i = 0U; i < SCENE_SPHERES; ++i)
+    {
+        Material sphereMaterial = material;
+        sphereMaterial.setDiffuse(vec4(sphereColors[i][0], sphereColors[i][1], sphereColors[i][2], 1.0f));
+        sphereMaterial.setAmbient(sphereMaterial.getDiffuse() * 0.2f);
+        packMaterial(&sphereMaterial, &materials[1U + i]);
+    }
+    arenaSetMaterials(&arena, materials, 1U + SCENE_SPHERES);
+
     /* Enabling Depth */
     glClearDepth(1.0f);      //[Compulsory] Make all bits in depth buffer as '1'
     glEnable(GL_DEPTH_TEST); //[Compulsory] enable depth test
@@ -588,12 +951,14 @@ int initialize()
 
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
-    glShadeModel(GL_SMOOTH);
 
     /* warm-up resize */
-    XWindowAttributes xattr = {};
-    XGetWindowAttributes(dpy, window, &xattr);
-    resize(xattr.width, xattr.height);
+    if (nullptr != dpy)
+    {
+        XWindowAttributes xattr = {};
+        XGetWindowAttributes(dpy, window, &xattr);
+        resize(xattr.width, xattr.height);
+    }
     return (0);
 }
 
@@ -602,7 +967,9 @@ void resize(int width, int height)
     if (height <= 0)
         height = 1;
 
-    projectionMatrix = vmath::perspective(45.0f, (float)width / (float)height, 0.1f, 100.0f);
+    projectionMatrix = vmath::perspective(FOVY, (float)width / (float)height, Z_NEAR, Z_FAR);
+    viewportWidth    = width;
+    viewportHeight   = height;
 
     glViewport(0, 0, width, height);
 }
@@ -611,54 +978,99 @@ void display()
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    mat4 modelMatrix       = mat4::identity();
-    mat4 translationMatrix = mat4::identity();
-    mat4 scaleMatrix       = mat4::identity();
     mat4 viewMatrix        = mat4::identity();
     vec3 cameraPosition    = vec3(0.0f, 5.0f, 10.0f);
     vec3 cameaDirection    = vec3(0.0f, 0.0f, 0.0f);
 
-    glUseProgram(shaderProgramObject);
-    glBindVertexArray(modelUniform.vao);
+    /* interpolate between the last two animation steps */
+    float angle = previousRotationAngle + (rotationAngle - previousRotationAngle) * runLoopAlpha(&runLoop);
+
+    if (True == bAnimationEnabled)
     {
-        viewMatrix = lookat(cameraPosition, cameaDirection, vec3(0.0f, 1.0f, 0.0f));
+        if (bSun)
+            light.setDirection(vec3(-0.5f * cosf(angle), -1.0f, -0.5f * sinf(angle)));
+        else
+            light.setDirection(vec3(debug * cosf(angle), -1.0f, debug * sinf(angle)));
+    }
+
+    viewMatrix = lookat(cameraPosition, cameaDirection, vec3(0.0f, 1.0f, 0.0f));
+
+    /* light matrices first, culling keeps what the camera or a shadow map layer sees */
+    if (bSun)
+    {
+        shadowMapUpdateDirectional(&shadowMap, light.getDirection(), viewMatrix, FOVY, (float)viewportWidth / (float)viewportHeight, Z_NEAR,
+                                   SHADOW_DISTANCE, SHADOW_CASTER_DISTANCE);
+    }
+    else
+    {
+        shadowMapUpdateSpot(&shadowMap, light.getPosition(), light.getDirection(), light.getOuterCutOff(), SPOT_SHADOW_RANGE);
+    }
+
+    /* whole scene in one glMultiDrawElementsIndirect per pass, spheres circle the cube */
+    arenaBeginFrame(&arena);
+    sceneCull(&scene, &arena, projectionMatrix * viewMatrix, shadowMap.lightMatrices, shadowMap.nCascades);
 
-        glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, modelMatrix);
-        glUniformMatrix4fv(viewMatrixUniform, 1, GL_FALSE, viewMatrix);
-        glUniformMatrix4fv(projectionMatrixUniform, 1, GL_FALSE, projectionMatrix);
+    /* depth only pass per shadow map layer */
+    glUseProgram(depthProgramObject);
+    shadowMapBegin(&shadowMap);
+    for (uint32_t cascade = 0U; cascade < shadowMap.nCascades; ++cascade)
+    {
+        glUniformMatrix4fv(lightMatrixUniform, 1, GL_FALSE, shadowMapBeginCascade(&shadowMap, cascade));
+        arenaDrawRange(&arena, scene.firstCaster, scene.nCasters);
+    }
+    shadowMapEnd(&shadowMap);
 
-        glUniform3fv(lightUniform.ambient, 1, light.getAmbient());
-        glUniform3fv(lightUniform.diffuse, 1, light.getDiffuse());
-        glUniform3fv(lightUniform.specular, 1, light.getSpecular());
-        glUniform3fv(lightUniform.position, 1, light.getPosition());
-        glUniform3fv(lightUniform.direction, 1, light.getDirection());
-        glUniform1f(lightUniform.constant, light.getConstantAttenuation());
-        glUniform1f(lightUniform.linear, light.getLinearAttenuation());
-        glUniform1f(lightUniform.quadratic, light.getQuadraticAttenuation());
-        glUniform1f(lightUniform.cutOff, light.getCutOff());
-        glUniform1f(lightUniform.outerCutOff, light.getOuterCutOff());
+    uniformRingBeginFrame(&uniformRing);
 
-        glUniform3fv(cameraPositionUniform, 1, cameraPosition);
+    glUseProgram(shaderProgramObject);
+    {
+        FrameBlock frameBlock;
+        frameBlock.viewMatrix       = viewMatrix;
+        frameBlock.projectionMatrix = projectionMatrix;
+        frameBlock.cameraPosition   = cameraPosition;
+        frameBlock.padding          = 0.0f;
+        packLight(&light, &frameBlock.light);
+        uniformRingBind(&uniformRing, AMC_BINDING_FRAME, &frameBlock, sizeof(frameBlock));
+        uniformRingBind(&uniformRing, SHADOW_BINDING_BLOCK, &shadowMap.block, sizeof(shadowMap.block));
+        shadowMapBind(&shadowMap);
+
+        /* point lights are binned into froxels of this view before any draw reads them */
+        updatePointLights(clustersBeginFrame(&clusters), nPointLights, angle);
+        clustersBuild(&clusters, nPointLights, viewMatrix, projectionMatrix, Z_NEAR, Z_FAR, viewportWidth, viewportHeight);
+        clustersBind(&clusters);
+
+        arenaDrawRange(&arena, scene.firstVisible, scene.nVisible);
+    }
 
-        glUniform4fv(materialUniform.ambient, 1, material.getAmbient());
-        glUniform4fv(materialUniform.diffuse, 1, material.getDiffuse());
-        glUniform4fv(materialUniform.specular, 1, material.getSpecular());
-        glUniform1f(materialUniform.shininess, material.getShininess());
+    /* depth of the opaque scene for the occlusion tests of the next frames */
+    sceneCaptureDepth(&scene, projectionMatrix * viewMatrix, viewportWidth, viewportHeight);
 
-        glDrawElements(GL_TRIANGLES, model.header.nIndices, GL_UNSIGNED_INT, 0);
+    /* spheres share the material of the plane, their transforms come from the instance buffer */
+    if (0U < nInstances)
+    {
+        updateInstances(instancingBeginFrame(&instancing), nInstances, angle);
+        instancingCull(&instancing, nInstances, projectionMatrix * viewMatrix);
+
+        glUseProgram(instanceProgramObject);
+        instancingDraw(&instancing);
+        instancingEndFrame(&instancing);
     }
-    glBindVertexArray(0U);
+
+    uniformRingEndFrame(&uniformRing);
 }
 
 void update()
 {
-    rotationAngle += 0.01;
-    if (360.0f < rotationAngle)
+    previousRotationAngle = rotationAngle;
+    if (True == bAnimationEnabled)
     {
-        rotationAngle -= 360.0f;
+        rotationAngle += ROTATION_SPEED * (float)runLoop.step;
+        if (360.0f < rotationAngle)
+        {
+            rotationAngle -= 360.0f;
+            previousRotationAngle -= 360.0f;
+        }
     }
-
-    light.setDirection(vec3(debug*cosf(rotationAngle), -1.0f, debug*sinf(rotationAngle)));
 }
 
 void toggleFullscreen(void)
@@ -698,6 +1110,7 @@ void toggleFullscreen(void)
 void uninitialize()
 {
     unloadModel(&model);
+    unloadModel(&sphere);
 
     GLXContext currentGLXContext = nullptr;
     if (0U != shaderProgramObject)
@@ -727,24 +1140,43 @@ void uninitialize()
         shaderProgramObject = 0U;
     }
 
-    /* Release Buffer objects */
-    if (0U != modelUniform.positions)
+    if (0U != depthProgramObject)
     {
-        glDeleteBuffers(1, &modelUniform.positions);
-        modelUniform.positions = 0U;
+        GLuint  shaders[2] = {};
+        GLsizei nShaders   = 0;
+        glGetAttachedShaders(depthProgramObject, 2, &nShaders, shaders);
+        for (GLsizei idx = 0; idx < nShaders; ++idx)
+        {
+            glDetachShader(depthProgramObject, shaders[idx]);
+            glDeleteShader(shaders[idx]);
+        }
+        glDeleteProgram(depthProgramObject);
+        depthProgramObject = 0U;
     }
 
-    if (0U != modelUniform.ebo)
+    if (0U != instanceProgramObject)
     {
-        glDeleteBuffers(1, &modelUniform.ebo);
-        modelUniform.ebo = 0U;
+        GLuint  shaders[2] = {};
+        GLsizei nShaders   = 0;
+        glGetAttachedShaders(instanceProgramObject, 2, &nShaders, shaders);
+        for (GLsizei idx = 0; idx < nShaders; ++idx)
+        {
+            glDetachShader(instanceProgramObject, shaders[idx]);
+            glDeleteShader(shaders[idx]);
+        }
+        glDeleteProgram(instanceProgramObject);
+        instanceProgramObject = 0U;
     }
 
-    if (0U != modelUniform.vao)
-    {
-        glDeleteVertexArrays(1, &modelUniform.vao);
-        modelUniform.vao = 0U;
-    }
+    /* Release Buffer objects */
+    uniformRingUninitialize(&uniformRing);
+    instancingUninitialize(&instancing);
+    sceneUninitialize(&scene);
+    arenaUninitialize(&arena);
+    clustersUninitialize(&clusters);
+    shadowMapUninitialize(&shadowMap);
+
+    deleteModelBuffers(&sphereUniform);
 
     currentGLXContext = glXGetCurrentContext();
     if ((nullptr != currentGLXContext) && (currentGLXContext == glxContext))
@@ -867,6 +1299,103 @@ GLint linkProgram(GLuint programId)
     return status;
 }
 
+void createModelBuffers(const Model* pModel, ModelUniform* pUniform)
+{
+    glGenVertexArrays(1, &pUniform->vao);
+    glBindVertexArray(pUniform->vao);
+
+    glGenBuffers(1, &pUniform->positions);
+    glBindBuffer(GL_ARRAY_BUFFER, pUniform->positions);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * pModel->header.nVertices, pModel->pVertices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(AMC_ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+    glEnableVertexAttribArray(AMC_ATTRIBUTE_POSITION);
+
+    glVertexAttribPointer(AMC_ATTRIBUTE_NORMALS, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(AMC_ATTRIBUTE_NORMALS);
+
+    glVertexAttribPointer(AMC_ATTRIBUTE_UVS, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texel));
+    glEnableVertexAttribArray(AMC_ATTRIBUTE_UVS);
+    glBindBuffer(GL_ARRAY_BUFFER, 0U);
+
+    glGenBuffers(1, &pUniform->ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pUniform->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * pModel->header.nIndices, pModel->pIndices, GL_STATIC_DRAW);
+
+    /*
+        The order of unbinding is important --
+        If Element buffer is unbound before vertex array buffer then we are indicating OpenGl
+        that we do not intend to use element buffer
+     */
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void deleteModelBuffers(ModelUniform* pUniform)
+{
+    if (0U != pUniform->positions)
+    {
+        glDeleteBuffers(1, &pUniform->positions);
+        pUniform->positions = 0U;
+    }
+
+    if (0U != pUniform->ebo)
+    {
+        glDeleteBuffers(1, &pUniform->ebo);
+        pUniform->ebo = 0U;
+    }
+
+    if (0U != pUniform->vao)
+    {
+        glDeleteVertexArrays(1, &pUniform->vao);
+        pUniform->vao = 0U;
+    }
+}
+
+void updateInstances(Instance* pInstances, uint32_t nInstances, float angle)
+{
+    /* square grid centred on the plane, large counts reach far outside the frustum */
+    uint32_t side   = (uint32_t)ceilf(sqrtf((float)nInstances));
+    float    origin = -0.5f * INSTANCE_SPACING * (float)(side - 1U);
+
+    /* all spheres spin around y, quaternion of half the angle */
+    vec4 rotation = vec4(0.0f, sinf(0.5f * angle), 0.0f, cosf(0.5f * angle));
+
+    for (uint32_t i = 0U; i < nInstances; ++i)
+    {
+        float x = origin + INSTANCE_SPACING * (float)(i % side);
+        float z = origin + INSTANCE_SPACING * (float)(i / side);
+        float y = INSTANCE_HEIGHT + 0.2f * sinf(angle + 0.5f * (x + z));
+
+        pInstances[i].rotation      = rotation;
+        pInstances[i].positionScale = vec4(x, y, z, INSTANCE_SCALE);
+    }
+}
+
+void updatePointLights(PointLight* pLights, uint32_t nLights, float angle)
+{
+    /* golden angle spiral over the plane, the whole spiral turns with the animation */
+    const float goldenAngle = 2.39996323f;
+
+    for (uint32_t i = 0U; i < nLights; ++i)
+    {
+        float distance = POINT_LIGHT_AREA * sqrtf(((float)i + 0.5f) / (float)nLights);
+        float theta    = goldenAngle * (float)i + angle;
+        float hue      = 6.0f * fmodf((float)i * 0.618034f, 1.0f);
+
+        /* hue to rgb, fully saturated */
+        vec3 color = vec3(fabsf(hue - 3.0f) - 1.0f, 2.0f - fabsf(hue - 2.0f), 2.0f - fabsf(hue - 4.0f));
+        for (int c = 0; c < 3; ++c)
+        {
+            color[c] = fminf(fmaxf(color[c], 0.0f), 1.0f);
+        }
+
+        pLights[i].positionRadius = vec4(distance * cosf(theta), 0.15f + 0.1f * sinf(3.0f * angle + (float)i), distance * sinf(theta),
+                                         POINT_LIGHT_RADIUS);
+        pLights[i].color          = vec4(color, 1.0f);
+    }
+}
+
 GLuint loadGLTexture(const char* filename)
 {
     unsigned char* data      = nullptr;
@@ -918,3 +1447,62 @@ GLuint loadGLTexture(const char* filename)
 
     return texture;
 }
+
+int runHeadless(uint32_t nFrames, const char* pOutput)
+{
+    Headless headless = {};
+    if (0 != headlessInitialize(&headless, WIN_WIDTH, WIN_HEIGHT))
+    {
+        fprintf(gpFile, "%s: failed to create offscreen context\n", __func__);
+        return -1;
+    }
+
+    if (0 > initialize())
+    {
+        fprintf(gpFile, "%s: initialize failed\n", __func__);
+        headlessUninitialize(&headless);
+        return -1;
+    }
+    resize(WIN_WIDTH, WIN_HEIGHT);
+
+    /* same simulated time every run so frames can be compared between runs */
+    uint32_t nSteps   = (uint32_t)(RUNLOOP_STEP_HZ / RUNLOOP_DEFAULT_FPS);
+    runLoop.step      = 1.0 / RUNLOOP_STEP_HZ;
+    bAnimationEnabled = True;
+
+    for (uint32_t frame = 0U; frame < nFrames; ++frame)
+    {
+        headlessBeginFrame(&headless);
+        for (uint32_t step = 0U; step < nSteps; ++step)
+        {
+            update();
+        }
+        display();
+        headlessEndFrame(&headless);
+    }
+    headlessFinish(&headless);
+    headlessReport(&headless, gpFile);
+    fprintf(gpFile, "uniform ring: %u of %u frames waited for the GPU\n", uniformRing.nStalls, nFrames);
+    if (0U < nPointLights)
+    {
+        fprintf(gpFile, "clusters: %u of %u point lights visible, longest froxel list %u, %u indices dropped\n", clusters.nVisible, nPointLights,
+                clusters.maxCount, clusters.nDropped);
+    }
+    fprintf(gpFile, "scene: %u objects, %u visible, %u outside the view, %u occluded, culling took %.3f ms per frame\n", (uint32_t)scene.objects.size(),
+            scene.nVisible, scene.nFrustumCulled, scene.nOccluded, (0U < scene.nCulls) ? scene.totalCullMs / (double)scene.nCulls : 0.0);
+    if (0U < nInstances)
+    {
+        fprintf(gpFile, "instancing: %u of %u instances visible, %u frames waited for the GPU\n", instancingVisibleCount(&instancing), nInstances,
+                instancing.nStalls);
+    }
+
+    int res = 0;
+    if (nullptr != pOutput)
+    {
+        res = headlessWriteFrame(&headless, pOutput);
+    }
+
+    uninitialize();
+    headlessUninitialize(&headless);
+    return res;
+}
@@ -7,3 +7,14 @@
  */
 
 #include "material.h"
+
+void packMaterial(const Material* pMaterial, MaterialBlock* pBlock)
+{
+    pBlock->ambient    = pMaterial->ambient;
+    pBlock->diffuse    = pMaterial->diffuse;
+    pBlock->specular   = pMaterial->specular;
+    pBlock->shininess  = pMaterial->shininess;
+    pBlock->padding[0] = 0.0f;
+    pBlock->padding[1] = 0.0f;
+    pBlock->padding[2] = 0.0f;
+}
@@ -0,0 +1,777 @@
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "scene.h"
+
+#define SCENE_STACK_SIZE 64U /**< nodes pending during a walk, the median split keeps the tree balanced */
+
+/* visibility flags of an object */
+enum
+{
+    SCENE_VISIBLE = 1U, /**< camera pass */
+    SCENE_CASTER  = 2U  /**< shadow passes */
+};
+
+/* result of a box against a frustum */
+enum
+{
+    SCENE_OUTSIDE = 0,
+    SCENE_INTERSECTING,
+    SCENE_INSIDE
+};
+
+/* farthest depth of SCENE_HIZ_TILE x SCENE_HIZ_TILE pixels per invocation */
+static const GLchar* reduceShaderSource =
+    "#version 450 core"
+    "\n"
+    "layout(local_size_x = 8, local_size_y = 8) in;"
+    "\n"
+    "layout(binding = 2) uniform sampler2D uDepth;"
+    "layout(std430, binding = 8) writeonly buffer Tiles"
+    "{"
+    "    float tiles[];"
+    "};"
+    "\n"
+    "uniform ivec2 uSize;"
+    "uniform uint  uOffset;"
+    "\n"
+    "void main(void)"
+    "{"
+    "    ivec2 nTiles = (uSize + 15) / 16;"
+    "    ivec2 tile   = ivec2(gl_GlobalInvocationID.xy);"
+    "    if (any(greaterThanEqual(tile, nTiles)))"
+    "        return;"
+    "\n"
+    "    ivec2 first    = tile * 16;"
+    "    ivec2 last     = min(first + 16, uSize);"
+    "    float farthest = 0.0;"
+    "    for (int y = first.y; y < last.y; ++y)"
+    "        for (int x = first.x; x < last.x; ++x)"
+    "            farthest = max(farthest, texelFetch(uDepth, ivec2(x, y), 0).r);"
+    "    tiles[uOffset + uint(tile.y * nTiles.x + tile.x)] = farthest;"
+    "}";
+
+/**
+ * @brief Planes of a frustum as structure of arrays, padded to 8 with planes that contain everything
+ */
+struct FrustumPlanes
+{
+    float x[8];
+    float y[8];
+    float z[8];
+    float w[8];
+    float absX[8]; /**< absolute normals, for the radius of a box along the normal */
+    float absY[8];
+    float absZ[8];
+};
+
+static double nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static GLuint buildReduceProgram(void)
+{
+    GLint  status  = GL_FALSE;
+    GLint  length  = 0;
+    GLchar log[1024];
+    GLuint shader  = glCreateShader(GL_COMPUTE_SHADER);
+    GLuint program = 0U;
+
+    glShaderSource(shader, 1, &reduceShaderSource, nullptr);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (GL_FALSE == status)
+    {
+        glGetShaderInfoLog(shader, sizeof(log), &length, log);
+        fprintf(stderr, "Depth reduction shader compilation error log: %s\n", log);
+        glDeleteShader(shader);
+        return 0U;
+    }
+
+    program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (GL_FALSE == status)
+    {
+        glGetProgramInfoLog(program, sizeof(log), &length, log);
+        fprintf(stderr, "Depth reduction program linking error log: %s\n", log);
+        glDeleteProgram(program);
+        return 0U;
+    }
+    return program;
+}
+
+static SceneBounds unite(const SceneBounds& a, const SceneBounds& b)
+{
+    SceneBounds result;
+    for (int i = 0; i < 3; ++i)
+    {
+        result.min[i] = fminf(a.min[i], b.min[i]);
+        result.max[i] = fmaxf(a.max[i], b.max[i]);
+    }
+    return result;
+}
+
+/* world box of a mesh, the box of the transformed box (Arvo) clipped to the box of the transformed sphere */
+static SceneBounds worldBounds(const SceneMesh& mesh, const vmath::mat4& modelMatrix)
+{
+    vmath::vec3 center = (mesh.bounds.min + mesh.bounds.max) * 0.5f;
+    vmath::vec3 extent = (mesh.bounds.max - mesh.bounds.min) * 0.5f;
+    float       scale  = 0.0f;
+    SceneBounds result;
+
+    for (int column = 0; column < 3; ++column)
+    {
+        vmath::vec3 axis = vmath::vec3(modelMatrix[column][0], modelMatrix[column][1], modelMatrix[column][2]);
+        scale            = fmaxf(scale, vmath::length(axis));
+    }
+
+    for (int row = 0; row < 3; ++row)
+    {
+        float boxCenter    = modelMatrix[3][row];
+        float boxExtent    = 0.0f;
+        float sphereCenter = modelMatrix[3][row];
+        for (int column = 0; column < 3; ++column)
+        {
+            boxCenter    += modelMatrix[column][row] * center[column];
+            boxExtent    += fabsf(modelMatrix[column][row]) * extent[column];
+            sphereCenter += modelMatrix[column][row] * mesh.sphere[column];
+        }
+
+        float radius   = mesh.sphere[3] * scale;
+        result.min[row] = fmaxf(boxCenter - boxExtent, sphereCenter - radius);
+        result.max[row] = fminf(boxCenter + boxExtent, sphereCenter + radius);
+    }
+    return result;
+}
+
+static void extractPlanes(const vmath::mat4& viewProjection, FrustumPlanes* pPlanes)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        float plane[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        if (i < 6)
+        {
+            /* Gribb / Hartmann: planes are sums and differences of the last row with the others */
+            int   row  = i / 2;
+            float sign = (0 == i % 2) ? 1.0f : -1.0f;
+            for (int column = 0; column < 4; ++column)
+                plane[column] = viewProjection[column][3] + sign * viewProjection[column][row];
+
+            float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            for (int column = 0; column < 4; ++column)
+                plane[column] /= length;
+        }
+
+        pPlanes->x[i]    = plane[0];
+        pPlanes->y[i]    = plane[1];
+        pPlanes->z[i]    = plane[2];
+        pPlanes->w[i]    = plane[3];
+        pPlanes->absX[i] = fabsf(plane[0]);
+        pPlanes->absY[i] = fabsf(plane[1]);
+        pPlanes->absZ[i] = fabsf(plane[2]);
+    }
+}
+
+#if defined(VMATH_SSE)
+static inline bool anyNegative(vmath::simd::float4 v)
+{
+    return 0 != _mm_movemask_ps(_mm_cmplt_ps(v, _mm_setzero_ps()));
+}
+#elif defined(VMATH_NEON)
+static inline bool anyNegative(vmath::simd::float4 v)
+{
+    uint32x4_t mask = vcltq_f32(v, vdupq_n_f32(0.0f));
+    uint32x2_t half = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+    return 0U != (vget_lane_u32(half, 0) | vget_lane_u32(half, 1));
+}
+#endif
+
+/* distance of the box center to each plane against the radius of the box along its normal */
+static int classify(const FrustumPlanes* pPlanes, const SceneBounds& bounds)
+{
+    float cx = 0.5f * (bounds.min[0] + bounds.max[0]), ex = 0.5f * (bounds.max[0] - bounds.min[0]);
+    float cy = 0.5f * (bounds.min[1] + bounds.max[1]), ey = 0.5f * (bounds.max[1] - bounds.min[1]);
+    float cz = 0.5f * (bounds.min[2] + bounds.max[2]), ez = 0.5f * (bounds.max[2] - bounds.min[2]);
+    bool  bInside = true;
+
+#if defined(VMATH_SIMD)
+    using namespace vmath::simd;
+    const float4 centerX = splat4(cx), centerY = splat4(cy), centerZ = splat4(cz);
+    const float4 extentX = splat4(ex), extentY = splat4(ey), extentZ = splat4(ez);
+
+    /* four planes at a time */
+    for (int i = 0; i < 8; i += 4)
+    {
+        float4 distance = madd4(centerX, load4(pPlanes->x + i), madd4(centerY, load4(pPlanes->y + i), madd4(centerZ, load4(pPlanes->z + i), load4(pPlanes->w + i))));
+        float4 radius   = madd4(extentX, load4(pPlanes->absX + i), madd4(extentY, load4(pPlanes->absY + i), mul4(extentZ, load4(pPlanes->absZ + i))));
+        if (anyNegative(add4(distance, radius)))
+            return SCENE_OUTSIDE;
+        bInside = bInside && !anyNegative(sub4(distance, radius));
+    }
+#else
+    for (int i = 0; i < 6; ++i)
+    {
+        float distance = cx * pPlanes->x[i] + cy * pPlanes->y[i] + cz * pPlanes->z[i] + pPlanes->w[i];
+        float radius   = ex * pPlanes->absX[i] + ey * pPlanes->absY[i] + ez * pPlanes->absZ[i];
+        if (distance + radius < 0.0f)
+            return SCENE_OUTSIDE;
+        bInside = bInside && (distance - radius >= 0.0f);
+    }
+#endif
+
+    return bInside ? SCENE_INSIDE : SCENE_INTERSECTING;
+}
+
+/* nearest depth of the box in the view of the pyramid against the farthest depth of the 2x2 texels it covers */
+static bool isOccluded(const Scene* pScene, const SceneBounds& bounds)
+{
+    const SceneDepthReadback& source = pScene->pyramidSource;
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, nearest = FLT_MAX;
+
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        vmath::vec4 clip = source.viewProjection * vmath::vec4((corner & 1) ? bounds.max[0] : bounds.min[0], (corner & 2) ? bounds.max[1] : bounds.min[1],
+                                                               (corner & 4) ? bounds.max[2] : bounds.min[2], 1.0f);
+
+        /* boxes reaching behind the camera cover the whole view */
+        if (clip[3] <= 1e-4f)
+            return false;
+
+        float inverse = 1.0f / clip[3];
+        minX          = fminf(minX, clip[0] * inverse);
+        maxX          = fmaxf(maxX, clip[0] * inverse);
+        minY          = fminf(minY, clip[1] * inverse);
+        maxY          = fmaxf(maxY, clip[1] * inverse);
+        nearest       = fminf(nearest, clip[2] * inverse);
+    }
+
+    /* outside the old view nothing is known about it */
+    if (maxX < -1.0f || 1.0f < minX || maxY < -1.0f || 1.0f < minY)
+        return false;
+
+    /* normalized device coordinates to texels of level 0 */
+    float    scaleX = 0.5f * (float)source.width / (float)SCENE_HIZ_TILE;
+    float    scaleY = 0.5f * (float)source.height / (float)SCENE_HIZ_TILE;
+    uint32_t x0     = (uint32_t)fmaxf((fmaxf(minX, -1.0f) + 1.0f) * scaleX, 0.0f);
+    uint32_t y0     = (uint32_t)fmaxf((fmaxf(minY, -1.0f) + 1.0f) * scaleY, 0.0f);
+    uint32_t x1     = std::min((uint32_t)((fminf(maxX, 1.0f) + 1.0f) * scaleX), pScene->levelWidths[0] - 1U);
+    uint32_t y1     = std::min((uint32_t)((fminf(maxY, 1.0f) + 1.0f) * scaleY), pScene->levelHeights[0] - 1U);
+
+    /* coarsest level first where the rectangle spans at most 2x2 texels */
+    uint32_t level = 0U;
+    while (level + 1U < pScene->nLevels && (1U < (x1 >> level) - (x0 >> level) || 1U < (y1 >> level) - (y0 >> level)))
+    {
+        ++level;
+    }
+
+    const float* pLevel   = pScene->pyramid.data() + pScene->levelOffsets[level];
+    float        farthest = 0.0f;
+    for (uint32_t y = y0 >> level; y <= (y1 >> level); ++y)
+    {
+        for (uint32_t x = x0 >> level; x <= (x1 >> level); ++x)
+        {
+            farthest = fmaxf(farthest, pLevel[y * pScene->levelWidths[level] + x]);
+        }
+    }
+
+    return farthest < nearest * 0.5f + 0.5f;
+}
+
+/* flag objects of every node the frustum touches, occlusion only for the camera */
+static void cullTree(Scene* pScene, const FrustumPlanes* pPlanes, uint8_t flag, bool bOcclusion)
+{
+    uint32_t stack[SCENE_STACK_SIZE];
+    bool     inside[SCENE_STACK_SIZE];
+    uint32_t nPending = 0U;
+
+    if (pScene->nodes.empty())
+        return;
+
+    stack[nPending]  = 0U;
+    inside[nPending] = false;
+    ++nPending;
+    while (0U < nPending)
+    {
+        --nPending;
+        const SceneNode& node    = pScene->nodes[stack[nPending]];
+        bool             bInside = inside[nPending];
+        ++pScene->nNodesVisited;
+
+        if (!bInside)
+        {
+            int result = classify(pPlanes, node.bounds);
+            if (SCENE_OUTSIDE == result)
+                continue;
+            bInside = (SCENE_INSIDE == result);
+        }
+
+        if (bOcclusion && isOccluded(pScene, node.bounds))
+        {
+            pScene->nOccluded += node.count;
+            continue;
+        }
+
+        /* without occlusion a node inside the frustum takes its whole subtree */
+        if (bInside && !bOcclusion)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                pScene->flags[pScene->order[i]] |= flag;
+            continue;
+        }
+
+        if (0U == node.right)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                uint32_t           object = pScene->order[i];
+                const SceneBounds& bounds = pScene->objects[object].bounds;
+                if (!bInside && SCENE_OUTSIDE == classify(pPlanes, bounds))
+                    continue;
+                if (bOcclusion && isOccluded(pScene, bounds))
+                {
+                    ++pScene->nOccluded;
+                    continue;
+                }
+                pScene->flags[object] |= flag;
+            }
+            continue;
+        }
+
+        if (nPending + 2U > SCENE_STACK_SIZE)
+        {
+            /* deeper than a balanced tree gets, keep the subtree rather than drop it */
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                pScene->flags[pScene->order[i]] |= flag;
+            continue;
+        }
+
+        uint32_t index   = (uint32_t)(&node - pScene->nodes.data());
+        stack[nPending]  = node.right;
+        inside[nPending] = bInside;
+        ++nPending;
+        stack[nPending]  = index + 1U;
+        inside[nPending] = bInside;
+        ++nPending;
+    }
+}
+
+static uint32_t buildNode(Scene* pScene, uint32_t first, uint32_t count)
+{
+    uint32_t  index = (uint32_t)pScene->nodes.size();
+    SceneNode node  = {};
+
+    node.first  = first;
+    node.count  = count;
+    node.bounds = pScene->objects[pScene->order[first]].bounds;
+
+    SceneBounds centers = {node.bounds.min, node.bounds.min};
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        const SceneBounds& bounds = pScene->objects[pScene->order[i]].bounds;
+        vmath::vec3        center = (bounds.min + bounds.max) * 0.5f;
+        node.bounds               = unite(node.bounds, bounds);
+        centers                   = unite((i == first) ? SceneBounds{center, center} : centers, SceneBounds{center, center});
+    }
+    pScene->nodes.push_back(node);
+
+    if (SCENE_LEAF_SIZE >= count)
+        return index;
+
+    /* median of the centers along the longest axis of their box, both halves get the same number of objects */
+    vmath::vec3 spread = centers.max - centers.min;
+    int         axis   = (spread[0] >= spread[1] && spread[0] >= spread[2]) ? 0 : ((spread[1] >= spread[2]) ? 1 : 2);
+    uint32_t    middle = first + count / 2U;
+    std::nth_element(pScene->order.begin() + first, pScene->order.begin() + middle, pScene->order.begin() + first + count,
+                     [pScene, axis](uint32_t a, uint32_t b) {
+                         const SceneBounds& boundsA = pScene->objects[a].bounds;
+                         const SceneBounds& boundsB = pScene->objects[b].bounds;
+                         return boundsA.min[axis] + boundsA.max[axis] < boundsB.min[axis] + boundsB.max[axis];
+                     });
+
+    buildNode(pScene, first, middle - first);
+    uint32_t right            = buildNode(pScene, middle, first + count - middle);
+    pScene->nodes[index].right = right;
+    return index;
+}
+
+/* max pyramid of the newest reduction the GPU finished, older ones are stale then */
+static void pollReadbacks(Scene* pScene)
+{
+    for (uint32_t age = 1U; age <= SCENE_HIZ_FRAMES; ++age)
+    {
+        uint32_t            region    = (pScene->region + SCENE_HIZ_FRAMES - age) % SCENE_HIZ_FRAMES;
+        SceneDepthReadback* pReadback = &pScene->readbacks[region];
+        if (0 == pReadback->fence)
+            continue;
+
+        GLenum result = glClientWaitSync(pReadback->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (GL_ALREADY_SIGNALED != result && GL_CONDITION_SATISFIED != result)
+            continue;
+
+        pScene->pyramidSource       = *pReadback;
+        pScene->pyramidSource.fence = 0;
+
+        /* level 0 is the reduction itself, every further level the max of 2x2 texels */
+        uint32_t width  = (pReadback->width + SCENE_HIZ_TILE - 1U) / SCENE_HIZ_TILE;
+        uint32_t height = (pReadback->height + SCENE_HIZ_TILE - 1U) / SCENE_HIZ_TILE;
+        uint32_t total  = 0U;
+        pScene->nLevels = 0U;
+        while (pScene->nLevels < 16U)
+        {
+            pScene->levelOffsets[pScene->nLevels] = total;
+            pScene->levelWidths[pScene->nLevels]  = width;
+            pScene->levelHeights[pScene->nLevels] = height;
+            total += width * height;
+            ++pScene->nLevels;
+            if (1U == width && 1U == height)
+                break;
+            width  = (width + 1U) / 2U;
+            height = (height + 1U) / 2U;
+        }
+
+        pScene->pyramid.resize(total);
+        std::copy(pScene->pReadback + region * pScene->regionTiles, pScene->pReadback + region * pScene->regionTiles + pScene->levelWidths[0] * pScene->levelHeights[0],
+                  pScene->pyramid.begin());
+        for (uint32_t level = 1U; level < pScene->nLevels; ++level)
+        {
+            const float* pFiner      = pScene->pyramid.data() + pScene->levelOffsets[level - 1U];
+            float*       pLevel      = pScene->pyramid.data() + pScene->levelOffsets[level];
+            uint32_t     finerWidth  = pScene->levelWidths[level - 1U];
+            uint32_t     finerHeight = pScene->levelHeights[level - 1U];
+            for (uint32_t y = 0U; y < pScene->levelHeights[level]; ++y)
+            {
+                for (uint32_t x = 0U; x < pScene->levelWidths[level]; ++x)
+                {
+                    uint32_t x1 = std::min(2U * x + 1U, finerWidth - 1U);
+                    uint32_t y1 = std::min(2U * y + 1U, finerHeight - 1U);
+                    pLevel[y * pScene->levelWidths[level] + x] =
+                        fmaxf(fmaxf(pFiner[2U * y * finerWidth + 2U * x], pFiner[2U * y * finerWidth + x1]), fmaxf(pFiner[y1 * finerWidth + 2U * x], pFiner[y1 * finerWidth + x1]));
+                }
+            }
+        }
+
+        /* this and every older reduction are done with */
+        for (uint32_t older = age; older <= SCENE_HIZ_FRAMES; ++older)
+        {
+            SceneDepthReadback* pOlder = &pScene->readbacks[(pScene->region + SCENE_HIZ_FRAMES - older) % SCENE_HIZ_FRAMES];
+            if (0 != pOlder->fence)
+            {
+                glDeleteSync(pOlder->fence);
+                pOlder->fence = 0;
+            }
+        }
+        return;
+    }
+}
+
+static void deleteDepthTargets(Scene* pScene)
+{
+    for (uint32_t i = 0U; i < SCENE_HIZ_FRAMES; ++i)
+    {
+        if (0 != pScene->readbacks[i].fence)
+        {
+            glDeleteSync(pScene->readbacks[i].fence);
+            pScene->readbacks[i].fence = 0;
+        }
+    }
+
+    if (0U != pScene->readbackBuffer)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pScene->readbackBuffer);
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+        glDeleteBuffers(1, &pScene->readbackBuffer);
+        pScene->readbackBuffer = 0U;
+        pScene->pReadback      = nullptr;
+    }
+
+    if (0U != pScene->depthTexture)
+    {
+        glDeleteTextures(1, &pScene->depthTexture);
+        pScene->depthTexture = 0U;
+    }
+
+    pScene->depthWidth  = 0;
+    pScene->depthHeight = 0;
+    pScene->nLevels     = 0U;
+}
+
+static int createDepthTargets(Scene* pScene, int width, int height)
+{
+    deleteDepthTargets(pScene);
+
+    glGenTextures(1, &pScene->depthTexture);
+    glBindTexture(GL_TEXTURE_2D, pScene->depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0U);
+
+    /* the GPU writes, the CPU reads frames later once the fence of the region is signalled */
+    pScene->regionTiles    = ((width + SCENE_HIZ_TILE - 1U) / SCENE_HIZ_TILE) * ((height + SCENE_HIZ_TILE - 1U) / SCENE_HIZ_TILE);
+    GLsizeiptr       size  = (GLsizeiptr)sizeof(float) * pScene->regionTiles * SCENE_HIZ_FRAMES;
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &pScene->readbackBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pScene->readbackBuffer);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, flags);
+    pScene->pReadback = (float*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, size, flags);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0U);
+
+    GLenum error = glGetError();
+    if (nullptr == pScene->pReadback || GL_NO_ERROR != error)
+    {
+        fprintf(stderr, "%s: failed to create %dx%d depth copy, error 0x%x\n", __func__, width, height, error);
+        deleteDepthTargets(pScene);
+        return -1;
+    }
+
+    pScene->depthWidth  = width;
+    pScene->depthHeight = height;
+    pScene->region      = 0U;
+    return 0;
+}
+
+int sceneInitialize(Scene* pScene, bool bOcclusion)
+{
+    pScene->meshes.clear();
+    pScene->objects.clear();
+    pScene->nodes.clear();
+    pScene->order.clear();
+    pScene->flags.clear();
+    pScene->pyramid.clear();
+    pScene->firstVisible   = 0U;
+    pScene->nVisible       = 0U;
+    pScene->firstCaster    = 0U;
+    pScene->nCasters       = 0U;
+    pScene->nFrustumCulled = 0U;
+    pScene->nOccluded      = 0U;
+    pScene->nNodesVisited  = 0U;
+    pScene->cullMs         = 0.0;
+    pScene->totalCullMs    = 0.0;
+    pScene->nCulls         = 0U;
+    pScene->bOcclusion     = false;
+    pScene->reduceProgram  = 0U;
+    pScene->depthTexture   = 0U;
+    pScene->readbackBuffer = 0U;
+    pScene->pReadback      = nullptr;
+    pScene->regionTiles    = 0U;
+    pScene->region         = 0U;
+    pScene->depthWidth     = 0;
+    pScene->depthHeight    = 0;
+    pScene->nLevels        = 0U;
+    for (uint32_t i = 0U; i < SCENE_HIZ_FRAMES; ++i)
+    {
+        pScene->readbacks[i].fence = 0;
+    }
+
+    if (bOcclusion)
+    {
+        pScene->reduceProgram = buildReduceProgram();
+        if (0U == pScene->reduceProgram)
+            return -1;
+        pScene->sizeUniform   = glGetUniformLocation(pScene->reduceProgram, "uSize");
+        pScene->offsetUniform = glGetUniformLocation(pScene->reduceProgram, "uOffset");
+        pScene->bOcclusion    = true;
+    }
+    return 0;
+}
+
+int sceneAddMesh(Scene* pScene, const Model* pModel, int arenaMesh)
+{
+    SceneMesh mesh = {};
+    mesh.arenaMesh = arenaMesh;
+    mesh.bounds    = SceneBounds{vmath::vec3(FLT_MAX, FLT_MAX, FLT_MAX), vmath::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX)};
+    for (uint32_t i = 0U; i < pModel->header.nVertices; ++i)
+    {
+        const Position& position = pModel->pVertices[i].position;
+        vmath::vec3     point    = vmath::vec3(position.x, position.y, position.z);
+        mesh.bounds              = unite(mesh.bounds, SceneBounds{point, point});
+    }
+
+    /* sphere around the center of the box, tighter than the box for round meshes under rotation */
+    vmath::vec3 center = (mesh.bounds.min + mesh.bounds.max) * 0.5f;
+    float       radius = 0.0f;
+    for (uint32_t i = 0U; i < pModel->header.nVertices; ++i)
+    {
+        const Position& position = pModel->pVertices[i].position;
+        radius                   = fmaxf(radius, vmath::length(vmath::vec3(position.x, position.y, position.z) - center));
+    }
+    mesh.sphere = vmath::vec4(center, radius);
+
+    pScene->meshes.push_back(mesh);
+    return (int)pScene->meshes.size() - 1;
+}
+
+uint32_t sceneAddObject(Scene* pScene, int mesh, const vmath::mat4& modelMatrix, uint32_t material)
+{
+    SceneObject object = {};
+    object.mesh        = mesh;
+    object.material    = material;
+    object.modelMatrix = modelMatrix;
+    object.bounds      = worldBounds(pScene->meshes[mesh], modelMatrix);
+
+    pScene->objects.push_back(object);
+    return (uint32_t)pScene->objects.size() - 1U;
+}
+
+void sceneSetTransform(Scene* pScene, uint32_t object, const vmath::mat4& modelMatrix)
+{
+    SceneObject& sceneObject = pScene->objects[object];
+    sceneObject.modelMatrix  = modelMatrix;
+    sceneObject.bounds       = worldBounds(pScene->meshes[sceneObject.mesh], modelMatrix);
+}
+
+void sceneBuild(Scene* pScene)
+{
+    uint32_t nObjects = (uint32_t)pScene->objects.size();
+
+    pScene->nodes.clear();
+    pScene->order.resize(nObjects);
+    pScene->flags.assign(nObjects, 0U);
+    for (uint32_t i = 0U; i < nObjects; ++i)
+    {
+        pScene->order[i] = i;
+    }
+
+    if (0U < nObjects)
+    {
+        pScene->nodes.reserve(2U * (nObjects / SCENE_LEAF_SIZE + 1U));
+        buildNode(pScene, 0U, nObjects);
+    }
+}
+
+void sceneRefit(Scene* pScene)
+{
+    /* children come after their parent */
+    for (size_t index = pScene->nodes.size(); 0U < index--;)
+    {
+        SceneNode& node = pScene->nodes[index];
+        if (0U == node.right)
+        {
+            node.bounds = pScene->objects[pScene->order[node.first]].bounds;
+            for (uint32_t i = node.first + 1U; i < node.first + node.count; ++i)
+                node.bounds = unite(node.bounds, pScene->objects[pScene->order[i]].bounds);
+        }
+        else
+        {
+            node.bounds = unite(pScene->nodes[index + 1U].bounds, pScene->nodes[node.right].bounds);
+        }
+    }
+}
+
+void sceneCull(Scene* pScene, GeometryArena* pArena, const vmath::mat4& viewProjection, const vmath::mat4* pCasterMatrices,
+               uint32_t nCasterMatrices)
+{
+    double        start = nowMs();
+    FrustumPlanes planes;
+
+    std::fill(pScene->flags.begin(), pScene->flags.end(), 0U);
+    pScene->nOccluded     = 0U;
+    pScene->nNodesVisited = 0U;
+
+    if (pScene->bOcclusion)
+        pollReadbacks(pScene);
+
+    extractPlanes(viewProjection, &planes);
+    cullTree(pScene, &planes, SCENE_VISIBLE, pScene->bOcclusion && 0U < pScene->nLevels);
+    for (uint32_t i = 0U; i < nCasterMatrices; ++i)
+    {
+        extractPlanes(pCasterMatrices[i], &planes);
+        cullTree(pScene, &planes, SCENE_CASTER, false);
+    }
+
+    /* camera only, both, shadow casters only: each pass draws two neighbouring ranges */
+    static const uint8_t groups[3] = {SCENE_VISIBLE, SCENE_VISIBLE | SCENE_CASTER, SCENE_CASTER};
+    uint32_t             counts[3] = {0U, 0U, 0U};
+    uint32_t             first     = (uint32_t)pArena->commands.size();
+    for (int group = 0; group < 3; ++group)
+    {
+        for (uint32_t i = 0U; i < (uint32_t)pScene->objects.size(); ++i)
+        {
+            const SceneObject& object = pScene->objects[i];
+            if (groups[group] == pScene->flags[i] && arenaAddDraw(pArena, pScene->meshes[object.mesh].arenaMesh, object.modelMatrix, object.material))
+                ++counts[group];
+        }
+    }
+
+    pScene->firstVisible   = first;
+    pScene->nVisible       = counts[0] + counts[1];
+    pScene->firstCaster    = first + counts[0];
+    pScene->nCasters       = counts[1] + counts[2];
+    pScene->nFrustumCulled = (uint32_t)pScene->objects.size() - pScene->nVisible - pScene->nOccluded;
+    pScene->cullMs         = nowMs() - start;
+    pScene->totalCullMs   += pScene->cullMs;
+    ++pScene->nCulls;
+}
+
+void sceneCaptureDepth(Scene* pScene, const vmath::mat4& viewProjection, int width, int height)
+{
+    if (!pScene->bOcclusion || 0 >= width || 0 >= height)
+        return;
+
+    if ((width != pScene->depthWidth || height != pScene->depthHeight) && 0 != createDepthTargets(pScene, width, height))
+    {
+        pScene->bOcclusion = false;
+        return;
+    }
+
+    /* the GPU is SCENE_HIZ_FRAMES frames behind, skip a capture rather than wait for it */
+    SceneDepthReadback* pReadback = &pScene->readbacks[pScene->region];
+    if (0 != pReadback->fence)
+    {
+        GLenum result = glClientWaitSync(pReadback->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (GL_ALREADY_SIGNALED != result && GL_CONDITION_SATISFIED != result)
+            return;
+        glDeleteSync(pReadback->fence);
+        pReadback->fence = 0;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + SCENE_HIZ_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, pScene->depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    glUseProgram(pScene->reduceProgram);
+    glUniform2i(pScene->sizeUniform, width, height);
+    glUniform1ui(pScene->offsetUniform, pScene->region * pScene->regionTiles);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCENE_BINDING_HIZ, pScene->readbackBuffer);
+    glDispatchCompute((width + 8 * SCENE_HIZ_TILE - 1U) / (8 * SCENE_HIZ_TILE), (height + 8 * SCENE_HIZ_TILE - 1U) / (8 * SCENE_HIZ_TILE), 1U);
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+    pReadback->fence          = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pReadback->viewProjection = viewProjection;
+    pReadback->width          = (uint32_t)width;
+    pReadback->height         = (uint32_t)height;
+    pScene->region            = (pScene->region + 1U) % SCENE_HIZ_FRAMES;
+
+    glBindTexture(GL_TEXTURE_2D, 0U);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(0U);
+}
+
+void sceneUninitialize(Scene* pScene)
+{
+    deleteDepthTargets(pScene);
+
+    if (0U != pScene->reduceProgram)
+    {
+        glDeleteProgram(pScene->reduceProgram);
+        pScene->reduceProgram = 0U;
+    }
+
+    pScene->meshes.clear();
+    pScene->objects.clear();
+    pScene->nodes.clear();
+    pScene->order.clear();
+    pScene->flags.clear();
+    pScene->pyramid.clear();
+    pScene->bOcclusion = false;
+}
@@ -0,0 +1,183 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "shadowmap.h"
+
+#define SHADOW_SPLIT_LAMBDA 0.75f /**< blend of logarithmic and uniform cascade splits */
+
+/* clip space -1 to 1 into texture coordinates and depth 0 to 1 */
+static const vmath::mat4 textureBias = vmath::mat4(vmath::vec4(0.5f, 0.0f, 0.0f, 0.0f), vmath::vec4(0.0f, 0.5f, 0.0f, 0.0f),
+                                                   vmath::vec4(0.0f, 0.0f, 0.5f, 0.0f), vmath::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+/* lookat needs an up vector that is not parallel to the direction */
+static vmath::vec3 upFor(const vmath::vec3& direction)
+{
+    return (0.99f < fabsf(vmath::normalize(direction)[1])) ? vmath::vec3(1.0f, 0.0f, 0.0f) : vmath::vec3(0.0f, 1.0f, 0.0f);
+}
+
+int shadowMapInitialize(ShadowMap* pShadowMap, GLsizei size, uint32_t nCascades)
+{
+    pShadowMap->size      = size;
+    pShadowMap->nCascades = (SHADOW_MAX_CASCADES < nCascades) ? SHADOW_MAX_CASCADES : ((0U < nCascades) ? nCascades : 1U);
+    pShadowMap->block     = ShadowBlock{};
+    for (uint32_t i = 0U; i < SHADOW_MAX_CASCADES; ++i)
+    {
+        pShadowMap->lightMatrices[i] = vmath::mat4::identity();
+    }
+
+    glGenTextures(1, &pShadowMap->texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, pShadowMap->texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, size, size, (GLsizei)pShadowMap->nCascades);
+
+    /* linear filtering of a compared texture averages four results, outside the map is lit */
+    const GLfloat border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0U);
+
+    /* depth only, the layer is attached by shadowMapBeginCascade */
+    glGenFramebuffers(1, &pShadowMap->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, pShadowMap->fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, pShadowMap->texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0U);
+
+    if (GL_FRAMEBUFFER_COMPLETE != status || GL_NO_ERROR != glGetError())
+    {
+        fprintf(stderr, "%s: failed to create %dx%d shadow map, framebuffer status 0x%x\n", __func__, size, size, status);
+        shadowMapUninitialize(pShadowMap);
+        return -1;
+    }
+
+    pShadowMap->block.params = vmath::vec4((float)pShadowMap->nCascades, 1.0f / (float)size, 0.0f, 0.0f);
+    return 0;
+}
+
+void shadowMapUpdateSpot(ShadowMap* pShadowMap, const vmath::vec3& position, const vmath::vec3& direction, float outerCutOff, float range)
+{
+    /* cone plus a few texels of margin for the filter taps at its rim */
+    float fovy  = 2.0f * vmath::degrees(acosf(outerCutOff)) * (1.0f + 4.0f / (float)pShadowMap->size);
+    float zNear = 0.01f * range;
+
+    vmath::mat4 view       = vmath::lookat(position, position + direction, upFor(direction));
+    vmath::mat4 projection = vmath::perspective(fovy, 1.0f, zNear, range);
+
+    pShadowMap->lightMatrices[0]  = projection * view;
+    pShadowMap->block.matrices[0] = textureBias * pShadowMap->lightMatrices[0];
+    pShadowMap->block.splits      = vmath::vec4(range, range, range, range);
+    pShadowMap->block.texels[0]   = 2.0f * tanf(vmath::radians(0.5f * fovy)) / (float)pShadowMap->size;
+    pShadowMap->block.params[0]   = 1.0f;
+}
+
+void shadowMapUpdateDirectional(ShadowMap* pShadowMap, const vmath::vec3& direction, const vmath::mat4& viewMatrix, float fovy, float aspect,
+                                float zNear, float shadowDistance, float casterDistance)
+{
+    vmath::mat4 cameraToWorld  = vmath::inverse(viewMatrix);
+    vmath::vec3 lightDirection = vmath::normalize(direction);
+    vmath::vec3 up             = upFor(lightDirection);
+    float       tanY           = tanf(vmath::radians(0.5f * fovy));
+    float       tanX           = tanY * aspect;
+    float       nCascades      = (float)pShadowMap->nCascades;
+
+    float sliceNear = zNear;
+    for (uint32_t cascade = 0U; cascade < pShadowMap->nCascades; ++cascade)
+    {
+        /* practical split scheme, mostly logarithmic with a uniform share for the far cascades */
+        float ratio    = (float)(cascade + 1U) / nCascades;
+        float sliceFar = SHADOW_SPLIT_LAMBDA * zNear * powf(shadowDistance / zNear, ratio) +
+                         (1.0f - SHADOW_SPLIT_LAMBDA) * (zNear + (shadowDistance - zNear) * ratio);
+
+        /* bounding sphere of the slice, its size does not change when the camera turns */
+        vmath::vec3 corners[8];
+        vmath::vec3 center = vmath::vec3(0.0f, 0.0f, 0.0f);
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            float       depth = (corner & 4) ? sliceFar : sliceNear;
+            vmath::vec4 world = cameraToWorld * vmath::vec4(((corner & 1) ? tanX : -tanX) * depth, ((corner & 2) ? tanY : -tanY) * depth, -depth, 1.0f);
+            corners[corner]   = vmath::vec3(world[0], world[1], world[2]);
+            center += corners[corner];
+        }
+        center = center * 0.125f;
+
+        float radius = 0.0f;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            radius = fmaxf(radius, vmath::length(corners[corner] - center));
+        }
+        radius = ceilf(radius * 16.0f) / 16.0f;
+
+        /* the light looks at the sphere from far enough to catch occluders outside of it */
+        vmath::mat4 view       = vmath::lookat(center - lightDirection * (radius + casterDistance), center, up);
+        vmath::mat4 projection = vmath::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + casterDistance);
+
+        /* move by less than a texel so the world origin lands on a texel, texels stay put while the sphere moves */
+        vmath::vec4 origin  = (projection * view) * vmath::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        float       texels  = 0.5f * (float)pShadowMap->size;
+        projection[3][0]   += (roundf(origin[0] * texels) - origin[0] * texels) / texels;
+        projection[3][1]   += (roundf(origin[1] * texels) - origin[1] * texels) / texels;
+
+        pShadowMap->lightMatrices[cascade]  = projection * view;
+        pShadowMap->block.matrices[cascade] = textureBias * pShadowMap->lightMatrices[cascade];
+        pShadowMap->block.splits[cascade]   = sliceFar;
+        pShadowMap->block.texels[cascade]   = 2.0f * radius / (float)pShadowMap->size;
+        sliceNear                           = sliceFar;
+    }
+    pShadowMap->block.params[0] = nCascades;
+}
+
+void shadowMapBegin(ShadowMap* pShadowMap)
+{
+    /* the scene may be drawn into a framebuffer of its own, e.g. headless */
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &pShadowMap->previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, pShadowMap->previousViewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, pShadowMap->fbo);
+    glViewport(0, 0, pShadowMap->size, pShadowMap->size);
+
+    /* slope scaled bias against acne, applied where the depth is written */
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+}
+
+const vmath::mat4& shadowMapBeginCascade(ShadowMap* pShadowMap, uint32_t cascade)
+{
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, pShadowMap->texture, 0, (GLint)cascade);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    return pShadowMap->lightMatrices[cascade];
+}
+
+void shadowMapEnd(ShadowMap* pShadowMap)
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)pShadowMap->previousFramebuffer);
+    glViewport(pShadowMap->previousViewport[0], pShadowMap->previousViewport[1], pShadowMap->previousViewport[2], pShadowMap->previousViewport[3]);
+}
+
+void shadowMapBind(const ShadowMap* pShadowMap)
+{
+    glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, pShadowMap->texture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void shadowMapUninitialize(ShadowMap* pShadowMap)
+{
+    if (0U != pShadowMap->fbo)
+    {
+        glDeleteFramebuffers(1, &pShadowMap->fbo);
+        pShadowMap->fbo = 0U;
+    }
+
+    if (0U != pShadowMap->texture)
+    {
+        glDeleteTextures(1, &pShadowMap->texture);
+        pShadowMap->texture = 0U;
+    }
+}
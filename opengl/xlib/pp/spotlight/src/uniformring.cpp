@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "uniformring.h"
+
+#define UNIFORM_RING_TIMEOUT 1000000000ULL /**< nanoseconds to wait for a fence before reporting */
+
+int uniformRingInitialize(UniformRing* pRing, GLsizeiptr regionSize)
+{
+    memset(pRing, 0, sizeof(UniformRing));
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &pRing->alignment);
+    if (0 >= pRing->alignment)
+        pRing->alignment = 256;
+
+    /* every region starts aligned so the first block of a frame can be bound */
+    pRing->regionSize = (regionSize + pRing->alignment - 1) / pRing->alignment * pRing->alignment;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &pRing->buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, pRing->buffer);
+    glBufferStorage(GL_UNIFORM_BUFFER, pRing->regionSize * UNIFORM_RING_FRAMES, nullptr, flags);
+    pRing->pMapped = (uint8_t*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, pRing->regionSize * UNIFORM_RING_FRAMES, flags);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0U);
+
+    if (nullptr == pRing->pMapped)
+    {
+        fprintf(stderr, "%s: failed to map uniform buffer, error 0x%x\n", __func__, glGetError());
+        uniformRingUninitialize(pRing);
+        return -1;
+    }
+
+    /* BeginFrame advances to region 0 */
+    pRing->region = UNIFORM_RING_FRAMES - 1U;
+    return 0;
+}
+
+void uniformRingBeginFrame(UniformRing* pRing)
+{
+    pRing->region = (pRing->region + 1U) % UNIFORM_RING_FRAMES;
+    pRing->offset = 0;
+
+    GLsync fence = pRing->fences[pRing->region];
+    if (0 == fence)
+        return;
+
+    /* poll first, only count frames that actually waited */
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (GL_TIMEOUT_EXPIRED == result)
+    {
+        pRing->nStalls++;
+        do
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UNIFORM_RING_TIMEOUT);
+        } while (GL_TIMEOUT_EXPIRED == result);
+    }
+    if (GL_WAIT_FAILED == result)
+        fprintf(stderr, "%s: waiting for region %u failed\n", __func__, pRing->region);
+
+    glDeleteSync(fence);
+    pRing->fences[pRing->region] = 0;
+}
+
+bool uniformRingBind(UniformRing* pRing, GLuint binding, const void* pData, GLsizeiptr size)
+{
+    if (pRing->regionSize < pRing->offset + size)
+    {
+        fprintf(stderr, "%s: %ld bytes of uniforms do not fit in region of %ld bytes\n", __func__, (long)(pRing->offset + size),
+                (long)pRing->regionSize);
+        return false;
+    }
+
+    GLintptr offset = (GLintptr)pRing->region * pRing->regionSize + pRing->offset;
+    memcpy(pRing->pMapped + offset, pData, size);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, pRing->buffer, offset, size);
+
+    pRing->offset += (size + pRing->alignment - 1) / pRing->alignment * pRing->alignment;
+    return true;
+}
+
+void uniformRingEndFrame(UniformRing* pRing)
+{
+    pRing->fences[pRing->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void uniformRingUninitialize(UniformRing* pRing)
+{
+    for (uint32_t i = 0U; i < UNIFORM_RING_FRAMES; ++i)
+    {
+        if (0 != pRing->fences[i])
+        {
+            glClientWaitSync(pRing->fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, UNIFORM_RING_TIMEOUT);
+            glDeleteSync(pRing->fences[i]);
+            pRing->fences[i] = 0;
+        }
+    }
+
+    if (0U != pRing->buffer)
+    {
+        if (nullptr != pRing->pMapped)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, pRing->buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0U);
+            pRing->pMapped = nullptr;
+        }
+        glDeleteBuffers(1, &pRing->buffer);
+        pRing->buffer = 0U;
+    }
+}
@@ -3,7 +3,16 @@
 
 #include <GL/glew.h>
 
-GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path, GLuint* program);
+/**
+ * @brief Compile and link a program, or restore it from the program binary cache
+ *
+ * Linked programs are saved with glGetProgramBinary to SHADER_CACHE_DIR
+ * (default ./shadercache, empty to disable) under a hash of the sources,
+ * defines and driver, and restored with glProgramBinary on later runs.
+ *
+ * @param pDefines [in] - "#define" lines inserted after #version, may be NULL
+ */
+GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path, GLuint* program, const char* pDefines = NULL);
 
 GLint loadShader(GLuint shaderId, const char* pFilename);
 #endif
@@ -0,0 +1,108 @@
+#ifndef SHADERRELOAD_H
+#define SHADERRELOAD_H
+
+/**
+ * @file    shaderreload.h
+ * @brief   Rebuild shader programs when their source files change
+ *
+ * Directories of registered vertex / fragment shaders are watched with
+ * inotify. A changed program is compiled and linked off the render loop:
+ * with GL_KHR/ARB_parallel_shader_compile the driver compiles on its own
+ * threads and shaderReloadUpdate() only polls GL_COMPLETION_STATUS, otherwise
+ * a worker thread compiles in a context shared with the render context and
+ * signals a fence. The new program replaces the old one only when it linked,
+ * on a failed build the old program stays in use and the log is printed.
+ */
+
+#include <GL/glew.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define SHADER_RELOAD_MAX_PROGRAMS 8U
+
+/**
+ * @brief Make the worker context current on the calling thread, or release it
+ *
+ * Called on the worker thread. The context has to share objects with the
+ * render context and be created on the render thread beforehand.
+ */
+typedef void (*PFNSHADERRELOADCURRENTPROC)(void* pUserData, bool bCurrent);
+
+struct ReloadProgram
+{
+    std::string vertexPath;
+    std::string fragmentPath;
+    int         watches[2];   /**< inotify watch of the directory of each file */
+    GLuint      program;      /**< program in use, owned by the registry */
+    uint32_t    generation;   /**< incremented on every swap, re-query uniform locations when it changes */
+    bool        bDirty;       /**< sources changed since the last build started */
+    bool        bBuilding;    /**< build in flight */
+    GLuint      pending;      /**< program being built */
+    GLuint      shaders[2];   /**< shaders of pending, parallel compile only */
+    GLsync      fence;        /**< signalled when the worker finished pending */
+};
+
+struct ShaderReload
+{
+    int           fd;                                  /**< inotify instance */
+    ReloadProgram programs[SHADER_RELOAD_MAX_PROGRAMS];
+    uint32_t      nPrograms;
+    bool          bParallel;                           /**< driver compiles in the background */
+
+    /* worker thread, without parallel shader compile */
+    PFNSHADERRELOADCURRENTPROC pfnCurrent;
+    void*                      pUserData;
+    std::thread                worker;
+    std::mutex                 mutex;
+    std::condition_variable    wake;
+    std::deque<uint32_t>       requests;              /**< programs to build */
+    std::deque<uint32_t>       results;               /**< programs built, fence set */
+    bool                       bQuit;
+};
+
+/**
+ * @brief Start watching, render context must be current
+ *
+ * @param pfnCurrent [in] - switches the worker context, NULL to build on the
+ *                          render thread when parallel compile is missing
+ * @param pUserData  [in] - passed to pfnCurrent
+ *
+ * @returns 0 on success else negative value
+ */
+int shaderReloadInitialize(ShaderReload* pReload, PFNSHADERRELOADCURRENTPROC pfnCurrent, void* pUserData);
+
+/**
+ * @brief Watch the sources of a linked program, the registry takes ownership of it
+ *
+ * @returns index of program else negative value
+ */
+int shaderReloadAdd(ShaderReload* pReload, const char* pVertexPath, const char* pFragmentPath, GLuint program);
+
+/**
+ * @brief Program to draw with this frame
+ */
+GLuint shaderReloadProgram(const ShaderReload* pReload, int index);
+
+/**
+ * @brief Number of times the program was replaced
+ */
+uint32_t shaderReloadGeneration(const ShaderReload* pReload, int index);
+
+/**
+ * @brief Read file events, start builds and swap in finished programs, call once per frame
+ *
+ * @returns true if a program was replaced
+ */
+bool shaderReloadUpdate(ShaderReload* pReload);
+
+/**
+ * @brief Stop watching, join worker and delete programs, render context must be current
+ */
+void shaderReloadUninitialize(ShaderReload* pReload);
+
+#endif // !SHADERRELOAD_H
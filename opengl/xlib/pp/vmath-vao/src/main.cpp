@@ -29,6 +29,7 @@
 #include <X11/keysymdef.h>
 #include "X11/XKBlib.h"
 #include "shader.h"
+#include "shaderreload.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include "vmath.h"
 #include "stb_image.h"
@@ -82,6 +83,25 @@ struct Vertex
     float v;
 };
 
+/**
+ * @brief Worker context of the shader reload thread
+ */
+struct WorkerContext
+{
+    Display*   dpy;
+    Window     w;
+    GLXContext ctxt; // shares objects with the render context
+};
+
+static void makeWorkerCurrent(void* pUserData, bool bCurrent)
+{
+    WorkerContext* pWorker = (WorkerContext*)pUserData;
+    if (bCurrent)
+        glXMakeCurrent(pWorker->dpy, pWorker->w, pWorker->ctxt);
+    else
+        glXMakeCurrent(pWorker->dpy, None, nullptr);
+}
+
 int main()
 {
     /* Windowing related variables */
@@ -106,6 +126,12 @@ int main()
     GLuint    texture      = 0U;    // handle to texture
     GLboolean shouldDraw   = false; // decide to render or not
 
+    /* Variables related to shader reload */
+    ShaderReload  reload;             // rebuilds program when shader sources change
+    WorkerContext worker       = {};  // context of the reload thread
+    int           programIndex = -1; // index of program in reload, negative without reload
+    uint32_t      generation   = 0U;  // generation of program MatrixID belongs to
+
     /* Variables related to texture */
     GLint width      = 0; // width of texture
     GLint height     = 0; // height of texture
@@ -129,6 +155,8 @@ int main()
 
     fclose(pFile);
 
+    /* shader reload thread makes its own context current */
+    XInitThreads();
     dpy = XOpenDisplay(NULL);
     if (!glXQueryVersion(dpy, &glxMajor, &glxMinor))
     {
@@ -195,6 +223,11 @@ int main()
         return -1;
     }
 
+    /* context of the shader reload thread, has to be created with the same visual */
+    worker.dpy  = dpy;
+    worker.w    = w;
+    worker.ctxt = glXCreateContext(dpy, vi, ctxt, GL_TRUE);
+
     /* free XVisual as it is not required */
     XFree(vi);
     vi = nullptr;
@@ -247,6 +280,13 @@ int main()
         return -1;
     }
 
+    if (0 != shaderReloadInitialize(&reload, (nullptr != worker.ctxt) ? makeWorkerCurrent : nullptr, &worker) ||
+        0 > (programIndex = shaderReloadAdd(&reload, "vertex.glsl", "fragment.glsl", program)))
+    {
+        std::cerr << "Shader reload is disabled\n";
+        programIndex = -1;
+    }
+
     /* register for window close event */
     wm_delete_window = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
     XSetWMProtocols(dpy, w, &wm_delete_window, 1);
@@ -319,6 +359,18 @@ int main()
         Model = vmath::translate(0.0f, 0.0f, 0.0f) * vmath::rotate(theta, 0.0f, 1.0f, 0.0f) * vmath::scale(1.0f, 1.0f, 1.0f);
         MVP   = Projection * View * Model;
 
+        /* swapped programs need their uniform locations again */
+        if (0 <= programIndex)
+        {
+            shaderReloadUpdate(&reload);
+            program = shaderReloadProgram(&reload, programIndex);
+            if (generation != shaderReloadGeneration(&reload, programIndex))
+            {
+                generation = shaderReloadGeneration(&reload, programIndex);
+                MatrixID   = glGetUniformLocation(program, "MVP");
+            }
+        }
+
         glUseProgram(program);
         glEnableVertexAttribArray(1);
         glBindTexture(GL_TEXTURE_2D, texture);
@@ -336,7 +388,11 @@ int main()
     /* resource cleanup */
     glDeleteBuffers(1, &vertexBuffer);
     glDeleteTextures(1, &texture);
-    glDeleteProgram(program);
+    if (0 > programIndex)
+        glDeleteProgram(program);
+    shaderReloadUninitialize(&reload);
+    if (nullptr != worker.ctxt)
+        glXDestroyContext(dpy, worker.ctxt);
     glXDestroyContext(dpy, ctxt);
     XFreeColormap(dpy, xattr.colormap);
     XDestroyWindow(dpy, w);
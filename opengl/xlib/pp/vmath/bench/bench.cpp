@@ -0,0 +1,271 @@
+/**
+ * @file        bench.cpp
+ * @description Micro benchmarks of float mat4 / vec4 operations in vmath.h
+ * @author      Rohit Nimkar
+ * @version     1.0
+ * @date        2024-03-02
+ * @copyright   Copyright 2024 Rohit Nimkar
+ *
+ * @attention
+ *  Use of this source code is governed by a BSD-style
+ *  license that can be found in the LICENSE file or at
+ *  opensource.org/licenses/BSD-3-Clause
+ *
+ * Built twice by "make bench", once as is and once with VMATH_NO_SIMD, so the
+ * SIMD specializations can be compared with the generic templates. Both
+ * builds print a checksum of the results; without FMA they must be equal.
+ * Inverses are left out of it, the SIMD one is a different algorithm.
+ * It lives in bench/ so the sample build (src/) never compiles it.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "vmath.h"
+
+#define BENCH_COUNT   1024U      /**< operands per pass, fits in L1 / L2 */
+#define BENCH_SECONDS 0.25       /**< minimum run time per operation */
+#define STREAM_COUNT  (1U << 22) /**< points per stream, 48 MB in and out */
+
+using namespace vmath;
+
+static mat4     gMatrices[BENCH_COUNT];
+static mat4     gResults[BENCH_COUNT];
+static vec4     gVectors[BENCH_COUNT];
+static vec4     gPoints[BENCH_COUNT];
+static vec3     gEyes[BENCH_COUNT];
+static float    gAngles[BENCH_COUNT];
+static uint32_t gChecksum = 2166136261U;
+
+/* same layout as Vertex of load.h */
+struct StreamVertex
+{
+    float position[3];
+    float normal[3];
+    float texel[2];
+};
+
+static StreamVertex* gpVertices;
+static soa3          gIn;
+static soa3          gOut;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* FNV-1a over the bits of the results, any rounding difference changes it */
+static void checksum(const void* pData, size_t size)
+{
+    const uint8_t* p = (const uint8_t*)pData;
+    for (size_t i = 0; i < size; i++)
+    {
+        gChecksum = (gChecksum ^ p[i]) * 16777619U;
+    }
+}
+
+static void matrixMultiply(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gResults[i] = gMatrices[i] * gMatrices[(i + 1) % BENCH_COUNT];
+}
+
+static void matrixVector(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gPoints[i] = gMatrices[i] * gVectors[i];
+}
+
+static void matrixTranspose(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gResults[i] = gMatrices[i].transpose();
+}
+
+static void matrixInverse(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gResults[i] = inverse(gMatrices[i]);
+}
+
+static void affineInverse(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gResults[i] = inverseAffine(gMatrices[i]);
+}
+
+static void normalMatrix(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+    {
+        const mat3 n  = inverseTranspose3x3(gMatrices[i]);
+        gResults[i][0] = vec4(n[0], 0.0f);
+        gResults[i][1] = vec4(n[1], 0.0f);
+        gResults[i][2] = vec4(n[2], 0.0f);
+    }
+}
+
+static void batchTransform(void)
+{
+    transform(gMatrices[0], gVectors, gPoints, BENCH_COUNT);
+}
+
+static void vectorArithmetic(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gPoints[i] = (gVectors[i] + gPoints[i]) * 0.5f - gVectors[(i + 1) % BENCH_COUNT] * gVectors[i];
+}
+
+static void viewMatrix(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gResults[i] = lookat(gEyes[i], vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+}
+
+static void rotationMatrix(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gResults[i] = rotate(gAngles[i], 0.267261f, 0.534522f, 0.801784f);
+}
+
+static void projectionMatrix(void)
+{
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gResults[i] = perspective(30.0f + gAngles[i] * 0.1f, 16.0f / 9.0f, 0.1f, 100.0f);
+}
+
+static void run(const char* pName, void (*pfnPass)(void), const void* pResults)
+{
+    uint32_t passes = 0;
+    double   start  = now();
+    double   elapsed;
+
+    do
+    {
+        pfnPass();
+        passes++;
+        elapsed = now() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    /* results of one pass from the initial operands */
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+        gPoints[i] = gVectors[i];
+    pfnPass();
+    if (pResults == gResults)
+        checksum(gResults, sizeof(gResults));
+    else if (pResults == gPoints)
+        checksum(gPoints, sizeof(gPoints));
+
+    printf("%-12s %8.2f ns\n", pName, elapsed * 1e9 / ((double)passes * BENCH_COUNT));
+}
+
+static void streamPoints(void)
+{
+    transformPoints(gMatrices[0], gIn, gOut, STREAM_COUNT);
+}
+
+static void streamNormals(void)
+{
+    transformNormals(gMatrices[0], gIn, gOut, STREAM_COUNT);
+}
+
+#if defined(VMATH_THREADS)
+static void streamPointsThreaded(void)
+{
+    transformPoints(gMatrices[0], gIn, gOut, STREAM_COUNT, 0);
+}
+#endif
+
+static void streamVertices(void)
+{
+    deinterleave(gpVertices[0].position, sizeof(StreamVertex), gIn, STREAM_COUNT);
+    transformPoints(gMatrices[0], gIn, gIn, STREAM_COUNT);
+    interleave(gIn, gpVertices[0].position, sizeof(StreamVertex), STREAM_COUNT);
+}
+
+/* bandwidth of one pass over large streams, bytes counts reads and writes */
+static void stream(const char* pName, void (*pfnPass)(void), double bytes)
+{
+    uint32_t passes = 0;
+    double   start  = now();
+    double   elapsed;
+
+    do
+    {
+        pfnPass();
+        passes++;
+        elapsed = now() - start;
+    } while (elapsed < BENCH_SECONDS * 4);
+
+    checksum(gOut.x, STREAM_COUNT * sizeof(float));
+    printf("%-12s %8.2f GB/s\n", pName, bytes * passes / elapsed * 1e-9);
+}
+
+int main(void)
+{
+#if defined(VMATH_AVX)
+    const char* pPath = "AVX";
+#elif defined(VMATH_SSE)
+    const char* pPath = "SSE";
+#elif defined(VMATH_NEON)
+    const char* pPath = "NEON";
+#else
+    const char* pPath = "generic";
+#endif
+
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+    {
+        for (int c = 0; c < 4; c++)
+            gMatrices[i][c] = vec4::random() * 2.0f - vecN<float,4>(1.0f);
+        gVectors[i] = vec4::random() * 10.0f;
+        gEyes[i]    = vec3::random() * 10.0f + vec3(0.0f, 0.0f, 1.0f);
+        gAngles[i]  = float(vmath::random<float>()) * 360.0f;
+    }
+
+    printf("vmath %s, ns per operation\n", pPath);
+    run("mat4 * mat4", matrixMultiply, gResults);
+    run("mat4 * vec4", matrixVector, gPoints);
+    run("transpose", matrixTranspose, gResults);
+    run("inverse", matrixInverse, NULL);
+    run("affine inv", affineInverse, NULL);
+    run("normal mat", normalMatrix, NULL);
+    run("transform", batchTransform, gPoints);
+    run("vec4 ops", vectorArithmetic, gPoints);
+    run("lookat", viewMatrix, gResults);
+    run("rotate", rotationMatrix, gResults);
+    run("perspective", projectionMatrix, gResults);
+
+    static float streams[6][STREAM_COUNT];
+    gIn.x      = streams[0];
+    gIn.y      = streams[1];
+    gIn.z      = streams[2];
+    gOut.x     = streams[3];
+    gOut.y     = streams[4];
+    gOut.z     = streams[5];
+    gpVertices = new StreamVertex[STREAM_COUNT];
+    for (uint32_t i = 0; i < STREAM_COUNT; i++)
+    {
+        gIn.x[i] = gVectors[i % BENCH_COUNT][0];
+        gIn.y[i] = gVectors[i % BENCH_COUNT][1];
+        gIn.z[i] = gVectors[i % BENCH_COUNT][2];
+        gpVertices[i].position[0] = gIn.x[i];
+        gpVertices[i].position[1] = gIn.y[i];
+        gpVertices[i].position[2] = gIn.z[i];
+    }
+
+    const double streamBytes = 6.0 * sizeof(float) * STREAM_COUNT;
+    stream("points", streamPoints, streamBytes);
+    stream("normals", streamNormals, streamBytes);
+#if defined(VMATH_THREADS)
+    stream("points x N", streamPointsThreaded, streamBytes);
+#endif
+    stream("vertices", streamVertices, 2.0 * sizeof(StreamVertex) * STREAM_COUNT + 2.0 * streamBytes);
+    delete[] gpVertices;
+
+    printf("checksum     %08x\n", gChecksum);
+
+    return 0;
+}
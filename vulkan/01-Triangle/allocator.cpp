@@ -0,0 +1,617 @@
+
+#include "allocator.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+/*--- Helpers ---*/
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1U) / alignment * alignment;
+}
+
+static VkDeviceSize nextPowerOfTwo(VkDeviceSize value)
+{
+    VkDeviceSize power = 1U;
+    while (power < value)
+    {
+        power <<= 1U;
+    }
+    return power;
+}
+
+static uint32_t orderOf(VkDeviceSize size)
+{
+    uint32_t order = 0U;
+    while ((ALLOCATOR_MIN_SIZE << order) < size)
+    {
+        order++;
+    }
+    return order;
+}
+
+uint32_t findMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1U << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+/*--- Buddy allocator ---*/
+void buddyInitialize(BuddyAllocator &allocator, VkDevice device, VkPhysicalDevice physicalDevice)
+{
+    allocator.device = device;
+    allocator.blocks.clear();
+    allocator.bytesInUse = 0U;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &allocator.memoryProperties);
+}
+
+static uint32_t addBlock(BuddyAllocator &allocator, uint32_t memoryTypeIndex, VkDeviceSize minSize)
+{
+    /* requests above the block size get a block of their own, rounded like any other range */
+    BuddyBlock block      = {};
+    block.size            = std::max(ALLOCATOR_BLOCK_SIZE, nextPowerOfTwo(minSize));
+    block.memoryTypeIndex = memoryTypeIndex;
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize       = block.size;
+    allocInfo.memoryTypeIndex      = memoryTypeIndex;
+
+    if (vkAllocateMemory(allocator.device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate device memory block!");
+    }
+
+    /* host visible blocks stay mapped, mapping per buffer is not allowed on the same memory twice */
+    if (allocator.memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        void *pMapped = nullptr;
+        if (vkMapMemory(allocator.device, block.memory, 0, VK_WHOLE_SIZE, 0, &pMapped) != VK_SUCCESS)
+        {
+            vkFreeMemory(allocator.device, block.memory, nullptr);
+            throw std::runtime_error("failed to map device memory block!");
+        }
+        block.pMapped = static_cast<uint8_t *>(pMapped);
+    }
+
+    uint32_t maxOrder = orderOf(block.size);
+    block.freeLists.resize(maxOrder + 1U);
+    block.freeLists[maxOrder].insert(0U);
+
+    allocator.blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(allocator.blocks.size() - 1U);
+}
+
+Allocation buddyAllocate(BuddyAllocator &allocator, const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties)
+{
+    uint32_t     memoryTypeIndex = findMemoryTypeIndex(allocator.memoryProperties, requirements.memoryTypeBits, properties);
+    VkDeviceSize size            = nextPowerOfTwo(std::max({requirements.size, requirements.alignment, ALLOCATOR_MIN_SIZE}));
+    uint32_t     order           = orderOf(size);
+
+    /* smallest free range that fits, in the first block of the memory type that has one */
+    uint32_t blockIndex = UINT32_MAX;
+    uint32_t freeOrder  = 0U;
+    for (uint32_t i = 0U; i < allocator.blocks.size() && UINT32_MAX == blockIndex; i++)
+    {
+        BuddyBlock &block = allocator.blocks[i];
+        if (block.memoryTypeIndex != memoryTypeIndex)
+            continue;
+
+        for (uint32_t k = order; k < block.freeLists.size(); k++)
+        {
+            if (!block.freeLists[k].empty())
+            {
+                blockIndex = i;
+                freeOrder  = k;
+                break;
+            }
+        }
+    }
+    if (UINT32_MAX == blockIndex)
+    {
+        blockIndex = addBlock(allocator, memoryTypeIndex, size);
+        freeOrder  = static_cast<uint32_t>(allocator.blocks[blockIndex].freeLists.size() - 1U);
+    }
+
+    BuddyBlock  &block  = allocator.blocks[blockIndex];
+    VkDeviceSize offset = *block.freeLists[freeOrder].begin();
+    block.freeLists[freeOrder].erase(block.freeLists[freeOrder].begin());
+
+    /* split, the upper halves go free */
+    while (freeOrder > order)
+    {
+        freeOrder--;
+        block.freeLists[freeOrder].insert(offset + (ALLOCATOR_MIN_SIZE << freeOrder));
+    }
+    block.orders[offset] = order;
+    allocator.bytesInUse += size;
+
+    Allocation allocation = {};
+    allocation.memory     = block.memory;
+    allocation.offset     = offset;
+    allocation.size       = size;
+    allocation.block      = blockIndex;
+    allocation.pMapped    = (nullptr != block.pMapped) ? block.pMapped + offset : nullptr;
+    return allocation;
+}
+
+void buddyFree(BuddyAllocator &allocator, Allocation &allocation)
+{
+    if (UINT32_MAX == allocation.block)
+        return;
+
+    BuddyBlock &block = allocator.blocks[allocation.block];
+    auto        it    = block.orders.find(allocation.offset);
+    if (block.orders.end() == it)
+    {
+        throw std::runtime_error("failed to free memory range, it was not allocated!");
+    }
+
+    VkDeviceSize offset = allocation.offset;
+    uint32_t     order  = it->second;
+    block.orders.erase(it);
+    allocator.bytesInUse -= ALLOCATOR_MIN_SIZE << order;
+
+    /* merge with the buddy as long as it is free as a whole */
+    while (order + 1U < block.freeLists.size())
+    {
+        VkDeviceSize buddy = offset ^ (ALLOCATOR_MIN_SIZE << order);
+        if (0U == block.freeLists[order].erase(buddy))
+            break;
+        offset = std::min(offset, buddy);
+        order++;
+    }
+    block.freeLists[order].insert(offset);
+
+    allocation = {};
+}
+
+void buddyUninitialize(BuddyAllocator &allocator)
+{
+    /* blocks are kept empty for reuse until here, freeing them wholesale also drops leaked ranges */
+    for (BuddyBlock &block : allocator.blocks)
+    {
+        if (nullptr != block.pMapped)
+        {
+            vkUnmapMemory(allocator.device, block.memory);
+        }
+        vkFreeMemory(allocator.device, block.memory, nullptr);
+    }
+    allocator.blocks.clear();
+    allocator.bytesInUse = 0U;
+}
+
+VkBuffer createBuffer(BuddyAllocator &allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Allocation &allocation)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size               = size;
+    bufferInfo.usage              = usage;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    if (vkCreateBuffer(allocator.device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create buffer!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(allocator.device, buffer, &memoryRequirements);
+
+    allocation = buddyAllocate(allocator, memoryRequirements, properties);
+    if (vkBindBufferMemory(allocator.device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to bind buffer memory!");
+    }
+    return buffer;
+}
+
+void destroyBuffer(BuddyAllocator &allocator, VkBuffer &buffer, Allocation &allocation)
+{
+    if (VK_NULL_HANDLE != buffer)
+    {
+        vkDestroyBuffer(allocator.device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+    }
+    buddyFree(allocator, allocation);
+}
+
+/*--- Linear allocator ---*/
+void linearInitialize(LinearAllocator &allocator, VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize regionSize, uint32_t nRegions,
+                      VkBufferUsageFlags usage)
+{
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    allocator           = {};
+    allocator.device    = device;
+    allocator.alignment = 16U;
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+    {
+        allocator.alignment = std::max(allocator.alignment, properties.limits.minUniformBufferOffsetAlignment);
+    }
+    if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+    {
+        allocator.alignment = std::max(allocator.alignment, properties.limits.minStorageBufferOffsetAlignment);
+    }
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.usage              = usage;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+    /* regions start on an allocation and a flush boundary, so offsets within them keep both */
+    VkDeviceSize regionAlignment = std::max(allocator.alignment, properties.limits.nonCoherentAtomSize);
+    allocator.regionSize         = alignUp(regionSize, regionAlignment);
+    bufferInfo.size              = allocator.regionSize * nRegions;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &allocator.buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create linear allocator buffer!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, allocator.buffer, &memoryRequirements);
+
+    /* coherent memory needs no flush, plain host visible memory is flushed once per frame */
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize       = memoryRequirements.size;
+    try
+    {
+        allocInfo.memoryTypeIndex =
+            findMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+    catch (const std::runtime_error &)
+    {
+        allocInfo.memoryTypeIndex = findMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        allocator.nonCoherentAtom = properties.limits.nonCoherentAtomSize;
+    }
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &allocator.memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate linear allocator memory!");
+    }
+    vkBindBufferMemory(device, allocator.buffer, allocator.memory, 0);
+
+    void *pMapped = nullptr;
+    if (vkMapMemory(device, allocator.memory, 0, VK_WHOLE_SIZE, 0, &pMapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map linear allocator memory!");
+    }
+    allocator.pMapped = static_cast<uint8_t *>(pMapped);
+}
+
+void linearBegin(LinearAllocator &allocator, uint32_t region)
+{
+    allocator.region = region;
+    allocator.head   = 0U;
+}
+
+void *linearAllocate(LinearAllocator &allocator, VkDeviceSize size, VkDeviceSize &offset)
+{
+    VkDeviceSize start = alignUp(allocator.head, allocator.alignment);
+    if (start + size > allocator.regionSize)
+    {
+        throw std::runtime_error("linear allocator region exhausted!");
+    }
+    allocator.head = start + size;
+    allocator.peak = std::max(allocator.peak, allocator.head);
+
+    offset = allocator.region * allocator.regionSize + start;
+    return allocator.pMapped + offset;
+}
+
+void linearFlush(LinearAllocator &allocator)
+{
+    if (0U == allocator.nonCoherentAtom || 0U == allocator.head)
+        return;
+
+    VkMappedMemoryRange range = {};
+    range.sType               = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory              = allocator.memory;
+    range.offset              = allocator.region * allocator.regionSize;
+    range.size                = std::min(alignUp(allocator.head, allocator.nonCoherentAtom), allocator.regionSize);
+    vkFlushMappedMemoryRanges(allocator.device, 1, &range);
+}
+
+void linearUninitialize(LinearAllocator &allocator)
+{
+    if (VK_NULL_HANDLE == allocator.buffer)
+        return;
+
+    vkDestroyBuffer(allocator.device, allocator.buffer, nullptr);
+    vkUnmapMemory(allocator.device, allocator.memory);
+    vkFreeMemory(allocator.device, allocator.memory, nullptr);
+    allocator = {};
+}
+
+/*--- Staging uploads ---*/
+static VkCommandBuffer allocateCommandBuffer(VkDevice device, VkCommandPool commandPool)
+{
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool                 = commandPool;
+    allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount          = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+    return commandBuffer;
+}
+
+static VkCommandPool createTransientPool(VkDevice device, uint32_t queueFamily)
+{
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex        = queueFamily;
+
+    VkCommandPool commandPool;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+    return commandPool;
+}
+
+void stagingInitialize(StagingUploader &uploader, VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily, VkQueue graphicsQueue,
+                       uint32_t transferFamily, VkQueue transferQueue, VkDeviceSize size)
+{
+    uploader                = {};
+    uploader.device         = device;
+    uploader.graphicsFamily = graphicsFamily;
+    uploader.graphicsQueue  = graphicsQueue;
+    uploader.transferFamily = transferFamily;
+    uploader.transferQueue  = transferQueue;
+    uploader.size           = size;
+
+    uploader.transferPool     = createTransientPool(device, transferFamily);
+    uploader.transferCommands = allocateCommandBuffer(device, uploader.transferPool);
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(device, &fenceInfo, nullptr, &uploader.fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create upload fence!");
+    }
+
+    /* a separate family owns the buffers after the copy, the graphics family acquires them behind a semaphore */
+    if (transferFamily != graphicsFamily)
+    {
+        uploader.graphicsPool    = createTransientPool(device, graphicsFamily);
+        uploader.acquireCommands = allocateCommandBuffer(device, uploader.graphicsPool);
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &uploader.transferDone) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create upload semaphore!");
+        }
+    }
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size               = size;
+    bufferInfo.usage              = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &uploader.buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create staging buffer!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, uploader.buffer, &memoryRequirements);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize       = memoryRequirements.size;
+    allocInfo.memoryTypeIndex =
+        findMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &uploader.memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate staging buffer memory!");
+    }
+    vkBindBufferMemory(device, uploader.buffer, uploader.memory, 0);
+
+    void *pMapped = nullptr;
+    if (vkMapMemory(device, uploader.memory, 0, VK_WHOLE_SIZE, 0, &pMapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map staging buffer memory!");
+    }
+    uploader.pMapped = static_cast<uint8_t *>(pMapped);
+}
+
+void stagingUpload(StagingUploader &uploader, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *pData, VkDeviceSize size,
+                   VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    const uint8_t *pBytes    = static_cast<const uint8_t *>(pData);
+    bool           bSeparate = uploader.transferFamily != uploader.graphicsFamily;
+
+    /* data larger than the staging buffer goes in pieces, one batch each */
+    while (0U < size)
+    {
+        if (uploader.head >= uploader.size)
+        {
+            stagingFlush(uploader);
+        }
+
+        if (!uploader.bRecording)
+        {
+            VkCommandBufferBeginInfo beginInfo = {};
+            beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            if (vkBeginCommandBuffer(uploader.transferCommands, &beginInfo) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to begin recording upload command buffer!");
+            }
+            uploader.bRecording = true;
+        }
+
+        VkDeviceSize chunk = std::min(size, uploader.size - uploader.head);
+        memcpy(uploader.pMapped + uploader.head, pBytes, chunk);
+
+        VkBufferCopy region = {};
+        region.srcOffset    = uploader.head;
+        region.dstOffset    = dstOffset;
+        region.size         = chunk;
+        vkCmdCopyBuffer(uploader.transferCommands, uploader.buffer, dstBuffer, 1, &region);
+
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType                 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask         = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask         = dstAccess;
+        barrier.srcQueueFamilyIndex   = bSeparate ? uploader.transferFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex   = bSeparate ? uploader.graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer                = dstBuffer;
+        barrier.offset                = dstOffset;
+        barrier.size                  = chunk;
+        uploader.barriers.push_back(barrier);
+        uploader.dstStages |= dstStage;
+
+        /* keep the next source offset aligned for the copy engine */
+        uploader.head = alignUp(uploader.head + chunk, 16U);
+        uploader.nBytes += chunk;
+        pBytes += chunk;
+        dstOffset += chunk;
+        size -= chunk;
+    }
+}
+
+void stagingFlush(StagingUploader &uploader)
+{
+    if (!uploader.bRecording)
+        return;
+
+    VkCommandBuffer transferCommands = uploader.transferCommands;
+    if (uploader.transferFamily == uploader.graphicsFamily)
+    {
+        /* one queue: a plain barrier makes the copies visible to the stages reading the buffers */
+        vkCmdPipelineBarrier(transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, uploader.dstStages, 0, 0, nullptr,
+                             static_cast<uint32_t>(uploader.barriers.size()), uploader.barriers.data(), 0, nullptr);
+        if (vkEndCommandBuffer(transferCommands) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        VkSubmitInfo submitInfo       = {};
+        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &transferCommands;
+        if (vkQueueSubmit(uploader.transferQueue, 1, &submitInfo, uploader.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+    }
+    else
+    {
+        /* release on the transfer queue, the destination access is ignored there */
+        std::vector<VkBufferMemoryBarrier> releases = uploader.barriers;
+        for (VkBufferMemoryBarrier &barrier : releases)
+        {
+            barrier.dstAccessMask = 0;
+        }
+        vkCmdPipelineBarrier(transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                             static_cast<uint32_t>(releases.size()), releases.data(), 0, nullptr);
+        if (vkEndCommandBuffer(transferCommands) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        VkSubmitInfo submitInfo         = {};
+        submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount   = 1;
+        submitInfo.pCommandBuffers      = &transferCommands;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores    = &uploader.transferDone;
+        if (vkQueueSubmit(uploader.transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        /* acquire on the graphics queue, the same ranges with the source access ignored */
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(uploader.acquireCommands, &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to begin recording acquire command buffer!");
+        }
+        for (VkBufferMemoryBarrier &barrier : uploader.barriers)
+        {
+            barrier.srcAccessMask = 0;
+        }
+        vkCmdPipelineBarrier(uploader.acquireCommands, uploader.dstStages, uploader.dstStages, 0, 0, nullptr,
+                             static_cast<uint32_t>(uploader.barriers.size()), uploader.barriers.data(), 0, nullptr);
+        if (vkEndCommandBuffer(uploader.acquireCommands) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record acquire command buffer!");
+        }
+
+        VkPipelineStageFlags waitStage = uploader.dstStages;
+        submitInfo                     = {};
+        submitInfo.sType               = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount  = 1;
+        submitInfo.pWaitSemaphores     = &uploader.transferDone;
+        submitInfo.pWaitDstStageMask   = &waitStage;
+        submitInfo.commandBufferCount  = 1;
+        submitInfo.pCommandBuffers     = &uploader.acquireCommands;
+        if (vkQueueSubmit(uploader.graphicsQueue, 1, &submitInfo, uploader.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit acquire command buffer!");
+        }
+    }
+
+    /* uploads happen while loading, waiting here lets the staging memory be reused right away */
+    vkWaitForFences(uploader.device, 1, &uploader.fence, VK_TRUE, UINT64_MAX);
+    vkResetFences(uploader.device, 1, &uploader.fence);
+    vkResetCommandPool(uploader.device, uploader.transferPool, 0);
+    if (VK_NULL_HANDLE != uploader.graphicsPool)
+    {
+        vkResetCommandPool(uploader.device, uploader.graphicsPool, 0);
+    }
+
+    uploader.bRecording = false;
+    uploader.head       = 0U;
+    uploader.dstStages  = 0U;
+    uploader.barriers.clear();
+    uploader.nSubmits++;
+}
+
+void stagingUninitialize(StagingUploader &uploader)
+{
+    if (VK_NULL_HANDLE == uploader.device)
+        return;
+
+    stagingFlush(uploader);
+
+    vkDestroyBuffer(uploader.device, uploader.buffer, nullptr);
+    vkUnmapMemory(uploader.device, uploader.memory);
+    vkFreeMemory(uploader.device, uploader.memory, nullptr);
+    vkDestroyFence(uploader.device, uploader.fence, nullptr);
+    vkDestroyCommandPool(uploader.device, uploader.transferPool, nullptr);
+    if (VK_NULL_HANDLE != uploader.graphicsPool)
+    {
+        vkDestroyCommandPool(uploader.device, uploader.graphicsPool, nullptr);
+        vkDestroySemaphore(uploader.device, uploader.transferDone, nullptr);
+    }
+    uploader = {};
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+/*
+ * Device memory sub-allocation: a handful of vkAllocateMemory calls instead of one per buffer.
+ * maxMemoryAllocationCount is as low as 4096 on common drivers, and each allocation is slow.
+ *
+ * - BuddyAllocator: static data such as meshes. Blocks of ALLOCATOR_BLOCK_SIZE per memory type,
+ *   split into power of two ranges down to ALLOCATOR_MIN_SIZE, freed ranges merge with their buddy.
+ *   Ranges are aligned to their size, which covers the alignment of every buffer no larger than them.
+ * - LinearAllocator: per-frame data. One host visible buffer with a region per frame in flight,
+ *   allocation bumps an offset, the region is reset once the fence of its frame signalled.
+ * - StagingUploader: copies through a host visible buffer, batched into one submission per flush.
+ *   Uses a transfer-only queue family where there is one and hands the buffers to the graphics family.
+ */
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#define ALLOCATOR_BLOCK_SIZE ((VkDeviceSize)64U << 20) // device memory per vkAllocateMemory of the buddy allocator
+#define ALLOCATOR_MIN_SIZE   ((VkDeviceSize)256U)      // smallest range handed out, order 0
+#define STAGING_SIZE         ((VkDeviceSize)8U << 20)  // host visible bytes per upload batch
+
+struct Allocation
+{
+    VkDeviceMemory memory  = VK_NULL_HANDLE;
+    VkDeviceSize   offset  = 0U;
+    VkDeviceSize   size    = 0U;       // power of two the request was rounded to
+    uint32_t       block   = UINT32_MAX;
+    void          *pMapped = nullptr; // host address of offset, nullptr unless host visible
+};
+
+struct BuddyBlock
+{
+    VkDeviceMemory                             memory          = VK_NULL_HANDLE;
+    VkDeviceSize                               size            = 0U;
+    uint32_t                                   memoryTypeIndex = 0U;
+    uint8_t                                   *pMapped         = nullptr;
+    std::vector<std::set<VkDeviceSize>>        freeLists;       // free offsets per order
+    std::unordered_map<VkDeviceSize, uint32_t> orders;          // order of each live range by offset
+};
+
+struct BuddyAllocator
+{
+    VkDevice                         device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    std::vector<BuddyBlock>          blocks;
+    VkDeviceSize                     bytesInUse = 0U;
+};
+
+struct LinearAllocator
+{
+    VkDevice       device          = VK_NULL_HANDLE;
+    VkBuffer       buffer          = VK_NULL_HANDLE;
+    VkDeviceMemory memory          = VK_NULL_HANDLE;
+    uint8_t       *pMapped         = nullptr;
+    VkDeviceSize   regionSize      = 0U;
+    VkDeviceSize   alignment       = 1U; // of every allocation, at least the offset alignment of the usage
+    VkDeviceSize   nonCoherentAtom = 0U; // 0 for coherent memory, else flush granularity
+    uint32_t       region          = 0U;
+    VkDeviceSize   head            = 0U; // next free byte in region
+    VkDeviceSize   peak            = 0U; // largest head seen, to size regionSize
+};
+
+struct StagingUploader
+{
+    VkDevice                           device = VK_NULL_HANDLE;
+    VkQueue                            transferQueue;
+    VkQueue                            graphicsQueue;
+    uint32_t                           transferFamily;
+    uint32_t                           graphicsFamily;
+    VkCommandPool                      transferPool    = VK_NULL_HANDLE;
+    VkCommandPool                      graphicsPool    = VK_NULL_HANDLE; // only with a separate transfer family
+    VkCommandBuffer                    transferCommands;
+    VkCommandBuffer                    acquireCommands;
+    VkSemaphore                        transferDone = VK_NULL_HANDLE;
+    VkFence                            fence        = VK_NULL_HANDLE;
+    VkBuffer                           buffer       = VK_NULL_HANDLE;
+    VkDeviceMemory                     memory       = VK_NULL_HANDLE;
+    uint8_t                           *pMapped      = nullptr;
+    VkDeviceSize                       size         = 0U;
+    VkDeviceSize                       head         = 0U;
+    bool                               bRecording   = false;
+    std::vector<VkBufferMemoryBarrier> barriers; // per copy of the batch, release on transfer, acquire on graphics
+    VkPipelineStageFlags               dstStages = 0U;
+    uint64_t                           nSubmits  = 0U;
+    VkDeviceSize                       nBytes    = 0U;
+};
+
+uint32_t findMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+void       buddyInitialize(BuddyAllocator &allocator, VkDevice device, VkPhysicalDevice physicalDevice);
+Allocation buddyAllocate(BuddyAllocator &allocator, const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties);
+void       buddyFree(BuddyAllocator &allocator, Allocation &allocation);
+void       buddyUninitialize(BuddyAllocator &allocator);
+
+/* buffer with its own memory range, bound and ready for use */
+VkBuffer createBuffer(BuddyAllocator &allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Allocation &allocation);
+void     destroyBuffer(BuddyAllocator &allocator, VkBuffer &buffer, Allocation &allocation);
+
+void  linearInitialize(LinearAllocator &allocator, VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize regionSize, uint32_t nRegions,
+                       VkBufferUsageFlags usage);
+void  linearBegin(LinearAllocator &allocator, uint32_t region);
+void *linearAllocate(LinearAllocator &allocator, VkDeviceSize size, VkDeviceSize &offset);
+void  linearFlush(LinearAllocator &allocator);
+void  linearUninitialize(LinearAllocator &allocator);
+
+void stagingInitialize(StagingUploader &uploader, VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily, VkQueue graphicsQueue,
+                       uint32_t transferFamily, VkQueue transferQueue, VkDeviceSize size = STAGING_SIZE);
+void stagingUpload(StagingUploader &uploader, VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *pData, VkDeviceSize size,
+                   VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+void stagingFlush(StagingUploader &uploader);
+void stagingUninitialize(StagingUploader &uploader);
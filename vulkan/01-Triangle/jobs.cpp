@@ -0,0 +1,103 @@
+
+#include "jobs.h"
+
+/* take jobs of the current run until none is left, called with the lock held */
+static void runJobs(JobSystem &jobs, uint32_t worker, std::unique_lock<std::mutex> &lock)
+{
+    while (jobs.nextJob < jobs.nJobs)
+    {
+        uint32_t job = jobs.nextJob++;
+
+        /* work stays unchanged until this job is counted as finished */
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            jobs.work(job, worker);
+        }
+        catch (...)
+        {
+            /* an exception leaving a worker thread would terminate the process */
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        if (error && !jobs.error)
+        {
+            jobs.error = error;
+        }
+
+        if (++jobs.nFinished == jobs.nJobs)
+        {
+            jobs.done.notify_all();
+        }
+    }
+}
+
+static void workerMain(JobSystem *pJobs, uint32_t worker)
+{
+    std::unique_lock<std::mutex> lock(pJobs->mutex);
+    uint64_t                     generation = 0U;
+
+    for (;;)
+    {
+        pJobs->wake.wait(lock, [&] { return pJobs->bQuit || pJobs->generation != generation; });
+        if (pJobs->bQuit)
+            return;
+
+        /* a worker that wakes late finds the jobs taken and goes back to sleep */
+        generation = pJobs->generation;
+        runJobs(*pJobs, worker, lock);
+    }
+}
+
+void jobsInitialize(JobSystem &jobs, uint32_t nWorkers)
+{
+    jobs.bQuit = false;
+    for (uint32_t worker = 1U; worker < nWorkers; worker++)
+    {
+        jobs.threads.emplace_back(workerMain, &jobs, worker);
+    }
+}
+
+void jobsRun(JobSystem &jobs, uint32_t nJobs, const JobFunction &work)
+{
+    if (0U == nJobs)
+        return;
+
+    std::unique_lock<std::mutex> lock(jobs.mutex);
+    jobs.work      = work;
+    jobs.nJobs     = nJobs;
+    jobs.nextJob   = 0U;
+    jobs.nFinished = 0U;
+    jobs.error     = nullptr;
+    jobs.generation++;
+    jobs.wake.notify_all();
+
+    /* the caller works too instead of waiting idle */
+    runJobs(jobs, 0U, lock);
+    jobs.done.wait(lock, [&] { return jobs.nFinished == jobs.nJobs; });
+    jobs.work = nullptr;
+
+    if (jobs.error)
+    {
+        std::exception_ptr error = jobs.error;
+        jobs.error               = nullptr;
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+void jobsUninitialize(JobSystem &jobs)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs.mutex);
+        jobs.bQuit = true;
+        jobs.wake.notify_all();
+    }
+    for (std::thread &thread : jobs.threads)
+    {
+        thread.join();
+    }
+    jobs.threads.clear();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * Fork-join jobs on a fixed set of worker threads, for recording command buffers in parallel.
+ * jobsRun hands out job indices to the workers and the calling thread, which counts as worker 0,
+ * and returns once every job finished. The worker index lets a job pick per-thread resources
+ * such as a command pool without locking.
+ * A job that throws does not take its thread down: the first exception of a run is kept, the
+ * remaining jobs still run, and jobsRun rethrows it on the calling thread once all are done.
+ */
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+typedef std::function<void(uint32_t job, uint32_t worker)> JobFunction;
+
+struct JobSystem
+{
+    std::vector<std::thread> threads;    // workers 1 to nWorkers - 1
+    std::mutex               mutex;
+    std::condition_variable  wake;       // a run started or quit
+    std::condition_variable  done;       // the last job of a run finished
+    JobFunction              work;
+    uint32_t                 nJobs      = 0U;
+    uint32_t                 nextJob    = 0U;
+    uint32_t                 nFinished  = 0U;
+    uint64_t                 generation = 0U; // incremented per run, workers join each run once
+    std::exception_ptr       error;            // first exception thrown by a job of the current run
+    bool                     bQuit      = false;
+};
+
+void jobsInitialize(JobSystem &jobs, uint32_t nWorkers);
+void jobsRun(JobSystem &jobs, uint32_t nJobs, const JobFunction &work);
+void jobsUninitialize(JobSystem &jobs);
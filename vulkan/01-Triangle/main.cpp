@@ -17,6 +17,7 @@
 #define _USE_MATH_DEFINES
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <math.h>
 
@@ -32,7 +33,7 @@
 #define WIN_HEIGHT 600
 
 /* function declaration */
-static int  initialize();
+static int  initialize(uint32_t nFramesInFlight, const RenderOptions &options);
 static void uninitialize();
 static void display();
 static void update();
@@ -46,15 +47,60 @@ bool        gbAbortFlag  = false;   // Global abort flag
 XRectangle  rect         = {0};     // window dimentions rectangle
 bool        gbFullscreen = false;   // should display in fullscreen mode
 bool        shouldDraw   = false;   // should scene be rendered
+bool        gbMinimized  = false;   // window is unmapped, e.g. iconified
 Colormap    colormap;
 XVisualInfo visualInfo;
+uint64_t    frameLimit  = 0U; // quit after this many frames, 0 runs until closed
+uint64_t    framesDrawn = 0U;
 
 /*--- Entry point --*/
 int main(int argc, char *argv[])
 {
     static Atom wm_delete_window = 0;   // atomic variable to detect close button click
     Window      root             = 0UL; // handle of root window [Desktop]
-    dpy                          = XOpenDisplay(nullptr);
+    uint32_t    nFramesInFlight  = DEFAULT_FRAMES_IN_FLIGHT;
+    RenderOptions            options;
+
+    /*
+     * -inflight <count>: frames recorded ahead of the GPU, -frames <count>: quit after drawing them to compare frame times,
+     * -model <file.model>: draw the mesh in place of the triangle, repeat for more,
+     * -objects <count>: draw that many instances of the models in a grid, -threads <count>: record the draws on worker threads
+     */
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "-inflight"))
+        {
+            nFramesInFlight = (uint32_t)atoi(argv[i + 1]);
+        }
+        else if (0 == strcmp(argv[i], "-frames"))
+        {
+            frameLimit = (uint64_t)atoll(argv[i + 1]);
+        }
+        else if (0 == strcmp(argv[i], "-model"))
+        {
+            options.models.push_back(argv[i + 1]);
+        }
+        else if (0 == strcmp(argv[i], "-objects"))
+        {
+            options.nObjects = (uint32_t)atoi(argv[i + 1]);
+        }
+        else if (0 == strcmp(argv[i], "-threads"))
+        {
+            options.nRecordThreads = (uint32_t)atoi(argv[i + 1]);
+        }
+    }
+    if (0U < options.nObjects && options.models.empty())
+    {
+        fprintf(stderr, "Warning: -objects needs a -model to draw, drawing the triangle\n");
+    }
+
+    /* -headless <frames> [output.png]: render offscreen without an X server, e.g. on lavapipe */
+    if (3 <= argc && 0 == strcmp(argv[1], "-headless"))
+    {
+        return runHeadless((uint32_t)atoi(argv[2]), (4 <= argc && '-' != argv[3][0]) ? argv[3] : nullptr, nFramesInFlight, options);
+    }
+
+    dpy = XOpenDisplay(nullptr);
 
     if (dpy == nullptr)
     {
@@ -107,13 +153,14 @@ int main(int argc, char *argv[])
     XMoveWindow(dpy, w, (screenWidth - WIN_WIDTH) / 2, (screenHeight - WIN_HEIGHT) / 2);
     XFlush(dpy);
 
-    initialize();
+    initialize(nFramesInFlight, options);
 
     shouldDraw = false;
     while (!gbAbortFlag)
     {
         XEvent event;
-        if (XPending(dpy))
+        /* nothing can be presented while minimized, block until the window manager brings the window back instead of spinning */
+        if (XPending(dpy) || gbMinimized || isSwapChainSuspended())
         {
             XNextEvent(dpy, &event);
             switch (event.type)
@@ -167,6 +214,18 @@ int main(int argc, char *argv[])
                     }
                     break;
                 }
+                case UnmapNotify:
+                {
+                    gbMinimized = true;
+                    break;
+                }
+                case MapNotify:
+                {
+                    /* the size may not change on restore, so no ConfigureNotify resumes a suspended swap chain */
+                    gbMinimized = false;
+                    resize(rect.width, rect.height);
+                    break;
+                }
                 case ConfigureNotify:
                 {
                     if (rect.width != event.xconfigure.width || rect.height != event.xconfigure.height)
@@ -180,10 +239,12 @@ int main(int argc, char *argv[])
             }
         }
 
-        if (!shouldDraw)
+        if (!shouldDraw || gbMinimized || isSwapChainSuspended())
             continue;
         update();
         display();
+        if (0U < frameLimit && frameLimit <= ++framesDrawn)
+            gbAbortFlag = true;
     }
 
     uninitialize();
@@ -194,12 +255,12 @@ int main(int argc, char *argv[])
     return 0;
 }
 
-static int initialize()
+static int initialize(uint32_t nFramesInFlight, const RenderOptions &options)
 {
     XWindowAttributes xattr = {};
     XGetWindowAttributes(dpy, w, &xattr);
 
-    initVulkan();
+    initVulkan(nFramesInFlight, options);
 
     // Set the clipping plane equation
     resize(xattr.width, xattr.height);
@@ -223,6 +284,7 @@ static void update()
 
 static void resize(int width, int height)
 {
+    onWindowResize(width, height);
 }
 
 static void toggleFullscreen(Display *display, Window window)
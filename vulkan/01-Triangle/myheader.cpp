@@ -1,20 +1,25 @@
 
 #include "myheader.h"
+#include "jobs.h"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
-#include <fstream>
+#include <fcntl.h>
 #include <iostream>
 #include <limits>
 #include <set>
 #include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
 #ifdef NDEBUG
-const bool                      enableValidationLayers = false;
-const std::vector<const char *> requiredExtensions     = {VK_KHR_SURFACE_EXTENSION_NAME, "VK_KHR_xlib_surface"};
+const bool enableValidationLayers = false;
 #else
-const bool                      enableValidationLayers = true;
-const std::vector<const char *> requiredExtensions     = {VK_KHR_SURFACE_EXTENSION_NAME, "VK_KHR_xlib_surface", VK_EXT_DEBUG_UTILS_EXTENSION_NAME};
+const bool enableValidationLayers = true;
 #endif
 
 /*--- GLobal function declarations ---*/
@@ -40,10 +45,28 @@ static bool isDeviceSuitable(VkPhysicalDevice device);
 static void createRenderPass();
 static void createFramebuffers();
 static void createCommandPool();
-static void createCommandBuffer();
+static void createCommandBuffers();
 static void createSyncObjects();
-static std::vector<char>       readFile(const char *filename);
-static VkShaderModule          createShaderModule(const std::vector<char> &code);
+static void createPresentSemaphores();
+static void cleanupSwapChain();
+static void recreateSwapChain();
+static void                    createOffscreenImage(uint32_t width, uint32_t height);
+static void                    createHeadlessResources();
+static void                    drawFrameHeadless(bool bCopy);
+static void                    collectTimestamps(uint32_t frame);
+static uint32_t                findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+static int                     writePng(const char *filename, uint32_t width, uint32_t height, const uint8_t *pRgba);
+static void                    createDescriptors(size_t nDraws);
+static void                    loadModels();
+static void                    createInstances(uint32_t nObjects);
+static void                    createRecordPools();
+static void                    bindDrawState(VkCommandBuffer commandBuffer);
+static void                    drawMeshes(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+static void                    createPipelineCache();
+static void                    savePipelineCache();
+static MappedFile              mapFile(const char *filename);
+static void                    unmapFile(MappedFile &file);
+static VkShaderModule          createShaderModule(const MappedFile &code);
 static VkExtent2D              chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 static VkSurfaceFormatKHR      chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
 static VkPresentModeKHR        chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes);
@@ -66,15 +89,66 @@ std::vector<VkImageView>        swapChainImageViews;
 VkRenderPass                    renderPass;
 VkPipeline                      graphicsPipeline;
 VkPipelineLayout                pipelineLayout;
+VkPipelineCache                 pipelineCache = VK_NULL_HANDLE;
 std::vector<VkFramebuffer>      swapChainFramebuffers;
 VkCommandPool                   commandPool;
-VkCommandBuffer                 commandBuffer;
-VkSemaphore                     imageAvailableSemaphore;
-VkSemaphore                     renderFinishedSemaphore;
-VkFence                         inFlightFence;
 const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
 const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
+/*--- Meshes of .model files: a few device memory blocks hold all of them, transforms go through a per-frame region ---*/
+std::vector<std::string> modelFiles;
+std::vector<ModelMesh>   meshes;
+BuddyAllocator           meshAllocator;
+LinearAllocator          uniformAllocator; // one region per frame in flight
+VkDescriptorSetLayout    descriptorSetLayout = VK_NULL_HANDLE;
+VkDescriptorPool         descriptorPool      = VK_NULL_HANDLE;
+VkDescriptorSet          descriptorSet       = VK_NULL_HANDLE; // dynamic offset selects the transform of a draw
+VkQueue                  transferQueue;
+std::vector<MeshInstance> instances;          // one draw each, grouped by mesh
+float                     sceneHalfWidth  = 0.0f; // of the instance positions, to fit the camera
+float                     sceneHalfHeight = 0.0f;
+
+/*--- Recording on worker threads: every job records a slice of the instances into a secondary command buffer ---*/
+uint32_t                                  recordThreads = 0U; // 0 records the draws into the primary
+JobSystem                                 recordJobs;
+std::vector<VkCommandPool>                recordPools;   // per frame in flight and thread, reset once the frame's fence signalled
+std::vector<std::vector<VkCommandBuffer>> recordBuffers; // secondaries of each pool, allocated on first use and reused
+std::vector<uint32_t>                     recordUsed;    // secondaries of each pool recorded this frame
+std::vector<VkCommandBuffer>              secondaries;   // per job of the current frame, executed in slice order
+double                                    recordMs = 0.0; // CPU time recording the draws, summed over the frames
+
+/*--- Frames in flight: the CPU records frame N + 1 while the GPU still renders frame N ---*/
+uint32_t                     framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+uint32_t                     currentFrame   = 0U;
+std::vector<VkCommandBuffer> commandBuffers;           // per frame in flight
+std::vector<VkSemaphore>     imageAvailableSemaphores; // per frame in flight, signalled by acquire
+std::vector<VkFence>         inFlightFences;           // per frame in flight, signalled when its submission retired
+std::vector<VkSemaphore>     renderFinishedSemaphores; // per swap chain image, present may hold one until the image returns
+std::vector<VkFence>         imagesInFlight;           // fence of the frame last rendering to each swap chain image
+bool                         framebufferResized = false;
+bool                         swapChainSuspended = false; // the window has no extent, nothing can be presented until it is resized
+
+/*--- Headless: one offscreen image in place of the swap chain, no surface ---*/
+bool              headless        = false;
+VkDeviceMemory    offscreenMemory = VK_NULL_HANDLE;
+VkBuffer          readbackBuffer  = VK_NULL_HANDLE; // host visible copy of the offscreen image
+VkDeviceMemory    readbackMemory  = VK_NULL_HANDLE;
+VkQueryPool       queryPool       = VK_NULL_HANDLE; // HEADLESS_TIMESTAMPS per frame in flight, none without timestamp support
+double            timestampPeriod = 0.0;            // nanoseconds per tick
+uint64_t          timestampMask   = 0U;             // valid bits of the graphics queue
+std::vector<bool> queriesPending;                   // per frame in flight, timestamps not read back yet
+std::vector<bool> copyPending;                      // per frame in flight, the frame copied the image out
+double            renderPassMs = 0.0;               // GPU time summed over the timed frames
+double            copyMs       = 0.0;
+uint64_t          nTimedFrames = 0U;
+uint64_t          nTimedCopies = 0U;
+
+/*--- Frame statistics, printed by cleanUp ---*/
+uint64_t                              frameCount   = 0U;
+double                                frameTimeMs  = 0.0; // between the ends of consecutive frames
+double                                fenceWaitMs  = 0.0; // CPU blocked on the GPU
+std::chrono::steady_clock::time_point lastFrameTime;
+
 /*--- Function definition ---*/
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT *pCreateInfo,
                                       const VkAllocationCallbacks *pAllocator, VkDebugUtilsMessengerEXT *pDebugMessenger)
@@ -99,8 +173,12 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
     }
 }
 
-int initVulkan()
+int initVulkan(uint32_t nFramesInFlight, const RenderOptions &options)
 {
+    framesInFlight = std::clamp(nFramesInFlight, 1U, MAX_FRAMES_IN_FLIGHT);
+    modelFiles     = options.models;
+    recordThreads  = std::min(options.nRecordThreads, MAX_RECORD_THREADS);
+
     VkResult result = createInstance();
     if (VK_SUCCESS != result)
     {
@@ -108,17 +186,49 @@ int initVulkan()
         return (-1);
     }
     setupDebugMessenger();
-    createSurface();
+    if (!headless)
+    {
+        createSurface();
+    }
     pickPhysicalDevice();
     createLogicalDevice();
-    createSwapChain();
+    if (headless)
+    {
+        createOffscreenImage(HEADLESS_WIDTH, HEADLESS_HEIGHT);
+    }
+    else
+    {
+        createSwapChain();
+    }
     createImageViews();
     createRenderPass();
+    createPipelineCache();
+    if (!modelFiles.empty())
+    {
+        createDescriptors(std::max((size_t)options.nObjects, modelFiles.size()));
+    }
     createGraphicsPipeline();
     createFramebuffers();
     createCommandPool();
-    createCommandBuffer();
+    if (!modelFiles.empty())
+    {
+        loadModels();
+        createInstances(options.nObjects);
+    }
+    createCommandBuffers();
+    if (!modelFiles.empty() && 0U < recordThreads)
+    {
+        createRecordPools();
+    }
     createSyncObjects();
+    if (headless)
+    {
+        createHeadlessResources();
+    }
+    else
+    {
+        createPresentSemaphores();
+    }
 
     return (0);
 }
@@ -126,24 +236,74 @@ int initVulkan()
 void cleanUp()
 {
     vkDeviceWaitIdle(device);
-    vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-    vkDestroyFence(device, inFlightFence, nullptr);
-    vkDestroyCommandPool(device, commandPool, nullptr);
-    for (auto framebuffer : swapChainFramebuffers)
+
+    if (VK_NULL_HANDLE != queryPool)
     {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
+        vkDestroyQueryPool(device, queryPool, nullptr);
+        queryPool = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != readbackBuffer)
+    {
+        vkDestroyBuffer(device, readbackBuffer, nullptr);
+        vkFreeMemory(device, readbackMemory, nullptr);
+        readbackBuffer = VK_NULL_HANDLE;
     }
 
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-    vkDestroyRenderPass(device, renderPass, nullptr);
-    for (auto imageView : swapChainImageViews)
+    for (ModelMesh &mesh : meshes)
     {
-        vkDestroyImageView(device, imageView, nullptr);
+        destroyBuffer(meshAllocator, mesh.vertexBuffer, mesh.vertexAllocation);
+        destroyBuffer(meshAllocator, mesh.indexBuffer, mesh.indexAllocation);
     }
+    meshes.clear();
+    buddyUninitialize(meshAllocator);
+    linearUninitialize(uniformAllocator);
+    if (VK_NULL_HANDLE != descriptorPool)
+    {
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        descriptorPool = VK_NULL_HANDLE;
+    }
+
+    if (1U < frameCount)
+    {
+        std::cout << frameCount << " frames, " << framesInFlight << " in flight: " << frameTimeMs / (double)(frameCount - 1U)
+                  << " ms per frame, " << fenceWaitMs / (double)frameCount << " ms waiting for the GPU per frame\n";
+    }
+    if (!modelFiles.empty() && 0U < frameCount)
+    {
+        std::cout << instances.size() << " draws recorded ";
+        if (recordPools.empty())
+        {
+            std::cout << "into the primary command buffer";
+        }
+        else
+        {
+            std::cout << "into " << secondaries.size() << " secondary command buffers on " << recordThreads << " threads";
+        }
+        std::cout << ": " << recordMs / (double)frameCount << " ms per frame\n";
+    }
+
+    jobsUninitialize(recordJobs);
+    for (VkCommandPool pool : recordPools)
+    {
+        vkDestroyCommandPool(device, pool, nullptr);
+    }
+    recordPools.clear();
+    recordBuffers.clear();
 
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    for (uint32_t i = 0U; i < framesInFlight; i++)
+    {
+        vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+        vkDestroyFence(device, inFlightFences[i], nullptr);
+    }
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    cleanupSwapChain();
+
+    vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyRenderPass(device, renderPass, nullptr);
+    savePipelineCache();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
     if (nullptr != device)
     {
         vkDestroyDevice(device, nullptr);
@@ -187,8 +347,9 @@ static VkResult createInstance()
     createInfo.pApplicationInfo = &appInfo;
 
     /*--- extensions ---*/
-    createInfo.enabledExtensionCount   = static_cast<uint32_t>(requiredExtensions.size());
-    createInfo.ppEnabledExtensionNames = requiredExtensions.data();
+    std::vector<const char *> requiredExtensions = getRequiredExtensions();
+    createInfo.enabledExtensionCount             = static_cast<uint32_t>(requiredExtensions.size());
+    createInfo.ppEnabledExtensionNames           = requiredExtensions.data();
 
     /*--- extensions: end ---*/
 
@@ -211,6 +372,22 @@ static VkResult createInstance()
     return result;
 }
 
+static std::vector<const char *> getRequiredExtensions()
+{
+    /* headless needs no surface, so it runs where the loader has no window system support */
+    std::vector<const char *> extensions;
+    if (!headless)
+    {
+        extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_XLIB_SURFACE_EXTENSION_NAME);
+    }
+    if (enableValidationLayers)
+    {
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+    return extensions;
+}
+
 void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo)
 {
     createInfo                 = {};
@@ -284,7 +461,8 @@ void createLogicalDevice()
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t>                   uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::set<uint32_t>                   uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(),
+                                                                    indices.transferFamily.value()};
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -305,8 +483,8 @@ void createLogicalDevice()
     createInfo.pQueueCreateInfos       = queueCreateInfos.data();
     createInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures        = &deviceFeatures;
-    createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount   = headless ? 0U : static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = headless ? nullptr : deviceExtensions.data();
 
     if (enableValidationLayers)
     {
@@ -325,6 +503,7 @@ void createLogicalDevice()
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
 }
 
 void createSwapChain()
@@ -423,7 +602,7 @@ static void createRenderPass()
     colorAttachment.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout             = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout             = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentRef = {};
     colorAttachmentRef.attachment            = 0;
@@ -434,13 +613,22 @@ static void createRenderPass()
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments    = &colorAttachmentRef;
 
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass          = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass          = 0;
-    dependency.srcStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask       = 0;
-    dependency.dstStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    /* headless frames in flight share one image, each waits for the writes and the copy of the one before */
+    VkSubpassDependency dependencies[2] = {};
+    dependencies[0].srcSubpass          = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass          = 0;
+    dependencies[0].srcStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | (headless ? VK_PIPELINE_STAGE_TRANSFER_BIT : 0);
+    dependencies[0].srcAccessMask       = headless ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
+    dependencies[0].dstStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    /* headless copies the image out after the pass */
+    dependencies[1].srcSubpass    = 0;
+    dependencies[1].dstSubpass    = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -448,8 +636,8 @@ static void createRenderPass()
     renderPassInfo.pAttachments           = &colorAttachment;
     renderPassInfo.subpassCount           = 1;
     renderPassInfo.pSubpasses             = &subpass;
-    renderPassInfo.pDependencies          = &dependency;
-    renderPassInfo.dependencyCount        = 1;
+    renderPassInfo.pDependencies          = dependencies;
+    renderPassInfo.dependencyCount        = headless ? 2 : 1;
 
     if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
     {
@@ -459,11 +647,19 @@ static void createRenderPass()
 
 void createGraphicsPipeline()
 {
-    auto vertShaderCode = readFile("shaders/vert.spv");
-    auto fragShaderCode = readFile("shaders/frag.spv");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    /* meshes take position and normal from vertex buffers and a transform per draw, the triangle is built into its shader */
+    bool bMeshes = !modelFiles.empty();
+
+    /* the driver copies the words while creating the modules, the mappings go right after */
+    MappedFile vertShaderCode = mapFile(bMeshes ? "shaders/model_vert.spv" : "shaders/vert.spv");
+    MappedFile fragShaderCode = mapFile("shaders/frag.spv");
 
     VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
     VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    unmapFile(vertShaderCode);
+    unmapFile(fragShaderCode);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -479,10 +675,27 @@ void createGraphicsPipeline()
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
+    VkVertexInputBindingDescription bindingDescription = {};
+    bindingDescription.binding                         = 0;
+    bindingDescription.stride                          = MODEL_VERTEX_SIZE;
+    bindingDescription.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription attributeDescriptions[2] = {};
+    attributeDescriptions[0].location                          = 0; // position
+    attributeDescriptions[0].binding                           = 0;
+    attributeDescriptions[0].format                            = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset                            = 0;
+    attributeDescriptions[1].location                          = 1; // normal
+    attributeDescriptions[1].binding                           = 0;
+    attributeDescriptions[1].format                            = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[1].offset                            = 3 * sizeof(float);
+
     VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
     vertexInputInfo.sType                                = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount        = 0;
-    vertexInputInfo.vertexAttributeDescriptionCount      = 0;
+    vertexInputInfo.vertexBindingDescriptionCount        = bMeshes ? 1 : 0;
+    vertexInputInfo.pVertexBindingDescriptions           = bMeshes ? &bindingDescription : nullptr;
+    vertexInputInfo.vertexAttributeDescriptionCount      = bMeshes ? 2 : 0;
+    vertexInputInfo.pVertexAttributeDescriptions         = bMeshes ? attributeDescriptions : nullptr;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
     inputAssembly.sType                                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -501,7 +714,7 @@ void createGraphicsPipeline()
     rasterizer.polygonMode                            = VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth                              = 1.0f;
     rasterizer.cullMode                               = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace                              = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.frontFace                              = bMeshes ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE; // meshes are wound for OpenGL
     rasterizer.depthBiasEnable                        = VK_FALSE;
 
     VkPipelineMultisampleStateCreateInfo multisampling = {};
@@ -533,7 +746,8 @@ void createGraphicsPipeline()
     dynamicState.pDynamicStates    = dynamicStates.data();
 
     pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount         = 0;
+    pipelineLayoutInfo.setLayoutCount         = bMeshes ? 1 : 0;
+    pipelineLayoutInfo.pSetLayouts            = bMeshes ? &descriptorSetLayout : nullptr;
     pipelineLayoutInfo.pushConstantRangeCount = 0;
 
     if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
@@ -557,13 +771,518 @@ void createGraphicsPipeline()
     pipelineInfo.subpass                      = 0;
     pipelineInfo.basePipelineHandle           = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
     vkDestroyShaderModule(device, fragShaderModule, nullptr);
     vkDestroyShaderModule(device, vertShaderModule, nullptr);
+
+    std::cout << "graphics pipeline created in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+              << " ms\n";
+}
+
+static void createDescriptors(size_t nDraws)
+{
+    /* one dynamic uniform buffer, every draw passes the offset of its transform in the frame's region */
+    linearInitialize(uniformAllocator, device, physicalDevice, (VkDeviceSize)nDraws * UNIFORM_SLOT_SIZE, framesInFlight,
+                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding                      = 0;
+    binding.descriptorType               = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount              = 1;
+    binding.stageFlags                   = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType                           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount                    = 1;
+    layoutInfo.pBindings                       = &binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize = {};
+    poolSize.type                 = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount      = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets                    = 1;
+    poolInfo.poolSizeCount              = 1;
+    poolInfo.pPoolSizes                 = &poolSize;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool              = descriptorPool;
+    allocInfo.descriptorSetCount          = 1;
+    allocInfo.pSetLayouts                 = &descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor set!");
+    }
+
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer                 = uniformAllocator.buffer;
+    bufferInfo.offset                 = 0;
+    bufferInfo.range                  = 16 * sizeof(float); // mat4 mvp
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet               = descriptorSet;
+    descriptorWrite.dstBinding           = 0;
+    descriptorWrite.descriptorCount      = 1;
+    descriptorWrite.descriptorType       = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.pBufferInfo          = &bufferInfo;
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+/*
+ * .model files as written by exportModel: header (name, vertex count, index count), uint32_t indices, then vertices.
+ * The file is mapped and copied straight into the staging buffer, all meshes go up in one batch.
+ */
+static void loadModels()
+{
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    buddyInitialize(meshAllocator, device, physicalDevice);
+
+    StagingUploader uploader;
+    stagingInitialize(uploader, device, physicalDevice, indices.graphicsFamily.value(), graphicsQueue, indices.transferFamily.value(), transferQueue);
+
+    const size_t headerSize = MODEL_NAME_SIZE + 2U * sizeof(uint32_t);
+    for (const std::string &path : modelFiles)
+    {
+        MappedFile file = mapFile(path.c_str());
+        if (nullptr == file.data || headerSize > file.size)
+        {
+            std::cerr << "failed to load model " << path << "\n";
+            unmapFile(file);
+            continue;
+        }
+
+        const uint8_t *pBytes    = static_cast<const uint8_t *>(file.data);
+        uint32_t       nVertices = 0U, nIndices = 0U;
+        memcpy(&nVertices, pBytes + MODEL_NAME_SIZE, sizeof(uint32_t));
+        memcpy(&nIndices, pBytes + MODEL_NAME_SIZE + sizeof(uint32_t), sizeof(uint32_t));
+
+        VkDeviceSize indexSize  = (VkDeviceSize)nIndices * sizeof(uint32_t);
+        VkDeviceSize vertexSize = (VkDeviceSize)nVertices * MODEL_VERTEX_SIZE;
+        if (0U == nIndices || 0U == nVertices || headerSize + indexSize + vertexSize > file.size)
+        {
+            std::cerr << "model " << path << " is truncated\n";
+            unmapFile(file);
+            continue;
+        }
+
+        /* the header keeps both arrays 4 byte aligned in the mapping */
+        const uint32_t *pIndices  = reinterpret_cast<const uint32_t *>(pBytes + headerSize);
+        const float    *pVertices = reinterpret_cast<const float *>(pBytes + headerSize + indexSize);
+
+        /* an index past the vertices would read outside the buffer on the GPU */
+        if (*std::max_element(pIndices, pIndices + nIndices) >= nVertices)
+        {
+            std::cerr << "model " << path << " has indices past its vertices\n";
+            unmapFile(file);
+            continue;
+        }
+
+        ModelMesh mesh = {};
+        mesh.nIndices  = nIndices;
+
+        float boundsMin[3] = {pVertices[0], pVertices[1], pVertices[2]};
+        float boundsMax[3] = {pVertices[0], pVertices[1], pVertices[2]};
+        for (uint32_t v = 1U; v < nVertices; v++)
+        {
+            const float *pPosition = pVertices + v * (MODEL_VERTEX_SIZE / sizeof(float));
+            for (int axis = 0; axis < 3; axis++)
+            {
+                boundsMin[axis] = std::min(boundsMin[axis], pPosition[axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], pPosition[axis]);
+            }
+        }
+        float halfDiagonal = 0.0f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            mesh.center[axis] = 0.5f * (boundsMin[axis] + boundsMax[axis]);
+            halfDiagonal += 0.25f * (boundsMax[axis] - boundsMin[axis]) * (boundsMax[axis] - boundsMin[axis]);
+        }
+        mesh.radius = std::max(sqrtf(halfDiagonal), 1e-6f);
+
+        mesh.vertexBuffer = createBuffer(meshAllocator, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.vertexAllocation);
+        mesh.indexBuffer  = createBuffer(meshAllocator, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.indexAllocation);
+
+        stagingUpload(uploader, mesh.vertexBuffer, 0, pVertices, vertexSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        stagingUpload(uploader, mesh.indexBuffer, 0, pIndices, indexSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+        unmapFile(file);
+
+        meshes.push_back(mesh);
+    }
+
+    stagingFlush(uploader);
+    std::cout << meshes.size() << " meshes, " << meshAllocator.bytesInUse / 1024U << " KiB in " << meshAllocator.blocks.size()
+              << " device memory blocks, uploaded in " << uploader.nSubmits << " submissions on the "
+              << ((indices.transferFamily != indices.graphicsFamily) ? "transfer" : "graphics") << " queue\n";
+    stagingUninitialize(uploader);
+}
+
+static void multiplyMatrix(float result[16], const float left[16], const float right[16])
+{
+    /* column major, result = left * right */
+    float product[16];
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            product[column * 4 + row] = left[0 * 4 + row] * right[column * 4 + 0] + left[1 * 4 + row] * right[column * 4 + 1] +
+                                        left[2 * 4 + row] * right[column * 4 + 2] + left[3 * 4 + row] * right[column * 4 + 3];
+        }
+    }
+    memcpy(result, product, sizeof(product));
+}
+
+/*
+ * Without an object count every mesh is drawn once, side by side in a row.
+ * With one the meshes fill a square grid in equal runs, so neighbouring draws share their vertex and index buffers.
+ */
+static void createInstances(uint32_t nObjects)
+{
+    instances.clear();
+    if (meshes.empty())
+        return;
+
+    if (0U == nObjects)
+    {
+        const float spacing = 2.5f;
+        for (uint32_t i = 0U; i < meshes.size(); i++)
+        {
+            MeshInstance instance = {};
+            instance.mesh         = i;
+            instance.position[0]  = spacing * ((float)i - 0.5f * (float)(meshes.size() - 1U));
+            instance.scale        = 1.0f / meshes[i].radius;
+            instances.push_back(instance);
+        }
+        sceneHalfWidth  = 0.5f * spacing * (float)meshes.size();
+        sceneHalfHeight = 0.0f;
+        return;
+    }
+
+    const uint32_t side    = (uint32_t)ceil(sqrt((double)nObjects));
+    const float    spacing = 1.0f;
+    instances.resize(nObjects);
+    for (uint32_t i = 0U; i < nObjects; i++)
+    {
+        MeshInstance &instance = instances[i];
+        instance.mesh          = (uint32_t)((uint64_t)i * meshes.size() / nObjects);
+        instance.position[0]   = spacing * ((float)(i % side) - 0.5f * (float)(side - 1U));
+        instance.position[1]   = spacing * ((float)(i / side) - 0.5f * (float)(side - 1U));
+        instance.scale         = 0.4f / meshes[instance.mesh].radius;
+        instance.phase         = 0.1f * (float)(i % 63U);
+    }
+    sceneHalfWidth  = 0.5f * spacing * (float)side;
+    sceneHalfHeight = sceneHalfWidth;
+}
+
+static void createRecordPools()
+{
+    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+    /* a pool belongs to one thread and one frame in flight, recording needs no lock and a reset frees a frame at once */
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex        = queueFamilyIndices.graphicsFamily.value();
+
+    recordPools.resize(framesInFlight * recordThreads);
+    recordBuffers.resize(recordPools.size());
+    recordUsed.resize(recordPools.size());
+    for (VkCommandPool &pool : recordPools)
+    {
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create command pool!");
+        }
+    }
+
+    jobsInitialize(recordJobs, recordThreads);
+}
+
+/* per-frame inputs of recordDraws, read by every recording thread */
+struct DrawFrame
+{
+    float        viewProjection[16];
+    float        angle;
+    uint8_t     *pTransforms; // mapped transform of the first instance
+    VkDeviceSize offset;      // of the first transform in the uniform buffer
+    VkDeviceSize stride;
+};
+
+/* secondary command buffers inherit nothing but the render pass, each sets up the pipeline state again */
+static void bindDrawState(VkCommandBuffer commandBuffer)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+
+    VkViewport viewport = {};
+    viewport.x          = 0.0f;
+    viewport.y          = 0.0f;
+    viewport.width      = (float)swapChainExtent.width;
+    viewport.height     = (float)swapChainExtent.height;
+    viewport.minDepth   = 0.0f;
+    viewport.maxDepth   = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset   = {0, 0};
+    scissor.extent   = swapChainExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+/* writes the transforms of instances [first, first + count) and records their draws, touches no shared state */
+static void recordDraws(VkCommandBuffer commandBuffer, const DrawFrame &frame, uint32_t first, uint32_t count)
+{
+    const ModelMesh *pBound    = nullptr;
+    VkDeviceSize     offsets[] = {0};
+    const float      tilt      = 0.4f;
+    const float      sinX = sinf(tilt), cosX = cosf(tilt);
+
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const MeshInstance &instance = instances[i];
+        const ModelMesh    &mesh     = meshes[instance.mesh];
+
+        /* turn around y, tilted towards the camera */
+        const float angle = frame.angle + instance.phase;
+        const float sinY = sinf(angle), cosY = cosf(angle);
+        const float rotation[9] = {cosY, sinX * sinY, -cosX * sinY, 0.0f, cosX, sinX, sinY, -sinX * cosY, cosX * cosY}; // columns of Rx * Ry
+
+        /* translate(position) * rotation * scale * translate(-center) */
+        float model[16] = {};
+        for (int column = 0; column < 3; column++)
+        {
+            for (int row = 0; row < 3; row++)
+            {
+                model[column * 4 + row] = rotation[column * 3 + row] * instance.scale;
+            }
+        }
+        for (int row = 0; row < 3; row++)
+        {
+            model[12 + row] = instance.position[row] -
+                              (model[row] * mesh.center[0] + model[4 + row] * mesh.center[1] + model[8 + row] * mesh.center[2]);
+        }
+        model[15] = 1.0f;
+
+        float *pMvp = reinterpret_cast<float *>(frame.pTransforms + (VkDeviceSize)i * frame.stride);
+        multiplyMatrix(pMvp, frame.viewProjection, model);
+
+        uint32_t dynamicOffset = static_cast<uint32_t>(frame.offset + (VkDeviceSize)i * frame.stride);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+        if (&mesh != pBound)
+        {
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer, offsets);
+            vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+            pBound = &mesh;
+        }
+        vkCmdDrawIndexed(commandBuffer, mesh.nIndices, 1, 0, 0, 0);
+    }
+}
+
+static void drawMeshes(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    /* the fence of this frame in flight signalled, its region of the uniform buffer is free again */
+    linearBegin(uniformAllocator, currentFrame);
+
+    /* instances scaled to a unit sphere or smaller and turning, camera far enough back to see all of them */
+    const float fovY     = 45.0f * (float)M_PI / 180.0f;
+    const float aspect   = (float)swapChainExtent.width / (float)swapChainExtent.height;
+    const float distance = std::max(4.0f, std::max(sceneHalfWidth / (tanf(0.5f * fovY) * aspect), sceneHalfHeight / tanf(0.5f * fovY)) + 2.0f);
+    const float zNear    = 0.1f;
+    const float zFar     = distance + 2.0f;
+
+    /* Vulkan clip space: y points down, depth 0 to 1 */
+    float f              = 1.0f / tanf(0.5f * fovY);
+    float projection[16] = {};
+    projection[0]        = f / aspect;
+    projection[5]        = -f;
+    projection[10]       = zFar / (zNear - zFar);
+    projection[11]       = -1.0f;
+    projection[14]       = zNear * zFar / (zNear - zFar);
+
+    DrawFrame frame    = {};
+    float     view[16] = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -distance, 1.0f};
+    multiplyMatrix(frame.viewProjection, projection, view);
+    frame.angle = 0.01f * (float)frameCount;
+
+    /* one range for all transforms, the threads write theirs without going through the allocator */
+    const uint32_t nInstances = static_cast<uint32_t>(instances.size());
+    if (0U == nInstances)
+        return;
+    const VkDeviceSize transformSize = 16 * sizeof(float);
+    frame.stride      = (transformSize + uniformAllocator.alignment - 1U) / uniformAllocator.alignment * uniformAllocator.alignment;
+    frame.pTransforms = static_cast<uint8_t *>(linearAllocate(uniformAllocator, (VkDeviceSize)nInstances * frame.stride, frame.offset));
+
+    if (recordPools.empty())
+    {
+        bindDrawState(commandBuffer);
+        recordDraws(commandBuffer, frame, 0U, nInstances);
+    }
+    else
+    {
+        /* the fence also retired the secondaries recorded into this frame's pools */
+        for (uint32_t thread = 0U; thread < recordThreads; thread++)
+        {
+            uint32_t pool = currentFrame * recordThreads + thread;
+            vkResetCommandPool(device, recordPools[pool], 0);
+            recordUsed[pool] = 0U;
+        }
+
+        uint32_t nJobs = std::clamp((nInstances + DRAWS_PER_JOB_MIN - 1U) / DRAWS_PER_JOB_MIN, 1U, recordThreads * JOBS_PER_THREAD);
+        secondaries.resize(nJobs);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo = {};
+        inheritanceInfo.sType                          = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass                     = renderPass;
+        inheritanceInfo.subpass                        = 0;
+        inheritanceInfo.framebuffer                    = swapChainFramebuffers[imageIndex];
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo         = &inheritanceInfo;
+
+        jobsRun(recordJobs, nJobs, [&](uint32_t job, uint32_t thread) {
+            uint32_t                      pool    = currentFrame * recordThreads + thread;
+            std::vector<VkCommandBuffer> &buffers = recordBuffers[pool];
+            if (recordUsed[pool] == buffers.size())
+            {
+                VkCommandBufferAllocateInfo allocInfo = {};
+                allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocInfo.commandPool                 = recordPools[pool];
+                allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+                allocInfo.commandBufferCount          = 1;
+
+                VkCommandBuffer secondary = VK_NULL_HANDLE;
+                if (vkAllocateCommandBuffers(device, &allocInfo, &secondary) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to allocate command buffers!");
+                }
+                buffers.push_back(secondary);
+            }
+            VkCommandBuffer secondary = buffers[recordUsed[pool]++];
+
+            if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to begin recording command buffer!");
+            }
+            bindDrawState(secondary);
+
+            uint32_t first = (uint32_t)((uint64_t)nInstances * job / nJobs);
+            uint32_t last  = (uint32_t)((uint64_t)nInstances * (job + 1U) / nJobs);
+            recordDraws(secondary, frame, first, last - first);
+
+            if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to record command buffer!");
+            }
+            secondaries[job] = secondary;
+        });
+
+        /* slices in instance order, the image is the same as recorded inline */
+        vkCmdExecuteCommands(commandBuffer, nJobs, secondaries.data());
+    }
+
+    linearFlush(uniformAllocator);
+}
+
+static void createPipelineCache()
+{
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    /*
+     * Drivers are required to reject data of another device or driver version, some crash on it instead.
+     * Only pass data on whose header matches this device, else start empty and overwrite the file on exit.
+     */
+    MappedFile file = mapFile(PIPELINE_CACHE_FILE);
+    bool       bValid = false;
+    if (nullptr != file.data && sizeof(VkPipelineCacheHeaderVersionOne) <= file.size)
+    {
+        VkPipelineCacheHeaderVersionOne header = {};
+        memcpy(&header, file.data, sizeof(header));
+        bValid = header.headerSize >= sizeof(header) && header.headerSize <= file.size && VK_PIPELINE_CACHE_HEADER_VERSION_ONE == header.headerVersion &&
+                 properties.vendorID == header.vendorID && properties.deviceID == header.deviceID &&
+                 0 == memcmp(properties.pipelineCacheUUID, header.pipelineCacheUUID, VK_UUID_SIZE);
+        if (bValid)
+        {
+            std::cout << "loaded " << file.size << " bytes of " << PIPELINE_CACHE_FILE << "\n";
+        }
+        else
+        {
+            std::cerr << PIPELINE_CACHE_FILE << " is from another device or driver, rebuilding pipelines\n";
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize           = bValid ? file.size : 0U;
+    createInfo.pInitialData              = bValid ? file.data : nullptr;
+
+    VkResult result = vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache);
+    if (VK_SUCCESS != result && bValid)
+    {
+        /* corrupt contents behind a valid header */
+        createInfo.initialDataSize = 0U;
+        createInfo.pInitialData    = nullptr;
+        result                     = vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache);
+    }
+    unmapFile(file);
+
+    if (VK_SUCCESS != result)
+    {
+        /* pipelines still build without a cache, only slower */
+        std::cerr << "failed to create pipeline cache\n";
+        pipelineCache = VK_NULL_HANDLE;
+    }
+}
+
+static void savePipelineCache()
+{
+    if (VK_NULL_HANDLE == pipelineCache)
+        return;
+
+    size_t size = 0U;
+    if (VK_SUCCESS != vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) || 0U == size)
+        return;
+
+    std::vector<char> data(size);
+    if (VK_SUCCESS != vkGetPipelineCacheData(device, pipelineCache, &size, data.data()))
+        return;
+
+    /* a crash while writing must not leave a truncated cache behind, write aside and rename */
+    const char *temporaryPath = PIPELINE_CACHE_FILE ".tmp";
+    FILE       *pFile         = fopen(temporaryPath, "wb");
+    if (nullptr == pFile)
+    {
+        std::cerr << "failed to write " << PIPELINE_CACHE_FILE << "\n";
+        return;
+    }
+
+    bool bWritten = (size == fwrite(data.data(), 1, size, pFile));
+    bWritten      = (0 == fclose(pFile)) && bWritten;
+    if (!bWritten || 0 != rename(temporaryPath, PIPELINE_CACHE_FILE))
+    {
+        std::cerr << "failed to write " << PIPELINE_CACHE_FILE << "\n";
+        remove(temporaryPath);
+    }
 }
 
 void createFramebuffers()
@@ -605,21 +1324,23 @@ void createCommandPool()
     }
 }
 
-void createCommandBuffer()
+void createCommandBuffers()
 {
+    commandBuffers.resize(framesInFlight);
+
     VkCommandBufferAllocateInfo allocInfo = {};
     allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool                 = commandPool;
     allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount          = 1;
+    allocInfo.commandBufferCount          = static_cast<uint32_t>(commandBuffers.size());
 
-    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to allocate command buffers!");
     }
 }
 
-void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool bCopy = false)
 {
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -629,6 +1350,14 @@ void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
         throw std::runtime_error("failed to begin recording command buffer!");
     }
 
+    /* timestamps before the render pass, after it and after the copy, in the queries of this frame in flight */
+    uint32_t firstQuery = currentFrame * HEADLESS_TIMESTAMPS;
+    if (VK_NULL_HANDLE != queryPool)
+    {
+        vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery, HEADLESS_TIMESTAMPS);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, firstQuery);
+    }
+
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass            = renderPass;
@@ -640,27 +1369,59 @@ void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
     renderPassInfo.clearValueCount = 1;
     renderPassInfo.pClearValues    = &clearColor;
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    /* with recording threads the primary only executes their secondary command buffers inside the render pass */
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, recordPools.empty() ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    if (modelFiles.empty())
+    {
+        bindDrawState(commandBuffer);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    }
+    else
+    {
+        std::chrono::steady_clock::time_point recordStart = std::chrono::steady_clock::now();
+        drawMeshes(commandBuffer, imageIndex);
+        recordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+    }
 
-    VkViewport viewport = {};
-    viewport.x          = 0.0f;
-    viewport.y          = 0.0f;
-    viewport.width      = (float)swapChainExtent.width;
-    viewport.height     = (float)swapChainExtent.height;
-    viewport.minDepth   = 0.0f;
-    viewport.maxDepth   = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdEndRenderPass(commandBuffer);
 
-    VkRect2D scissor = {};
-    scissor.offset   = {0, 0};
-    scissor.extent   = swapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    if (VK_NULL_HANDLE != queryPool)
+    {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, firstQuery + 1U);
+    }
 
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    /* the render pass left the image in TRANSFER_SRC_OPTIMAL and made its writes visible to transfers */
+    if (bCopy)
+    {
+        VkBufferImageCopy region               = {};
+        region.bufferOffset                    = 0;
+        region.bufferRowLength                 = 0; // tightly packed
+        region.bufferImageHeight               = 0;
+        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageOffset                     = {0, 0, 0};
+        region.imageExtent                     = {swapChainExtent.width, swapChainExtent.height, 1};
+        vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType                 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask         = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask         = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer                = readbackBuffer;
+        barrier.offset                = 0;
+        barrier.size                  = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
 
-    vkCmdEndRenderPass(commandBuffer);
+    if (VK_NULL_HANDLE != queryPool)
+    {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, firstQuery + 2U);
+    }
 
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
     {
@@ -670,36 +1431,163 @@ void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 
 void createSyncObjects()
 {
+    imageAvailableSemaphores.resize(framesInFlight);
+    inFlightFences.resize(framesInFlight);
+
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
+    /* signalled, the first wait on each frame returns at once */
     VkFenceCreateInfo fenceInfo = {};
     fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags             = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-        vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
-        vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS)
+    for (uint32_t i = 0U; i < framesInFlight; i++)
     {
-        throw std::runtime_error("failed to create synchronization objects for a frame!");
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        }
     }
 }
 
+void createPresentSemaphores()
+{
+    renderFinishedSemaphores.resize(swapChainImages.size());
+    imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (size_t i = 0; i < swapChainImages.size(); i++)
+    {
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create synchronization objects for a swap chain image!");
+        }
+    }
+}
+
+void cleanupSwapChain()
+{
+    for (auto semaphore : renderFinishedSemaphores)
+    {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+    renderFinishedSemaphores.clear();
+    imagesInFlight.clear();
+
+    for (auto framebuffer : swapChainFramebuffers)
+    {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    swapChainFramebuffers.clear();
+
+    for (auto imageView : swapChainImageViews)
+    {
+        vkDestroyImageView(device, imageView, nullptr);
+    }
+    swapChainImageViews.clear();
+
+    if (headless)
+    {
+        for (auto image : swapChainImages)
+        {
+            vkDestroyImage(device, image, nullptr);
+        }
+        vkFreeMemory(device, offscreenMemory, nullptr);
+        offscreenMemory = VK_NULL_HANDLE;
+    }
+    else
+    {
+        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        swapChain = VK_NULL_HANDLE;
+    }
+    swapChainImages.clear();
+}
+
+void recreateSwapChain()
+{
+    /* a minimized window has no extent, keep the old swap chain until it is restored */
+    VkSurfaceCapabilitiesKHR capabilities = {};
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &capabilities);
+    if (0U == capabilities.currentExtent.width || 0U == capabilities.currentExtent.height)
+    {
+        swapChainSuspended = true;
+        return;
+    }
+
+    /* frames in flight still render to the old images, the format and so the render pass and pipeline stay */
+    vkDeviceWaitIdle(device);
+
+    cleanupSwapChain();
+    createSwapChain();
+    createImageViews();
+    createFramebuffers();
+    createPresentSemaphores();
+
+    framebufferResized = false;
+    swapChainSuspended = false;
+}
+
+void onWindowResize(int width, int height)
+{
+    /* the next drawFrame recreates the swap chain, drivers do not always report VK_ERROR_OUT_OF_DATE_KHR */
+    if (0 < width && 0 < height && (static_cast<uint32_t>(width) != swapChainExtent.width || static_cast<uint32_t>(height) != swapChainExtent.height))
+    {
+        framebufferResized = true;
+    }
+    /* a restored window may come back at its old size, let the next drawFrame try again */
+    if (0 < width && 0 < height)
+    {
+        swapChainSuspended = false;
+    }
+}
+
+bool isSwapChainSuspended()
+{
+    return swapChainSuspended;
+}
+
 void drawFrame()
 {
-    vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(device, 1, &inFlightFence);
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+    /* only the submission framesInFlight frames ago has to be done, the newer ones keep the GPU busy */
+    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
     uint32_t imageIndex;
-    vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    if (VK_ERROR_OUT_OF_DATE_KHR == result)
+    {
+        recreateSwapChain();
+        return;
+    }
+    else if (VK_SUCCESS != result && VK_SUBOPTIMAL_KHR != result)
+    {
+        throw std::runtime_error("failed to acquire swap chain image!");
+    }
+
+    /* images may come back out of order, one still rendered by another frame in flight has to finish first */
+    if (VK_NULL_HANDLE != imagesInFlight[imageIndex] && inFlightFences[currentFrame] != imagesInFlight[imageIndex])
+    {
+        vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+    }
+    imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+    fenceWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
 
+    /* reset only once a submission is certain, an early return above must not leave the fence unsignalled */
+    vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+    VkCommandBuffer commandBuffer = commandBuffers[currentFrame];
     vkResetCommandBuffer(commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
     recordCommandBuffer(commandBuffer, imageIndex);
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType        = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore          waitSemaphores[] = {imageAvailableSemaphore};
+    VkSemaphore          waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
     VkPipelineStageFlags waitStages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
     submitInfo.waitSemaphoreCount         = 1;
     submitInfo.pWaitSemaphores            = waitSemaphores;
@@ -708,11 +1596,11 @@ void drawFrame()
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers    = &commandBuffer;
 
-    VkSemaphore signalSemaphores[]  = {renderFinishedSemaphore};
+    VkSemaphore signalSemaphores[]  = {renderFinishedSemaphores[imageIndex]};
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores    = signalSemaphores;
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS)
+    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
@@ -729,15 +1617,353 @@ void drawFrame()
 
     presentInfo.pImageIndices = &imageIndex;
 
-    vkQueuePresentKHR(presentQueue, &presentInfo);
+    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    if (VK_ERROR_OUT_OF_DATE_KHR == result || VK_SUBOPTIMAL_KHR == result || framebufferResized)
+    {
+        recreateSwapChain();
+    }
+    else if (VK_SUCCESS != result)
+    {
+        throw std::runtime_error("failed to present swap chain image!");
+    }
+
+    currentFrame = (currentFrame + 1U) % framesInFlight;
+
+    std::chrono::steady_clock::time_point frameEnd = std::chrono::steady_clock::now();
+    if (0U < frameCount)
+    {
+        frameTimeMs += std::chrono::duration<double, std::milli>(frameEnd - lastFrameTime).count();
+    }
+    lastFrameTime = frameEnd;
+    frameCount++;
+}
+
+static uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    return findMemoryTypeIndex(memoryProperties, typeFilter, properties);
 }
 
-VkShaderModule createShaderModule(const std::vector<char> &code)
+static void createOffscreenImage(uint32_t width, uint32_t height)
 {
+    /* stands in for the swap chain, same sRGB encoding as the window surface prefers */
+    swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    swapChainExtent      = {width, height};
+    swapChainImages.resize(1);
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+    imageInfo.format            = swapChainImageFormat;
+    imageInfo.extent            = {width, height, 1};
+    imageInfo.mipLevels         = 1;
+    imageInfo.arrayLayers       = 1;
+    imageInfo.samples           = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage             = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &swapChainImages[0]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create offscreen image!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(device, swapChainImages[0], &memoryRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize       = memoryRequirements.size;
+    allocInfo.memoryTypeIndex      = findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &offscreenMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate offscreen image memory!");
+    }
+    vkBindImageMemory(device, swapChainImages[0], offscreenMemory, 0);
+}
+
+static void createHeadlessResources()
+{
+    /* RGBA8 rows without padding, as the PNG writer takes them */
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size               = (VkDeviceSize)swapChainExtent.width * swapChainExtent.height * 4U;
+    bufferInfo.usage              = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &readbackBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create readback buffer!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, readbackBuffer, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize       = memoryRequirements.size;
+    allocInfo.memoryTypeIndex      = findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &readbackMemory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate readback buffer memory!");
+    }
+    vkBindBufferMemory(device, readbackBuffer, readbackMemory, 0);
+
+    /* timestamps are optional, without them only CPU times are reported */
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t qFamilyCount = 0U;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &qFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(qFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &qFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[findQueueFamilies(physicalDevice).graphicsFamily.value()].timestampValidBits;
+    if (0U == validBits)
+    {
+        std::cerr << "graphics queue has no timestamps, GPU times are not measured\n";
+        return;
+    }
+    timestampPeriod = (double)properties.limits.timestampPeriod;
+    timestampMask   = (64U <= validBits) ? UINT64_MAX : ((1ULL << validBits) - 1ULL);
+
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount            = framesInFlight * HEADLESS_TIMESTAMPS;
+
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        std::cerr << "failed to create timestamp query pool, GPU times are not measured\n";
+        queryPool = VK_NULL_HANDLE;
+    }
+    queriesPending.assign(framesInFlight, false);
+    copyPending.assign(framesInFlight, false);
+}
+
+/* GPU times of a frame in flight once its fence signalled */
+static void collectTimestamps(uint32_t frame)
+{
+    if (VK_NULL_HANDLE == queryPool || !queriesPending[frame])
+        return;
+
+    uint64_t timestamps[HEADLESS_TIMESTAMPS];
+    if (VK_SUCCESS == vkGetQueryPoolResults(device, queryPool, frame * HEADLESS_TIMESTAMPS, HEADLESS_TIMESTAMPS, sizeof(timestamps), timestamps,
+                                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT))
+    {
+        double msPerTick = timestampPeriod / 1000000.0;
+        renderPassMs += (double)((timestamps[1] - timestamps[0]) & timestampMask) * msPerTick;
+        nTimedFrames++;
+        if (copyPending[frame])
+        {
+            copyMs += (double)((timestamps[2] - timestamps[1]) & timestampMask) * msPerTick;
+            nTimedCopies++;
+        }
+    }
+    queriesPending[frame] = false;
+}
+
+static void drawFrameHeadless(bool bCopy)
+{
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+    /* no acquire and present, the fence of the frame in flight is the only wait */
+    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    fenceWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    collectTimestamps(currentFrame);
+    vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+    VkCommandBuffer commandBuffer = commandBuffers[currentFrame];
+    vkResetCommandBuffer(commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
+    recordCommandBuffer(commandBuffer, 0U, bCopy);
+
+    VkSubmitInfo submitInfo       = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &commandBuffer;
+
+    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit draw command buffer!");
+    }
+    if (VK_NULL_HANDLE != queryPool)
+    {
+        queriesPending[currentFrame] = true;
+        copyPending[currentFrame]    = bCopy;
+    }
+
+    currentFrame = (currentFrame + 1U) % framesInFlight;
+
+    std::chrono::steady_clock::time_point frameEnd = std::chrono::steady_clock::now();
+    if (0U < frameCount)
+    {
+        frameTimeMs += std::chrono::duration<double, std::milli>(frameEnd - lastFrameTime).count();
+    }
+    lastFrameTime = frameEnd;
+    frameCount++;
+}
+
+int runHeadless(uint32_t nFrames, const char *pOutput, uint32_t nFramesInFlight, const RenderOptions &options)
+{
+    headless = true;
+    if (0 != initVulkan(nFramesInFlight, options))
+    {
+        return (-1);
+    }
+
+    /* only the last frame is copied out, the others measure rendering alone */
+    for (uint32_t frame = 0U; frame < nFrames; frame++)
+    {
+        drawFrameHeadless(nullptr != pOutput && frame + 1U == nFrames);
+    }
+    vkDeviceWaitIdle(device);
+    for (uint32_t frame = 0U; frame < framesInFlight; frame++)
+    {
+        collectTimestamps(frame);
+    }
+
+    if (0U < nTimedFrames)
+    {
+        std::cout << "GPU ms per frame: render pass " << renderPassMs / (double)nTimedFrames;
+        if (0U < nTimedCopies)
+        {
+            std::cout << ", copy " << copyMs / (double)nTimedCopies;
+        }
+        std::cout << " (" << nTimedFrames << " frames timed)\n";
+    }
+
+    int result = 0;
+    if (nullptr != pOutput && 0U < nFrames)
+    {
+        void *pPixels = nullptr;
+        vkMapMemory(device, readbackMemory, 0, VK_WHOLE_SIZE, 0, &pPixels);
+        result = writePng(pOutput, swapChainExtent.width, swapChainExtent.height, static_cast<const uint8_t *>(pPixels));
+        vkUnmapMemory(device, readbackMemory);
+    }
+
+    cleanUp();
+    return result;
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *pData, size_t size)
+{
+    static uint32_t table[256];
+    if (0U == table[1])
+    {
+        for (uint32_t n = 0U; n < 256U; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1U) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ pData[i]) & 0xFFU] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void appendBigEndian(std::vector<uint8_t> &bytes, uint32_t value)
+{
+    bytes.push_back((uint8_t)(value >> 24));
+    bytes.push_back((uint8_t)(value >> 16));
+    bytes.push_back((uint8_t)(value >> 8));
+    bytes.push_back((uint8_t)value);
+}
+
+static void appendChunk(std::vector<uint8_t> &png, const char type[4], const std::vector<uint8_t> &data)
+{
+    appendBigEndian(png, (uint32_t)data.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    appendBigEndian(png, crc32(0U, png.data() + start, png.size() - start));
+}
+
+/*
+ * RGBA8 PNG with stored (uncompressed) deflate blocks: a frame is written once per run,
+ * so size does not matter and no zlib is needed on the servers this runs on.
+ */
+static int writePng(const char *filename, uint32_t width, uint32_t height, const uint8_t *pRgba)
+{
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0}); // 8 bits, RGBA, deflate, adaptive filter, no interlace
+
+    /* filter type 0 in front of every row */
+    size_t               rowSize = (size_t)width * 4U;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1U) * height);
+    for (uint32_t y = 0U; y < height; y++)
+    {
+        raw.push_back(0U);
+        raw.insert(raw.end(), pRgba + y * rowSize, pRgba + (y + 1U) * rowSize);
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for (size_t offset = 0U; offset < raw.size(); offset += 65535U)
+    {
+        size_t blockSize = std::min(raw.size() - offset, (size_t)65535U);
+        zlib.push_back((offset + blockSize == raw.size()) ? 1U : 0U); // last block flag, stored
+        zlib.push_back((uint8_t)blockSize);
+        zlib.push_back((uint8_t)(blockSize >> 8));
+        zlib.push_back((uint8_t)~blockSize);
+        zlib.push_back((uint8_t)(~blockSize >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+    }
+
+    uint32_t a = 1U, b = 0U;
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521U;
+        b = (b + a) % 65521U;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+
+    FILE *pFile = fopen(filename, "wb");
+    if (nullptr == pFile)
+    {
+        std::cerr << "failed to open " << filename << "\n";
+        return (-1);
+    }
+    bool bWritten = (png.size() == fwrite(png.data(), 1, png.size(), pFile));
+    bWritten      = (0 == fclose(pFile)) && bWritten;
+    if (!bWritten)
+    {
+        std::cerr << "failed to write " << filename << "\n";
+        return (-1);
+    }
+    return (0);
+}
+
+VkShaderModule createShaderModule(const MappedFile &code)
+{
+    if (nullptr == code.data || 0U != code.size % sizeof(uint32_t))
+    {
+        throw std::runtime_error("failed to load shader code!");
+    }
+
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode    = reinterpret_cast<const uint32_t *>(code.data());
+    createInfo.codeSize = code.size;
+    createInfo.pCode    = static_cast<const uint32_t *>(code.data);
 
     VkShaderModule shaderModule;
     if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
@@ -823,8 +2049,13 @@ SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device)
 
 bool isDeviceSuitable(VkPhysicalDevice device)
 {
-    QueueFamilyIndices indices              = findQueueFamilies(device);
-    bool               isExtensionSupported = checkDeviceExtensionSupport(device);
+    QueueFamilyIndices indices = findQueueFamilies(device);
+    if (headless)
+    {
+        return indices.isComplete();
+    }
+
+    bool isExtensionSupported = checkDeviceExtensionSupport(device);
 
     bool swapChainAdequate = false;
     if (isExtensionSupported)
@@ -872,8 +2103,12 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device)
             indices.graphicsFamily = i;
         }
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        /* nothing is presented headless, the graphics queue stands in */
+        VkBool32 presentSupport = headless && indices.graphicsFamily.has_value();
+        if (!headless)
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        }
 
         if (presentSupport)
         {
@@ -888,6 +2123,21 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device)
         i++;
     }
 
+    /* a family with transfers only is usually a copy engine that runs alongside rendering */
+    for (uint32_t family = 0U; family < qFamilyCount; family++)
+    {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+        {
+            indices.transferFamily = family;
+            break;
+        }
+    }
+    if (!indices.transferFamily.has_value())
+    {
+        indices.transferFamily = indices.graphicsFamily;
+    }
+
     return indices;
 }
 
@@ -929,24 +2179,38 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityF
     return VK_FALSE;
 }
 
-static std::vector<char> readFile(const char *filename)
+/* whole file read only, data is nullptr if it is missing or empty */
+static MappedFile mapFile(const char *filename)
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    MappedFile  file = {};
+    struct stat st   = {};
 
-    if (!file.is_open())
+    int fd = open(filename, O_RDONLY);
+    if (-1 == fd)
+        return file;
+
+    if (0 == fstat(fd, &st) && 0 < st.st_size)
     {
-        throw std::runtime_error("failed to open file!");
+        void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED != data)
+        {
+            file.data = data;
+            file.size = (size_t)st.st_size;
+        }
     }
 
-    size_t            fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
+    /* the mapping keeps the file alive */
+    close(fd);
+    return file;
+}
 
-    return buffer;
+static void unmapFile(MappedFile &file)
+{
+    if (nullptr != file.data)
+    {
+        munmap(const_cast<void *>(file.data), file.size);
+    }
+    file = {};
 }
 
 /*--- temp ---*/
@@ -2,10 +2,13 @@
 
 #include <X11/Xlib.h>
 #include <optional>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_xlib.h>
 
+#include "allocator.h"
+
 extern Display *dpy;
 extern Window   w;
 
@@ -13,6 +16,7 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> transferFamily; // transfer only family if the device has one, else the graphics family
 
     bool isComplete()
     {
@@ -24,7 +28,51 @@ struct SwapChainSupportDetails {
     std::vector<VkSurfaceFormatKHR> formats;
     std::vector<VkPresentModeKHR> presentModes;
 };
-int initVulkan();
+struct MappedFile {
+    const void *data = nullptr; // page aligned, so SPIR-V words can be read in place
+    size_t      size = 0U;
+};
+struct ModelMesh {
+    VkBuffer   vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer   indexBuffer  = VK_NULL_HANDLE;
+    Allocation vertexAllocation;
+    Allocation indexAllocation;
+    uint32_t   nIndices = 0U;
+    float      center[3] = {0.0f, 0.0f, 0.0f}; // of the bounding box, the mesh is drawn around it
+    float      radius    = 1.0f;
+};
+struct MeshInstance {
+    uint32_t mesh        = 0U;
+    float    position[3] = {0.0f, 0.0f, 0.0f};
+    float    scale       = 1.0f; // to the size of a unit sphere or smaller
+    float    phase       = 0.0f; // added to the rotation angle
+};
+struct RenderOptions {
+    std::vector<std::string> models;              // .model files drawn in place of the triangle
+    uint32_t                 nObjects       = 0U; // instances of the models in a grid, 0 draws each model once
+    uint32_t                 nRecordThreads = 0U; // threads recording secondary command buffers, 0 records into the primary
+};
+#define PIPELINE_CACHE_FILE "pipeline.cache" // VkPipelineCache data of the last run, next to the shaders
+
+#define DEFAULT_FRAMES_IN_FLIGHT 2U // frames recorded on the CPU while the GPU renders earlier ones
+#define MAX_FRAMES_IN_FLIGHT     8U
+
+#define MODEL_NAME_SIZE     20U // bytes of the name in the header of a .model file
+#define MODEL_VERTEX_SIZE   32U // position, normal, texel
+#define UNIFORM_SLOT_SIZE   256U // transform of a mesh rounded up to the largest minUniformBufferOffsetAlignment allowed
+
+#define MAX_RECORD_THREADS 64U
+#define DRAWS_PER_JOB_MIN  256U // fewer draws per secondary command buffer cost more in vkCmdExecuteCommands than they save
+#define JOBS_PER_THREAD    4U   // slices per recording thread, so a thread that started late still gets a share
+
+#define HEADLESS_WIDTH      800U
+#define HEADLESS_HEIGHT     600U
+#define HEADLESS_TIMESTAMPS 3U // per frame: before the render pass, after it, after the copy
+
+int initVulkan(uint32_t nFramesInFlight = DEFAULT_FRAMES_IN_FLIGHT, const RenderOptions &options = {});
+int runHeadless(uint32_t nFrames, const char *pOutput, uint32_t nFramesInFlight = DEFAULT_FRAMES_IN_FLIGHT, const RenderOptions &options = {});
 void drawFrame();
+void onWindowResize(int width, int height);
+bool isSwapChainSuspended(); // acquire reported out of date at a 0x0 extent, wait for a resize instead of drawing
 
 void cleanUp();
@@ -0,0 +1,15 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform Transform {
+    mat4 mvp;
+} transform;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    gl_Position = transform.mvp * vec4(inPosition, 1.0);
+    fragColor = inNormal * 0.5 + 0.5;
+}